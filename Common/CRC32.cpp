@@ -1,6 +1,7 @@
 //This file is based on the crc32 code from http://web.archive.org/web/20080303102530/http://c.snippets.org/snip_lister.php?fname=crc_32.c : (see copyright notice below)
 
 #include "CRC32.h"
+#include "platforms.h"
 
 /* Copyright (C) 1986 Gary S. Brown.  You may use this program, or
    code or tables extracted from it, as desired without restriction.*/
@@ -100,9 +101,54 @@ uint32_t updateCRC32(unsigned char ch, uint32_t crc){
 }
 
 uint32_t crc32buf(const char* buf, size_t len){
-	register uint32_t oldcrc32 = 0xFFFFFFFF;
+	return ~updateCRC32Buffer((const uint8_t*)buf, len, 0xFFFFFFFF);
+}
+
+#ifdef MICROCONTROLLER_PLATFORM
+
+uint32_t updateCRC32Buffer(const uint8_t* buf, size_t len, uint32_t crc){
 	for(; len>0; --len, ++buf){
-		oldcrc32 = UPDC32(*buf, oldcrc32);
+		crc = UPDC32(*buf, crc);
 	}
-	return ~oldcrc32;
+	return crc;
+}
+
+#else
+
+//! tables[0] is crc_32_tab, tables[k][i] is the crc of byte i followed by k zero bytes
+struct SlicingTables{
+	uint32_t tables[8][256];
+	SlicingTables(){
+		for(uint32_t i=0; i<256; i++){tables[0][i] = crc_32_tab[i];}
+		for(uint32_t k=1; k<8; k++){
+			for(uint32_t i=0; i<256; i++){
+				tables[k][i] = (tables[k-1][i] >> 8) ^ crc_32_tab[tables[k-1][i] & 0xff];
+			}
+		}
+	}
+};
+
+//! initialized on first use (safe during static initialization of other translation units)
+static const SlicingTables& getSlicingTables(){
+	static const SlicingTables slicingTables;
+	return slicingTables;
 }
+
+static inline uint32_t readUInt32LE(const uint8_t* p){
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+uint32_t updateCRC32Buffer(const uint8_t* buf, size_t len, uint32_t crc){
+	const uint32_t (*t)[256] = getSlicingTables().tables;
+	for(; len>=8; len-=8, buf+=8){
+		uint32_t lo = crc ^ readUInt32LE(buf);
+		uint32_t hi = readUInt32LE(buf+4);
+		crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^ t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^ t[3][hi & 0xff] ^ t[2][(hi >> 8) & 0xff] ^ t[1][(hi >> 16) & 0xff] ^ t[0][hi >> 24];
+	}
+	for(; len>0; --len, ++buf){
+		crc = UPDC32(*buf, crc);
+	}
+	return crc;
+}
+
+#endif
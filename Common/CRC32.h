@@ -14,4 +14,7 @@ uint32_t updateCRC32(unsigned char ch, uint32_t crc);
 
 uint32_t crc32buf(const char* buf, size_t len);
 
+//! same result as applying UPDC32 to each byte (no STARTCRC32/ENDCRC32), processes 8 bytes at a time (slicing by 8) except on microcontrollers (tables too large)
+uint32_t updateCRC32Buffer(const uint8_t* buf, size_t len, uint32_t crc);
+
 #endif
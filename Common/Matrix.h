@@ -9,8 +9,53 @@
 #include <ostream>
 #include <iomanip>
 #include <cmath>
+#include <limits>
+#include <type_traits>
+#include <utility>
+
+//! Define MATRIX_NO_SIMD to disable the SSE/NEON specializations of the 4x4 operations
+#if !defined(MATRIX_NO_SIMD) && (defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=1))
+#define MATRIX_USE_SSE
+#include <xmmintrin.h>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+#define MATRIX_USE_SSE2
+#include <emmintrin.h>
+#endif
+#elif !defined(MATRIX_NO_SIMD) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define MATRIX_USE_NEON
+#include <arm_neon.h>
+#endif
 
 //! Serveral Matrix implementations are defined here. Operations are generically defined outside of matrix classes and basic stuff like get/set and init inside the matrices to exploit compile time polymorphism
+//! Element wise operations (+, -, scalar * and /) return lazy expressions which are evaluated when assigned to a matrix, this avoids temporaries in chained operations.
+//! Small fixed size loops are unrolled at compile time (see MatrixIndexLoop), 4x4 products have SSE/NEON specializations.
+
+//! Upper limit of the element count for compile time unrolled loops
+#define MATRIX_MAX_UNROLL 16
+
+//! Calls f(0), f(1), ..., f(TCount-1), unrolled at compile time if TCount<=MATRIX_MAX_UNROLL
+template <uint32_t TCount, bool TUnroll = (TCount<=MATRIX_MAX_UNROLL)>
+struct MatrixIndexLoop{
+	template <typename TFunction>
+	static inline void run(const TFunction& f){
+		MatrixIndexLoop<TCount-1, true>::run(f);
+		f(TCount-1);
+	}
+};
+
+template <>
+struct MatrixIndexLoop<0, true>{
+	template <typename TFunction>
+	static inline void run(const TFunction& f){}
+};
+
+template <uint32_t TCount>
+struct MatrixIndexLoop<TCount, false>{
+	template <typename TFunction>
+	static inline void run(const TFunction& f){
+		for(uint32_t i=0; i<TCount; i++){f(i);}
+	}
+};
 
 enum class MatrixInit{
 	UNDEFINED,
@@ -83,7 +128,7 @@ class Matrix{
    
 	template<typename TMatrix>
 	Matrix& operator=(const TMatrix& matrix){
-		return copyMatrix(matrix, *this);
+		return assignMatrix(matrix, *this);
 	}
 	
 };
@@ -135,7 +180,7 @@ class MatrixInterpretation{
    
 	template<typename TMatrix>
 	MatrixInterpretation& operator=(const TMatrix& matrix){
-		return copyMatrix(matrix, *this);
+		return assignMatrix(matrix, *this);
 	}
 	
 };
@@ -181,12 +226,12 @@ class TransposeMatrix{
 	
 	template<typename TMatrix>
 	TransposeMatrix& operator=(const TMatrix& matrix){
-		return copyMatrix(matrix, *this);
+		return assignMatrix(matrix, *this);
 	}
 
 };
 
-#define createTransposeMatrix(M) TransposeMatrix<decltype(M)>(M)
+#define createTransposeMatrix(M) TransposeMatrix<typename std::remove_reference<decltype(M)>::type>(M)
 
 //! A representation of a part of a parent matrix by referencing it which is especially useful to fill parts (such as vectors) of a matrix.
 template <uint32_t TRowIndex, uint32_t TColumnIndex, uint32_t TRowCount, uint32_t TColumnCount, typename TParentMatrix>
@@ -230,12 +275,12 @@ class SubMatrix{
 	
 	template<typename TMatrix>
 	SubMatrix& operator=(const TMatrix& matrix){
-		return copyMatrix(matrix, *this);
+		return assignMatrix(matrix, *this);
 	}
 	
 };
 
-#define createSubMatrix(M, TRowIndex, TColumnIndex, TRowCount, TColumnCount) SubMatrix<TRowIndex, TColumnIndex, TRowCount, TColumnCount, decltype(M)>(M)
+#define createSubMatrix(M, TRowIndex, TColumnIndex, TRowCount, TColumnCount) SubMatrix<TRowIndex, TColumnIndex, TRowCount, TColumnCount, typename std::remove_reference<decltype(M)>::type>(M)
 
 //! A representation of a part of a parent matrix with deleted row i and deleted column j by referencing it and translating the indices
 template <typename TParentMatrix>
@@ -283,12 +328,12 @@ class SubMatrixIJ{
 	
 	template<typename TMatrix>
 	SubMatrixIJ& operator=(const TMatrix& matrix){
-		return copyMatrix(matrix, *this);
+		return assignMatrix(matrix, *this);
 	}
 	
 };
 
-#define createSubMatrixIJ(M, I, J) SubMatrixIJ<decltype(M)>(M, I, J)
+#define createSubMatrixIJ(M, I, J) SubMatrixIJ<typename std::remove_reference<decltype(M)>::type>(M, I, J)
 
 template<uint32_t TSize, typename TScalar>
 using Vector = Matrix<TSize, 1, TScalar>;
@@ -316,99 +361,339 @@ using Matrix4D = Matrix<4, 4, TScalar>;
 template <typename TMatrixA, typename TMatrixB>
 struct ResultScalar{using type = decltype((typename TMatrixA::Scalar)1*(typename TMatrixB::Scalar)1);};
 
-//! multiply two matrices
+//! Element operations of the lazy expressions below
+struct MatrixAddition{
+	template <typename TA, typename TB>
+	static inline auto apply(TA a, TB b)->decltype(a+b){return a+b;}
+};
+
+struct MatrixSubtraction{
+	template <typename TA, typename TB>
+	static inline auto apply(TA a, TB b)->decltype(a-b){return a-b;}
+};
+
+struct MatrixScalarMultiplication{
+	template <typename TA, typename TB>
+	static inline auto apply(TA a, TB b)->decltype(a*b){return b*a;}
+};
+
+struct MatrixScalarDivision{
+	template <typename TA, typename TB>
+	static inline auto apply(TA a, TB b)->decltype(a/b){return a/b;}
+};
+
+//! Operands of lazy expressions: temporaries are moved into the expression, everything else is referenced. Therefore expressions can safely be stored using auto.
+template <typename TOperand>
+using MatrixOperand = typename std::conditional<std::is_lvalue_reference<TOperand>::value, TOperand, typename std::remove_cv<typename std::remove_reference<TOperand>::type>::type>::type;
+
+//! Lazy element wise operation of two matrices. Nothing is calculated until it is assigned to a matrix, therefore chained operations like a+b-c don't create temporaries.
+template <typename TOperation, typename TMatrixA, typename TMatrixB>
+class MatrixBinaryExpression{
+	
+	typedef typename std::decay<TMatrixA>::type MatrixA;
+	typedef typename std::decay<TMatrixB>::type MatrixB;
+	
+	MatrixOperand<TMatrixA> a;
+	MatrixOperand<TMatrixB> b;
+	
+	public:
+	
+	typedef typename ResultScalar<MatrixA, MatrixB>::type Scalar;
+	typedef Scalar value_type;
+	static constexpr uint32_t rowCount = MatrixA::rowCount;
+	static constexpr uint32_t columnCount = MatrixA::columnCount;
+	static constexpr uint32_t size = rowCount*columnCount;
+	static constexpr bool isMatrix = true;
+	static constexpr bool isMatrixExpression = true;
+	
+	MatrixBinaryExpression(TMatrixA&& a, TMatrixB&& b):a(std::forward<TMatrixA>(a)),b(std::forward<TMatrixB>(b)){
+		static_assert(MatrixA::rowCount==MatrixB::rowCount && MatrixA::columnCount==MatrixB::columnCount, "");
+	}
+	
+	Scalar get(uint32_t row, uint32_t column = 0) const{
+		return TOperation::apply(a.get(row, column), b.get(row, column));
+	}
+	
+	Scalar operator[](uint32_t i) const{
+		return get(i/columnCount, i%columnCount);
+	}
+	
+};
+
+//! Lazy element wise operation of a matrix and a scalar
+template <typename TOperation, typename TMatrix>
+class MatrixScalarExpression{
+	
+	typedef typename std::decay<TMatrix>::type MatrixType;
+	
+	MatrixOperand<TMatrix> m;
+	
+	public:
+	
+	typedef typename MatrixType::Scalar Scalar;
+	typedef Scalar value_type;
+	static constexpr uint32_t rowCount = MatrixType::rowCount;
+	static constexpr uint32_t columnCount = MatrixType::columnCount;
+	static constexpr uint32_t size = rowCount*columnCount;
+	static constexpr bool isMatrix = true;
+	static constexpr bool isMatrixExpression = true;
+	
+	private:
+	
+	Scalar s;
+	
+	public:
+	
+	MatrixScalarExpression(TMatrix&& m, Scalar s):m(std::forward<TMatrix>(m)),s(s){}
+	
+	Scalar get(uint32_t row, uint32_t column = 0) const{
+		return TOperation::apply(m.get(row, column), s);
+	}
+	
+	Scalar operator[](uint32_t i) const{
+		return get(i/columnCount, i%columnCount);
+	}
+	
+};
+
+//! Lazy negation of a matrix
+template <typename TMatrix>
+class MatrixNegationExpression{
+	
+	typedef typename std::decay<TMatrix>::type MatrixType;
+	
+	MatrixOperand<TMatrix> m;
+	
+	public:
+	
+	typedef typename MatrixType::Scalar Scalar;
+	typedef Scalar value_type;
+	static constexpr uint32_t rowCount = MatrixType::rowCount;
+	static constexpr uint32_t columnCount = MatrixType::columnCount;
+	static constexpr uint32_t size = rowCount*columnCount;
+	static constexpr bool isMatrix = true;
+	static constexpr bool isMatrixExpression = true;
+	
+	MatrixNegationExpression(TMatrix&& m):m(std::forward<TMatrix>(m)){}
+	
+	Scalar get(uint32_t row, uint32_t column = 0) const{
+		return -m.get(row, column);
+	}
+	
+	Scalar operator[](uint32_t i) const{
+		return get(i/columnCount, i%columnCount);
+	}
+	
+};
+
+//! Type trait to check if a (possibly reference) type is a matrix
+template <typename TMatrix, typename = void>
+struct is_matrix : std::false_type{};
+
+template <typename TMatrix>
+struct is_matrix<TMatrix, typename std::enable_if<std::decay<TMatrix>::type::isMatrix>::type> : std::true_type{};
+
+//! Type trait to check if a type is a lazy expression
+template <typename TMatrix, typename = void>
+struct is_matrix_expression : std::false_type{};
+
+template <typename TMatrix>
+struct is_matrix_expression<TMatrix, typename std::enable_if<std::decay<TMatrix>::type::isMatrixExpression>::type> : std::true_type{};
+
+//! multiply two matrices (evaluated immediately since the result elements depend on several elements of the operands which would be recalculated by a lazy evaluation)
 template <typename TMatrixA, typename TMatrixB>
 Matrix<TMatrixA::rowCount, TMatrixB::columnCount, typename ResultScalar<TMatrixA,TMatrixB>::type> operator*(const TMatrixA& a, const TMatrixB& b){
 	static_assert(TMatrixA::columnCount==TMatrixB::rowCount, "");//check compatibility to make runtime errors to compile time errors
-	Matrix<TMatrixA::rowCount, TMatrixB::columnCount, typename ResultScalar<TMatrixA,TMatrixB>::type> res;
-	for(uint32_t inColumn=0; inColumn<TMatrixB::columnCount; inColumn++){
-		for(uint32_t row=0; row<TMatrixA::rowCount; row++){
-			typename ResultScalar<TMatrixA,TMatrixB>::type dotProduct = 0;
-			for(uint32_t column=0; column<TMatrixA::columnCount; column++){
-				dotProduct += a.get(row,column)*b.get(column, inColumn);
-			}
-			res.set(row, inColumn, dotProduct);
-		}
+	typedef typename ResultScalar<TMatrixA,TMatrixB>::type ResScalar;
+	Matrix<TMatrixA::rowCount, TMatrixB::columnCount, ResScalar> res;
+	MatrixIndexLoop<TMatrixA::rowCount*TMatrixB::columnCount>::run([&a, &b, &res](uint32_t i){
+		uint32_t row = i/TMatrixB::columnCount;
+		uint32_t inColumn = i%TMatrixB::columnCount;
+		ResScalar dotProduct = 0;
+		MatrixIndexLoop<TMatrixA::columnCount>::run([&a, &b, &dotProduct, row, inColumn](uint32_t column){
+			dotProduct += a.get(row,column)*b.get(column, inColumn);
+		});
+		res.set(row, inColumn, dotProduct);
+	});
+	return res;
+}
+
+#ifdef MATRIX_USE_SSE
+
+//! 4x4 float matrix product using SSE (same operation order and therefore same results as the generic implementation)
+inline Matrix4D<float> operator*(const Matrix4D<float>& a, const Matrix4D<float>& b){
+	Matrix4D<float> res;
+	const float* pa = a.getData();
+	const float* pb = b.getData();
+	__m128 b0 = _mm_loadu_ps(pb), b1 = _mm_loadu_ps(pb+4), b2 = _mm_loadu_ps(pb+8), b3 = _mm_loadu_ps(pb+12);
+	for(uint32_t row=0; row<4; row++){
+		const float* r = pa+4*row;
+		__m128 sum = _mm_mul_ps(_mm_set1_ps(r[0]), b0);
+		sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(r[1]), b1));
+		sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(r[2]), b2));
+		sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(r[3]), b3));
+		_mm_storeu_ps(res.getData()+4*row, sum);
 	}
 	return res;
 }
 
-//! visit all elements of a matrix
-template <typename TMatrix>
-void visitMatrix(TMatrix& matrix, const std::function<void(uint32_t,uint32_t,typename TMatrix::Scalar&)>& f){
-	for(uint32_t i=0; i<TMatrix::rowCount; i++){
-		for(uint32_t j=0; j<TMatrix::columnCount; j++){
-			f(i,j,matrix.get(i,j));
+//! 4x4 float matrix times 4D vector using SSE
+inline Vector4D<float> operator*(const Matrix4D<float>& a, const Vector4D<float>& v){
+	Vector4D<float> res;
+	const float* pa = a.getData();
+	__m128 c0 = _mm_loadu_ps(pa), c1 = _mm_loadu_ps(pa+4), c2 = _mm_loadu_ps(pa+8), c3 = _mm_loadu_ps(pa+12);
+	_MM_TRANSPOSE4_PS(c0, c1, c2, c3);//rows to columns
+	__m128 sum = _mm_mul_ps(c0, _mm_set1_ps(v[0]));
+	sum = _mm_add_ps(sum, _mm_mul_ps(c1, _mm_set1_ps(v[1])));
+	sum = _mm_add_ps(sum, _mm_mul_ps(c2, _mm_set1_ps(v[2])));
+	sum = _mm_add_ps(sum, _mm_mul_ps(c3, _mm_set1_ps(v[3])));
+	_mm_storeu_ps(res.getData(), sum);
+	return res;
+}
+
+#ifdef MATRIX_USE_SSE2
+
+//! 4x4 double matrix product using SSE2
+inline Matrix4D<double> operator*(const Matrix4D<double>& a, const Matrix4D<double>& b){
+	Matrix4D<double> res;
+	const double* pa = a.getData();
+	const double* pb = b.getData();
+	for(uint32_t half=0; half<4; half+=2){
+		__m128d b0 = _mm_loadu_pd(pb+half), b1 = _mm_loadu_pd(pb+4+half), b2 = _mm_loadu_pd(pb+8+half), b3 = _mm_loadu_pd(pb+12+half);
+		for(uint32_t row=0; row<4; row++){
+			const double* r = pa+4*row;
+			__m128d sum = _mm_mul_pd(_mm_set1_pd(r[0]), b0);
+			sum = _mm_add_pd(sum, _mm_mul_pd(_mm_set1_pd(r[1]), b1));
+			sum = _mm_add_pd(sum, _mm_mul_pd(_mm_set1_pd(r[2]), b2));
+			sum = _mm_add_pd(sum, _mm_mul_pd(_mm_set1_pd(r[3]), b3));
+			_mm_storeu_pd(res.getData()+4*row+half, sum);
 		}
 	}
+	return res;
+}
+
+#endif
+
+#elif defined(MATRIX_USE_NEON)
+
+//! 4x4 float matrix product using NEON (same operation order and therefore same results as the generic implementation)
+inline Matrix4D<float> operator*(const Matrix4D<float>& a, const Matrix4D<float>& b){
+	Matrix4D<float> res;
+	const float* pa = a.getData();
+	const float* pb = b.getData();
+	float32x4_t b0 = vld1q_f32(pb), b1 = vld1q_f32(pb+4), b2 = vld1q_f32(pb+8), b3 = vld1q_f32(pb+12);
+	for(uint32_t row=0; row<4; row++){
+		const float* r = pa+4*row;
+		float32x4_t sum = vmulq_n_f32(b0, r[0]);
+		sum = vaddq_f32(sum, vmulq_n_f32(b1, r[1]));
+		sum = vaddq_f32(sum, vmulq_n_f32(b2, r[2]));
+		sum = vaddq_f32(sum, vmulq_n_f32(b3, r[3]));
+		vst1q_f32(res.getData()+4*row, sum);
+	}
+	return res;
+}
+
+//! 4x4 float matrix times 4D vector using NEON
+inline Vector4D<float> operator*(const Matrix4D<float>& a, const Vector4D<float>& v){
+	Vector4D<float> res;
+	float32x4x4_t c = vld4q_f32(a.getData());//deinterleaved load: c.val[i] is column i
+	float32x4_t sum = vmulq_n_f32(c.val[0], v[0]);
+	sum = vaddq_f32(sum, vmulq_n_f32(c.val[1], v[1]));
+	sum = vaddq_f32(sum, vmulq_n_f32(c.val[2], v[2]));
+	sum = vaddq_f32(sum, vmulq_n_f32(c.val[3], v[3]));
+	vst1q_f32(res.getData(), sum);
+	return res;
 }
 
-//! Copy Matrices and returns the target
+#endif
+
+//! visit all elements of a matrix, f(row, column, value)
+template <typename TMatrix, typename TFunction>
+void visitMatrix(TMatrix& matrix, const TFunction& f){
+	MatrixIndexLoop<TMatrix::size>::run([&matrix, &f](uint32_t i){
+		uint32_t row = i/TMatrix::columnCount;
+		uint32_t column = i%TMatrix::columnCount;
+		f(row, column, matrix.get(row, column));
+	});
+}
+
+//! Copy Matrices and returns the target, the source may also be an expression
 template <typename TMatrixA, typename TMatrixB>
 TMatrixB& copyMatrix(const TMatrixA& source, TMatrixB& target){
 	static_assert(TMatrixA::rowCount==TMatrixB::rowCount && TMatrixA::columnCount==TMatrixB::columnCount, "");
-	visitMatrix(const_cast<TMatrixA&>(source), [&target](uint32_t row, uint32_t column, typename TMatrixA::Scalar& value){target.set(row, column, value);});
+	MatrixIndexLoop<TMatrixA::size>::run([&source, &target](uint32_t i){
+		uint32_t row = i/TMatrixA::columnCount;
+		uint32_t column = i%TMatrixA::columnCount;
+		target.set(row, column, source.get(row, column));
+	});
 	return target;
 }
 
+//! Assignment of a matrix (copied directly)
+template <typename TMatrixA, typename TMatrixB, typename std::enable_if<!is_matrix_expression<TMatrixA>::value, int>::type = 0>
+TMatrixB& assignMatrix(const TMatrixA& source, TMatrixB& target){
+	return copyMatrix(source, target);
+}
+
+//! Assignment of a lazy expression: it is evaluated first because the target may be an operand (e.g. m = createTransposeMatrix(m)+m)
+template <typename TMatrixA, typename TMatrixB, typename std::enable_if<is_matrix_expression<TMatrixA>::value, int>::type = 0>
+TMatrixB& assignMatrix(const TMatrixA& source, TMatrixB& target){
+	Matrix<TMatrixA::rowCount, TMatrixA::columnCount, typename TMatrixA::Scalar> evaluated(source);
+	return copyMatrix(evaluated, target);
+}
+
 //! Output Matrices
 template <typename TMatrix, typename std::enable_if<TMatrix::isMatrix, int>::type = 0>
 std::ostream& operator<<(std::ostream &out, const TMatrix& m){
-	visitMatrix(const_cast<TMatrix&>(m), [&out](uint32_t row, uint32_t column, typename TMatrix::Scalar& value){
-		out << std::setw(15) << std::right << value;
-		if(row!=TMatrix::rowCount-1 && column==TMatrix::columnCount-1){out << "\n";}
-	});
+	for(uint32_t row=0; row<TMatrix::rowCount; row++){
+		for(uint32_t column=0; column<TMatrix::columnCount; column++){
+			out << std::setw(15) << std::right << m.get(row, column);
+		}
+		if(row!=TMatrix::rowCount-1){out << "\n";}
+	}
 	return out; 
 }
 
-//! Subtract Matrices
-template <typename TMatrixA, typename TMatrixB, typename std::enable_if<TMatrixA::isMatrix&&TMatrixB::isMatrix, int>::type = 0>
-Matrix<TMatrixA::rowCount, TMatrixA::columnCount, typename ResultScalar<TMatrixA, TMatrixB>::type> operator-(const TMatrixA& a, const TMatrixB& b){
-	static_assert(TMatrixA::rowCount==TMatrixB::rowCount && TMatrixA::columnCount==TMatrixB::columnCount, "");
-	using ResScalar = typename ResultScalar<TMatrixA, TMatrixB>::type;
-	Matrix<TMatrixA::rowCount, TMatrixA::columnCount, ResScalar> res;
-	visitMatrix(res, [&a, &b](uint32_t row, uint32_t column, ResScalar& value){value = a.get(row, column)-b.get(row, column);});
-	return res;
+//! Subtract Matrices (lazy)
+template <typename TMatrixA, typename TMatrixB, typename std::enable_if<is_matrix<TMatrixA>::value&&is_matrix<TMatrixB>::value, int>::type = 0>
+MatrixBinaryExpression<MatrixSubtraction, TMatrixA, TMatrixB> operator-(TMatrixA&& a, TMatrixB&& b){
+	return MatrixBinaryExpression<MatrixSubtraction, TMatrixA, TMatrixB>(std::forward<TMatrixA>(a), std::forward<TMatrixB>(b));
 }
 
-//! Subtract Matrix from zero
-template <typename TMatrix, typename std::enable_if<TMatrix::isMatrix, int>::type = 0>
-Matrix<TMatrix::rowCount, TMatrix::columnCount, typename TMatrix::Scalar> operator-(const TMatrix& m){
-	Matrix<TMatrix::rowCount, TMatrix::columnCount, typename TMatrix::Scalar> res;
-	visitMatrix(res, [&m](uint32_t row, uint32_t column, typename TMatrix::Scalar& value){value = -m.get(row, column);});
-	return res;
+//! Subtract Matrix from zero (lazy)
+template <typename TMatrix, typename std::enable_if<is_matrix<TMatrix>::value, int>::type = 0>
+MatrixNegationExpression<TMatrix> operator-(TMatrix&& m){
+	return MatrixNegationExpression<TMatrix>(std::forward<TMatrix>(m));
 }
 
-//! Add Matrices
-template <typename TMatrixA, typename TMatrixB, typename std::enable_if<TMatrixA::isMatrix&&TMatrixB::isMatrix, int>::type = 0>
-Matrix<TMatrixA::rowCount, TMatrixA::columnCount, typename ResultScalar<TMatrixA, TMatrixB>::type> operator+(const TMatrixA& a, const TMatrixB& b){
-	static_assert(TMatrixA::rowCount==TMatrixB::rowCount && TMatrixA::columnCount==TMatrixB::columnCount, "");
-	using ResScalar = typename ResultScalar<TMatrixA, TMatrixB>::type;
-	Matrix<TMatrixA::rowCount, TMatrixA::columnCount, ResScalar> res;
-	visitMatrix(res, [&a, &b](uint32_t row, uint32_t column, ResScalar& value){value = a.get(row, column)+b.get(row, column);});
-	return res;
+//! Add Matrices (lazy)
+template <typename TMatrixA, typename TMatrixB, typename std::enable_if<is_matrix<TMatrixA>::value&&is_matrix<TMatrixB>::value, int>::type = 0>
+MatrixBinaryExpression<MatrixAddition, TMatrixA, TMatrixB> operator+(TMatrixA&& a, TMatrixB&& b){
+	return MatrixBinaryExpression<MatrixAddition, TMatrixA, TMatrixB>(std::forward<TMatrixA>(a), std::forward<TMatrixB>(b));
 }
 
-//! Multiply with Scalar
-template <typename TMatrix, typename TScalar, typename std::enable_if<TMatrix::isMatrix&&std::is_same<typename TMatrix::Scalar,TScalar>::value, int>::type = 0>
-Matrix<TMatrix::rowCount, TMatrix::columnCount, typename TMatrix::Scalar> operator*(const TMatrix& m, TScalar s){
-	Matrix<TMatrix::rowCount, TMatrix::columnCount, typename TMatrix::Scalar> res;
-	visitMatrix(res, [&m,s](uint32_t row, uint32_t column, typename TMatrix::Scalar& value){value = s*m.get(row, column);});
-	return res;
+//! Multiply with Scalar (lazy)
+template <typename TMatrix, typename TScalar, typename std::enable_if<is_matrix<TMatrix>::value&&std::is_same<typename std::decay<TMatrix>::type::Scalar,TScalar>::value, int>::type = 0>
+MatrixScalarExpression<MatrixScalarMultiplication, TMatrix> operator*(TMatrix&& m, TScalar s){
+	return MatrixScalarExpression<MatrixScalarMultiplication, TMatrix>(std::forward<TMatrix>(m), s);
 }
 
-//! Multiply with Scalar #2
-template <typename TMatrix, typename TScalar, typename std::enable_if<TMatrix::isMatrix&&std::is_same<typename TMatrix::Scalar,TScalar>::value, int>::type = 0>
-Matrix<TMatrix::rowCount, TMatrix::columnCount, typename TMatrix::Scalar> operator*(TScalar s, const TMatrix& m){
-	return m*s;
+//! Multiply with Scalar #2 (lazy)
+template <typename TMatrix, typename TScalar, typename std::enable_if<is_matrix<TMatrix>::value&&std::is_same<typename std::decay<TMatrix>::type::Scalar,TScalar>::value, int>::type = 0>
+MatrixScalarExpression<MatrixScalarMultiplication, TMatrix> operator*(TScalar s, TMatrix&& m){
+	return MatrixScalarExpression<MatrixScalarMultiplication, TMatrix>(std::forward<TMatrix>(m), s);
 }
 
-//! Divide by Scalar, Attention: In case of integral scalar types this will be integer division!!!
-template <typename TMatrix, typename TScalar, typename std::enable_if<TMatrix::isMatrix&&std::is_same<typename TMatrix::Scalar,TScalar>::value, int>::type = 0>
-Matrix<TMatrix::rowCount, TMatrix::columnCount, typename TMatrix::Scalar> operator/(const TMatrix& m, TScalar s){
-	Matrix<TMatrix::rowCount, TMatrix::columnCount, typename TMatrix::Scalar> res;
-	visitMatrix(res, [&m,s](uint32_t row, uint32_t column, typename TMatrix::Scalar& value){value = m.get(row, column)/s;});
-	return res;
+//! Divide by Scalar (lazy), Attention: In case of integral scalar types this will be integer division!!!
+template <typename TMatrix, typename TScalar, typename std::enable_if<is_matrix<TMatrix>::value&&std::is_same<typename std::decay<TMatrix>::type::Scalar,TScalar>::value, int>::type = 0>
+MatrixScalarExpression<MatrixScalarDivision, TMatrix> operator/(TMatrix&& m, TScalar s){
+	return MatrixScalarExpression<MatrixScalarDivision, TMatrix>(std::forward<TMatrix>(m), s);
+}
+
+//! Evaluates a lazy expression (or copies a matrix), useful in combination with auto if the operands are going to be changed
+template <typename TMatrix, typename std::enable_if<TMatrix::isMatrix, int>::type = 0>
+Matrix<TMatrix::rowCount, TMatrix::columnCount, typename TMatrix::Scalar> evalMatrix(const TMatrix& m){
+	return Matrix<TMatrix::rowCount, TMatrix::columnCount, typename TMatrix::Scalar>(m);
 }
 
 //! Linear Interpolation, time specifices the progress of the interpolaton form start (0) to end (1)
@@ -481,9 +766,119 @@ Matrix<TMatrix::rowCount, TMatrix::columnCount, typename TMatrix::Scalar> calcCo
 	return res;
 }
 
-//! Calculates the inverse of a square matrix using Cramer's rule.
-//! WARNING: Inefficient (O(n*n!) for nxn matrix)! For large matrices use sth. like LR decomposition!!!
+//! LU decomposition with partial pivoting: P*m = L*U where L (unit lower triangle, diagonal not stored) and U are both stored in lu.
+//! permutation[i] is the row of m which is row i of P*m, permutationSign is the determinant of P (1 or -1).
+//! Returns false if the matrix is singular (lu is incomplete in this case). O(n^3)
+template<typename TMatrix, typename std::enable_if<is_square_matrix<TMatrix>::value, int>::type = 0>
+bool calcLUDecomposition(const TMatrix& m, Matrix<TMatrix::rowCount, TMatrix::columnCount, typename TMatrix::Scalar>& lu, std::array<uint32_t, TMatrix::rowCount>& permutation, typename TMatrix::Scalar& permutationSign){
+	static_assert(std::is_floating_point<typename TMatrix::Scalar>::value, "");
+	typedef typename TMatrix::Scalar Scalar;
+	const uint32_t n = TMatrix::rowCount;
+	lu = m;
+	permutationSign = (Scalar)1;
+	for(uint32_t i=0; i<n; i++){permutation[i] = i;}
+	for(uint32_t k=0; k<n; k++){
+		uint32_t pivot = k;
+		Scalar pivotAbs = std::abs(lu.get(k,k));
+		for(uint32_t i=k+1; i<n; i++){
+			Scalar a = std::abs(lu.get(i,k));
+			if(a>pivotAbs){pivot = i; pivotAbs = a;}
+		}
+		if(pivotAbs==(Scalar)0){return false;}
+		if(pivot!=k){
+			for(uint32_t j=0; j<n; j++){std::swap(lu.get(k,j), lu.get(pivot,j));}
+			std::swap(permutation[k], permutation[pivot]);
+			permutationSign = -permutationSign;
+		}
+		Scalar invPivot = ((Scalar)1)/lu.get(k,k);
+		for(uint32_t i=k+1; i<n; i++){
+			Scalar factor = lu.get(i,k)*invPivot;
+			lu.get(i,k) = factor;
+			for(uint32_t j=k+1; j<n; j++){lu.get(i,j) -= factor*lu.get(k,j);}
+		}
+	}
+	return true;
+}
+
+//! Solves m*x = b for x using the results of calcLUDecomposition, b may have several columns (right hand sides)
+template<uint32_t TSize, uint32_t TColumnCount, typename TScalar, typename TMatrixB>
+Matrix<TSize, TColumnCount, TScalar> solveWithLU(const Matrix<TSize, TSize, TScalar>& lu, const std::array<uint32_t, TSize>& permutation, const TMatrixB& b){
+	static_assert(TMatrixB::rowCount==TSize && TMatrixB::columnCount==TColumnCount, "");
+	Matrix<TSize, TColumnCount, TScalar> x;
+	for(uint32_t c=0; c<TColumnCount; c++){
+		for(uint32_t i=0; i<TSize; i++){//forward substitution (L has unit diagonal)
+			TScalar sum = b.get(permutation[i], c);
+			for(uint32_t j=0; j<i; j++){sum -= lu.get(i,j)*x.get(j,c);}
+			x.get(i,c) = sum;
+		}
+		for(uint32_t i=TSize; i-->0;){//backward substitution
+			TScalar sum = x.get(i,c);
+			for(uint32_t j=i+1; j<TSize; j++){sum -= lu.get(i,j)*x.get(j,c);}
+			x.get(i,c) = sum/lu.get(i,i);
+		}
+	}
+	return x;
+}
+
+//! Solves a*x = b for x using the LU decomposition, returns false if a is singular
+template<typename TMatrixA, typename TMatrixB, typename std::enable_if<is_square_matrix<TMatrixA>::value, int>::type = 0>
+bool solveLinearSystem(const TMatrixA& a, const TMatrixB& b, Matrix<TMatrixA::rowCount, TMatrixB::columnCount, typename TMatrixA::Scalar>& x){
+	Matrix<TMatrixA::rowCount, TMatrixA::columnCount, typename TMatrixA::Scalar> lu;
+	std::array<uint32_t, TMatrixA::rowCount> permutation;
+	typename TMatrixA::Scalar permutationSign;
+	if(!calcLUDecomposition(a, lu, permutation, permutationSign)){return false;}
+	x = solveWithLU<TMatrixA::rowCount, TMatrixB::columnCount>(lu, permutation, b);
+	return true;
+}
+
+//! Cholesky decomposition m = L*L^T of a symmetric positive definite matrix (only the lower triangle of m is used), the upper triangle of l is set to zero.
+//! Returns false if the matrix is not positive definite. About twice as fast as the LU decomposition.
 template<typename TMatrix, typename std::enable_if<is_square_matrix<TMatrix>::value, int>::type = 0>
+bool calcCholeskyDecomposition(const TMatrix& m, Matrix<TMatrix::rowCount, TMatrix::columnCount, typename TMatrix::Scalar>& l){
+	static_assert(std::is_floating_point<typename TMatrix::Scalar>::value, "");
+	typedef typename TMatrix::Scalar Scalar;
+	const uint32_t n = TMatrix::rowCount;
+	for(uint32_t j=0; j<n; j++){
+		Scalar d = m.get(j,j);
+		for(uint32_t k=0; k<j; k++){d -= l.get(j,k)*l.get(j,k);}
+		if(!(d>(Scalar)0)){return false;}
+		d = std::sqrt(d);
+		l.get(j,j) = d;
+		Scalar invD = ((Scalar)1)/d;
+		for(uint32_t i=j+1; i<n; i++){
+			Scalar sum = m.get(i,j);
+			for(uint32_t k=0; k<j; k++){sum -= l.get(i,k)*l.get(j,k);}
+			l.get(i,j) = sum*invD;
+			l.get(j,i) = (Scalar)0;
+		}
+	}
+	return true;
+}
+
+//! Solves m*x = b for x using the result of calcCholeskyDecomposition, b may have several columns (right hand sides)
+template<uint32_t TSize, uint32_t TColumnCount, typename TScalar, typename TMatrixB>
+Matrix<TSize, TColumnCount, TScalar> solveWithCholesky(const Matrix<TSize, TSize, TScalar>& l, const TMatrixB& b){
+	static_assert(TMatrixB::rowCount==TSize && TMatrixB::columnCount==TColumnCount, "");
+	Matrix<TSize, TColumnCount, TScalar> x;
+	for(uint32_t c=0; c<TColumnCount; c++){
+		for(uint32_t i=0; i<TSize; i++){//L*y = b
+			TScalar sum = b.get(i,c);
+			for(uint32_t j=0; j<i; j++){sum -= l.get(i,j)*x.get(j,c);}
+			x.get(i,c) = sum/l.get(i,i);
+		}
+		for(uint32_t i=TSize; i-->0;){//L^T*x = y
+			TScalar sum = x.get(i,c);
+			for(uint32_t j=i+1; j<TSize; j++){sum -= l.get(j,i)*x.get(j,c);}
+			x.get(i,c) = sum/l.get(i,i);
+		}
+	}
+	return x;
+}
+
+//! Calculates the inverse of a square matrix.
+//! 1x1, 2x2 and 3x3 matrices are inverted using the closed form (adjugate/determinant), larger ones using the LU decomposition (O(n^3)).
+//! The result contains infinite or NaN values if the matrix is singular.
+template<typename TMatrix, typename std::enable_if<is_square_matrix<TMatrix>::value&&(TMatrix::rowCount<=3), int>::type = 0>
 Matrix<TMatrix::rowCount, TMatrix::columnCount, typename TMatrix::Scalar> calcInverse(const TMatrix& m){
 	static_assert(std::is_floating_point<typename TMatrix::Scalar>::value, "");
 	typedef typename TMatrix::Scalar Scalar;
@@ -492,6 +887,19 @@ Matrix<TMatrix::rowCount, TMatrix::columnCount, typename TMatrix::Scalar> calcIn
 	return invDet * createTransposeMatrix(c);
 };
 
+template<typename TMatrix, typename std::enable_if<is_square_matrix<TMatrix>::value&&(TMatrix::rowCount>3), int>::type = 0>
+Matrix<TMatrix::rowCount, TMatrix::columnCount, typename TMatrix::Scalar> calcInverse(const TMatrix& m){
+	static_assert(std::is_floating_point<typename TMatrix::Scalar>::value, "");
+	typedef typename TMatrix::Scalar Scalar;
+	Matrix<TMatrix::rowCount, TMatrix::columnCount, Scalar> lu;
+	std::array<uint32_t, TMatrix::rowCount> permutation;
+	Scalar permutationSign;
+	if(!calcLUDecomposition(m, lu, permutation, permutationSign)){
+		return Matrix<TMatrix::rowCount, TMatrix::columnCount, Scalar>(std::numeric_limits<Scalar>::infinity());
+	}
+	return solveWithLU<TMatrix::rowCount, TMatrix::columnCount>(lu, permutation, Matrix<TMatrix::rowCount, TMatrix::columnCount, Scalar>(MatrixInit::IDENTITY));
+};
+
 //! determinant for a 1x1 matrix
 template<typename TMatrix, typename std::enable_if<is_square_matrix<TMatrix>::value&&TMatrix::rowCount==1, int>::type = 0>
 typename TMatrix::Scalar calcDeterminant(const TMatrix& m){
@@ -510,9 +918,21 @@ typename TMatrix::Scalar calcDeterminant(const TMatrix& m){
 	return m.get(0,0)*m.get(1,1)*m.get(2,2) + m.get(0,1)*m.get(1,2)*m.get(2,0) + m.get(0,2)*m.get(1,0)*m.get(2,1) - m.get(0,2)*m.get(1,1)*m.get(2,0) - m.get(0,1)*m.get(1,0)*m.get(2,2) - m.get(0,0)*m.get(1,2)*m.get(2,1);
 }
 
-//! determinant for a nxn matrix
-//! WARNING: Inefficient (O(n!) for nxn matrix)! For large matrices use sth. like LR decomposition!!!
-template<typename TMatrix, typename std::enable_if<is_square_matrix<TMatrix>::value&&(TMatrix::rowCount>3), int>::type = 0>
+//! determinant for a nxn matrix with floating point scalars using the LU decomposition (O(n^3))
+template<typename TMatrix, typename std::enable_if<is_square_matrix<TMatrix>::value&&(TMatrix::rowCount>3)&&std::is_floating_point<typename TMatrix::Scalar>::value, int>::type = 0>
+typename TMatrix::Scalar calcDeterminant(const TMatrix& m){
+	typedef typename TMatrix::Scalar Scalar;
+	Matrix<TMatrix::rowCount, TMatrix::columnCount, Scalar> lu;
+	std::array<uint32_t, TMatrix::rowCount> permutation;
+	Scalar res;
+	if(!calcLUDecomposition(m, lu, permutation, res)){return (Scalar)0;}
+	for(uint32_t i=0; i<TMatrix::rowCount; i++){res *= lu.get(i,i);}
+	return res;
+}
+
+//! determinant for a nxn matrix with integral scalars (exact, no rounding errors)
+//! WARNING: Inefficient (O(n!) for nxn matrix)!
+template<typename TMatrix, typename std::enable_if<is_square_matrix<TMatrix>::value&&(TMatrix::rowCount>3)&&!std::is_floating_point<typename TMatrix::Scalar>::value, int>::type = 0>
 typename TMatrix::Scalar calcDeterminant(const TMatrix& m){
 	typename TMatrix::Scalar res = 0;
 	for(uint32_t column=0; column<TMatrix::columnCount; column++){
@@ -526,7 +946,10 @@ typename TMatrix::Scalar calcDeterminant(const TMatrix& m){
 template<typename TMatrix, typename std::enable_if<TMatrix::isMatrix, int>::type = 0>
 typename TMatrix::Scalar getMatrixMin(const TMatrix& m){
 	typename TMatrix::Scalar res = m.get(0);
-	visitMatrix(const_cast<TMatrix&>(m), [&res](uint32_t row, uint32_t column, typename TMatrix::Scalar& value){if(value<res){res = value;}});
+	MatrixIndexLoop<TMatrix::size>::run([&m, &res](uint32_t i){
+		typename TMatrix::Scalar value = m.get(i/TMatrix::columnCount, i%TMatrix::columnCount);
+		if(value<res){res = value;}
+	});
 	return res;
 }
 
@@ -534,7 +957,10 @@ typename TMatrix::Scalar getMatrixMin(const TMatrix& m){
 template<typename TMatrix, typename std::enable_if<TMatrix::isMatrix, int>::type = 0>
 typename TMatrix::Scalar getMatrixMax(const TMatrix& m){
 	typename TMatrix::Scalar res = m.get(0);
-	visitMatrix(const_cast<TMatrix&>(m), [&res](uint32_t row, uint32_t column, typename TMatrix::Scalar& value){if(value>res){res = value;}});
+	MatrixIndexLoop<TMatrix::size>::run([&m, &res](uint32_t i){
+		typename TMatrix::Scalar value = m.get(i/TMatrix::columnCount, i%TMatrix::columnCount);
+		if(value>res){res = value;}
+	});
 	return res;
 }
 
@@ -542,7 +968,10 @@ typename TMatrix::Scalar getMatrixMax(const TMatrix& m){
 template<typename TMatrix, typename std::enable_if<TMatrix::isMatrix, int>::type = 0>
 typename TMatrix::Scalar calcSquareSumNorm(const TMatrix& m){
 	typename TMatrix::Scalar res = 0;
-	visitMatrix(const_cast<TMatrix&>(m), [&res](uint32_t row, uint32_t column, typename TMatrix::Scalar& value){res += value*value;});
+	MatrixIndexLoop<TMatrix::size>::run([&m, &res](uint32_t i){
+		typename TMatrix::Scalar value = m.get(i/TMatrix::columnCount, i%TMatrix::columnCount);
+		res += value*value;
+	});
 	return res;
 }
 
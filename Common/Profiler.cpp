@@ -0,0 +1,301 @@
+#include "Profiler.h"
+
+#include <Threading.h>
+
+#include <chrono>
+#include <memory>
+#include <atomic>
+#include <map>
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+#include <cmath>
+
+struct ProfileEvent{
+	const char* name;
+	uint64_t startTime;
+	uint64_t endTime;
+};
+
+//! slot of the ring buffer, written by the owning thread while other threads may read it (relaxed atomics are plain loads and stores on common platforms)
+struct ProfileEventSlot{
+	std::atomic<const char*> name;
+	std::atomic<uint64_t> startTime;
+	std::atomic<uint64_t> endTime;
+};
+
+//! Ring buffer of a thread, only the owning thread writes events (without locking).
+//! Readers copy the events and discard those which may have been overwritten meanwhile.
+struct ProfileThreadBuffer{
+	Mutex m;//protects threadName
+	std::atomic<uint32_t> threadId;
+	std::string threadName;
+	const uint32_t size;
+	std::unique_ptr<ProfileEventSlot[]> events;
+	std::atomic<uint64_t> startCount;//count of started writes, greater than writeCount while an event is written
+	std::atomic<uint64_t> writeCount;//total count of written events, next write index is writeCount % size
+	std::atomic<uint64_t> clearCount;//events with lower indices have been cleared
+
+	ProfileThreadBuffer(uint32_t threadId, uint32_t size):threadId(threadId),size(size),events(new ProfileEventSlot[size]),startCount(0),writeCount(0),clearCount(0){
+		initMutex(m);
+	}
+
+	~ProfileThreadBuffer(){
+		deleteMutex(m);
+	}
+
+	//! must only be called by the owning thread
+	void record(const char* name, uint64_t startTime, uint64_t endTime){
+		uint64_t index = writeCount.load(std::memory_order_relaxed);
+		startCount.store(index+1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		ProfileEventSlot& e = events[index%size];
+		e.name.store(name, std::memory_order_relaxed);
+		e.startTime.store(startTime, std::memory_order_relaxed);
+		e.endTime.store(endTime, std::memory_order_relaxed);
+		writeCount.store(index+1, std::memory_order_release);
+	}
+
+	//! appends all currently stored events in chronological order of recording
+	void copyEvents(std::vector<ProfileEvent>& out){
+		uint64_t end = writeCount.load(std::memory_order_acquire);
+		uint64_t begin = std::max(end-std::min(end, (uint64_t)size), clearCount.load(std::memory_order_relaxed));
+		size_t first = out.size();
+		for(uint64_t i=begin; i<end; i++){
+			const ProfileEventSlot& e = events[i%size];
+			out.push_back(ProfileEvent{e.name.load(std::memory_order_relaxed), e.startTime.load(std::memory_order_relaxed), e.endTime.load(std::memory_order_relaxed)});
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+		//all events up to startCount-size may have been overwritten while copying
+		uint64_t overwritten = startCount.load(std::memory_order_relaxed);
+		if(overwritten>begin+size){
+			uint64_t invalid = std::min(overwritten-size-begin, end-begin);
+			out.erase(out.begin()+first, out.begin()+first+invalid);
+		}
+	}
+
+	void clear(){
+		clearCount.store(writeCount.load(std::memory_order_acquire), std::memory_order_relaxed);
+	}
+
+};
+
+//! The buffer of a thread is released when the thread exits and reused by the next thread which records events,
+//! so the data of exited threads can still be exported until then and the memory does not grow with short-lived threads.
+class ProfileRegistry{
+
+	private:
+
+	Mutex m;
+	std::vector<std::shared_ptr<ProfileThreadBuffer>> buffers;
+	std::vector<std::shared_ptr<ProfileThreadBuffer>> freeBuffers;
+	uint32_t ringBufferSize;
+	uint32_t threadCount;
+
+	public:
+
+	ProfileRegistry():ringBufferSize(16384),threadCount(0){
+		initMutex(m);
+	}
+
+	~ProfileRegistry(){
+		deleteMutex(m);
+	}
+
+	std::shared_ptr<ProfileThreadBuffer> acquireBuffer(){
+		lockMutex(m);
+		threadCount++;
+		std::shared_ptr<ProfileThreadBuffer> buffer;
+		if(!freeBuffers.empty()){
+			buffer = freeBuffers.back();
+			freeBuffers.pop_back();
+			buffer->clear();//events of the previous thread
+			lockMutex(buffer->m);
+			buffer->threadName.clear();
+			unlockMutex(buffer->m);
+			buffer->threadId = threadCount;
+		}else{
+			buffer = std::make_shared<ProfileThreadBuffer>(threadCount, ringBufferSize);
+			buffers.push_back(buffer);
+		}
+		unlockMutex(m);
+		return buffer;
+	}
+
+	void releaseBuffer(const std::shared_ptr<ProfileThreadBuffer>& buffer){
+		lockMutex(m);
+		if(buffer->size==ringBufferSize){
+			freeBuffers.push_back(buffer);
+		}else{
+			buffers.erase(std::find(buffers.begin(), buffers.end(), buffer));
+		}
+		unlockMutex(m);
+	}
+
+	void setRingBufferSize(uint32_t eventCount){
+		lockMutex(m);
+		ringBufferSize = std::max(eventCount, (uint32_t)1);
+		for(auto& b : freeBuffers){//can not be reused
+			buffers.erase(std::find(buffers.begin(), buffers.end(), b));
+		}
+		freeBuffers.clear();
+		unlockMutex(m);
+	}
+
+	std::vector<std::shared_ptr<ProfileThreadBuffer>> getBuffers(){
+		lockMutex(m);
+		std::vector<std::shared_ptr<ProfileThreadBuffer>> res = buffers;
+		unlockMutex(m);
+		return res;
+	}
+
+};
+
+static ProfileRegistry& getProfileRegistry(){
+	static ProfileRegistry registry;
+	return registry;
+}
+
+//! releases the buffer when the thread exits
+struct ProfileThreadBufferHolder{
+
+	std::shared_ptr<ProfileThreadBuffer> buffer;
+
+	ProfileThreadBufferHolder():buffer(getProfileRegistry().acquireBuffer()){}
+
+	~ProfileThreadBufferHolder(){
+		getProfileRegistry().releaseBuffer(buffer);
+	}
+
+};
+
+static ProfileThreadBuffer* getCurrentProfileThreadBuffer(){
+	thread_local ProfileThreadBufferHolder holder;
+	return holder.buffer.get();
+}
+
+static const std::chrono::steady_clock::time_point profileStartTime = std::chrono::steady_clock::now();
+
+uint64_t getProfileTime(){
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-profileStartTime).count();
+}
+
+void recordProfileEvent(const char* name, uint64_t startTime, uint64_t endTime){
+	getCurrentProfileThreadBuffer()->record(name, startTime, endTime);
+}
+
+void setProfileThreadName(const std::string& name){
+	ProfileThreadBuffer* buffer = getCurrentProfileThreadBuffer();
+	lockMutex(buffer->m);
+	buffer->threadName = name;
+	unlockMutex(buffer->m);
+}
+
+void setProfileRingBufferSize(uint32_t eventCount){
+	getProfileRegistry().setRingBufferSize(eventCount);
+}
+
+uint32_t getProfileThreadBufferCount(){
+	return getProfileRegistry().getBuffers().size();
+}
+
+void clearProfileData(){
+	std::vector<std::shared_ptr<ProfileThreadBuffer>> buffers = getProfileRegistry().getBuffers();
+	for(auto& b : buffers){
+		b->clear();
+	}
+}
+
+static void writeJSONString(std::ostream& out, const char* s){
+	out << '"';
+	for(; *s; s++){
+		unsigned char c = *s;
+		if(c=='"' || c=='\\'){
+			out << '\\' << c;
+		}else if(c<0x20){
+			out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)c << std::dec << std::setfill(' ');
+		}else{
+			out << c;
+		}
+	}
+	out << '"';
+}
+
+void writeChromeTrace(std::ostream& out){
+	std::vector<std::shared_ptr<ProfileThreadBuffer>> buffers = getProfileRegistry().getBuffers();
+	out << "{\"traceEvents\":[";
+	bool first = true;
+	std::vector<ProfileEvent> events;
+	std::ios::fmtflags flags = out.flags();
+	out << std::fixed << std::setprecision(3);
+	for(auto& b : buffers){
+		uint32_t threadId = b->threadId;
+		lockMutex(b->m);
+		std::string threadName = b->threadName;
+		unlockMutex(b->m);
+		if(!threadName.empty()){
+			if(!first){out << ",\n";}
+			first = false;
+			out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << threadId << ",\"args\":{\"name\":";
+			writeJSONString(out, threadName.c_str());
+			out << "}}";
+		}
+		events.clear();
+		b->copyEvents(events);
+		for(const ProfileEvent& e : events){
+			if(!first){out << ",\n";}
+			first = false;
+			out << "{\"name\":";
+			writeJSONString(out, e.name);
+			out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << threadId << ",\"ts\":" << (e.startTime/1000.0) << ",\"dur\":" << ((e.endTime-e.startTime)/1000.0) << "}";
+		}
+	}
+	out << "]}\n";
+	out.flags(flags);
+}
+
+//! nearest rank percentile of sorted values
+static double getPercentile(const std::vector<double>& sorted, double percentile){
+	uint32_t rank = (uint32_t)std::ceil(percentile/100.0*sorted.size());
+	return sorted[rank>0?(rank-1):0];
+}
+
+std::vector<ProfileStatistics> calcProfileStatistics(double windowSeconds){
+	uint64_t now = getProfileTime();
+	uint64_t window = windowSeconds*1000000000.0;
+	uint64_t minEndTime = now>window?(now-window):0;
+	std::map<std::string, std::vector<double>> durations;
+	std::vector<ProfileEvent> events;
+	std::vector<std::shared_ptr<ProfileThreadBuffer>> buffers = getProfileRegistry().getBuffers();
+	for(auto& b : buffers){
+		events.clear();
+		b->copyEvents(events);
+		for(const ProfileEvent& e : events){
+			if(e.endTime>=minEndTime){
+				durations[e.name].push_back((e.endTime-e.startTime)/1000.0);
+			}
+		}
+	}
+	std::vector<ProfileStatistics> res;
+	res.reserve(durations.size());
+	for(auto& d : durations){
+		std::vector<double>& v = d.second;
+		std::sort(v.begin(), v.end());
+		double sum = 0.0;
+		for(double x : v){sum += x;}
+		res.push_back(ProfileStatistics{d.first, (uint32_t)v.size(), sum/v.size(), getPercentile(v, 50.0), getPercentile(v, 90.0), getPercentile(v, 99.0), v.back()});
+	}
+	return res;
+}
+
+std::string printProfileStatistics(double windowSeconds){
+	std::vector<ProfileStatistics> stats = calcProfileStatistics(windowSeconds);
+	std::stringstream ss;
+	ss << std::fixed << std::setprecision(1);
+	ss << "Profile statistics of the last " << windowSeconds << " s [µs]:\n";
+	ss << std::left << std::setw(40) << "name" << std::right << std::setw(10) << "count" << std::setw(12) << "mean" << std::setw(12) << "p50" << std::setw(12) << "p90" << std::setw(12) << "p99" << std::setw(12) << "max" << "\n";
+	for(const ProfileStatistics& s : stats){
+		ss << std::left << std::setw(40) << s.name << std::right << std::setw(10) << s.count << std::setw(12) << s.mean << std::setw(12) << s.p50 << std::setw(12) << s.p90 << std::setw(12) << s.p99 << std::setw(12) << s.max << "\n";
+	}
+	return ss.str();
+}
@@ -0,0 +1,83 @@
+#ifndef Profiler_H_INCLUDED
+#define Profiler_H_INCLUDED
+
+//! Low overhead scope based profiling for the host side (see uCProfiler.h for microcontrollers)
+//! Each thread records its events into its own ring buffer (without locking), the collected events can be exported as Chrome trace-event JSON
+//! (load in chrome://tracing or https://ui.perfetto.dev) or summarized as percentiles over a rolling time window.
+//! To enable the PROFILE_SCOPE macros define USE_PROFILING (e.g. make USE_PROFILING=1), otherwise they expand to nothing.
+//! The functions below are always available, e.g. for recording events of other profilers.
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <ostream>
+
+#define PROFILE_CONCAT_IMPL(A, B) A##B
+#define PROFILE_CONCAT(A, B) PROFILE_CONCAT_IMPL(A, B)
+
+#ifdef USE_PROFILING
+//! NAME must be a string literal or must live as long as the profile data is used
+#define PROFILE_SCOPE(NAME) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(NAME)
+#define PROFILE_THREAD_NAME(NAME) setProfileThreadName(NAME)
+#else
+#define PROFILE_SCOPE(NAME)
+#define PROFILE_THREAD_NAME(NAME)
+#endif
+
+//! nanoseconds since program start (monotonic clock)
+uint64_t getProfileTime();
+
+//! records an event of the current thread, name must be a string literal or must live as long as the profile data is used
+void recordProfileEvent(const char* name, uint64_t startTime, uint64_t endTime);
+
+//! sets the name of the current thread in the exported data
+void setProfileThreadName(const std::string& name);
+
+//! sets the ring buffer size (event count) for threads which record their first event afterwards (default: 16384)
+void setProfileRingBufferSize(uint32_t eventCount);
+
+//! number of ring buffers, a buffer is reused by the next thread after its thread has exited
+uint32_t getProfileThreadBufferCount();
+
+//! removes all recorded events
+void clearProfileData();
+
+//! writes all recorded events in Chrome trace-event JSON format
+void writeChromeTrace(std::ostream& out);
+
+struct ProfileStatistics{
+	std::string name;
+	uint32_t count;
+	//! all times in microseconds
+	double mean;
+	double p50;
+	double p90;
+	double p99;
+	double max;
+};
+
+//! statistics per name of the events which ended in the last windowSeconds, sorted by name
+std::vector<ProfileStatistics> calcProfileStatistics(double windowSeconds = 10.0);
+
+//! human readable table of calcProfileStatistics
+std::string printProfileStatistics(double windowSeconds = 10.0);
+
+//! measures its own life time
+class ProfileScope{
+
+	private:
+
+	const char* name;
+	uint64_t startTime;
+
+	public:
+
+	ProfileScope(const char* name):name(name),startTime(getProfileTime()){}
+
+	~ProfileScope(){
+		recordProfileEvent(name, startTime, getProfileTime());
+	}
+
+};
+
+#endif
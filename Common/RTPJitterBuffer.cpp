@@ -0,0 +1,399 @@
+#include "RTPJitterBuffer.h"
+
+#include <BitFunctions.h>
+#include <timing.h>
+
+#include <map>
+#include <deque>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+#include <iostream>
+
+RTPJitterBuffer::Parameters::Parameters():clockRate(90000),minDelay(0.01),maxDelay(0.5),jitterFactor(4.0),maxPendingFrames(64),maxPacketsPerFrame(500),sourceTimeout(1.0){}
+
+//! minimum (TCompare = std::less) or maximum (std::greater) of the last values
+template<typename TCompare>
+class WindowExtremum{
+
+	std::deque<std::pair<uint64_t, double> > candidates;//ordered by TCompare
+	uint64_t count;
+	uint64_t windowSize;
+	TCompare compare;
+
+	public:
+
+	WindowExtremum(uint64_t windowSize):count(0),windowSize(windowSize){}
+
+	void add(double value){
+		while(!candidates.empty() && !compare(candidates.back().second, value)){candidates.pop_back();}
+		candidates.emplace_back(count, value);
+		count++;
+		if(candidates.front().first+windowSize<count){candidates.pop_front();}
+	}
+
+	bool isEmpty() const{
+		return candidates.empty();
+	}
+
+	double get() const{
+		return candidates.front().second;
+	}
+
+};
+
+class RTPJitterBufferPrivate{
+
+	public:
+
+	using Frame = RTPJitterBuffer::Frame;
+
+	enum FrameState{PENDING, GIVEN_UP, DONE};//GIVEN_UP: playout time passed while incomplete, DONE: played / late / lost (kept to find the start of the next frame)
+
+	struct PendingFrame{
+		std::map<int64_t, std::vector<char> > packets;//extended sequence number -> payload
+		int64_t endSequenceNumber = -1;//marker
+		int64_t lastSequenceNumber = -1;//highest received
+		FrameState state = PENDING;
+		bool complete = false;
+		bool counted = true;//false for frames before the first played frame
+	};
+
+	ICommunicationEndpoint* slaveSocket;
+	const bool mustDelete;
+	const RTPJitterBuffer::Parameters params;
+
+	static constexpr uint32_t maxPacketSize = 65536;
+	char buf[maxPacketSize];
+
+	std::map<int64_t, PendingFrame> frames;//extended timestamp -> frame
+	Frame frame;
+
+	bool anyReceived;
+	uint32_t sourceSSRC;
+	double lastSourceTime;//of the last accepted packet
+	int64_t firstSequenceNumber, highestSequenceNumber;
+	int64_t firstTimestamp, highestTimestamp;
+	int64_t lastSlotTimestamp;//timestamp of the last playout time (played or concealed)
+	bool anyPlayed;
+	uint32_t concealedSinceLastPlayed;
+
+	WindowExtremum<std::less<double> > minTransit;//completion time - timestamp time, minimum is the base for the schedule
+	WindowExtremum<std::greater<double> > maxTransit;
+	WindowExtremum<std::less<double> > frameInterval;//smallest timestamp difference of consecutive frames
+	double lastTransit;
+	bool anyTransit;
+	double jitter;
+	double delay;
+
+	RTPJitterBuffer::Statistics stats;
+	int64_t expectedPrior, receivedPrior;//for the receiver report
+
+	RTPJitterBufferPrivate(ICommunicationEndpoint* slaveSocket, bool mustDelete, const RTPJitterBuffer::Parameters& params):slaveSocket(slaveSocket),mustDelete(mustDelete),params(params),minTransit(128),maxTransit(128),frameInterval(32){
+		reset();
+	}
+
+	//! initial state, also used if the source changes
+	void reset(){
+		frames.clear();
+		anyReceived = false;
+		sourceSSRC = 0;
+		lastSourceTime = 0.0;
+		firstSequenceNumber = highestSequenceNumber = 0;
+		firstTimestamp = highestTimestamp = 0;
+		lastSlotTimestamp = 0;
+		anyPlayed = false;
+		concealedSinceLastPlayed = 0;
+		minTransit = WindowExtremum<std::less<double> >(128);
+		maxTransit = WindowExtremum<std::greater<double> >(128);
+		frameInterval = WindowExtremum<std::less<double> >(32);
+		lastTransit = 0.0;
+		anyTransit = false;
+		jitter = 0.0;
+		delay = params.minDelay;
+		expectedPrior = receivedPrior = 0;
+		memset(&stats, 0, sizeof(stats));
+	}
+
+	~RTPJitterBufferPrivate(){
+		if(mustDelete){
+			delete slaveSocket;
+		}
+	}
+
+	//! closest value to reference with the given lower bits
+	template<typename TUnsigned, typename TSigned>
+	static int64_t extend(TUnsigned value, int64_t reference){
+		return reference+(TSigned)(TUnsigned)(value-(TUnsigned)reference);
+	}
+
+	double getTimestampTime(int64_t timestamp) const{
+		return (timestamp-firstTimestamp)/(double)params.clockRate;
+	}
+
+	double getPlayoutTime(int64_t timestamp) const{
+		return getTimestampTime(timestamp)+minTransit.get()+delay;
+	}
+
+	//! -1 if unknown
+	int64_t getStartSequenceNumber(std::map<int64_t, PendingFrame>::iterator it){
+		if(it==frames.begin() || it->second.packets.empty()){return -1;}
+		const PendingFrame& previous = std::prev(it)->second;
+		if(previous.endSequenceNumber>=0){
+			return previous.endSequenceNumber+1;
+		}else if(previous.lastSequenceNumber>=0 && previous.lastSequenceNumber+1==it->second.packets.begin()->first){
+			return it->second.packets.begin()->first;
+		}
+		return -1;
+	}
+
+	void checkComplete(std::map<int64_t, PendingFrame>::iterator it, double t){
+		PendingFrame& f = it->second;
+		if(f.complete || f.state==DONE || f.endSequenceNumber<0){return;}
+		int64_t start = getStartSequenceNumber(it);
+		if(start>=0 && f.packets.begin()->first==start && (int64_t)f.packets.size()==f.endSequenceNumber-start+1){
+			f.complete = true;
+			double transit = t-getTimestampTime(it->first);
+			if(anyTransit){
+				jitter += (std::abs(transit-lastTransit)-jitter)/16.0;//RFC 3550
+			}
+			anyTransit = true;
+			lastTransit = transit;
+			minTransit.add(transit);
+			maxTransit.add(transit);
+			//the spread of the transit times covers the frames which complete late because of a single slow packet (underestimated by the averaged jitter)
+			double target = std::min(params.maxDelay, std::max(params.minDelay, std::max(params.jitterFactor*jitter, maxTransit.get()-minTransit.get())));
+			if(f.state==GIVEN_UP){//late => the delay must cover it
+				target = std::min(params.maxDelay, std::max(target, transit-minTransit.get()));
+				if(f.counted){stats.lateFrames++;}
+				f.state = DONE;
+				f.packets.clear();
+			}
+			if(target>delay){
+				delay = target;
+			}else{
+				delay += (target-delay)/64.0;
+			}
+		}
+	}
+
+	//! parses the header and inserts the payload
+	void insertPacket(uint32_t received, double t){
+		if(received<12){return;}
+		const uint8_t* data = (const uint8_t*)buf;
+		if(((data[0]>>6)&0b11)!=2){return;}
+		bool hasPadding = getBit(data[0], 5);
+		bool hasExtension = getBit(data[0], 4);
+		bool marker = getBit(data[1], 7);
+		uint32_t offset = 2;
+		uint16_t sequenceNumber = readBigEndian<uint16_t>(data, offset);
+		uint32_t timestamp = readBigEndian<uint32_t>(data, offset);
+		uint32_t ssrc = readBigEndian<uint32_t>(data, offset);
+		uint32_t start = 12+4*(data[0]&0b1111);
+		if(hasExtension){
+			if(start+4>received){return;}
+			uint32_t extensionOffset = start+2;
+			start += 4+4*readBigEndian<uint16_t>(data, extensionOffset);
+		}
+		uint32_t end = received;
+		if(hasPadding){
+			if(data[received-1]>received){return;}
+			end -= data[received-1];
+		}
+		if(start>end){return;}
+		if(anyReceived && ssrc!=sourceSSRC){
+			if(t-lastSourceTime<params.sourceTimeout){
+				stats.foreignPackets++;
+				return;
+			}
+			std::cout << "RTP source changed, restarting the jitter buffer." << std::endl;
+			reset();
+		}
+		lastSourceTime = t;
+		if(!anyReceived){
+			anyReceived = true;
+			sourceSSRC = ssrc;
+			firstSequenceNumber = highestSequenceNumber = sequenceNumber+(1<<16);//cycles may be negative due to reordering
+			firstTimestamp = highestTimestamp = timestamp;
+			lastSlotTimestamp = (int64_t)timestamp-1;
+		}
+		int64_t extSequenceNumber = extend<uint16_t, int16_t>(sequenceNumber, highestSequenceNumber);
+		int64_t extTimestamp = extend<uint32_t, int32_t>(timestamp, highestTimestamp);
+		firstSequenceNumber = std::min(firstSequenceNumber, extSequenceNumber);//reordered at the start
+		highestSequenceNumber = std::max(highestSequenceNumber, extSequenceNumber);
+		stats.receivedPackets++;
+		auto it = frames.find(extTimestamp);
+		if(it==frames.end()){
+			if(extTimestamp<=lastSlotTimestamp){return;}//frame already counted as lost
+			if(extTimestamp>highestTimestamp){
+				frameInterval.add(extTimestamp-highestTimestamp);
+				highestTimestamp = extTimestamp;
+			}
+			it = frames.emplace(extTimestamp, PendingFrame()).first;
+			it->second.counted = anyPlayed;
+		}
+		PendingFrame& f = it->second;
+		if(f.state==DONE){return;}
+		if(f.packets.find(extSequenceNumber)!=f.packets.end()){
+			stats.duplicatePackets++;
+			return;
+		}
+		if(f.packets.size()>=params.maxPacketsPerFrame){
+			std::cerr << "Frame too large, dropping." << std::endl;
+			dropFrame(it);
+			return;
+		}
+		f.packets.emplace(extSequenceNumber, std::vector<char>(buf+start, buf+end));
+		f.lastSequenceNumber = std::max(f.lastSequenceNumber, extSequenceNumber);
+		if(marker){f.endSequenceNumber = extSequenceNumber;}
+		checkComplete(it, t);
+		auto next = std::next(it);
+		if(next!=frames.end()){checkComplete(next, t);}//start of the next frame may be known now
+	}
+
+	void dropFrame(std::map<int64_t, PendingFrame>::iterator it){
+		PendingFrame& f = it->second;
+		if(f.state==PENDING){
+			consumeSlot(it->first, f.counted);
+		}
+		if(f.counted){stats.lostFrames++;}
+		f.state = DONE;
+		f.packets.clear();
+	}
+
+	//! playout time of a frame passed, frames between the last one and this one have been lost completely
+	void consumeSlot(int64_t timestamp, bool counted){
+		if(counted && !frameInterval.isEmpty()){
+			int64_t missing = llround((timestamp-lastSlotTimestamp)/frameInterval.get())-1;
+			if(missing>0){
+				stats.lostFrames += missing;
+				stats.concealedFrames += missing;
+				concealedSinceLastPlayed += missing;
+			}
+		}
+		lastSlotTimestamp = timestamp;
+	}
+
+	//! removes finished frames except the last one before the pending frames
+	void removeFinished(double t){
+		while(frames.size()>1 && frames.begin()->second.state==DONE && std::next(frames.begin())->second.state==DONE){
+			frames.erase(frames.begin());
+		}
+		uint32_t pendingCount = 0;
+		for(auto it=frames.begin(); it!=frames.end(); ++it){
+			if(it->second.state==GIVEN_UP && t>getPlayoutTime(it->first)+params.maxDelay){
+				if(it->second.counted){stats.lostFrames++;}
+				it->second.state = DONE;
+				it->second.packets.clear();
+			}else if(it->second.state==PENDING){
+				pendingCount++;
+			}
+		}
+		for(auto it=frames.begin(); it!=frames.end() && pendingCount>params.maxPendingFrames; ++it){
+			if(it->second.state==PENDING){
+				dropFrame(it);
+				pendingCount--;
+			}
+		}
+	}
+
+	const Frame* update(double t){
+		int32_t received = slaveSocket->recv(buf, maxPacketSize);
+		while(received>0){
+			insertPacket(received, t);
+			received = slaveSocket->recv(buf, maxPacketSize);
+		}
+		removeFinished(t);
+		if(minTransit.isEmpty()){return NULL;}//no complete frame yet
+		for(auto it=frames.begin(); it!=frames.end(); ++it){
+			PendingFrame& f = it->second;
+			if(f.state!=PENDING){continue;}
+			double playoutTime = getPlayoutTime(it->first);
+			if(playoutTime>t){return NULL;}
+			consumeSlot(it->first, f.counted);
+			if(f.complete){
+				frame.timestamp = (uint32_t)it->first;
+				frame.payload.clear();
+				for(auto& packet : f.packets){
+					frame.payload.insert(frame.payload.end(), packet.second.begin(), packet.second.end());
+				}
+				frame.playoutTime = playoutTime;
+				frame.concealedBefore = concealedSinceLastPlayed;
+				concealedSinceLastPlayed = 0;
+				f.state = DONE;
+				f.packets.clear();
+				if(!anyPlayed){//frames before the first played one are not counted
+					anyPlayed = true;
+					for(auto& other : frames){other.second.counted = other.first>it->first;}
+				}
+				stats.playedFrames++;
+				return &frame;
+			}else{
+				f.state = GIVEN_UP;
+				if(f.counted){
+					stats.concealedFrames++;
+					concealedSinceLastPlayed++;
+				}
+			}
+		}
+		return NULL;
+	}
+
+	RTPJitterBuffer::Statistics getStatistics() const{
+		RTPJitterBuffer::Statistics res = stats;
+		res.lostPackets = anyReceived?(highestSequenceNumber-firstSequenceNumber+1-(int64_t)(stats.receivedPackets-stats.duplicatePackets)):0;
+		res.jitter = jitter;
+		res.delay = delay;
+		return res;
+	}
+
+	uint32_t writeReceiverReport(uint8_t* buf, uint32_t bufSize, uint32_t ssrc){
+		if(!anyReceived || bufSize<32){return 0;}
+		int64_t expected = highestSequenceNumber-firstSequenceNumber+1;
+		int64_t received = stats.receivedPackets-stats.duplicatePackets;
+		int64_t expectedInterval = expected-expectedPrior;
+		int64_t lostInterval = expectedInterval-(received-receivedPrior);
+		expectedPrior = expected;
+		receivedPrior = received;
+		uint8_t fractionLost = (expectedInterval<=0 || lostInterval<=0)?0:(uint8_t)((lostInterval<<8)/expectedInterval);
+		int32_t lost = (int32_t)std::max<int64_t>(-0x800000, std::min<int64_t>(0x7FFFFF, expected-received));
+		uint32_t offset = 0;
+		buf[offset++] = 0b10000001;//version 2, one report block
+		buf[offset++] = 201;//receiver report
+		writeBigEndian<uint16_t>(buf, offset, 7);//length in 32 bit words - 1
+		writeBigEndian<uint32_t>(buf, offset, ssrc);
+		writeBigEndian<uint32_t>(buf, offset, sourceSSRC);
+		writeBigEndian<uint32_t>(buf, offset, ((uint32_t)fractionLost<<24) | ((uint32_t)lost&0xFFFFFF));
+		writeBigEndian<uint32_t>(buf, offset, (uint32_t)(highestSequenceNumber-(1<<16)));//cycles and highest sequence number
+		writeBigEndian<uint32_t>(buf, offset, (uint32_t)(jitter*params.clockRate));
+		writeBigEndian<uint32_t>(buf, offset, 0);//no sender reports evaluated
+		writeBigEndian<uint32_t>(buf, offset, 0);
+		return offset;
+	}
+
+};
+
+RTPJitterBuffer::RTPJitterBuffer(ICommunicationEndpoint* slaveSocket, bool mustDelete, const Parameters& params){
+	p = new RTPJitterBufferPrivate(slaveSocket, mustDelete, params);
+}
+
+RTPJitterBuffer::~RTPJitterBuffer(){
+	delete p;
+}
+
+const RTPJitterBuffer::Frame* RTPJitterBuffer::update(double t){
+	return p->update(t);
+}
+
+const RTPJitterBuffer::Frame* RTPJitterBuffer::update(){
+	return p->update(getSecs());
+}
+
+RTPJitterBuffer::Statistics RTPJitterBuffer::getStatistics() const{
+	return p->getStatistics();
+}
+
+uint32_t RTPJitterBuffer::writeReceiverReport(uint8_t* buf, uint32_t bufSize, uint32_t ssrc){
+	return p->writeReceiverReport(buf, bufSize, ssrc);
+}
@@ -0,0 +1,74 @@
+#ifndef RTPJitterBuffer_H_
+#define RTPJitterBuffer_H_
+
+#include "ICommunicationEndpoint.h"
+
+#include <cstdint>
+#include <vector>
+
+class RTPJitterBufferPrivate;
+
+//! Receives RTP packets of frame based payloads such as MJPEG (all packets of a frame share the timestamp, marker is set at a frame's end) and releases the frames on a schedule derived from their timestamps.
+//! The playout delay adapts to the jitter of the frame completion times (interarrival jitter as in RFC 3550 and the spread of the recent transit times): it increases immediately if frames are late and decreases slowly.
+//! A frame is only released if its first packet is known to follow the last packet of the previous frame, the frames before the first released one are not counted.
+//! Only the source (SSRC) of the first packet is accepted, the buffer restarts with another source (including the statistics) if the current one has been silent for sourceTimeout.
+class RTPJitterBuffer{
+
+	RTPJitterBufferPrivate* p;
+
+	public:
+
+	struct Parameters{
+		uint32_t clockRate;//! timestamp units per second (90000 for video)
+		double minDelay;//! s
+		double maxDelay;//! s
+		double jitterFactor;//! target delay = jitterFactor * jitter
+		uint32_t maxPendingFrames;//! the oldest pending frame is dropped if exceeded
+		uint32_t maxPacketsPerFrame;
+		double sourceTimeout;//! s, packets of other sources are ignored while the current source has sent packets within this time
+
+		Parameters();
+	};
+
+	struct Frame{
+		uint32_t timestamp;
+		std::vector<char> payload;//! payloads of all packets in sequence order
+		double playoutTime;//! scheduled time (time base of getSecs)
+		uint32_t concealedBefore;//! frames which could not be played out since the previous frame (late or lost), the previous frame should be shown meanwhile
+	};
+
+	struct Statistics{
+		uint64_t receivedPackets;
+		uint64_t duplicatePackets;
+		uint64_t foreignPackets;//! packets of other sources (ignored)
+		int64_t lostPackets;//! expected - received (RFC 3550)
+		uint64_t playedFrames;
+		uint64_t lateFrames;//! completed after the playout time
+		uint64_t lostFrames;//! never completed
+		uint64_t concealedFrames;//! playout times without a frame (late or lost)
+		double jitter;//! s
+		double delay;//! current playout delay in s
+	};
+
+	//! slaveSocket must be packet oriented, mustDelete: true if slaveSocket must be deleted on destruction
+	RTPJitterBuffer(ICommunicationEndpoint* slaveSocket, bool mustDelete = true, const Parameters& params = Parameters());
+
+	~RTPJitterBuffer();
+
+	//! receives the available packets and returns the next frame if it is due at time t (getSecs), NULL otherwise
+	//! the frame is valid until the next call, should be called until NULL is returned to catch up
+	const Frame* update(double t);
+
+	//! update(getSecs())
+	const Frame* update();
+
+	Statistics getStatistics() const;
+
+	//! writes an RTCP receiver report (RFC 3550) for the received source, ssrc identifies the receiver
+	//! returns the size (32 bytes), 0 if nothing has been received yet or bufSize is too small
+	//! the jitter field contains the jitter of the frame completion times
+	uint32_t writeReceiverReport(uint8_t* buf, uint32_t bufSize, uint32_t ssrc);
+
+};
+
+#endif
@@ -8,9 +8,11 @@
 #include <sstream>
 #include <iostream>
 #include <memory>
+#include <random>
 
 #define TCP_CONNECT_TIMEOUT 1000 //ms
 #define RTSP_RECV_BUF_SIZE 1024
+#define RTCP_BUF_SIZE 64
 
 class RTSPClientPrivate{
 
@@ -46,6 +48,69 @@ class RTSPClientPrivate{
 	
 	double lastHeartbeatTime, lastReceiveTime;
 	
+	//jitter buffer (optional)
+	bool useJitterBuffer;
+	RTPJitterBuffer::Parameters jitterBufferParams;
+	double reportPeriod;
+	uint32_t ssrc;//receiver
+	uint16_t serverRTCPPort;//0 if unknown
+	RTPJitterBuffer* jitterBuffer;
+	IPv4UDPSocket* rtcpSocket;
+	double lastReportTime;
+	
+	void createJitterBuffer(){
+		IPv4UDPSocket* rtpSocket = new IPv4UDPSocket();
+		rtpSocket->setReceiveBufferSize(4*1024*1024);//frames arrive in bursts
+		rtcpSocket = new IPv4UDPSocket();
+		if(useMulticast){
+			if(address->getIPVersion()!=IIPAddress::IPV4){
+				std::cerr << "Error: The jitter buffer only supports IPv4 multicast." << std::endl;
+				delete rtpSocket;
+				delete rtcpSocket;
+				rtcpSocket = NULL;
+				return;
+			}
+			IPv4Address group(address->getAddressAsString(), address->getPort());
+			rtpSocket->bind(group.getPort(), true);
+			rtpSocket->enableAutoMulticastGroupJoining(group);
+			rtcpSocket->bind(group.getPort()+1, true);
+			rtcpSocket->setUDPTarget(IPv4Address(group.getAddressAsString(), group.getPort()+1));
+			serverRTCPPort = group.getPort()+1;
+		}else{
+			rtpSocket->bind(rtpPort);
+			rtcpSocket->bind(rtpPort+1);
+			IIPAddress* server = serverRTCPPort==0?NULL:s->createPeerAddress();//the address of the RTSP connection (resolving the host name again could block the update)
+			if(server && server->getIPVersion()==IIPAddress::IPV4){
+				server->setPort(serverRTCPPort);
+				rtcpSocket->setUDPTarget(*(IPv4Address*)server);
+			}else{
+				if(serverRTCPPort!=0){std::cerr << "No IPv4 address of the RTSP server, receiver reports are disabled." << std::endl;}
+				serverRTCPPort = 0;
+			}
+			delete server;
+		}
+		jitterBuffer = new RTPJitterBuffer(rtpSocket, true, jitterBufferParams);
+		lastReportTime = getSecs();
+	}
+	
+	void sendReceiverReport(double t){
+		if(jitterBuffer && serverRTCPPort!=0 && t-lastReportTime>reportPeriod){
+			lastReportTime = t;
+			uint8_t report[RTCP_BUF_SIZE];
+			uint32_t size = jitterBuffer->writeReceiverReport(report, RTCP_BUF_SIZE, ssrc);
+			if(size>0){
+				rtcpSocket->send((const char*)report, size);
+			}
+		}
+	}
+	
+	void deleteJitterBuffer(){
+		delete jitterBuffer;
+		jitterBuffer = NULL;
+		delete rtcpSocket;
+		rtcpSocket = NULL;
+	}
+	
 	void fillSameFieldsAndSend(std::stringstream& ss){
 		ss << "CSeq: " << cseq << "\r\n";
 		ss << "User-Agent: MissionServer\r\n\r\n";
@@ -174,13 +239,14 @@ class RTSPClientPrivate{
 	}
 	
 	void reset(){
+		deleteJitterBuffer();
 		delete s;
 		s = NULL;
 		state = 0;
 		action = 0;
 	}
 	
-	RTSPClientPrivate(const std::string& url, uint16_t rtpPort, double heartBeatPeriod):state(0),cseq(1),action(0),url(url),rtpPort(rtpPort),heartBeatPeriod(heartBeatPeriod),s(NULL){
+	RTSPClientPrivate(const std::string& url, uint16_t rtpPort, double heartBeatPeriod):state(0),cseq(1),action(0),url(url),rtpPort(rtpPort),heartBeatPeriod(heartBeatPeriod),s(NULL),useJitterBuffer(false),reportPeriod(5.0),ssrc(std::random_device()()),serverRTCPPort(0),jitterBuffer(NULL),rtcpSocket(NULL){
 		if(url.size()>7){//"rtsp://"
 			if(convertStringToUpper(url.substr(0,7))=="RTSP://"){
 				auto colonPos = url.find(':', 7);
@@ -200,6 +266,7 @@ class RTSPClientPrivate{
 	}
 	
 	~RTSPClientPrivate(){
+		deleteJitterBuffer();
 		delete s;
 	}
 	
@@ -255,6 +322,9 @@ class RTSPClientPrivate{
 				return;
 			}
 			//Communication state dependent //0: not connected, 1: connecting (mjpg), 2: options sent (mjpg), 3: describe sent (mjpg), 4: setup sent (mjpg), 5: play sent (mjpg), 6: playing (mjpg), 7: playing (heartbeat sent)
+			if(state==6 || state==7){
+				sendReceiverReport(t);
+			}
 			if(state==1){
 				sendOptions();
 				state = 2;
@@ -337,6 +407,15 @@ class RTSPClientPrivate{
 							}
 						}else{
 							address = std::shared_ptr<IIPAddress>(new IPv4Address("127.0.0.1", rtpPort));
+							serverRTCPPort = 0;
+							for(const std::string& s : transportFields){
+								if(isPrefixEqual(s, "server_port=")){
+									size_t dashPos = s.find('-', 12);
+									if(dashPos!=std::string::npos){//second port is rtcp
+										serverRTCPPort = convertStringTo<uint16_t>(s.substr(dashPos+1, std::string::npos));
+									}
+								}
+							}
 						}
 						sendPlay();
 						state = 5;
@@ -344,6 +423,9 @@ class RTSPClientPrivate{
 				}
 			}else if(state==5){
 				if(newResponse){
+					if(useJitterBuffer){
+						createJitterBuffer();
+					}
 					OnPlay(*address, useMulticast);
 					lastHeartbeatTime = t;
 					state = 6;
@@ -395,3 +477,13 @@ void RTSPClient::play(const std::function<void(const IIPAddress&, bool)>& OnPlay
 void RTSPClient::stop(){
 	p->action = 0;
 }
+
+void RTSPClient::enableJitterBuffer(const RTPJitterBuffer::Parameters& params, double reportPeriod){
+	p->useJitterBuffer = true;
+	p->jitterBufferParams = params;
+	p->reportPeriod = reportPeriod;
+}
+
+RTPJitterBuffer* RTSPClient::getJitterBuffer(){
+	return p->jitterBuffer;
+}
@@ -1,6 +1,8 @@
 #ifndef RTSPClient_H_
 #define RTSPClient_H_
 
+#include "RTPJitterBuffer.h"
+
 #include <string>
 #include <cstdint>
 #include <functional>
@@ -32,6 +34,13 @@ class RTSPClient{
 	
 	void stop();
 	
+	//! must be called before play: the client receives the RTP stream itself (IPv4 only) and releases the frames using a jitter buffer (see getJitterBuffer)
+	//! RTCP receiver reports are sent every reportPeriod seconds from rtpPort+1 (unicast, if the server announces its ports) or to the multicast group
+	void enableJitterBuffer(const RTPJitterBuffer::Parameters& params = RTPJitterBuffer::Parameters(), double reportPeriod = 5.0);
+	
+	//! NULL if not enabled or not playing, RTPJitterBuffer::update must be called regularly to get the frames
+	RTPJitterBuffer* getJitterBuffer();
+	
 };
 
 #endif
@@ -13,21 +13,50 @@
 #include <cassert>
 #include <cstring>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <atomic>
+
+#include <poll.h>
+
+static const unsigned char sessionIDContext[] = "SSLSocket";
+static const size_t maxCachedClientSessions = 256;
 
 class SSLContextPrivate{
 	
 	public:
 	
 	SSL_CTX* ctx;
+	SSLContext::Mode mode;
 	
 	std::list<RSA*> privateKeys;
 	std::list<X509*> certificates;
 	
-	SSLContextPrivate(SSLContext::Mode mode){
+	bool sessionResumption;
+	bool kernelTLS;
+	std::mutex sessionMutex;
+	std::map<std::string, SSL_SESSION*> peer2session;//client only
+	
+	std::atomic<uint32_t> fullHandshakeCount;
+	std::atomic<uint32_t> resumedHandshakeCount;
+	
+	SSLContextPrivate(SSLContext::Mode mode):mode(mode),sessionResumption(true),kernelTLS(false),fullHandshakeCount(0),resumedHandshakeCount(0){
 		ctx = SSL_CTX_new(mode==SSLContext::SERVER?TLS_server_method():TLS_client_method());
+		if(ctx){
+			SSL_CTX_set_app_data(ctx, this);
+			SSL_CTX_set_info_callback(ctx, onInfo);
+			if(mode==SSLContext::SERVER){
+				SSL_CTX_set_session_id_context(ctx, sessionIDContext, sizeof(sessionIDContext));
+				SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
+			}else{
+				SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+				SSL_CTX_sess_set_new_cb(ctx, onNewSession);
+			}
+		}
 	}
 	
 	~SSLContextPrivate(){
+		clearSessionCache();
 		SSL_CTX_free(ctx);
 		for(RSA* rsa : privateKeys){
 			RSA_free(rsa);
@@ -37,6 +66,33 @@ class SSLContextPrivate{
 		}
 	}
 	
+	void clearSessionCache(){
+		std::lock_guard<std::mutex> lock(sessionMutex);
+		for(auto& it : peer2session){
+			SSL_SESSION_free(it.second);
+		}
+		peer2session.clear();
+	}
+	
+	//! returns a new reference or NULL
+	SSL_SESSION* getSession(const std::string& peerName){
+		std::lock_guard<std::mutex> lock(sessionMutex);
+		auto it = peer2session.find(peerName);
+		if(it!=peer2session.end()){
+			if(SSL_SESSION_is_resumable(it->second)){
+				SSL_SESSION_up_ref(it->second);
+				return it->second;
+			}
+			SSL_SESSION_free(it->second);
+			peer2session.erase(it);
+		}
+		return NULL;
+	}
+	
+	static void onInfo(const SSL* ssl, int where, int ret);
+	
+	static int onNewSession(SSL* ssl, SSL_SESSION* session);
+	
 };
 
 SSLContext::SSLContext(Mode mode){
@@ -71,6 +127,38 @@ bool SSLContext::useCertificate(const std::vector<char>& data){
 	return success;
 }
 
+void SSLContext::setSessionResumptionEnabled(bool enabled){
+	p->sessionResumption = enabled;
+	if(p->mode==SERVER){
+		SSL_CTX_set_session_cache_mode(p->ctx, enabled?SSL_SESS_CACHE_SERVER:SSL_SESS_CACHE_OFF);
+		if(enabled){
+			SSL_CTX_clear_options(p->ctx, SSL_OP_NO_TICKET);
+		}else{
+			SSL_CTX_set_options(p->ctx, SSL_OP_NO_TICKET);
+		}
+		SSL_CTX_set_num_tickets(p->ctx, enabled?2:0);
+	}else if(!enabled){
+		p->clearSessionCache();
+	}
+}
+
+void SSLContext::setKernelTLSEnabled(bool enabled){
+	p->kernelTLS = enabled;
+	if(enabled){
+		SSL_CTX_set_options(p->ctx, SSL_OP_ENABLE_KTLS);
+	}else{
+		SSL_CTX_clear_options(p->ctx, SSL_OP_ENABLE_KTLS);
+	}
+}
+
+void SSLContext::clearSessionCache(){
+	p->clearSessionCache();
+}
+
+SSLContext::HandshakeStatistics SSLContext::getHandshakeStatistics() const{
+	return HandshakeStatistics{p->fullHandshakeCount, p->resumedHandshakeCount};
+}
+
 bool SSLContext::loadFile(std::vector<char>& out, const std::string& path){
 	std::ifstream f(path.c_str(), std::ifstream::binary);
 	if(f.good()){
@@ -111,17 +199,68 @@ class SSLSocketPrivate{
 	ICommunicationEndpoint* slaveSocket;
 	bool mustDeleteSlaveSocket;
 	
+	ASocket* directSocket;//not NULL if OpenSSL uses the socket directly (kTLS)
+	bool directReceive;//OpenSSL reads from the socket directly (only if kTLS receive is active after the handshake)
+	
 	bool pseudoBlocking;//during accept and connect
 	
 	SSL* ssl;
 	
-	SSLSocketPrivate(SSLContext* c, ICommunicationEndpoint* slaveSocket, bool mustDeleteSlaveSocket):c(c),slaveSocket(slaveSocket),mustDeleteSlaveSocket(mustDeleteSlaveSocket),pseudoBlocking(false){
+	std::string peerName;//client session cache key
+	
+	//! during accept and connect the records are collected and sent when reading (complete flight), the last flight is sent at the end of accept and connect
+	std::vector<char> pendingWrites;
+	
+	bool flushPendingWrites(){
+		bool success = pendingWrites.empty() || slaveSocket->send(&pendingWrites[0], pendingWrites.size());
+		pendingWrites.clear();
+		return success;
+	}
+	
+	SSLSocketPrivate(SSLContext* c, ICommunicationEndpoint* slaveSocket, bool mustDeleteSlaveSocket):c(c),slaveSocket(slaveSocket),mustDeleteSlaveSocket(mustDeleteSlaveSocket),directSocket(NULL),directReceive(false),pseudoBlocking(false){
 		ssl = SSL_new(c->p->ctx);
 		if(ssl){
+			SSL_set_app_data(ssl, this);
+			ASocket* socket = dynamic_cast<ASocket*>(slaveSocket);
+			if(socket){
+				socket->setNoDelay(true);//records are written as complete flights, otherwise the first data after the last flight of the handshake waits for the delayed acknowledgement
+			}
+			if(c->p->kernelTLS){
+				directSocket = socket;
+			}
+			if(directSocket && SSL_set_fd(ssl, directSocket->getSocketHandle())==1){
+				SSL_clear_mode(ssl, SSL_MODE_AUTO_RETRY);//the socket is blocking, recv must not block after non application data records (e.g. session tickets)
+			}else{
+				directSocket = NULL;
+				if(bio_method==NULL){init_bio_method();}
+				BIO* bio = BIO_new(bio_method);
+				BIO_set_data(bio, this);
+				SSL_set_bio(ssl, bio, bio);//bio is reference counted
+			}
+		}
+	}
+	
+	//! after the handshake: if the kernel does not decrypt the received records SSL_read on the blocking socket could block, the non blocking slave socket is used for receiving instead
+	void onHandshakeDone(){
+		if(!directSocket){return;}
+		#ifndef OPENSSL_NO_KTLS
+		directReceive = BIO_get_ktls_recv(SSL_get_rbio(ssl));
+		#endif
+		if(!directReceive){
 			if(bio_method==NULL){init_bio_method();}
 			BIO* bio = BIO_new(bio_method);
 			BIO_set_data(bio, this);
-			SSL_set_bio(ssl, bio, bio);//bio is reference counted
+			SSL_set0_rbio(ssl, bio);//frees the socket bio (does not close the socket)
+		}
+	}
+	
+	void useCachedSession(){
+		if(ssl && c->p->sessionResumption){
+			SSL_SESSION* session = c->p->getSession(peerName);
+			if(session){
+				SSL_set_session(ssl, session);
+				SSL_SESSION_free(session);
+			}
 		}
 	}
 	
@@ -129,6 +268,7 @@ class SSLSocketPrivate{
 		if(ssl){
 			int res = SSL_shutdown(ssl);
 			if(res<=0){ERR_print_errors_fp(stderr);}
+			flushPendingWrites();
 			SSL_free(ssl);
 		}
 		if(mustDeleteSlaveSocket){delete slaveSocket;}
@@ -136,6 +276,36 @@ class SSLSocketPrivate{
 	
 };
 
+void SSLContextPrivate::onInfo(const SSL* ssl, int where, int ret){
+	if((where&SSL_CB_HANDSHAKE_DONE)!=0){
+		SSLContextPrivate* p = (SSLContextPrivate*)SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl));
+		if(SSL_session_reused(ssl)){
+			p->resumedHandshakeCount++;
+		}else{
+			p->fullHandshakeCount++;
+		}
+	}
+}
+
+int SSLContextPrivate::onNewSession(SSL* ssl, SSL_SESSION* session){
+	SSLSocketPrivate* s = (SSLSocketPrivate*)SSL_get_app_data(ssl);
+	SSLContextPrivate* p = s->c->p;
+	if(s->peerName.empty() || !p->sessionResumption){return 0;}
+	std::lock_guard<std::mutex> lock(p->sessionMutex);
+	auto it = p->peer2session.find(s->peerName);
+	if(it!=p->peer2session.end()){
+		SSL_SESSION_free(it->second);
+		it->second = session;
+	}else{
+		if(p->peer2session.size()>=maxCachedClientSessions){
+			SSL_SESSION_free(p->peer2session.begin()->second);
+			p->peer2session.erase(p->peer2session.begin());
+		}
+		p->peer2session[s->peerName] = session;
+	}
+	return 1;//reference is kept
+}
+
 static int bio_create(BIO *b){
 	BIO_set_init(b, 1);
 	BIO_set_data(b, NULL);
@@ -151,6 +321,7 @@ static int bio_destroy(BIO *b){
 static int bio_read(BIO *b, char* buf, int len){
 	if(b==NULL){return 0;}
 	SSLSocketPrivate* p = (SSLSocketPrivate*)BIO_get_data(b);
+	if(!p->flushPendingWrites()){return -1;}
 	int res = p->slaveSocket->recv(buf, len);
 	while(p->pseudoBlocking && res==0){delay(1); res = p->slaveSocket->recv(buf, len);}//pseudo blocking to assure accept and connect
 	return res;
@@ -159,12 +330,19 @@ static int bio_read(BIO *b, char* buf, int len){
 static int bio_write(BIO* b, const char* buf, int len){
 	if(b==NULL){return 0;}
 	SSLSocketPrivate* p = (SSLSocketPrivate*)BIO_get_data(b);
+	if(p->pseudoBlocking || !p->pendingWrites.empty()){
+		p->pendingWrites.insert(p->pendingWrites.end(), buf, buf+len);
+		return len;
+	}
 	bool success = p->slaveSocket->send(buf, len);
 	return success?len:-1;
 }
 
 static long bio_ctrl(BIO *b, int cmd, long num, void *ptr){
-	if(cmd == BIO_CTRL_FLUSH){return 1;}
+	if(cmd == BIO_CTRL_FLUSH){
+		SSLSocketPrivate* p = (SSLSocketPrivate*)BIO_get_data(b);
+		return (p==NULL || p->pseudoBlocking || p->flushPendingWrites())?1:0;
+	}
 	return 0;
 }
 
@@ -198,10 +376,19 @@ SSLSocket::~SSLSocket(){
 
 int32_t SSLSocket::recv(char* buf, uint32_t bufSize){
 	if(!p->ssl){return -1;}
+	if(p->directReceive && SSL_pending(p->ssl)==0){//non blocking read (with kTLS the socket only becomes readable if a complete record has been received)
+		pollfd pfd;
+		pfd.fd = p->directSocket->getSocketHandle();
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		if(poll(&pfd, 1, 0)<=0){return 0;}
+	}
 	int res = SSL_read(p->ssl, buf, bufSize);
 	if(res>=0){
 		return res;
 	}else{
+		int error = SSL_get_error(p->ssl, res);
+		if(error==SSL_ERROR_WANT_READ || error==SSL_ERROR_WANT_WRITE){return 0;}
 		ERR_print_errors_fp(stderr);
 		return -1;
 	}
@@ -210,9 +397,12 @@ int32_t SSLSocket::recv(char* buf, uint32_t bufSize){
 bool SSLSocket::send(const char* buf, uint32_t bufSize){
 	if(!p->ssl){return false;}
 	if(bufSize>0){
+		if(p->directSocket && isKernelTLSSendActive()){
+			return p->directSocket->send(buf, bufSize);//the kernel creates the records
+		}
 		int res = SSL_write(p->ssl, buf, bufSize);
 		if(res<=0){ERR_print_errors_fp(stderr);}
-		return res>0;
+		return p->flushPendingWrites() && res>0;
 		//TODO handle SSL_ERROR_WANT_READ and SSL_ERROR_WANT_WRITE
 	}
 	return true;
@@ -264,7 +454,12 @@ bool SSLSocket::accept(){
 	p->pseudoBlocking = true;
 	int res = SSL_accept(p->ssl);
 	p->pseudoBlocking = false;
-	if(res<=0){printLastSSLError(p->ssl, res, "SSLSocket::accept");}
+	if(!p->flushPendingWrites()){res = -1;}//the last flight of the server (e.g. Finished in a TLS 1.2 handshake) must not wait for the first data
+	if(res<=0){
+		printLastSSLError(p->ssl, res, "SSLSocket::accept");
+	}else{
+		p->onHandshakeDone();
+	}
 	return res>0;
 }
 
@@ -272,10 +467,40 @@ bool SSLSocket::connect(){
 	p->pseudoBlocking = true;
 	int res = SSL_connect(p->ssl);
 	p->pseudoBlocking = false;
-	if(res<=0){printLastSSLError(p->ssl, res, "SSLSocket::connect");}
+	if(!p->flushPendingWrites()){res = -1;}
+	if(res<=0){
+		printLastSSLError(p->ssl, res, "SSLSocket::connect");
+	}else{
+		p->onHandshakeDone();
+	}
 	return res>0;
 }
 
+void SSLSocket::setPeerName(const std::string& peerName){
+	p->peerName = peerName;
+	p->useCachedSession();
+}
+
+bool SSLSocket::isSessionReused(){
+	return p->ssl && SSL_session_reused(p->ssl);
+}
+
+bool SSLSocket::isKernelTLSSendActive(){
+	#ifndef OPENSSL_NO_KTLS
+	return p->directSocket && BIO_get_ktls_send(SSL_get_wbio(p->ssl));
+	#else
+	return false;
+	#endif
+}
+
+bool SSLSocket::isKernelTLSReceiveActive(){
+	#ifndef OPENSSL_NO_KTLS
+	return p->directReceive;
+	#else
+	return false;
+	#endif
+}
+
 bool SSLSocket::verifyPeerCertificate(){
 	if(hasPeerCertificate()){
 		return SSL_get_verify_result(p->ssl)==X509_V_OK;
@@ -32,6 +32,11 @@ class SSLContext{
 		MODE_COUNT
 	};
 	
+	struct HandshakeStatistics{
+		uint32_t fullHandshakeCount;
+		uint32_t resumedHandshakeCount;
+	};
+	
 	SSLContext(Mode mode);
 	
 	virtual ~SSLContext();
@@ -54,6 +59,21 @@ class SSLContext{
 	
 	static bool loadFile(std::vector<char>& out, const std::string& path);
 	
+	//! enabled by default, server: session tickets and session cache, client: the sessions are cached per peer (see SSLSocket::setPeerName)
+	//! resumed handshakes save a round trip and the asymmetric crypto operations
+	void setSessionResumptionEnabled(bool enabled);
+	
+	//! client only: forgets all cached sessions
+	void clearSessionCache();
+	
+	//! completed handshakes of all sockets using this context
+	HandshakeStatistics getHandshakeStatistics() const;
+	
+	//! opt-in, disabled by default, only affects sockets created afterwards:
+	//! if the slave socket is an ASocket OpenSSL uses the socket directly instead of the slave socket's send/recv and hands the negotiated keys to the kernel after the handshake (Linux kTLS, requires the tls kernel module and a supported cipher)
+	//! if the kernel does not support it OpenSSL still encrypts in user space (see SSLSocket::isKernelTLSSendActive)
+	void setKernelTLSEnabled(bool enabled);
+	
 };
 
 //! Represantation fo X509 Certificates (see SSLSocket below)
@@ -97,6 +117,19 @@ class SSLSocket : public ICommunicationEndpoint{
 	//! called by the SSL Client to establish a SSL connection / negotation, returns true if successful
 	bool connect();
 	
+	//! client only, must be called before the handshake: key for the session cache of the context (e.g. address and port of the server)
+	//! a cached session for this peer is offered for resumption, no sessions are cached for sockets without peer name
+	void setPeerName(const std::string& peerName);
+	
+	//! true if the handshake has resumed a previous session
+	bool isSessionReused();
+	
+	//! true if the kernel encrypts (after the handshake, see SSLContext::setKernelTLSEnabled), data written to the slave socket directly (e.g. sendfile) is sent encrypted
+	bool isKernelTLSSendActive();
+	
+	//! true if the kernel decrypts (after the handshake, see SSLContext::setKernelTLSEnabled)
+	bool isKernelTLSReceiveActive();
+	
 	//! true if the peer has presented a certificate
 	bool hasPeerCertificate();
 	
@@ -1,17 +1,29 @@
 #include "SimpleSockets.h"
 #include "timing.h"
 #include "platforms.h"
+#include "Threading.h"
 
 #include <cassert>
 #include <cstring>
+#include <cmath>
 #include <iostream>
 #include <sstream>
 #include <set>
+#include <map>
+#include <deque>
+#include <vector>
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <atomic>
 
 #if SIMPLESOCKETS_WIN
 //TODO
 #else
 #include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <poll.h>
 #include <sys/ioctl.h>
 #include <netdb.h>
 #include <net/if.h>
@@ -22,6 +34,12 @@
 #include <fcntl.h>
 #include <ifaddrs.h>
 
+#if defined(__linux__) || defined(__ANDROID__)
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#define USE_RTNETLINK
+#endif
+
 #if defined(__ANDROID__)// || defined(__linux__)
 #include <android/log.h>
 #define USE_ANDROID_BRD_ADDR_WORKAROUND
@@ -273,6 +291,15 @@ bool IPv6Address::operator<(const IPv6Address& other) const{
 	return addr.sin6_port<other.addr.sin6_port;
 }
 
+size_t IPv6AddressHash::operator()(const IPv6Address& a) const{
+	const sockaddr_in6& r = a.getInternalRepresentation();
+	uint64_t h = 14695981039346656037ULL;//FNV-1a
+	for(int i=0; i<16; i++){h = (h^r.sin6_addr.s6_addr[i])*1099511628211ULL;}
+	h = (h^(r.sin6_port&0xFF))*1099511628211ULL;
+	h = (h^(r.sin6_port>>8))*1099511628211ULL;
+	return (size_t)h;
+}
+
 bool IPv6Address::operator==(const IPv6Address& other) const{
 	bool equal = true;
 	const uint8_t* this_s6_addr = addr.sin6_addr.s6_addr;
@@ -331,10 +358,53 @@ void ASocket::setBlockingReceiveTimeout(uint32_t microseconds){
 	#endif
 }
 
+//! true if the socket is readable (or writable) or has an error within timeout ms
+static bool waitForSocket(int socketHandle, uint32_t timeout, bool write){
+	#if SIMPLESOCKETS_WIN
+	fd_set set;
+	FD_ZERO(&set);
+	FD_SET(socketHandle, &set);
+	timeval tv;
+	tv.tv_sec = timeout/1000;
+	tv.tv_usec = (timeout%1000)*1000;
+	return select(socketHandle+1, write?NULL:&set, write?&set:NULL, NULL, &tv)>0;
+	#else
+	pollfd pfd;//no FD_SETSIZE limit for processes with many sockets
+	pfd.fd = socketHandle;
+	pfd.events = write?POLLOUT:POLLIN;
+	pfd.revents = 0;
+	return poll(&pfd, 1, (int)std::min<uint32_t>(timeout, INT32_MAX))>0;//errors and hang ups are reported as well (like select)
+	#endif
+}
+
+bool ASocket::waitForReceive(uint32_t timeout){
+	return waitForSocket(socketHandle, timeout, false);
+}
+
 int ASocket::getSocketHandle() const{
 	return socketHandle;
 }
 
+IIPAddress* ASocket::createPeerAddress() const{
+	sockaddr_storage addr;
+	#if SIMPLESOCKETS_WIN
+	int len = sizeof(addr);
+	#else
+	socklen_t len = sizeof(addr);
+	#endif
+	if(socketHandle==-1 || getpeername(socketHandle, (sockaddr*)&addr, &len)!=0){return NULL;}
+	if(addr.ss_family==AF_INET){
+		IPv4Address* res = new IPv4Address();
+		res->setInternalRepresentation(*(sockaddr_in*)&addr);
+		return res;
+	}else if(addr.ss_family==AF_INET6){
+		IPv6Address* res = new IPv6Address();
+		res->setInternalRepresentation(*(sockaddr_in6*)&addr);
+		return res;
+	}
+	return NULL;
+}
+
 bool ASocket::setReceiveBufferSize(uint32_t size){
 	#if SIMPLESOCKETS_WIN
 	int s = size;
@@ -361,6 +431,11 @@ bool ASocket::setSendBufferSize(uint32_t size){
 	return false;
 }
 
+bool ASocket::setNoDelay(bool enabled){
+	int value = enabled?1:0;
+	return setsockopt(socketHandle, IPPROTO_TCP, TCP_NODELAY, (const char*)&value, sizeof(value))!=-1;
+}
+
 bool ASocket::restore(){
 	if(restoreReceiveSize>=0){
 		return setReceiveBufferSize(restoreReceiveSize);
@@ -510,6 +585,53 @@ bool ASocket::send(const char* buf, uint32_t bufSize){
 	#endif
 }
 
+int64_t ASocket::sendBuffers(const char* const* bufs, const uint32_t* sizes, uint32_t count, bool blocking){
+	#if SIMPLESOCKETS_WIN
+	int64_t res = 0;
+	for(uint32_t i=0; i<count; i++){
+		if(!send(bufs[i], sizes[i])){return -1;}
+		res += sizes[i];
+	}
+	return res;
+	#else
+	ONSEND
+	static constexpr uint32_t maxBuffersPerSystemCall = 64;
+	int64_t res = 0;
+	uint32_t index = 0;
+	uint32_t offset = 0;//already sent bytes of bufs[index]
+	while(index<count){
+		iovec iovs[maxBuffersPerSystemCall];
+		uint32_t n = 0;
+		for(uint32_t i=index; i<count && n<maxBuffersPerSystemCall; i++, n++){
+			iovs[n].iov_base = (void*)(bufs[i]+(i==index?offset:0));
+			iovs[n].iov_len = sizes[i]-(i==index?offset:0);
+		}
+		msghdr msg;
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = iovs;
+		msg.msg_iovlen = n;
+		ssize_t sent = sendmsg(socketHandle, &msg, MSG_NOSIGNAL|(blocking?0:MSG_DONTWAIT));
+		if(sent<0){
+			if(errno==EINTR){continue;}
+			if(errno==EAGAIN || errno==EWOULDBLOCK){
+				if(blocking){continue;}
+				break;
+			}
+			return -1;
+		}
+		res += sent;
+		while(index<count && sent>=(ssize_t)(sizes[index]-offset)){
+			sent -= sizes[index]-offset;
+			offset = 0;
+			index++;
+		}
+		offset += sent;
+		if(!blocking && index<count){break;}//partial write
+	}
+	return res;
+	#endif
+}
+
 IPv4Socket::IPv4Socket(){restoreBind = -1; restoreReusePort = false;}
 
 bool IPv4Socket::restore(){
@@ -560,38 +682,37 @@ struct IPv4UDPSocketAutoMulticastParams{
 	IPv4UDPSocket* s;
 	std::set<IPv4Address> multicastAddresses;
 	std::function<void(const IPv4Address& multicastAddress, const IPv4Address& localInterfaceAddress, bool success)> perInterfaceCallback = nullptr;
+	uint64_t interfaceGeneration = 0;
 	double lastJoinAttemptTime = 0.0;
-	double lastReceiveTime = 0.0;
+	bool joinError = false;
 
-	static constexpr double rejoinPeriodNoData = 1.0; //seconds
-	static constexpr double rejoinPeriodWithData = 30.0; //seconds
-	static constexpr double dataTimeout = 1.0; //seconds
+	static constexpr double rejoinPeriod = 30.0; //seconds, in case a change has been missed
+	static constexpr double rejoinPeriodAfterError = 10.0; //seconds
 
 	IPv4UDPSocketAutoMulticastParams(IPv4UDPSocket* s):s(s){}
 
-	//! receivedData must be true if data has been received since the last call to update
-	void update(bool receivedData){
-		double t = getSecs();
-		if(receivedData){lastReceiveTime = t;}
-		double dt = t-lastReceiveTime>dataTimeout?rejoinPeriodNoData:rejoinPeriodWithData;
-		if(t-lastJoinAttemptTime>dt){
-			lastJoinAttemptTime = t;
-			std::list<IPInterface> ifaces = queryIPInterfaces();
-			bool error = false;
-			if(ifaces.empty()){
-				for(const IPv4Address& multicastAddress : multicastAddresses){
-					if(!s->joinMulticastGroup(multicastAddress.getAddressAsString())){error = true;}
-				}
-			}else{
-				for(const IPv4Address& multicastAddress : multicastAddresses){
-					if(!s->joinMulticastGroup(multicastAddress, ifaces, perInterfaceCallback)){error = true;}
-				}
+	void join(){
+		interfaceGeneration = IPInterfaceMonitor::getGeneration();
+		lastJoinAttemptTime = getSecs();
+		std::list<IPInterface> ifaces = IPInterfaceMonitor::getInterfaces();
+		joinError = false;
+		if(ifaces.empty()){
+			for(const IPv4Address& multicastAddress : multicastAddresses){
+				if(!s->joinMulticastGroup(multicastAddress.getAddressAsString())){joinError = true;}
 			}
-			if(error){
-				lastJoinAttemptTime += 10.0; //wait longer if there was an error
+		}else{
+			for(const IPv4Address& multicastAddress : multicastAddresses){
+				if(!s->joinMulticastGroup(multicastAddress, ifaces, perInterfaceCallback)){joinError = true;}
 			}
 		}
 	}
+
+	//! rejoins if the interfaces have changed or the rejoin period has elapsed
+	void update(){
+		if(IPInterfaceMonitor::getGeneration()!=interfaceGeneration || getSecs()-lastJoinAttemptTime>(joinError?rejoinPeriodAfterError:rejoinPeriod)){
+			join();
+		}
+	}
 };
 
 IPv4UDPSocket::IPv4UDPSocket():boundOrSent(false),targetAddress("0.0.0.0",0),lastReceivedAddress("0.0.0.0",0){
@@ -609,11 +730,10 @@ IPv4UDPSocket::~IPv4UDPSocket(){
 void IPv4UDPSocket::enableAutoMulticastGroupJoining(const IPv4Address& multicastAddress, const std::function<void(const IPv4Address& multicastAddress, const IPv4Address& localInterfaceAddress, bool success)>& perInterfaceCallback){
 	if(!autoMulticastParams){
 		autoMulticastParams = new IPv4UDPSocketAutoMulticastParams(this);
-		autoMulticastParams->lastJoinAttemptTime = getSecs();
 	}
 	autoMulticastParams->multicastAddresses.insert(multicastAddress);
 	autoMulticastParams->perInterfaceCallback = perInterfaceCallback;
-	joinMulticastGroup(multicastAddress, queryIPInterfaces(), perInterfaceCallback);
+	autoMulticastParams->join();
 }
 
 
@@ -707,11 +827,95 @@ uint32_t IPv4UDPSocket::recv(char* buf, uint32_t bufSize, bool readBlocking){
 	}
 	#endif
 	if(autoMulticastParams){
-		autoMulticastParams->update(received>0);
+		autoMulticastParams->update();
 	}
 	return received;
 }
 	
+#ifdef __linux__
+static constexpr uint32_t maxDatagramsPerSystemCall = 64;
+#endif
+
+uint32_t IPv4UDPSocket::recvBatch(char* const* bufs, uint32_t bufSize, uint32_t* sizes, uint32_t count){
+	#ifdef __linux__
+	if(!boundOrSent){return 0;}
+	ONRECEIVE(false)
+	ONUDPRECEIVE
+	uint32_t res = 0;
+	while(res<count){
+		uint32_t n = std::min(count-res, maxDatagramsPerSystemCall);
+		mmsghdr msgs[maxDatagramsPerSystemCall];
+		iovec iovs[maxDatagramsPerSystemCall];
+		sockaddr_in addrs[maxDatagramsPerSystemCall];
+		memset(msgs, 0, n*sizeof(mmsghdr));
+		for(uint32_t i=0; i<n; i++){
+			iovs[i].iov_base = bufs[res+i];
+			iovs[i].iov_len = bufSize;
+			msgs[i].msg_hdr.msg_iov = &iovs[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+			msgs[i].msg_hdr.msg_name = &addrs[i];
+			msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+		}
+		int received = recvmmsg(socketHandle, msgs, n, MSG_DONTWAIT, NULL);
+		if(received<=0){
+			if(received<0 && errno!=EAGAIN && errno!=EWOULDBLOCK && errno!=EHOSTUNREACH){handleErrorMessage();}
+			break;
+		}
+		for(int i=0; i<received; i++){
+			sizes[res+i] = msgs[i].msg_len;
+		}
+		lastReceivedAddress.setInternalRepresentation(addrs[received-1]);
+		res += received;
+		if((uint32_t)received<n){break;}
+	}
+	if(autoMulticastParams){
+		autoMulticastParams->update();
+	}
+	return res;
+	#else
+	uint32_t res = 0;
+	while(res<count){
+		sizes[res] = recv(bufs[res], bufSize, false);
+		if(sizes[res]==0){break;}
+		res++;
+	}
+	return res;
+	#endif
+}
+
+uint32_t IPv4UDPSocket::sendBatch(const char* const* bufs, const uint32_t* sizes, uint32_t count){
+	#ifdef __linux__
+	boundOrSent = true;
+	ONSEND
+	uint32_t res = 0;
+	while(res<count){
+		uint32_t n = std::min(count-res, maxDatagramsPerSystemCall);
+		mmsghdr msgs[maxDatagramsPerSystemCall];
+		iovec iovs[maxDatagramsPerSystemCall];
+		memset(msgs, 0, n*sizeof(mmsghdr));
+		for(uint32_t i=0; i<n; i++){
+			iovs[i].iov_base = (void*)bufs[res+i];
+			iovs[i].iov_len = sizes[res+i];
+			msgs[i].msg_hdr.msg_iov = &iovs[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+			msgs[i].msg_hdr.msg_name = (void*)&(targetAddress.getInternalRepresentation());
+			msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+		}
+		int sent = sendmmsg(socketHandle, msgs, n, 0);
+		if(sent<=0){
+			if(sent<0){handleErrorMessage();}
+			break;
+		}
+		res += sent;
+	}
+	return res;
+	#else
+	uint32_t res = 0;
+	while(res<count && send(bufs[res], sizes[res])){res++;}
+	return res;
+	#endif
+}
+
 const IPv4Address& IPv4UDPSocket::getLastDatagramAddress() const{
 	return lastReceivedAddress;
 }
@@ -956,13 +1160,7 @@ bool IPv4TCPSocket::listen(int maxPendingConnections){
 
 //! Helper function to do an accept with timeout
 static inline int acceptWithTimeout(int socketHandle, uint32_t timeout, sockaddr* saddr, socklen_t* saddrLen){
-	fd_set readSet;
-	FD_ZERO(&readSet);
-	FD_SET(socketHandle, &readSet);
-	timeval tv;
-	tv.tv_sec=timeout/1000;
-	tv.tv_usec=(timeout%1000)*1000;
-	if(select(socketHandle+1, &readSet, NULL, NULL, &tv)>0){
+	if(waitForSocket(socketHandle, timeout, false)){
 		return ::accept(socketHandle, saddr, saddrLen);
 	}else{
 		return -1;
@@ -1011,14 +1209,8 @@ static int connectWithTimeout(int socketHandle, uint32_t timeout, const sockaddr
 	#else
 	if(res==-1 && errno!=EINPROGRESS){return -1;}
 	#endif
-	fd_set fdset;
-	FD_ZERO(&fdset);
-	FD_SET(socketHandle, &fdset);
-	timeval tv;
-	tv.tv_sec=timeout/1000;
-	tv.tv_usec=(timeout%1000)*1000;
 	int so_error = -1;
-	if(select(socketHandle+1, NULL, &fdset, NULL, &tv)>0){
+	if(waitForSocket(socketHandle, timeout, true)){
 		socklen_t len = sizeof(so_error);
 		getsockopt(socketHandle, SOL_SOCKET, SO_ERROR, (char*)&so_error, &len);
 	}
@@ -1113,25 +1305,178 @@ bool IPv6TCPSocket::connect(const IPv6Address& address, uint32_t timeout){
 	return false;
 }
 
-ASocket* connectSocketForAddressList(const std::list<IIPAddress*>& addressList, uint32_t timeout, IIPAddress** connectedAddress){
-	for(std::list<IIPAddress*>::const_iterator it = addressList.begin(); it != addressList.end(); ++it){
-		if((*it)->getIPVersion()==IIPAddress::IPV6){
-			IPv6TCPSocket* s = new IPv6TCPSocket();
-			if(s->connect(*((IPv6Address*)(*it)), timeout)){
-				if(connectedAddress){*connectedAddress = *it;}
-				return s;
+static bool setSocketBlocking(int socketHandle, bool blocking){
+	#if SIMPLESOCKETS_WIN
+	unsigned long mode = blocking?0:1;
+	return ioctlsocket(socketHandle, FIONBIO, &mode)==0;
+	#else
+	return setBlockingFlag(socketHandle, blocking)!=-1;
+	#endif
+}
+
+//! IPv6 and IPv4 addresses alternating, starting with the family of the first address
+static std::vector<IIPAddress*> interleaveAddressFamilies(const std::list<IIPAddress*>& addressList){
+	std::vector<IIPAddress*> families[IIPAddress::IP_COUNT];
+	for(IIPAddress* a : addressList){
+		families[a->getIPVersion()].push_back(a);
+	}
+	std::vector<IIPAddress*> res;
+	int first = addressList.empty()?0:addressList.front()->getIPVersion();
+	for(size_t i=0; res.size()<addressList.size(); i++){
+		for(int f=0; f<IIPAddress::IP_COUNT; f++){
+			std::vector<IIPAddress*>& v = families[(first+f)%IIPAddress::IP_COUNT];
+			if(i<v.size()){res.push_back(v[i]);}
+		}
+	}
+	return res;
+}
+
+struct ConnectAttempt{
+	ASocket* socket;
+	IIPAddress* address;
+};
+
+//! starts a non-blocking connect, returns false if it failed immediately, established is true if the connection has been established immediately
+static bool startConnectAttempt(ConnectAttempt& attempt, IIPAddress* address, bool& established){
+	const sockaddr* addr;
+	int addrLen;
+	attempt.address = address;
+	if(address->getIPVersion()==IIPAddress::IPV6){
+		attempt.socket = new IPv6TCPSocket();
+		addr = (const sockaddr*)&(((IPv6Address*)address)->getInternalRepresentation());
+		addrLen = sizeof(sockaddr_in6);
+	}else{
+		attempt.socket = new IPv4TCPSocket();
+		addr = (const sockaddr*)&(((IPv4Address*)address)->getInternalRepresentation());
+		addrLen = sizeof(sockaddr_in);
+	}
+	int socketHandle = attempt.socket->getSocketHandle();
+	bool succ = socketHandle!=-1 && setSocketBlocking(socketHandle, false);
+	if(succ){
+		int res = ::connect(socketHandle, addr, addrLen);
+		established = res==0;
+		#if SIMPLESOCKETS_WIN
+		succ = res==0 || WSAGetLastError()==WSAEWOULDBLOCK;
+		#else
+		succ = res==0 || errno==EINPROGRESS;
+		#endif
+	}
+	if(!succ){
+		delete attempt.socket;
+		attempt.socket = NULL;
+	}
+	return succ;
+}
+
+ASocket* connectSocketForAddressList(const std::list<IIPAddress*>& addressList, uint32_t timeout, IIPAddress** connectedAddress, uint32_t attemptDelay){
+	ONCONNECT
+	std::vector<IIPAddress*> candidates = interleaveAddressFamilies(addressList);
+	std::list<ConnectAttempt> pending;
+	ConnectAttempt winner{NULL, NULL};
+	double t = getSecs();
+	const double deadline = t+timeout/1000.0;
+	double nextAttemptTime = t;
+	size_t next = 0;
+	while(winner.socket==NULL && t<deadline){
+		if(next<candidates.size() && (t>=nextAttemptTime || pending.empty())){
+			ConnectAttempt attempt;
+			bool established = false;
+			if(startConnectAttempt(attempt, candidates[next], established)){
+				if(established){
+					winner = attempt;
+				}else{
+					pending.push_back(attempt);
+					nextAttemptTime = t+attemptDelay/1000.0;
+				}
+			}else{
+				nextAttemptTime = t;
 			}
-			delete s;
+			next++;
+		}else if(pending.empty()){
+			break;//all attempts failed
 		}else{
-			IPv4TCPSocket* s = new IPv4TCPSocket();
-			if(s->connect(*((IPv4Address*)(*it)), timeout)){
-				if(connectedAddress){*connectedAddress = *it;}
-				return s;
+			double waitUntil = (next<candidates.size() && nextAttemptTime<deadline)?nextAttemptTime:deadline;
+			double waitTime = std::max(0.0, waitUntil-t);
+			#if SIMPLESOCKETS_WIN
+			fd_set writeSet, errorSet;
+			FD_ZERO(&writeSet);
+			FD_ZERO(&errorSet);
+			int maxHandle = -1;
+			for(ConnectAttempt& a : pending){
+				int socketHandle = a.socket->getSocketHandle();
+				FD_SET(socketHandle, &writeSet);
+				FD_SET(socketHandle, &errorSet);
+				maxHandle = std::max(maxHandle, socketHandle);
+			}
+			timeval tv;
+			tv.tv_sec = (long)waitTime;
+			tv.tv_usec = (long)((waitTime-tv.tv_sec)*1000000.0);
+			if(select(maxHandle+1, NULL, &writeSet, &errorSet, &tv)>0){
+			#else
+			std::vector<pollfd> pfds(pending.size());//no FD_SETSIZE limit for processes with many sockets
+			uint32_t i = 0;
+			for(ConnectAttempt& a : pending){
+				pfds[i].fd = a.socket->getSocketHandle();
+				pfds[i].events = POLLOUT;
+				pfds[i].revents = 0;
+				i++;
+			}
+			if(poll(pfds.data(), pfds.size(), (int)std::ceil(waitTime*1000.0))>0){
+				i = 0;
+			#endif
+				for(auto it = pending.begin(); it != pending.end() && winner.socket==NULL;){
+					int socketHandle = it->socket->getSocketHandle();
+					#if SIMPLESOCKETS_WIN
+					if(FD_ISSET(socketHandle, &writeSet) || FD_ISSET(socketHandle, &errorSet)){
+					#else
+					if(pfds[i++].revents!=0){//writable, error or hang up
+					#endif
+						int so_error = -1;
+						socklen_t len = sizeof(so_error);
+						getsockopt(socketHandle, SOL_SOCKET, SO_ERROR, (char*)&so_error, &len);
+						if(so_error==0){
+							winner = *it;
+						}else{
+							delete it->socket;
+							nextAttemptTime = t;//failed => next attempt immediately
+						}
+						it = pending.erase(it);
+					}else{
+						++it;
+					}
+				}
 			}
-			delete s;
 		}
+		t = getSecs();
 	}
-	return NULL;
+	for(ConnectAttempt& a : pending){
+		delete a.socket;
+	}
+	if(winner.socket){
+		if(winner.address->getIPVersion()==IIPAddress::IPV6){
+			IPv6TCPSocket* s = (IPv6TCPSocket*)winner.socket;
+			#if SIMPLESOCKETS_WIN
+			if(s->isBlocking){setSocketBlocking(s->getSocketHandle(), true);}
+			#else
+			setSocketBlocking(s->getSocketHandle(), true);
+			#endif
+			s->restoreTimeout = timeout;
+			s->restoreAddress = *((IPv6Address*)winner.address);
+			s->restoreListen = -1;
+		}else{
+			IPv4TCPSocket* s = (IPv4TCPSocket*)winner.socket;
+			#if SIMPLESOCKETS_WIN
+			if(s->isBlocking){setSocketBlocking(s->getSocketHandle(), true);}
+			#else
+			setSocketBlocking(s->getSocketHandle(), true);
+			#endif
+			s->restoreTimeout = timeout;
+			s->restoreAddress = *((IPv4Address*)winner.address);
+			s->restoreListen = -1;
+		}
+		if(connectedAddress){*connectedAddress = winner.address;}
+	}
+	return winner.socket;
 }
 
 std::list<IIPAddress*> copyAddressList(const std::list<IIPAddress*>& other){
@@ -1153,33 +1498,218 @@ static inline void* get_in_addr(struct sockaddr *sa) {
   return sa->sa_family == AF_INET?(void *)&(((sockaddr_in*)sa)->sin_addr):(void*)&(((sockaddr_in6*)sa)->sin6_addr);
 }
 
-std::list<IIPAddress*> queryIPAddressesForHostName(const std::string& hostName, uint16_t portToFill){
+//! blocking getaddrinfo, returns the addresses with port 0
+static std::list<IIPAddress*> resolveHostName(const std::string& hostName){
 	checkAndInitGlobally();
 	std::list<IIPAddress*> l;
+	addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;//one result per address instead of one per socket type
 	addrinfo* result;
 	addrinfo* res;
-	int error = getaddrinfo(hostName.c_str(), NULL, NULL, &result);
+	int error = getaddrinfo(hostName.c_str(), NULL, &hints, &result);
 	if(error==0){
 		for(res = result; res != NULL; res = res->ai_next){   
 			char s[INET6_ADDRSTRLEN];
 			if(inet_ntop(res->ai_family, get_in_addr((sockaddr*)res->ai_addr), s, sizeof(s))==NULL){
 				handleErrorMessage();
-				return l;
+				break;
 			}
 			if(res->ai_family==AF_INET){
-				l.push_back(new IPv4Address(s, portToFill));
+				l.push_back(new IPv4Address(s, 0));
 			}else{
-				l.push_back(new IPv6Address(s, portToFill));
+				l.push_back(new IPv6Address(s, 0));
 			}
 		}
 		freeaddrinfo(result);
 	}
-	return l;	
+	return l;
+}
+
+struct HostNameCacheEntry{
+	double expiryTime;
+	std::list<std::shared_ptr<IIPAddress>> addresses;
+};
+
+struct HostNameCache{
+	std::mutex mutex;
+	uint32_t ttl;
+	std::map<std::string, HostNameCacheEntry> entries;
+	HostNameCache():ttl(60000){}
+};
+
+static const size_t maxHostNameCacheSize = 64;
+
+static HostNameCache& getHostNameCache(){
+	static HostNameCache cache;
+	return cache;
+}
+
+//! returns true and fills out if hostName is cached
+static bool lookupHostNameCache(const std::string& hostName, uint16_t portToFill, std::list<IIPAddress*>& out){
+	HostNameCache& cache = getHostNameCache();
+	std::lock_guard<std::mutex> lock(cache.mutex);
+	auto it = cache.entries.find(hostName);
+	if(it==cache.entries.end()){return false;}
+	if(it->second.expiryTime<getSecs()){
+		cache.entries.erase(it);
+		return false;
+	}
+	for(const std::shared_ptr<IIPAddress>& a : it->second.addresses){
+		IIPAddress* copy = a->createNewCopy();
+		copy->setPort(portToFill);
+		out.push_back(copy);
+	}
+	return true;
+}
+
+static void storeInHostNameCache(const std::string& hostName, const std::list<IIPAddress*>& addresses){
+	if(addresses.empty()){return;}//failures are not cached
+	HostNameCache& cache = getHostNameCache();
+	std::lock_guard<std::mutex> lock(cache.mutex);
+	if(cache.ttl==0){return;}
+	double t = getSecs();
+	if(cache.entries.size()>=maxHostNameCacheSize && cache.entries.find(hostName)==cache.entries.end()){
+		auto oldest = cache.entries.begin();
+		for(auto it = cache.entries.begin(); it != cache.entries.end(); ++it){
+			if(it->second.expiryTime<oldest->second.expiryTime){oldest = it;}
+		}
+		cache.entries.erase(oldest);
+	}
+	HostNameCacheEntry& e = cache.entries[hostName];
+	e.expiryTime = t+cache.ttl/1000.0;
+	e.addresses.clear();
+	for(IIPAddress* a : addresses){
+		e.addresses.push_back(std::shared_ptr<IIPAddress>(a->createNewCopy()));
+	}
+}
+
+void setHostNameCacheTTL(uint32_t ttl){
+	HostNameCache& cache = getHostNameCache();
+	std::lock_guard<std::mutex> lock(cache.mutex);
+	cache.ttl = ttl;
+	if(ttl==0){cache.entries.clear();}
+}
+
+void clearHostNameCache(){
+	HostNameCache& cache = getHostNameCache();
+	std::lock_guard<std::mutex> lock(cache.mutex);
+	cache.entries.clear();
+}
+
+struct HostNameQuery::State{
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool done;
+	std::string hostName;
+	std::list<IIPAddress*> addresses;
+	State(const std::string& hostName):done(false),hostName(hostName){}
+	~State(){
+		deleteAddressList(addresses);
+	}
+};
+
+struct HostNameQuery::Resolvers{
+	std::mutex mutex;//locked before State::mutex
+	std::map<std::string, std::shared_ptr<State>> unfinished;//queued or being resolved
+	std::deque<std::shared_ptr<State>> queue;
+	uint32_t threadCount;
+	Resolvers():threadCount(0){}
+};
+
+HostNameQuery::Resolvers& HostNameQuery::getResolvers(){
+	static Resolvers resolvers;
+	return resolvers;
+}
+
+//! resolves queued host names until the queue is empty
+void* HostNameQuery::resolveMain(void* arg){
+	Resolvers& resolvers = getResolvers();
+	std::unique_lock<std::mutex> resolversLock(resolvers.mutex);
+	while(!resolvers.queue.empty()){
+		std::shared_ptr<State> state = resolvers.queue.front();
+		resolvers.queue.pop_front();
+		resolversLock.unlock();
+		std::list<IIPAddress*> addresses = resolveHostName(state->hostName);
+		storeInHostNameCache(state->hostName, addresses);
+		resolversLock.lock();
+		resolvers.unfinished.erase(state->hostName);//further queries use the cache or resolve again
+		std::lock_guard<std::mutex> lock(state->mutex);
+		state->addresses = addresses;
+		state->done = true;
+		state->condition.notify_all();
+	}
+	resolvers.threadCount--;
+	return NULL;
+}
+
+HostNameQuery::HostNameQuery(const std::string& hostName):state(std::make_shared<State>(hostName)){
+	if(lookupHostNameCache(hostName, 0, state->addresses)){
+		state->done = true;
+		return;
+	}
+	Resolvers& resolvers = getResolvers();
+	std::lock_guard<std::mutex> lock(resolvers.mutex);
+	auto it = resolvers.unfinished.find(hostName);
+	if(it!=resolvers.unfinished.end()){
+		state = it->second;
+		return;
+	}
+	resolvers.unfinished[hostName] = state;
+	resolvers.queue.push_back(state);
+	if(resolvers.threadCount<maxResolverThreads){
+		Thread thread;
+		if(createThread(thread, resolveMain, NULL, false)){
+			resolvers.threadCount++;
+		}else if(resolvers.threadCount==0){//nobody would process the queue
+			resolvers.queue.clear();
+			resolvers.unfinished.clear();
+			state->done = true;
+		}
+	}
+}
+
+bool HostNameQuery::isDone() const{
+	std::lock_guard<std::mutex> lock(state->mutex);
+	return state->done;
+}
+
+bool HostNameQuery::wait(uint32_t timeout){
+	std::unique_lock<std::mutex> lock(state->mutex);
+	return state->condition.wait_for(lock, std::chrono::milliseconds(timeout), [this](){return state->done;});
+}
+
+std::list<IIPAddress*> HostNameQuery::createAddressList(uint16_t portToFill) const{
+	std::lock_guard<std::mutex> lock(state->mutex);
+	std::list<IIPAddress*> res = copyAddressList(state->addresses);
+	for(IIPAddress* a : res){
+		a->setPort(portToFill);
+	}
+	return res;
 }
 
-ASocket* createSocketForHostName(bool tcp, const std::string& hostName, uint16_t port, uint32_t tcpConnectTimeout){
+std::list<IIPAddress*> queryIPAddressesForHostName(const std::string& hostName, uint16_t portToFill){
+	std::list<IIPAddress*> l;
+	if(!lookupHostNameCache(hostName, portToFill, l)){
+		l = resolveHostName(hostName);
+		storeInHostNameCache(hostName, l);
+		for(IIPAddress* a : l){
+			a->setPort(portToFill);
+		}
+	}
+	return l;
+}
+
+std::list<IIPAddress*> queryIPAddressesForHostName(const std::string& hostName, uint16_t portToFill, uint32_t timeout){
+	HostNameQuery query(hostName);
+	query.wait(timeout);
+	return query.createAddressList(portToFill);
+}
+
+ASocket* createSocketForHostName(bool tcp, const std::string& hostName, uint16_t port, uint32_t tcpConnectTimeout, uint32_t resolveTimeout){
 	ASocket* res = NULL;
-	std::list<IIPAddress*> l = queryIPAddressesForHostName(hostName, port);
+	std::list<IIPAddress*> l = queryIPAddressesForHostName(hostName, port, resolveTimeout);
 	if(tcp){
 		res = connectSocketForAddressList(l, tcpConnectTimeout);
 	}else if(!l.empty()){
@@ -1343,3 +1873,135 @@ std::list<IPInterface> queryIPInterfaces(){
 	#endif
 	return l;
 }
+
+static bool isEqual(const std::shared_ptr<IIPAddress>& a, const std::shared_ptr<IIPAddress>& b){
+	if(!a || !b){return a==b;}
+	return a->getIPVersion()==b->getIPVersion() && a->getAddressAsString()==b->getAddressAsString();
+}
+
+static bool isEqual(const std::list<IPInterface>& a, const std::list<IPInterface>& b){
+	if(a.size()!=b.size()){return false;}
+	for(auto ita = a.begin(), itb = b.begin(); ita != a.end(); ++ita, ++itb){
+		if(ita->name!=itb->name || ita->isUp!=itb->isUp || ita->isLoopback!=itb->isLoopback || ita->isPointToPoint!=itb->isPointToPoint || ita->isBroadcast!=itb->isBroadcast){return false;}
+		if(!isEqual(ita->address, itb->address) || !isEqual(ita->netmask, itb->netmask) || !isEqual(ita->broadcastAddress, itb->broadcastAddress)){return false;}
+	}
+	return true;
+}
+
+struct IPInterfaceMonitor::State{
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool started = false;
+	int notificationSocket = -1;//rtnetlink
+	std::atomic<uint64_t> generation{0};
+	std::list<IPInterface> interfaces;
+};
+
+static const uint32_t interfacePollingPeriod = 2000;//ms, if not event driven
+static const uint32_t interfaceChangeDebounceTime = 10;//ms, changes usually arrive as a burst of messages
+
+IPInterfaceMonitor::State& IPInterfaceMonitor::getState(){
+	static State* state = new State();//never deleted because the detached thread may outlive static destruction
+	return *state;
+}
+
+#ifdef USE_RTNETLINK
+static int openInterfaceNotificationSocket(){
+	int fd = socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
+	if(fd<0){return -1;}
+	sockaddr_nl addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.nl_family = AF_NETLINK;
+	addr.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR;
+	if(::bind(fd, (sockaddr*)&addr, sizeof(addr))<0){//e.g. not permitted on newer Android versions
+		::close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+//! blocks until a notification has been received and the burst is over, false if the socket is broken
+static bool waitForInterfaceNotification(int fd){
+	char buf[8192];
+	ssize_t received = ::recv(fd, buf, sizeof(buf), 0);
+	if(received<0 && errno!=ENOBUFS && errno!=EINTR){return false;}//ENOBUFS: notifications lost => query anyway
+	while(true){
+		fd_set fdset;
+		FD_ZERO(&fdset);
+		FD_SET(fd, &fdset);
+		timeval tv;
+		tv.tv_sec = 0;
+		tv.tv_usec = interfaceChangeDebounceTime*1000;
+		if(select(fd+1, &fdset, NULL, NULL, &tv)<=0){break;}
+		::recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+	}
+	return true;
+}
+#endif
+
+void* IPInterfaceMonitor::monitorMain(void* arg){
+	State& state = getState();
+	while(true){
+		#ifdef USE_RTNETLINK
+		if(state.notificationSocket>=0){
+			if(!waitForInterfaceNotification(state.notificationSocket)){
+				std::lock_guard<std::mutex> lock(state.mutex);
+				::close(state.notificationSocket);
+				state.notificationSocket = -1;
+			}
+		}else{
+			delay(interfacePollingPeriod);
+		}
+		#else
+		delay(interfacePollingPeriod);
+		#endif
+		std::list<IPInterface> interfaces = queryIPInterfaces();
+		std::lock_guard<std::mutex> lock(state.mutex);
+		if(!isEqual(interfaces, state.interfaces)){
+			state.interfaces.swap(interfaces);
+			state.generation++;
+			state.condition.notify_all();
+		}
+	}
+	return NULL;
+}
+
+void IPInterfaceMonitor::start(){
+	State& state = getState();
+	std::lock_guard<std::mutex> lock(state.mutex);
+	if(state.started){return;}
+	state.started = true;
+	#ifdef USE_RTNETLINK
+	state.notificationSocket = openInterfaceNotificationSocket();//before the query to avoid missing changes
+	#endif
+	state.interfaces = queryIPInterfaces();
+	state.generation = 1;
+	Thread thread;
+	if(!createThread(thread, monitorMain, NULL, false)){
+		handleErrorMessage("IPInterfaceMonitor: thread creation failed", false);
+	}
+}
+
+uint64_t IPInterfaceMonitor::getGeneration(){
+	return getState().generation.load(std::memory_order_relaxed);
+}
+
+std::list<IPInterface> IPInterfaceMonitor::getInterfaces(){
+	start();
+	State& state = getState();
+	std::lock_guard<std::mutex> lock(state.mutex);
+	return state.interfaces;
+}
+
+uint64_t IPInterfaceMonitor::waitForChange(uint64_t knownGeneration, uint32_t timeout){
+	State& state = getState();
+	std::unique_lock<std::mutex> lock(state.mutex);
+	state.condition.wait_for(lock, std::chrono::milliseconds(timeout), [&state, knownGeneration](){return state.generation!=knownGeneration;});
+	return state.generation;
+}
+
+bool IPInterfaceMonitor::isEventDriven(){
+	State& state = getState();
+	std::lock_guard<std::mutex> lock(state.mutex);
+	return state.notificationSocket>=0;
+}
@@ -111,6 +111,11 @@ class IPv6Address : public IIPAddress{
 
 };
 
+//! for unordered containers, consistent with IPv6Address::operator== (address and port)
+struct IPv6AddressHash{
+	size_t operator()(const IPv6Address& a) const;
+};
+
 struct IPInterface{
 
 	std::string name;
@@ -176,6 +181,10 @@ class ASocket : public ISocket{
 	//! true if buf has been sent (does not gurantee reception on other side)
 	virtual bool send(const char* buf, uint32_t bufSize);
 	
+	//! gather write: sends the buffers as if they were concatenated (one system call if possible), the non blocking variant may send only a part
+	//! returns the amount of sent bytes or -1 if the connection is lost (stream sockets)
+	int64_t sendBuffers(const char* const* bufs, const uint32_t* sizes, uint32_t count, bool blocking = true);
+	
 	//! reusePort: if true multiple sockets can bind to this port (UDP: for send/receive TCP: for listen)
 	virtual bool bind(int port, bool reusePort = false) = 0;
 	
@@ -187,13 +196,22 @@ class ASocket : public ISocket{
 	
 	virtual int getSocketHandle() const;
 	
+	//! address of the connected peer, NULL if not connected, must be deleted by the caller
+	IIPAddress* createPeerAddress() const;
+	
 	virtual bool setReceiveBufferSize(uint32_t size);
 	
 	virtual bool setSendBufferSize(uint32_t size);
 	
+	//! disables the Nagle algorithm (TCP only): small writes are sent immediately instead of waiting for the acknowledgement of previous ones
+	virtual bool setNoDelay(bool enabled);
+	
 	//! useful only for blocking reads
 	virtual void setBlockingReceiveTimeout(uint32_t microseconds);
 	
+	//! waits up to timeout ms, true if data is available or the connection has been closed by the peer (getAvailableBytes()==0 in this case)
+	virtual bool waitForReceive(uint32_t timeout);
+	
 	virtual ~ASocket();
 
 };
@@ -275,6 +293,13 @@ class IPv4UDPSocket : public IPv4Socket{
 	
 	uint32_t recv(char* buf, uint32_t bufSize, bool readBlocking = false);
 	
+	//! receives up to count datagrams (non blocking) using a single system call if available (recvmmsg), each buffer in bufs must have bufSize bytes
+	//! sizes[i] is set to the size of the i-th datagram, returns the amount of received datagrams, getLastDatagramAddress returns the address of the last one
+	uint32_t recvBatch(char* const* bufs, uint32_t bufSize, uint32_t* sizes, uint32_t count);
+	
+	//! sends count datagrams to the UDP target using a single system call if available (sendmmsg), returns the amount of sent datagrams
+	uint32_t sendBatch(const char* const* bufs, const uint32_t* sizes, uint32_t count);
+	
 	const IPv4Address& getLastDatagramAddress() const;
 	
 	//! addressString must be a multicast address from 224.0.0.0/4 subnet, true if successful
@@ -287,7 +312,7 @@ class IPv4UDPSocket : public IPv4Socket{
 	//! chooses a list of specific local interfaces (if up), true if successful for all, see also queryIPInterfaces, ports are ignored
 	bool joinMulticastGroup(const IPv4Address& multicastAddress, const std::list<IPInterface>& localInterfaces, const std::function<void(const IPv4Address& multicastAddress, const IPv4Address& localInterfaceAddress, bool success)>& perInterfaceCallback = nullptr);
 
-	//! automatically joins the multicast group on all available interfaces on a regular basis (recv call)
+	//! automatically joins the multicast group on all available interfaces if they change (checked in recv, see IPInterfaceMonitor) and on a regular basis
 	//! the callback function is overriden at each call of this function
 	//! if no local interfaces are found the multicast group is joined on INADDR_ANY
 	void enableAutoMulticastGroupJoining(const IPv4Address& multicastAddress, const std::function<void(const IPv4Address& multicastAddress, const IPv4Address& localInterfaceAddress, bool success)>& perInterfaceCallback = nullptr);
@@ -362,6 +387,8 @@ class IPv4TCPSocket : public IPv4Socket{
 	
 	//! timeout in ms
 	bool connect(const IPv4Address& address, uint32_t timeout);
+	
+	friend ASocket* connectSocketForAddressList(const std::list<IIPAddress*>& addressList, uint32_t timeout, IIPAddress** connectedAddress, uint32_t attemptDelay);
 
 };
 
@@ -391,22 +418,69 @@ class IPv6TCPSocket : public IPv6Socket{
 	
 	//! timeout in ms
 	bool connect(const IPv6Address& address, uint32_t timeout);
+	
+	friend ASocket* connectSocketForAddressList(const std::list<IIPAddress*>& addressList, uint32_t timeout, IIPAddress** connectedAddress, uint32_t attemptDelay);
 
 };
 
-//! returns NULL if unsuccessful, timeout in ms (total timeout = timeout * addressList.size()), addressList will be deleted, connectedAddress will be filled if not NULL (pointer from list)
-ASocket* connectSocketForAddressList(const std::list<IIPAddress*>& addressList, uint32_t timeout, IIPAddress** connectedAddress = NULL);
+//! returns NULL if unsuccessful, timeout in ms for all attempts together, addressList is not deleted, connectedAddress will be filled if not NULL (pointer from list)
+//! "Happy Eyeballs" (RFC 8305): the addresses are tried alternating between IPv6 and IPv4 (starting with the family of the first address),
+//! a new attempt is started every attemptDelay ms (immediately if the previous attempts failed) without aborting the pending ones, the first established connection wins
+ASocket* connectSocketForAddressList(const std::list<IIPAddress*>& addressList, uint32_t timeout, IIPAddress** connectedAddress = NULL, uint32_t attemptDelay = 250);
+
+//! Resolves a host name in a background thread since getaddrinfo blocks without timeout.
+//! The query can be deleted at any time without blocking (an unfinished resolution completes in the background and only fills the cache).
+class HostNameQuery{
 
-//! WARNING: NO TIMEOUT; portToFill: port which is filled into the results
+	private:
+	
+	struct State;
+	std::shared_ptr<State> state;
+	
+	struct Resolvers;//queued host names and running resolver threads shared by all queries
+	static Resolvers& getResolvers();
+	
+	static void* resolveMain(void* arg);
+	
+	public:
+	
+	//! resolutions which are started while maxResolverThreads are running are queued
+	static const uint32_t maxResolverThreads = 8;
+	
+	//! starts the resolution unless the host name is cached, queries of a host name which is still being resolved share the resolution
+	HostNameQuery(const std::string& hostName);
+	
+	//! true if the resolution has finished (successful or not)
+	bool isDone() const;
+	
+	//! waits at most timeout ms, returns isDone()
+	bool wait(uint32_t timeout);
+	
+	//! returns new copies of the resolved addresses with the given port (empty if not done or unsuccessful)
+	std::list<IIPAddress*> createAddressList(uint16_t portToFill) const;
+
+};
+
+//! WARNING: NO TIMEOUT (see overload below); portToFill: port which is filled into the results
 std::list<IIPAddress*> queryIPAddressesForHostName(const std::string& hostname, uint16_t portToFill = 0);
 
+//! returns an empty list if the host name can not be resolved within timeout ms
+std::list<IIPAddress*> queryIPAddressesForHostName(const std::string& hostname, uint16_t portToFill, uint32_t timeout);
+
+//! time in ms for which resolved host names are reused (getaddrinfo does not provide the DNS TTL), 0 disables the cache, default: 60000
+void setHostNameCacheTTL(uint32_t ttl);
+
+//! e.g. if the network has changed
+void clearHostNameCache();
+
 std::list<IIPAddress*> copyAddressList(const std::list<IIPAddress*>& other);
 
 void deleteAddressList(std::list<IIPAddress*>& l);
 
-//! if tcp create tcp socket and connect with tcpConnectTimeout, else create udp and set target
+//! if tcp create tcp socket and connect with tcpConnectTimeout (see connectSocketForAddressList), else create udp and set target
+//! resolveTimeout: max time in ms for the host name resolution
 //! returns NULL if no known ip address or tcp connection failed
-ASocket* createSocketForHostName(bool tcp, const std::string& hostname, uint16_t port, uint32_t tcpConnectTimeout);
+ASocket* createSocketForHostName(bool tcp, const std::string& hostname, uint16_t port, uint32_t tcpConnectTimeout, uint32_t resolveTimeout = 5000);
 
 template<typename TUDPSocket, typename TContainer>
 bool sendUDPToAddresses(TUDPSocket& s, const TContainer& addressList, const char* buf, uint32_t bufSize){
@@ -424,4 +498,36 @@ std::list<IPv4Address> queryIPv4BroadcastAdresses(uint16_t portToFill = 0);
 
 std::list<IPInterface> queryIPInterfaces();
 
+//! Process-wide snapshot of the local interfaces (see queryIPInterfaces) which is kept up to date by a background thread.
+//! On Linux and Android the thread is woken up by rtnetlink if an interface comes up, goes down or changes its address, on other platforms queryIPInterfaces is polled.
+//! The generation only changes if the interfaces have actually changed, it is cheap enough to be checked in receive loops.
+class IPInterfaceMonitor{
+
+	private:
+	
+	struct State;
+	
+	static State& getState();
+	
+	static void* monitorMain(void* arg);
+	
+	public:
+	
+	//! starts the background thread if not running yet
+	static void start();
+	
+	//! incremented on each change of the interfaces, 0 if the monitor has not been started
+	static uint64_t getGeneration();
+	
+	//! latest snapshot (starts the monitor if required)
+	static std::list<IPInterface> getInterfaces();
+	
+	//! blocks until the generation differs from knownGeneration or timeout ms have passed, returns the current generation
+	static uint64_t waitForChange(uint64_t knownGeneration, uint32_t timeout);
+	
+	//! true if changes are signaled by the operating system, false if they are polled
+	static bool isEventDriven();
+
+};
+
 #endif
@@ -0,0 +1,91 @@
+#include "TCPAcceptor.h"
+#include "SimpleSockets.h"
+
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <memory>
+
+#if !SIMPLESOCKETS_WIN
+#include <sys/socket.h>
+#endif
+
+class TCPAcceptorPrivate{
+	
+	public:
+	
+	#if defined(__linux__)
+	static constexpr uint32_t stopCheckPeriod = UINT32_MAX;//ms, the destructor wakes up the threads by shutdown of the listening sockets
+	#else
+	static constexpr uint32_t stopCheckPeriod = 100;//ms, the listening sockets may not be woken up by shutdown
+	#endif
+	
+	TCPAcceptor::OnAccept onAccept;
+	std::vector<std::unique_ptr<IPv6TCPSocket> > sockets;
+	std::vector<std::thread> threads;
+	std::atomic<bool> running;
+	std::atomic<uint64_t> acceptedCount;
+	bool good;
+	
+	TCPAcceptorPrivate(const TCPAcceptor::OnAccept& onAccept):onAccept(onAccept),running(true),acceptedCount(0),good(true){}
+	
+	void run(IPv6TCPSocket* socket){
+		while(running){
+			IPv6Address address;
+			IPv6TCPSocket* s = socket->accept(stopCheckPeriod, &address);
+			if(s){
+				if(running){
+					acceptedCount++;
+					onAccept(s, address);
+				}else{
+					delete s;
+				}
+			}
+		}
+	}
+	
+};
+
+TCPAcceptor::TCPAcceptor(uint16_t port, uint32_t threadCount, int maxPendingConnections, const OnAccept& onAccept){
+	p = new TCPAcceptorPrivate(onAccept);
+	#if SIMPLESOCKETS_WIN
+	threadCount = 1;
+	#endif
+	if(threadCount==0){threadCount = 1;}
+	for(uint32_t i=0; i<threadCount; i++){//all sockets are bound before the first one listens
+		p->sockets.emplace_back(new IPv6TCPSocket());
+		p->good = p->good && p->sockets.back()->bind(port, threadCount>1);
+	}
+	for(std::unique_ptr<IPv6TCPSocket>& s : p->sockets){
+		p->good = p->good && s->listen(maxPendingConnections);
+	}
+	if(p->good){
+		for(std::unique_ptr<IPv6TCPSocket>& s : p->sockets){
+			IPv6TCPSocket* socket = s.get();
+			p->threads.emplace_back([this, socket](){p->run(socket);});
+		}
+	}
+}
+
+TCPAcceptor::~TCPAcceptor(){
+	p->running = false;
+	#if !SIMPLESOCKETS_WIN
+	for(std::unique_ptr<IPv6TCPSocket>& s : p->sockets){
+		::shutdown(s->getSocketHandle(), SHUT_RDWR);//wakes up the waiting threads
+	}
+	#endif
+	for(std::thread& t : p->threads){t.join();}
+	delete p;
+}
+
+bool TCPAcceptor::isGood() const{
+	return p->good;
+}
+
+uint32_t TCPAcceptor::getThreadCount() const{
+	return p->sockets.size();
+}
+
+uint64_t TCPAcceptor::getAcceptedCount() const{
+	return p->acceptedCount;
+}
@@ -0,0 +1,42 @@
+#ifndef TCPAcceptor_H_INCLUDED
+#define TCPAcceptor_H_INCLUDED
+
+#include <functional>
+#include <cstdint>
+
+class IPv6TCPSocket;
+class IPv6Address;
+class TCPAcceptorPrivate;
+
+//! Accepts TCP connections of a port in background threads which block until a connection is ready (on Linux without timeout, other platforms check for the destruction every 100 ms).
+//! Each thread has its own listening socket bound with SO_REUSEPORT, the kernel distributes the incoming connections among them (not on Windows: one thread).
+class TCPAcceptor{
+	
+	public:
+	
+	//! called in an accept thread for each new connection, the socket must be deleted by the callee
+	typedef std::function<void(IPv6TCPSocket*, const IPv6Address&)> OnAccept;
+	
+	private:
+	
+	TCPAcceptorPrivate* p;
+	
+	public:
+	
+	//! threadCount: listening sockets / threads (at least 1)
+	//! maxPendingConnections: per listening socket
+	TCPAcceptor(uint16_t port, uint32_t threadCount, int maxPendingConnections, const OnAccept& onAccept);
+	
+	//! stops the threads, onAccept is not called anymore afterwards
+	~TCPAcceptor();
+	
+	//! true if all sockets are bound and listening
+	bool isGood() const;
+	
+	uint32_t getThreadCount() const;
+	
+	uint64_t getAcceptedCount() const;
+	
+};
+
+#endif
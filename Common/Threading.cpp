@@ -24,6 +24,12 @@ bool createThread(Thread& outThread, void* (*start_routine)(void*), void* arg, b
 	return res==0;
 }
 
+bool setCurrentThreadRealtimePriority(){
+	struct sched_param param;
+	param.sched_priority = (sched_get_priority_min(SCHED_FIFO)+sched_get_priority_max(SCHED_FIFO))/2;
+	return pthread_setschedparam(pthread_self(), SCHED_FIFO, &param)==0;
+}
+
 PooledThread::PooledThread(){
 	initMutex(mutex);
 	start_routine = NULL;
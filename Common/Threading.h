@@ -12,6 +12,7 @@ typedef pthread_t Thread;
 typedef pthread_mutex_t Mutex;
 
 #define lockMutex(M) pthread_mutex_lock(&M)
+#define tryLockMutex(M) (pthread_mutex_trylock(&M)==0)
 #define unlockMutex(M) pthread_mutex_unlock(&M)
 #define initMutex(M) pthread_mutex_init(&M, NULL)
 #define deleteMutex(M) pthread_mutex_destroy(&M)
@@ -22,6 +23,9 @@ class ThreadPool;
 //! stackSize in bytes (<0 => default)
 bool createThread(Thread& outThread, void* (*start_routine)(void*), void* arg, bool joinable = false, int32_t stackSize = -1);
 
+//! tries to get a real-time scheduling priority for the calling thread (usually requires privileges), false if it keeps the default priority
+bool setCurrentThreadRealtimePriority();
+
 class PooledThread{
 
 	private:
@@ -3,7 +3,111 @@
 
 #include <zlib.h>
 #include <cassert>
+#include <cstring>
 #include <iostream>
+#include <algorithm>
+#include <map>
+#include <mutex>
+
+static const uint8_t syncFlushMarker[] = {0x00, 0x00, 0xFF, 0xFF};
+
+class DeflateCodecPrivate{
+
+	public:
+	
+	z_stream deflateStrm;
+	z_stream inflateStrm;
+	uint32_t level;
+	uint32_t pendingLevel;
+	std::vector<char> inflateInput;
+	
+	DeflateCodecPrivate(uint32_t level, const std::string& dictionary):level(level),pendingLevel(level){
+		deflateStrm.zalloc = Z_NULL;
+		deflateStrm.zfree = Z_NULL;
+		deflateStrm.opaque = Z_NULL;
+		bool success = deflateInit2(&deflateStrm, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY)==Z_OK;//raw deflate: no header and checksum
+		inflateStrm.zalloc = Z_NULL;
+		inflateStrm.zfree = Z_NULL;
+		inflateStrm.opaque = Z_NULL;
+		inflateStrm.avail_in = 0;
+		inflateStrm.next_in = Z_NULL;
+		success = success && inflateInit2(&inflateStrm, -15)==Z_OK;
+		if(!success){std::cerr << "ERROR: DeflateCodec initialization failed" << std::endl;}
+		if(!dictionary.empty()){
+			deflateSetDictionary(&deflateStrm, (const Bytef*)dictionary.c_str(), dictionary.size());
+			inflateSetDictionary(&inflateStrm, (const Bytef*)dictionary.c_str(), dictionary.size());
+		}
+	}
+	
+	~DeflateCodecPrivate(){
+		deflateEnd(&deflateStrm);
+		inflateEnd(&inflateStrm);
+	}
+	
+};
+
+DeflateCodec::DeflateCodec(uint32_t level, const std::string& dictionary){
+	p = new DeflateCodecPrivate(level, dictionary);
+}
+
+DeflateCodec::~DeflateCodec(){
+	delete p;
+}
+
+bool DeflateCodec::encode(const char* in, uint32_t inSize, std::vector<char>& out){
+	size_t start = out.size();
+	out.resize(start+deflateBound(&p->deflateStrm, inSize)+16);
+	p->deflateStrm.next_out = (Bytef*)&out[start];
+	p->deflateStrm.avail_out = out.size()-start;
+	if(p->pendingLevel!=p->level){//no pending input since the last block has been flushed
+		if(deflateParams(&p->deflateStrm, p->pendingLevel, Z_DEFAULT_STRATEGY)!=Z_OK){return false;}
+		p->level = p->pendingLevel;
+	}
+	p->deflateStrm.next_in = (Bytef*)in;
+	p->deflateStrm.avail_in = inSize;
+	while(true){
+		int ret = deflate(&p->deflateStrm, Z_SYNC_FLUSH);
+		if(ret==Z_STREAM_ERROR){return false;}
+		if(p->deflateStrm.avail_out>0){break;}
+		size_t used = out.size();
+		out.resize(2*out.size());
+		p->deflateStrm.next_out = (Bytef*)&out[used];
+		p->deflateStrm.avail_out = out.size()-used;
+	}
+	out.resize(out.size()-p->deflateStrm.avail_out);
+	if(out.size()-start>=sizeof(syncFlushMarker) && memcmp(&out[out.size()-sizeof(syncFlushMarker)], syncFlushMarker, sizeof(syncFlushMarker))==0){
+		out.resize(out.size()-sizeof(syncFlushMarker));
+	}
+	return true;
+}
+
+bool DeflateCodec::decode(const char* in, uint32_t inSize, std::vector<char>& out){
+	p->inflateInput.assign(in, in+inSize);
+	p->inflateInput.insert(p->inflateInput.end(), (const char*)syncFlushMarker, (const char*)syncFlushMarker+sizeof(syncFlushMarker));
+	p->inflateStrm.next_in = (Bytef*)&p->inflateInput[0];
+	p->inflateStrm.avail_in = p->inflateInput.size();
+	do{
+		size_t start = out.size();
+		out.resize(start+std::max<size_t>(4*inSize, 4096));
+		p->inflateStrm.next_out = (Bytef*)&out[start];
+		p->inflateStrm.avail_out = out.size()-start;
+		int ret = inflate(&p->inflateStrm, Z_SYNC_FLUSH);
+		out.resize(out.size()-p->inflateStrm.avail_out);
+		if(ret!=Z_OK && ret!=Z_BUF_ERROR){return false;}
+	}while(p->inflateStrm.avail_in>0 || p->inflateStrm.avail_out==0);
+	return true;
+}
+
+void DeflateCodec::setLevel(uint32_t level){
+	p->pendingLevel = level;
+}
+
+const std::string& DeflateCodec::getJSONRPCDictionary(){
+	//the most frequent strings at the end (shortest distances)
+	static const std::string dictionary = "\"error\":{\"code\":-32600,\"message\":\"Invalid Request\"}\"error\":{\"code\":-32601,\"message\":\"Method not found\"}"
+		"\"data\":null,true,false,0.0,[],{},\"},{\"\":\"\",\"\"]\"}],\"result\":[{\"{\"jsonrpc\":\"2.0\",\"result\":\"params\":[{\"params\":{\"{\"jsonrpc\":\"2.0\",\"method\":\"\",\"params\":[\"],\"id\":";
+	return dictionary;
+}
 
 class ZSocketPrivate{
 	
@@ -12,6 +116,27 @@ class ZSocketPrivate{
 	bool mustDeleteSlaveSocket;
 	ICommunicationEndpoint* slaveSocket;
 	
+	ZSocket::Statistics stats;
+	
+	//framed mode:
+	IZSocketCodec* codec;
+	bool adaptive;
+	uint32_t maxLevel;
+	double ratioEstimate;//encoded/raw, negative if no sample
+	uint32_t bypassRemaining;//blocks to pass through before the next sample
+	uint32_t bypassBlockCount;
+	std::vector<char> sendFrames;
+	std::vector<char> encodedBlock;
+	std::vector<char> receivedFrames;
+	std::vector<char> decoded;
+	size_t decodedPos;
+	
+	static const uint32_t maxBlockSize = 65536;
+	static const uint32_t minEncodeSize = 16;//smaller blocks are not worth it
+	static constexpr double bypassRatio = 0.95;
+	static const uint32_t minBypassBlockCount = 4;
+	static const uint32_t maxBypassBlockCount = 256;
+	
 	char* sendBuf;
 	uint32_t sendBufSize;
 	
@@ -35,7 +160,7 @@ class ZSocketPrivate{
 		lastInflateFinished = true;
 	}
 	
-	ZSocketPrivate(ICommunicationEndpoint* slaveSocket, uint32_t sendBufSize, uint32_t recvBufSize, uint32_t compressionLevel, bool mustDeleteSlaveSocket):mustDeleteSlaveSocket(mustDeleteSlaveSocket),slaveSocket(slaveSocket),sendBufSize(sendBufSize),recvBufSize(recvBufSize){
+	ZSocketPrivate(ICommunicationEndpoint* slaveSocket, uint32_t sendBufSize, uint32_t recvBufSize, uint32_t compressionLevel, bool mustDeleteSlaveSocket):mustDeleteSlaveSocket(mustDeleteSlaveSocket),slaveSocket(slaveSocket),stats{0, 0, 0, compressionLevel},codec(NULL),sendBufSize(sendBufSize),recvBufSize(recvBufSize){
 		sendBuf = new char[sendBufSize];
 		recvBuf = new char[recvBufSize];
 		//allocate deflate state
@@ -47,16 +172,134 @@ class ZSocketPrivate{
 		initInflate();
 	}
 	
+	ZSocketPrivate(ICommunicationEndpoint* slaveSocket, IZSocketCodec* codec, bool adaptive, uint32_t maxLevel, bool mustDeleteSlaveSocket):mustDeleteSlaveSocket(mustDeleteSlaveSocket),slaveSocket(slaveSocket),stats{0, 0, 0, maxLevel},codec(codec),adaptive(adaptive),maxLevel(maxLevel),
+		ratioEstimate(-1.0),bypassRemaining(0),bypassBlockCount(minBypassBlockCount),decodedPos(0),sendBuf(NULL),sendBufSize(0),recvBufSize(maxBlockSize){
+		recvBuf = new char[recvBufSize];
+		codec->setLevel(maxLevel);
+	}
+	
 	~ZSocketPrivate(){
 		if(mustDeleteSlaveSocket){delete slaveSocket;}
-		deflateEnd(&deflateStrm);
-		inflateEnd(&inflateStrm);
+		if(codec){
+			delete codec;
+		}else{
+			deflateEnd(&deflateStrm);
+			inflateEnd(&inflateStrm);
+		}
 		delete[] sendBuf;
 		delete[] recvBuf;
 	}
 	
+	//! adapts level and bypass to the compression ratio of the last encoded block
+	void addRatioSample(double ratio){
+		ratioEstimate = ratioEstimate<0.0?ratio:(0.75*ratioEstimate+0.25*ratio);
+		if(ratioEstimate>bypassRatio){
+			bypassRemaining = bypassBlockCount;
+			bypassBlockCount = std::min(2*bypassBlockCount, maxBypassBlockCount);//still incompressible after the next sample => longer bypass
+			ratioEstimate = -1.0;//the next sample decides alone
+		}else{
+			bypassBlockCount = minBypassBlockCount;
+			uint32_t level = ratioEstimate<0.5?maxLevel:(ratioEstimate<0.8?std::min(maxLevel, 4u):1);
+			if(level!=stats.level){
+				stats.level = level;
+				codec->setLevel(level);
+			}
+		}
+	}
+	
+	static void appendVarint(std::vector<char>& out, uint32_t value){
+		while(value>=0x80){
+			out.push_back((char)(value|0x80));
+			value >>= 7;
+		}
+		out.push_back((char)value);
+	}
+	
+	//! frame: varint (length<<1 | encoded) followed by the payload
+	bool appendBlock(const char* in, uint32_t inSize){
+		stats.rawBytes += inSize;
+		if(inSize>=minEncodeSize && (!adaptive || bypassRemaining==0)){
+			encodedBlock.clear();
+			if(!codec->encode(in, inSize, encodedBlock)){return false;}
+			if(adaptive){addRatioSample(encodedBlock.size()/(double)inSize);}
+			appendVarint(sendFrames, (encodedBlock.size()<<1)|1);
+			sendFrames.insert(sendFrames.end(), encodedBlock.begin(), encodedBlock.end());
+		}else{
+			if(inSize>=minEncodeSize){
+				bypassRemaining--;
+				stats.bypassedBytes += inSize;
+			}
+			appendVarint(sendFrames, inSize<<1);
+			sendFrames.insert(sendFrames.end(), in, in+inSize);
+		}
+		return true;
+	}
+	
+	bool sendFramed(const char* inBuf, uint32_t inBufSize){
+		sendFrames.clear();
+		bool success = true;
+		while(success && inBufSize>0){
+			uint32_t blockSize = std::min(inBufSize, maxBlockSize);
+			success = appendBlock(inBuf, blockSize);
+			inBuf += blockSize;
+			inBufSize -= blockSize;
+		}
+		if(!success){
+			std::cerr << "ERROR: ZSocket codec error while encoding" << std::endl;
+			return false;
+		}
+		stats.sentBytes += sendFrames.size();
+		return sendFrames.empty() || slaveSocket->send(&sendFrames[0], sendFrames.size());
+	}
+	
+	//! decodes all complete frames, false on error
+	bool decodeFrames(){
+		size_t pos = 0;
+		while(pos<receivedFrames.size()){
+			uint32_t header = 0;
+			size_t headerPos = pos;
+			bool complete = false;
+			for(uint32_t shift=0; headerPos<receivedFrames.size() && shift<35; shift+=7){
+				uint8_t b = (uint8_t)receivedFrames[headerPos++];
+				header |= (uint32_t)(b&0x7F)<<shift;
+				if((b&0x80)==0){complete = true; break;}
+			}
+			uint32_t length = header>>1;
+			if(!complete || receivedFrames.size()-headerPos<length){break;}
+			const char* payload = length>0?&receivedFrames[headerPos]:NULL;
+			if(header&1){
+				if(!codec->decode(payload, length, decoded)){return false;}
+			}else{
+				decoded.insert(decoded.end(), payload, payload+length);
+			}
+			pos = headerPos+length;
+		}
+		receivedFrames.erase(receivedFrames.begin(), receivedFrames.begin()+pos);
+		return true;
+	}
+	
+	int32_t recvFramed(char* outBuf, uint32_t outBufSize){
+		if(decodedPos==decoded.size()){
+			decoded.clear();
+			decodedPos = 0;
+			int32_t received = slaveSocket->recv(recvBuf, recvBufSize);
+			if(received<=0){return received;}
+			receivedFrames.insert(receivedFrames.end(), recvBuf, recvBuf+received);
+			if(!decodeFrames()){
+				std::cerr << "ERROR: ZSocket codec error while decoding" << std::endl;
+				return -1;
+			}
+		}
+		uint32_t count = std::min((size_t)outBufSize, decoded.size()-decodedPos);
+		if(count>0){memcpy(outBuf, &decoded[decodedPos], count);}
+		decodedPos += count;
+		return count;
+	}
+	
 	bool send(const char* inBuf, uint32_t inBufSize){
+		if(codec){return sendFramed(inBuf, inBufSize);}
 		bool success = true;
+		stats.rawBytes += inBufSize;
 		if(inBufSize>0){
 			deflateStrm.avail_in = inBufSize;
 			deflateStrm.next_in = (Bytef*)inBuf;
@@ -67,6 +310,7 @@ class ZSocketPrivate{
 				assert(ret != Z_STREAM_ERROR);
 				uint32_t have = sendBufSize - deflateStrm.avail_out;//available bytes, which is the difference between how much space was provided before the call, and how much output space is still available after the call.
 				if(have>0){
+					stats.sentBytes += have;
 					bool thisSuccess = slaveSocket->send(sendBuf, have);
 					success = success && thisSuccess;
 				}
@@ -92,6 +336,7 @@ class ZSocketPrivate{
 	}
 	
 	int32_t recv(char* outBuf, uint32_t outBufSize){
+		if(codec){return recvFramed(outBuf, outBufSize);}
 		if(!lastInflateFinished){
 			return execInflate(outBuf, outBufSize);
 		}
@@ -110,6 +355,10 @@ ZSocket::ZSocket(ICommunicationEndpoint* slaveSocket, uint32_t sendBufSize, uint
 	p = new ZSocketPrivate(slaveSocket, sendBufSize, recvBufSize, compressionLevel, mustDeleteSlaveSocket);
 }
 	
+ZSocket::ZSocket(ICommunicationEndpoint* slaveSocket, IZSocketCodec* codec, bool adaptive, uint32_t maxLevel, bool mustDeleteSlaveSocket){
+	p = new ZSocketPrivate(slaveSocket, codec, adaptive, maxLevel, mustDeleteSlaveSocket);
+}
+
 ZSocket::~ZSocket(){
 	delete p;
 }
@@ -122,4 +371,49 @@ bool ZSocket::send(const char* buf, uint32_t bufSize){
 	return p->send(buf, bufSize);
 }
 
+ZSocket::Statistics ZSocket::getStatistics() const{
+	return p->stats;
+}
+
+struct ZSocketCodecRegistry{
+	std::mutex mutex;
+	std::map<std::string, ZSocketCodecFactory> name2factory;
+	ZSocketCodecRegistry(){
+		name2factory["deflate"] = [](){return new DeflateCodec();};
+		name2factory["deflate-json"] = [](){return new DeflateCodec(9, DeflateCodec::getJSONRPCDictionary());};
+	}
+};
+
+static ZSocketCodecRegistry& getCodecRegistry(){
+	static ZSocketCodecRegistry registry;
+	return registry;
+}
+
+void registerZSocketCodec(const std::string& name, const ZSocketCodecFactory& factory){
+	ZSocketCodecRegistry& r = getCodecRegistry();
+	std::lock_guard<std::mutex> lock(r.mutex);
+	r.name2factory[name] = factory;
+}
+
+bool isZSocketCodecAvailable(const std::string& name){
+	ZSocketCodecRegistry& r = getCodecRegistry();
+	std::lock_guard<std::mutex> lock(r.mutex);
+	return r.name2factory.find(name)!=r.name2factory.end();
+}
+
+ZSocket* createZSocket(ICommunicationEndpoint* slaveSocket, const std::string& codecName, bool mustDeleteSlaveSocket){
+	if(codecName.empty()){
+		return new ZSocket(slaveSocket, 1024*1024, 1024*1024, 9, mustDeleteSlaveSocket);
+	}
+	ZSocketCodecFactory factory;
+	{
+		ZSocketCodecRegistry& r = getCodecRegistry();
+		std::lock_guard<std::mutex> lock(r.mutex);
+		auto it = r.name2factory.find(codecName);
+		if(it==r.name2factory.end()){return NULL;}
+		factory = it->second;
+	}
+	return new ZSocket(slaveSocket, factory(), true, 9, mustDeleteSlaveSocket);
+}
+
 #endif
@@ -5,29 +5,106 @@
 
 #include "ICommunicationEndpoint.h"
 
+#include <vector>
+#include <string>
+#include <functional>
+
 class ZSocketPrivate;
 
+//! Codec for the framed mode of ZSocket, both directions of a connection use the same codec instance.
+//! Each block passed to encode must be decodable by the peer as soon as it has received all previous blocks (e.g. flushed).
+class IZSocketCodec{
+
+	public:
+
+	virtual ~IZSocketCodec(){}
+
+	//! appends the encoded block to out, false on error
+	virtual bool encode(const char* in, uint32_t inSize, std::vector<char>& out) = 0;
+
+	//! appends the decoded block to out, false on error
+	virtual bool decode(const char* in, uint32_t inSize, std::vector<char>& out) = 0;
+
+	//! 1 (fastest) ... 9 (best compression), used by the adaptive mode, codecs may ignore it
+	virtual void setLevel(uint32_t level){}
+
+};
+
+class DeflateCodecPrivate;
+
+//! raw deflate with a sync flush per block (the sync flush marker is not transmitted), optional preset dictionary (must be equal on both sides)
+class DeflateCodec : public IZSocketCodec{
+
+	private:
+
+	DeflateCodecPrivate* p;
+
+	public:
+
+	DeflateCodec(uint32_t level = 9, const std::string& dictionary = "");
+
+	~DeflateCodec();
+
+	bool encode(const char* in, uint32_t inSize, std::vector<char>& out);
+
+	bool decode(const char* in, uint32_t inSize, std::vector<char>& out);
+
+	void setLevel(uint32_t level);
+
+	//! common JSON-RPC 2.0 vocabulary
+	static const std::string& getJSONRPCDictionary();
+
+};
+
 //! Socket Layer for transparent compression with zlib using a "slave" socket
 class ZSocket : public ICommunicationEndpoint{
 	friend class ZSocketPrivate;
 
+	public:
+
+	struct Statistics{
+		uint64_t rawBytes;//! passed to send
+		uint64_t sentBytes;//! sent to the slave socket
+		uint64_t bypassedBytes;//! raw bytes which have been sent uncompressed (framed mode)
+		uint32_t level;//! current level (framed mode)
+	};
+
 	private:
-	
+
 	ZSocketPrivate* p;
 
 	public:
-	
+
+	//! classic mode: zlib stream with a sync flush after each send
 	//! mustDeleteSlaveSocket: true if slaveSocket shall be deleted upon destruction, sendBufSize/recvBufSize: buffer size for compressed data, should be large to get as much data as possible with less overhead
 	ZSocket(ICommunicationEndpoint* slaveSocket, uint32_t sendBufSize = 1024*1024, uint32_t recvBufSize = 1024*1024, uint32_t compressionLevel = 9, bool mustDeleteSlaveSocket = true);
-	
+
+	//! framed mode (not compatible with the classic mode): the data is sent in blocks which are either encoded by the codec or passed through uncompressed
+	//! adaptive: the compression ratio is sampled, the level is lowered (down to 1) if the data compresses poorly and blocks are passed through while it is incompressible
+	//! codec will be deleted upon destruction
+	ZSocket(ICommunicationEndpoint* slaveSocket, IZSocketCodec* codec, bool adaptive = true, uint32_t maxLevel = 9, bool mustDeleteSlaveSocket = true);
+
 	~ZSocket();
-	
+
 	int32_t recv(char* buf, uint32_t bufSize);
-	
+
 	bool send(const char* buf, uint32_t bufSize);
-	
+
+	Statistics getStatistics() const;
+
 };
 
+typedef std::function<IZSocketCodec*()> ZSocketCodecFactory;
+
+//! makes a codec available for createZSocket, built-in: "deflate" and "deflate-json" (preset dictionary with JSON-RPC 2.0 vocabulary)
+void registerZSocketCodec(const std::string& name, const ZSocketCodecFactory& factory);
+
+//! e.g. to decide during protocol negotiation (see IMetaProtocolHandler)
+bool isZSocketCodecAvailable(const std::string& name);
+
+//! codecName: empty for the classic mode, otherwise adaptive framed mode with the registered codec, NULL if the codec is unknown
+ZSocket* createZSocket(ICommunicationEndpoint* slaveSocket, const std::string& codecName, bool mustDeleteSlaveSocket = true);
+
 #endif
 
 #endif
@@ -21,6 +21,9 @@ namespace scene
 		//! Irrlicht native mesh writer, for static .irrmesh files.
 		EMWT_IRR_MESH     = MAKE_IRR_ID('i','r','r','m'),
 
+		//! Irrlicht native binary mesh writer, for static .irrbmesh files.
+		EMWT_IRR_BINARY_MESH = MAKE_IRR_ID('i','r','r','b'),
+
 		//! COLLADA mesh writer for .dae and .xml files
 		EMWT_COLLADA      = MAKE_IRR_ID('c','o','l','l'),
 
@@ -16,6 +16,20 @@ namespace irr
 
 class ITimer;
 
+//! Gets informed about the profile-timing of all ids, e.g. to forward it to an external profiler.
+/** The calls happen in the thread which calls IProfiler::start/stop and only for the outermost start/stop pair of an id. */
+class IProfileListener
+{
+public:
+	virtual ~IProfileListener() {}
+
+	//! Called when profile-timing for the given id starts
+	virtual void onProfileStart(s32 id) = 0;
+
+	//! Called when profile-timing for the given id stops
+	virtual void onProfileStop(s32 id) = 0;
+};
+
 //! Used to store the profile data (and also used for profile group data).
 struct SProfileData
 {
@@ -102,7 +116,7 @@ class IProfiler
 {
 public:
 	//! Constructor. You could use this to create a new profiler, but usually getProfiler() is used to access the global instance.
-    IProfiler()	: Timer(0), NextAutoId(INT_MAX)
+    IProfiler()	: Timer(0), Listener(0), NextAutoId(INT_MAX)
 	{}
 
 	virtual ~IProfiler()
@@ -181,6 +195,19 @@ public:
 	*/
     inline void stop(s32 id);
 
+	//! Set a listener which is informed about all start/stop calls (0 to remove it)
+	/** The listener is not owned by the profiler and has to stay valid until it's removed again. */
+	void setListener(IProfileListener* listener)
+	{
+		Listener = listener;
+	}
+
+	//! Get the current listener (0 if none is set)
+	IProfileListener* getListener() const
+	{
+		return Listener;
+	}
+
 	//! Reset profile data for the given id
     inline void resetDataById(s32 id);
 
@@ -212,6 +239,7 @@ protected:
 	// I would prefer using os::Timer, but os.h is not in the public interface so far.
 	// Timer must be initialized by the implementation.
     ITimer * Timer;
+	IProfileListener * Listener;
 	core::array<SProfileData> ProfileDatas;
     core::array<SProfileData> ProfileGroups;
 
@@ -285,7 +313,11 @@ void IProfiler::start(s32 id)
 	{
 		++ProfileDatas[idx].StartStopCounter;
 		if (ProfileDatas[idx].StartStopCounter == 1 )
+		{
 			ProfileDatas[idx].LastTimeStarted = Timer->getRealTime();
+			if ( Listener )
+				Listener->onProfileStart(id);
+		}
 	}
 }
 
@@ -301,6 +333,9 @@ void IProfiler::stop(s32 id)
 			--ProfileDatas[idx].StartStopCounter;
 			if ( data.LastTimeStarted != 0 && ProfileDatas[idx].StartStopCounter == 0)
 			{
+				if ( Listener )
+					Listener->onProfileStop(id);
+
 				// update data for this id
 				++data.CountCalls;
 				u32 diffTime = timeNow - data.LastTimeStarted;
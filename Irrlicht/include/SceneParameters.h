@@ -174,6 +174,18 @@ namespace scene
 	**/
 	const c8* const DEBUG_NORMAL_COLOR = "DEBUG_Normal_Color";
 
+	//! Name of the parameter for setting the directory of the binary mesh cache.
+	/** If set, static meshes loaded by ISceneManager::getMesh from files in the native file
+	system are additionally stored as .irrbmesh files in this directory. Later calls load
+	those files instead of parsing the original file again, as long as modification time and
+	size of the original file are unchanged. The directory must exist. Disabled by default.
+	Use it like this:
+	\code
+	SceneManager->getParameters()->setAttribute(scene::MESH_BINARY_CACHE_DIRECTORY, "path/to/cache");
+	\endcode
+	**/
+	const c8* const MESH_BINARY_CACHE_DIRECTORY = "MESH_BinaryCacheDirectory";
+
 
 } // end namespace scene
 } // end namespace irr
@@ -122,6 +122,8 @@ LOCAL_SRC_FILES := \
 					CIrrDeviceWin32.cpp \
 					CIrrMeshFileLoader.cpp \
 					CIrrMeshWriter.cpp \
+					CIrrBinaryMeshFileLoader.cpp \
+					CIrrBinaryMeshWriter.cpp \
 					CLightSceneNode.cpp \
 					CLimitReadFile.cpp \
 					CLMTSMeshFileLoader.cpp \
@@ -8,6 +8,8 @@
 #ifdef _IRR_COMPILE_WITH_GUI_
 
 #include "IVideoDriver.h"
+#include "EProfileIDs.h"
+#include "IProfiler.h"
 
 #include "CGUISkin.h"
 #include "CGUIButton.h"
@@ -95,6 +97,15 @@ CGUIEnvironment::CGUIEnvironment(io::IFileSystem* fs, video::IVideoDriver* drive
 	// environment is root tab group
 	Environment = this;
 	setTabGroup(true);
+
+	IRR_PROFILE(
+		static bool initProfile = false;
+		if (!initProfile )
+		{
+			initProfile = true;
+			getProfiler().add(EPID_GUI_DRAW_ALL, L"drawAll", L"Irrlicht gui");
+		}
+	)
 }
 
 
@@ -193,6 +204,8 @@ void CGUIEnvironment::loadBuiltInFont()
 //! draws all gui elements
 void CGUIEnvironment::drawAll()
 {
+	IRR_PROFILE(CProfileScope psAll(EPID_GUI_DRAW_ALL);)
+
 	if (Driver)
 	{
 		core::dimension2d<s32> dim(Driver->getScreenSize());
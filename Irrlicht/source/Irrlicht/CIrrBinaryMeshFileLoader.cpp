@@ -0,0 +1,335 @@
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#include "IrrCompileConfig.h"
+#ifdef _IRR_COMPILE_WITH_IRR_BINARY_MESH_LOADER_
+
+#include "CIrrBinaryMeshFileLoader.h"
+#include "os.h"
+#include "SAnimatedMesh.h"
+#include "SMesh.h"
+#include "SMeshBuffer.h"
+#include "SMeshBufferLightMap.h"
+#include "SMeshBufferTangents.h"
+#include "CDynamicMeshBuffer.h"
+
+#if defined(_IRR_WINDOWS_API_)
+#include <windows.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#endif
+
+namespace irr
+{
+namespace scene
+{
+
+
+//! Constructor
+CIrrBinaryMeshFileLoader::CIrrBinaryMeshFileLoader(scene::ISceneManager* smgr)
+	: SceneManager(smgr)
+{
+	#ifdef _DEBUG
+	setDebugName("CIrrBinaryMeshFileLoader");
+	#endif
+}
+
+
+//! Returns true if the file maybe is able to be loaded by this class.
+/** This decision should be based only on the file extension (e.g. ".cob") */
+bool CIrrBinaryMeshFileLoader::isALoadableFileExtension(const io::path& filename) const
+{
+	return core::hasFileExtension ( filename, "irrbmesh" );
+}
+
+
+static core::aabbox3df floatsToBox(const f32* in)
+{
+	return core::aabbox3df(in[0], in[1], in[2], in[3], in[4], in[5]);
+}
+
+
+//! creates/loads an animated mesh from the file.
+//! \return Pointer to the created mesh. Returns 0 if loading failed.
+//! If you no longer need the mesh, you should call IAnimatedMesh::drop().
+//! See IReferenceCounted::drop() for more information.
+IAnimatedMesh* CIrrBinaryMeshFileLoader::createMesh(io::IReadFile* file)
+{
+	SIrrBinaryMeshHeader header;
+	if (!readHeader(file, header))
+		return 0;
+
+	if (!skip(file, header.SourcePathLength + getIrrBinaryMeshPadding(header.SourcePathLength)))
+		return 0;
+
+	SMesh* mesh = new SMesh();
+	for (u32 i=0; i<header.MeshBufferCount; ++i)
+	{
+		IMeshBuffer* buffer = readMeshBuffer(file);
+		if (!buffer)
+		{
+			os::Printer::log("Could not read mesh buffer", file->getFileName(), ELL_ERROR);
+			mesh->drop();
+			return 0;
+		}
+		mesh->addMeshBuffer(buffer);
+		buffer->drop();
+	}
+	mesh->setBoundingBox(floatsToBox(header.BoundingBox));
+
+	SAnimatedMesh* animatedmesh = new SAnimatedMesh();
+	animatedmesh->addMesh(mesh);
+	mesh->drop();
+	animatedmesh->recalculateBoundingBox();
+
+	return animatedmesh;
+}
+
+
+bool CIrrBinaryMeshFileLoader::readSourceInfo(io::IReadFile* file, io::path& absolutePath, u64& modificationTime, u64& size)
+{
+	SIrrBinaryMeshHeader header;
+	core::stringc path;
+	if (!readHeader(file, header) || !readString(file, header.SourcePathLength, path))
+		return false;
+	absolutePath = path;
+	modificationTime = header.SourceModificationTime;
+	size = header.SourceSize;
+	return true;
+}
+
+
+bool CIrrBinaryMeshFileLoader::getFileInfo(const io::path& filename, u64& modificationTime, u64& size)
+{
+	const core::stringc name(filename);
+#if defined(_IRR_WINDOWS_API_)
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if (!GetFileAttributesExA(name.c_str(), GetFileExInfoStandard, &data))
+		return false;
+	modificationTime = ((u64)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+	size = ((u64)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+#else
+	struct stat st;
+	if (stat(name.c_str(), &st) != 0)
+		return false;
+#if defined(__APPLE__)
+	modificationTime = (u64)st.st_mtimespec.tv_sec*1000000000ull + (u64)st.st_mtimespec.tv_nsec;
+#else
+	modificationTime = (u64)st.st_mtim.tv_sec*1000000000ull + (u64)st.st_mtim.tv_nsec;
+#endif
+	size = (u64)st.st_size;
+#endif
+	return true;
+}
+
+
+bool CIrrBinaryMeshFileLoader::readHeader(io::IReadFile* file, SIrrBinaryMeshHeader& header)
+{
+	if (!file || !readData(file, &header, sizeof(header)))
+		return false;
+
+	if (header.Magic != IRR_BINARY_MESH_MAGIC)
+		return false;
+
+	if (header.Version != IRR_BINARY_MESH_VERSION || header.EndianCheck != IRR_BINARY_MESH_ENDIAN_CHECK ||
+		header.VertexSizes != IRR_BINARY_MESH_VERTEX_SIZES)
+	{
+		os::Printer::log("Incompatible version or vertex layout of binary mesh", file->getFileName(), ELL_WARNING);
+		return false;
+	}
+
+	return true;
+}
+
+
+//! Creates a mesh buffer of the type the loaders usually create for the given vertex type
+template <class T>
+static IMeshBuffer* readCMeshBuffer(io::IReadFile* file, const SIrrBinaryMeshBufferHeader& header, CMeshBuffer<T>* buffer)
+{
+	buffer->Vertices.set_used(header.VertexCount);
+	buffer->Indices.set_used(header.IndexCount);
+	const u32 vertexBytes = header.VertexCount * sizeof(T);
+	const u32 indexBytes = header.IndexCount * sizeof(u16);
+	if ((u32)file->read(buffer->Vertices.pointer(), vertexBytes) != vertexBytes ||
+		(u32)file->read(buffer->Indices.pointer(), indexBytes) != indexBytes)
+	{
+		buffer->drop();
+		return 0;
+	}
+	return buffer;
+}
+
+
+IMeshBuffer* CIrrBinaryMeshFileLoader::readMeshBuffer(io::IReadFile* file)
+{
+	SIrrBinaryMeshBufferHeader header;
+	if (!readData(file, &header, sizeof(header)))
+		return 0;
+
+	if (header.VertexType > video::EVT_TANGENTS || header.IndexType > video::EIT_32BIT)
+		return 0;
+
+	// sanity check to avoid huge allocations for broken files
+	const u64 remaining = (u64)(file->getSize() - file->getPos());
+	const u64 vertexBytes = (u64)header.VertexCount * video::getVertexPitchFromType((video::E_VERTEX_TYPE)header.VertexType);
+	const u64 indexBytes = (u64)header.IndexCount * (header.IndexType==video::EIT_16BIT ? sizeof(u16) : sizeof(u32));
+	if (vertexBytes + indexBytes > remaining)
+		return 0;
+
+	video::SMaterial material;
+	if (!readMaterial(file, material))
+		return 0;
+
+	const video::E_VERTEX_TYPE vertexType = (video::E_VERTEX_TYPE)header.VertexType;
+	const video::E_INDEX_TYPE indexType = (video::E_INDEX_TYPE)header.IndexType;
+
+	IMeshBuffer* buffer = 0;
+	if (indexType == video::EIT_16BIT)
+	{
+		switch (vertexType)
+		{
+		case video::EVT_STANDARD:
+			buffer = readCMeshBuffer(file, header, new SMeshBuffer());
+			break;
+		case video::EVT_2TCOORDS:
+			buffer = readCMeshBuffer(file, header, new SMeshBufferLightMap());
+			break;
+		case video::EVT_TANGENTS:
+			buffer = readCMeshBuffer(file, header, new SMeshBufferTangents());
+			break;
+		}
+	}
+	else
+	{
+		CDynamicMeshBuffer* dynamicBuffer = new CDynamicMeshBuffer(vertexType, indexType);
+		dynamicBuffer->getVertexBuffer().set_used(header.VertexCount);
+		dynamicBuffer->getIndexBuffer().set_used(header.IndexCount);
+		if (readData(file, dynamicBuffer->getVertexBuffer().getData(), header.VertexCount*video::getVertexPitchFromType(vertexType)) &&
+			readData(file, dynamicBuffer->getIndexBuffer().getData(), header.IndexCount*sizeof(u32)))
+			buffer = dynamicBuffer;
+		else
+			dynamicBuffer->drop();
+	}
+
+	if (!buffer || !skip(file, getIrrBinaryMeshPadding((u32)indexBytes)))
+	{
+		if (buffer)
+			buffer->drop();
+		return 0;
+	}
+
+	buffer->getMaterial() = material;
+	buffer->setBoundingBox(floatsToBox(header.BoundingBox));
+	buffer->setPrimitiveType((E_PRIMITIVE_TYPE)header.PrimitiveType);
+	buffer->setHardwareMappingHint((E_HARDWARE_MAPPING)header.HardwareMappingHintVertex, EBT_VERTEX);
+	buffer->setHardwareMappingHint((E_HARDWARE_MAPPING)header.HardwareMappingHintIndex, EBT_INDEX);
+
+	return buffer;
+}
+
+
+bool CIrrBinaryMeshFileLoader::readMaterial(io::IReadFile* file, video::SMaterial& material)
+{
+	SIrrBinaryMeshMaterial m;
+	if (!readData(file, &m, sizeof(m)))
+		return false;
+
+	material.MaterialType = (video::E_MATERIAL_TYPE)m.MaterialType;
+	material.AmbientColor.color = m.AmbientColor;
+	material.DiffuseColor.color = m.DiffuseColor;
+	material.EmissiveColor.color = m.EmissiveColor;
+	material.SpecularColor.color = m.SpecularColor;
+	material.Shininess = m.Shininess;
+	material.MaterialTypeParam = m.MaterialTypeParam;
+	material.MaterialTypeParam2 = m.MaterialTypeParam2;
+	material.Thickness = m.Thickness;
+	material.ZBuffer = (u8)m.ZBuffer;
+	material.AntiAliasing = (u8)m.AntiAliasing;
+	material.ColorMask = (u8)m.ColorMask;
+	material.ColorMaterial = (u8)m.ColorMaterial;
+	material.BlendOperation = (video::E_BLEND_OPERATION)m.BlendOperation;
+	material.BlendFactor = m.BlendFactor;
+	material.PolygonOffsetFactor = (u8)m.PolygonOffsetFactor;
+	material.PolygonOffsetDirection = (video::E_POLYGON_OFFSET)m.PolygonOffsetDirection;
+	material.PolygonOffsetDepthBias = m.PolygonOffsetDepthBias;
+	material.PolygonOffsetSlopeScale = m.PolygonOffsetSlopeScale;
+	material.ZWriteEnable = (video::E_ZWRITE)m.ZWriteEnable;
+	material.Wireframe = (m.Flags & EIBMMF_WIREFRAME) != 0;
+	material.PointCloud = (m.Flags & EIBMMF_POINT_CLOUD) != 0;
+	material.GouraudShading = (m.Flags & EIBMMF_GOURAUD_SHADING) != 0;
+	material.Lighting = (m.Flags & EIBMMF_LIGHTING) != 0;
+	material.BackfaceCulling = (m.Flags & EIBMMF_BACKFACE_CULLING) != 0;
+	material.FrontfaceCulling = (m.Flags & EIBMMF_FRONTFACE_CULLING) != 0;
+	material.FogEnable = (m.Flags & EIBMMF_FOG_ENABLE) != 0;
+	material.NormalizeNormals = (m.Flags & EIBMMF_NORMALIZE_NORMALS) != 0;
+	material.UseMipMaps = (m.Flags & EIBMMF_USE_MIPMAPS) != 0;
+
+	video::IVideoDriver* driver = SceneManager->getVideoDriver();
+	for (u32 i=0; i<m.TextureLayerCount; ++i)
+	{
+		SIrrBinaryMeshTextureLayer l;
+		core::stringc textureName;
+		if (!readData(file, &l, sizeof(l)) || !readString(file, l.TextureNameLength, textureName))
+			return false;
+
+		// layers not supported by this build are skipped
+		if (i >= video::MATERIAL_MAX_TEXTURES)
+			continue;
+
+		video::SMaterialLayer& layer = material.TextureLayer[i];
+		layer.TextureWrapU = (u8)l.TextureWrapU;
+		layer.TextureWrapV = (u8)l.TextureWrapV;
+		layer.TextureWrapW = (u8)l.TextureWrapW;
+		layer.BilinearFilter = (l.Flags & EIBMLF_BILINEAR_FILTER) != 0;
+		layer.TrilinearFilter = (l.Flags & EIBMLF_TRILINEAR_FILTER) != 0;
+		layer.AnisotropicFilter = (u8)l.AnisotropicFilter;
+		layer.LODBias = (s8)l.LODBias;
+		if (l.Flags & EIBMLF_TEXTURE_MATRIX)
+		{
+			core::matrix4 matrix;
+			matrix.setM(l.TextureMatrix);
+			layer.setTextureMatrix(matrix);
+		}
+		if (!textureName.empty() && driver)
+			layer.Texture = driver->getTexture(textureName);
+	}
+
+	return true;
+}
+
+
+bool CIrrBinaryMeshFileLoader::readString(io::IReadFile* file, u32 length, core::stringc& str)
+{
+	if (length > (u32)(file->getSize() - file->getPos()))
+		return false;
+	core::array<c8> chars;
+	chars.set_used(length + 1);
+	if (!readData(file, chars.pointer(), length))
+		return false;
+	chars[length] = 0;
+	str = chars.const_pointer();
+	return skip(file, getIrrBinaryMeshPadding(length));
+}
+
+
+bool CIrrBinaryMeshFileLoader::readData(io::IReadFile* file, void* data, u32 size)
+{
+	if (size == 0)
+		return true;
+	return (u32)file->read(data, size) == size;
+}
+
+
+bool CIrrBinaryMeshFileLoader::skip(io::IReadFile* file, u32 size)
+{
+	if (size == 0)
+		return true;
+	return file->seek(size, true);
+}
+
+
+} // end namespace scene
+} // end namespace irr
+
+#endif // _IRR_COMPILE_WITH_IRR_BINARY_MESH_LOADER_
@@ -0,0 +1,71 @@
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#ifndef __C_IRR_BINARY_MESH_FILE_LOADER_H_INCLUDED__
+#define __C_IRR_BINARY_MESH_FILE_LOADER_H_INCLUDED__
+
+#include "IMeshLoader.h"
+#include "IVideoDriver.h"
+#include "IReadFile.h"
+#include "ISceneManager.h"
+#include "SIrrBinaryMeshStructs.h"
+
+namespace irr
+{
+namespace scene
+{
+
+
+//! Meshloader capable of loading .irrbmesh meshes, a binary format for static meshes
+/** The format is described in SIrrBinaryMeshStructs.h. Vertices and indices are read
+directly into the arrays of the created mesh buffers without any conversion. */
+class CIrrBinaryMeshFileLoader : public IMeshLoader
+{
+public:
+
+	//! Constructor
+	CIrrBinaryMeshFileLoader(scene::ISceneManager* smgr);
+
+	//! returns true if the file maybe is able to be loaded by this class
+	//! based on the file extension (e.g. ".irrbmesh")
+	virtual bool isALoadableFileExtension(const io::path& filename) const _IRR_OVERRIDE_;
+
+	//! creates/loads an animated mesh from the file.
+	//! \return Pointer to the created mesh. Returns 0 if loading failed.
+	//! If you no longer need the mesh, you should call IAnimatedMesh::drop().
+	//! See IReferenceCounted::drop() for more information.
+	virtual IAnimatedMesh* createMesh(io::IReadFile* file) _IRR_OVERRIDE_;
+
+	//! Reads the information about the file the mesh has been created from.
+	/** The file is read from its current position.
+	\return false if the file is not a compatible .irrbmesh file */
+	static bool readSourceInfo(io::IReadFile* file, io::path& absolutePath, u64& modificationTime, u64& size);
+
+	//! Gets modification time (ns since epoch, 100 ns since 1601 on Windows) and size of a file in the native file system.
+	/** Seconds would not detect changes within the same second.
+	\return false if the file does not exist in the native file system (e.g. if it is in an archive) */
+	static bool getFileInfo(const io::path& filename, u64& modificationTime, u64& size);
+
+private:
+
+	//! reads the header and checks if the file is compatible
+	static bool readHeader(io::IReadFile* file, SIrrBinaryMeshHeader& header);
+
+	IMeshBuffer* readMeshBuffer(io::IReadFile* file);
+
+	bool readMaterial(io::IReadFile* file, video::SMaterial& material);
+
+	static bool readString(io::IReadFile* file, u32 length, core::stringc& str);
+
+	static bool readData(io::IReadFile* file, void* data, u32 size);
+
+	static bool skip(io::IReadFile* file, u32 size);
+
+	scene::ISceneManager* SceneManager;
+};
+
+
+} // end namespace scene
+} // end namespace irr
+
+#endif
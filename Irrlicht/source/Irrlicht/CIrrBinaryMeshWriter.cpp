@@ -0,0 +1,251 @@
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#include "IrrCompileConfig.h"
+
+#ifdef _IRR_COMPILE_WITH_IRR_BINARY_WRITER_
+
+#include "CIrrBinaryMeshWriter.h"
+#include "SIrrBinaryMeshStructs.h"
+#include "os.h"
+#include "IMesh.h"
+#include "IMeshBuffer.h"
+#include "ITexture.h"
+
+#include <stdio.h>
+#if defined(_IRR_WINDOWS_API_)
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace irr
+{
+namespace scene
+{
+
+
+CIrrBinaryMeshWriter::CIrrBinaryMeshWriter()
+	: SourceModificationTime(0), SourceSize(0)
+{
+	#ifdef _DEBUG
+	setDebugName("CIrrBinaryMeshWriter");
+	#endif
+}
+
+
+//! Returns the type of the mesh writer
+EMESH_WRITER_TYPE CIrrBinaryMeshWriter::getType() const
+{
+	return EMWT_IRR_BINARY_MESH;
+}
+
+
+void CIrrBinaryMeshWriter::setSourceInfo(const io::path& absolutePath, u64 modificationTime, u64 size)
+{
+	SourcePath = absolutePath;
+	SourceModificationTime = modificationTime;
+	SourceSize = size;
+}
+
+
+bool CIrrBinaryMeshWriter::writeMeshReplacingFile(io::IFileSystem* fileSystem, const io::path& filename, scene::IMesh* mesh)
+{
+	// the process id makes the temporary file unique among processes writing the same file
+	c8 suffix[32];
+#if defined(_IRR_WINDOWS_API_)
+	snprintf(suffix, sizeof(suffix), ".%lu.tmp", (unsigned long)GetCurrentProcessId());
+#else
+	snprintf(suffix, sizeof(suffix), ".%lu.tmp", (unsigned long)getpid());
+#endif
+	const io::path tempFile = filename + suffix;
+	io::IWriteFile* file = fileSystem->createAndWriteFile(tempFile);
+	if (!file)
+		return false;
+	bool success = writeMesh(file, mesh);
+	file->drop();
+
+	const core::stringc temp(tempFile), target(filename);
+	if (success)
+	{
+#if defined(_IRR_WINDOWS_API_)
+		success = MoveFileExA(temp.c_str(), target.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+		success = rename(temp.c_str(), target.c_str()) == 0;
+#endif
+	}
+	if (!success)
+		remove(temp.c_str());
+	return success;
+}
+
+
+static void boxToFloats(const core::aabbox3df& box, f32* out)
+{
+	out[0] = box.MinEdge.X;
+	out[1] = box.MinEdge.Y;
+	out[2] = box.MinEdge.Z;
+	out[3] = box.MaxEdge.X;
+	out[4] = box.MaxEdge.Y;
+	out[5] = box.MaxEdge.Z;
+}
+
+
+//! writes a mesh
+bool CIrrBinaryMeshWriter::writeMesh(io::IWriteFile* file, scene::IMesh* mesh, s32 flags)
+{
+	if (!file || !mesh)
+		return false;
+
+	os::Printer::log("Writing mesh", file->getFileName());
+
+	u32 bufferCount = 0;
+	for (u32 i=0; i<mesh->getMeshBufferCount(); ++i)
+		if (mesh->getMeshBuffer(i))
+			++bufferCount;
+
+	const core::stringc sourcePath(SourcePath);
+
+	SIrrBinaryMeshHeader header;
+	header.Magic = IRR_BINARY_MESH_MAGIC;
+	header.Version = IRR_BINARY_MESH_VERSION;
+	header.EndianCheck = IRR_BINARY_MESH_ENDIAN_CHECK;
+	header.VertexSizes = IRR_BINARY_MESH_VERTEX_SIZES;
+	header.SourceModificationTime = SourceModificationTime;
+	header.SourceSize = SourceSize;
+	header.SourcePathLength = sourcePath.size();
+	header.MeshBufferCount = bufferCount;
+	boxToFloats(mesh->getBoundingBox(), header.BoundingBox);
+
+	if (!writeData(file, &header, sizeof(header)) || !writeString(file, sourcePath))
+		return false;
+
+	for (u32 i=0; i<mesh->getMeshBufferCount(); ++i)
+	{
+		const scene::IMeshBuffer* buffer = mesh->getMeshBuffer(i);
+		if (buffer && !writeMeshBuffer(file, buffer))
+			return false;
+	}
+
+	return true;
+}
+
+
+bool CIrrBinaryMeshWriter::writeMeshBuffer(io::IWriteFile* file, const scene::IMeshBuffer* buffer)
+{
+	SIrrBinaryMeshBufferHeader header;
+	header.VertexType = buffer->getVertexType();
+	header.IndexType = buffer->getIndexType();
+	header.VertexCount = buffer->getVertexCount();
+	header.IndexCount = buffer->getIndexCount();
+	header.PrimitiveType = buffer->getPrimitiveType();
+	header.HardwareMappingHintVertex = buffer->getHardwareMappingHint_Vertex();
+	header.HardwareMappingHintIndex = buffer->getHardwareMappingHint_Index();
+	header.Reserved = 0;
+	boxToFloats(buffer->getBoundingBox(), header.BoundingBox);
+
+	if (!writeData(file, &header, sizeof(header)) || !writeMaterial(file, buffer->getMaterial()))
+		return false;
+
+	const u32 vertexBytes = header.VertexCount * video::getVertexPitchFromType(buffer->getVertexType());
+	const u32 indexBytes = header.IndexCount * (buffer->getIndexType()==video::EIT_16BIT ? sizeof(u16) : sizeof(u32));
+	return writeData(file, buffer->getVertices(), vertexBytes) &&
+		writeData(file, buffer->getIndices(), indexBytes) &&
+		writePadding(file, getIrrBinaryMeshPadding(indexBytes));
+}
+
+
+bool CIrrBinaryMeshWriter::writeMaterial(io::IWriteFile* file, const video::SMaterial& material)
+{
+	SIrrBinaryMeshMaterial m;
+	m.MaterialType = material.MaterialType;
+	m.AmbientColor = material.AmbientColor.color;
+	m.DiffuseColor = material.DiffuseColor.color;
+	m.EmissiveColor = material.EmissiveColor.color;
+	m.SpecularColor = material.SpecularColor.color;
+	m.Shininess = material.Shininess;
+	m.MaterialTypeParam = material.MaterialTypeParam;
+	m.MaterialTypeParam2 = material.MaterialTypeParam2;
+	m.Thickness = material.Thickness;
+	m.ZBuffer = material.ZBuffer;
+	m.AntiAliasing = material.AntiAliasing;
+	m.ColorMask = material.ColorMask;
+	m.ColorMaterial = material.ColorMaterial;
+	m.BlendOperation = material.BlendOperation;
+	m.BlendFactor = material.BlendFactor;
+	m.PolygonOffsetFactor = material.PolygonOffsetFactor;
+	m.PolygonOffsetDirection = material.PolygonOffsetDirection;
+	m.PolygonOffsetDepthBias = material.PolygonOffsetDepthBias;
+	m.PolygonOffsetSlopeScale = material.PolygonOffsetSlopeScale;
+	m.ZWriteEnable = material.ZWriteEnable;
+	m.Flags = (material.Wireframe ? EIBMMF_WIREFRAME : 0) |
+		(material.PointCloud ? EIBMMF_POINT_CLOUD : 0) |
+		(material.GouraudShading ? EIBMMF_GOURAUD_SHADING : 0) |
+		(material.Lighting ? EIBMMF_LIGHTING : 0) |
+		(material.BackfaceCulling ? EIBMMF_BACKFACE_CULLING : 0) |
+		(material.FrontfaceCulling ? EIBMMF_FRONTFACE_CULLING : 0) |
+		(material.FogEnable ? EIBMMF_FOG_ENABLE : 0) |
+		(material.NormalizeNormals ? EIBMMF_NORMALIZE_NORMALS : 0) |
+		(material.UseMipMaps ? EIBMMF_USE_MIPMAPS : 0);
+	m.TextureLayerCount = video::MATERIAL_MAX_TEXTURES_USED;
+
+	if (!writeData(file, &m, sizeof(m)))
+		return false;
+
+	for (u32 i=0; i<m.TextureLayerCount; ++i)
+	{
+		const video::SMaterialLayer& layer = material.TextureLayer[i];
+		const core::stringc textureName = layer.Texture ? core::stringc(layer.Texture->getName().getPath()) : core::stringc();
+		const core::matrix4& matrix = layer.getTextureMatrix();
+
+		SIrrBinaryMeshTextureLayer l;
+		l.TextureWrapU = layer.TextureWrapU;
+		l.TextureWrapV = layer.TextureWrapV;
+		l.TextureWrapW = layer.TextureWrapW;
+		l.Flags = (layer.BilinearFilter ? EIBMLF_BILINEAR_FILTER : 0) |
+			(layer.TrilinearFilter ? EIBMLF_TRILINEAR_FILTER : 0) |
+			(matrix.isIdentity() ? 0 : EIBMLF_TEXTURE_MATRIX);
+		l.AnisotropicFilter = layer.AnisotropicFilter;
+		l.LODBias = layer.LODBias;
+		for (u32 j=0; j<16; ++j)
+			l.TextureMatrix[j] = matrix[j];
+		l.TextureNameLength = textureName.size();
+
+		if (!writeData(file, &l, sizeof(l)) || !writeString(file, textureName))
+			return false;
+	}
+
+	return true;
+}
+
+
+bool CIrrBinaryMeshWriter::writeString(io::IWriteFile* file, const core::stringc& str)
+{
+	return writeData(file, str.c_str(), str.size()) && writePadding(file, getIrrBinaryMeshPadding(str.size()));
+}
+
+
+bool CIrrBinaryMeshWriter::writeData(io::IWriteFile* file, const void* data, u32 size)
+{
+	if (size == 0)
+		return true;
+	if (file->write(data, size) != (size_t)size)
+	{
+		os::Printer::log("Could not write file", file->getFileName(), ELL_ERROR);
+		return false;
+	}
+	return true;
+}
+
+
+bool CIrrBinaryMeshWriter::writePadding(io::IWriteFile* file, u32 size)
+{
+	const c8 zeros[4] = {0, 0, 0, 0};
+	return writeData(file, zeros, size);
+}
+
+
+} // end namespace
+} // end namespace
+
+#endif
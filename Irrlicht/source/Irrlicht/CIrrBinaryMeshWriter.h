@@ -0,0 +1,63 @@
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+#ifndef __IRR_IRR_BINARY_MESH_WRITER_H_INCLUDED__
+#define __IRR_IRR_BINARY_MESH_WRITER_H_INCLUDED__
+
+#include "IMeshWriter.h"
+#include "IWriteFile.h"
+#include "SMaterial.h"
+#include "path.h"
+#include "IFileSystem.h"
+
+namespace irr
+{
+
+namespace scene
+{
+	class IMeshBuffer;
+
+
+	//! class to write meshes, implementing a binary IrrMesh (.irrbmesh) writer
+	/** The format is described in SIrrBinaryMeshStructs.h. */
+	class CIrrBinaryMeshWriter : public IMeshWriter
+	{
+	public:
+
+		CIrrBinaryMeshWriter();
+
+		//! Returns the type of the mesh writer
+		virtual EMESH_WRITER_TYPE getType() const _IRR_OVERRIDE_;
+
+		//! writes a mesh
+		virtual bool writeMesh(io::IWriteFile* file, scene::IMesh* mesh, s32 flags=EMWF_NONE) _IRR_OVERRIDE_;
+
+		//! Sets the information about the file the next written meshes have been loaded from.
+		/** It is stored in the header and used to determine if a cached file is outdated. */
+		void setSourceInfo(const io::path& absolutePath, u64 modificationTime, u64 size);
+
+		//! Writes a mesh to a temporary file and replaces filename with it only if it has been written completely.
+		/** Neither a crash nor a concurrent process can leave or read a truncated file. */
+		bool writeMeshReplacingFile(io::IFileSystem* fileSystem, const io::path& filename, scene::IMesh* mesh);
+
+	protected:
+
+		bool writeMeshBuffer(io::IWriteFile* file, const scene::IMeshBuffer* buffer);
+
+		bool writeMaterial(io::IWriteFile* file, const video::SMaterial& material);
+
+		bool writeString(io::IWriteFile* file, const core::stringc& str);
+
+		bool writeData(io::IWriteFile* file, const void* data, u32 size);
+
+		bool writePadding(io::IWriteFile* file, u32 size);
+
+		io::path SourcePath;
+		u64 SourceModificationTime;
+		u64 SourceSize;
+	};
+
+} // end namespace
+} // end namespace
+
+#endif
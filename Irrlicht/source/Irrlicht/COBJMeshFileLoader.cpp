@@ -89,8 +89,9 @@ IAnimatedMesh* COBJMeshFileLoader::createMesh(io::IReadFile* file)
 	const io::path fullName = file->getFileName();
 	const io::path relPath = FileSystem->getFileDir(fullName)+"/";
 
-	c8* buf = new c8[filesize];
-	memset(buf, 0, filesize);
+	// zero terminated, so numbers at the very end of the file can be parsed in place
+	c8* buf = new c8[filesize+1];
+	memset(buf, 0, filesize+1);
 	file->read((void*)buf, filesize);
 	const c8* const bufEnd = buf+filesize;
 
@@ -200,8 +201,8 @@ IAnimatedMesh* COBJMeshFileLoader::createMesh(io::IReadFile* file)
 
 		case 'f':               // face
 		{
-			c8 vertexWord[WORD_BUFFER_LENGTH]; // for retrieving vertex data
 			video::S3DVertex v;
+			v.Color.set(255, 255, 255, 255);
 			// Assign vertex color from currently active material's diffuse color
 			if (mtlChanged)
 			{
@@ -216,15 +217,17 @@ IAnimatedMesh* COBJMeshFileLoader::createMesh(io::IReadFile* file)
 				v.Color = currMtl->Meshbuffer->Material.DiffuseColor;
 
 			// get all vertices data in this face (current line of obj file)
-			const core::stringc wordBuffer = copyLine(bufPtr, bufEnd);
-			const c8* linePtr = wordBuffer.c_str();
-			const c8* const endPtr = linePtr+wordBuffer.size();
+			// The line is parsed in place, no copies of the line or its words are made.
+			const c8* lineEnd = bufPtr;
+			while (lineEnd != bufEnd && *lineEnd != '\n' && *lineEnd != '\r' && *lineEnd != 0)
+				++lineEnd;
+			const c8* linePtr = bufPtr;
 
 			faceCorners.set_used(0); // fast clear
 
 			// read in all vertices
-			linePtr = goNextWord(linePtr, endPtr);
-			while (0 != linePtr[0])
+			linePtr = goNextWord(linePtr, lineEnd);
+			while (linePtr != lineEnd && 0 != linePtr[0])
 			{
 				// Array to communicate with retrieveVertexIndices()
 				// sends the buffer sizes and gets the actual indices
@@ -232,15 +235,17 @@ IAnimatedMesh* COBJMeshFileLoader::createMesh(io::IReadFile* file)
 				s32 Idx[3];
 				Idx[0] = Idx[1] = Idx[2] = -1;
 
-				// read in next vertex's data
-				u32 wlength = copyWord(vertexWord, linePtr, WORD_BUFFER_LENGTH, endPtr);
+				// find the end of the current vertex's data
+				const c8* wordEnd = linePtr;
+				while (wordEnd != lineEnd && !core::isspace(*wordEnd))
+					++wordEnd;
 				// this function will also convert obj's 1-based index to c++'s 0-based index
-				retrieveVertexIndices(vertexWord, Idx, vertexWord+wlength+1, vertexBuffer.size(), textureCoordBuffer.size(), normalsBuffer.size());
+				retrieveVertexIndices(linePtr, Idx, wordEnd, vertexBuffer.size(), textureCoordBuffer.size(), normalsBuffer.size());
 				if ( -1 != Idx[0] && Idx[0] < (irr::s32)vertexBuffer.size() )
 					v.Pos = vertexBuffer[Idx[0]];
 				else
 				{
-					os::Printer::log("Invalid vertex index in this line:", wordBuffer.c_str(), ELL_ERROR);
+					os::Printer::log("Invalid vertex index in this line:", copyLine(bufPtr, bufEnd).c_str(), ELL_ERROR);
 					delete [] buf;
 					return 0;
 				}
@@ -256,23 +261,20 @@ IAnimatedMesh* COBJMeshFileLoader::createMesh(io::IReadFile* file)
 					currMtl->RecalculateNormals=true;
 				}
 
-				int vertLocation;
-				core::map<video::S3DVertex, int>::Node* n = currMtl->VertMap.find(v);
-				if (n)
-				{
-					vertLocation = n->getValue();
-				}
-				else
+				// Vertices which are equal within the rounding tolerance of S3DVertex::operator== are merged
+				const core::array<video::S3DVertex>& vertices = currMtl->Meshbuffer->Vertices;
+				int vertLocation = currMtl->VertHash.find(v, vertices);
+				if (vertLocation < 0)
 				{
 					currMtl->Meshbuffer->Vertices.push_back(v);
 					vertLocation = currMtl->Meshbuffer->Vertices.size() -1;
-					currMtl->VertMap.insert(v, vertLocation);
+					currMtl->VertHash.insert(v, vertLocation, vertices);
 				}
 
 				faceCorners.push_back(vertLocation);
 
 				// go to next vertex
-				linePtr = goNextWord(linePtr, endPtr);
+				linePtr = goNextWord(linePtr, lineEnd);
 			}
 
 			// triangulate the face
@@ -282,7 +284,7 @@ IAnimatedMesh* COBJMeshFileLoader::createMesh(io::IReadFile* file)
 				// Add a triangle
 				const int a = faceCorners[i + 1];
 				const int b = faceCorners[i];
-				if (a != b && a != c && b != c)	// ignore degenerated faces. We can get them when we merge vertices above in the VertMap.
+				if (a != b && a != c && b != c)	// ignore degenerated faces. We can get them when the file references the same vertex twice in a face.
 				{
 					currMtl->Meshbuffer->Indices.push_back(a);
 					currMtl->Meshbuffer->Indices.push_back(b);
@@ -721,15 +723,13 @@ const c8* COBJMeshFileLoader::readColor(const c8* bufPtr, video::SColor& color,
 //! Read 3d vector of floats
 const c8* COBJMeshFileLoader::readVec3(const c8* bufPtr, core::vector3df& vec, const c8* const bufEnd)
 {
-	const u32 WORD_BUFFER_LENGTH = 256;
-	c8 wordBuffer[WORD_BUFFER_LENGTH];
-
-	bufPtr = goAndCopyNextWord(wordBuffer, bufPtr, WORD_BUFFER_LENGTH, bufEnd);
-	vec.X=-core::fast_atof(wordBuffer); // change handedness
-	bufPtr = goAndCopyNextWord(wordBuffer, bufPtr, WORD_BUFFER_LENGTH, bufEnd);
-	vec.Y=core::fast_atof(wordBuffer);
-	bufPtr = goAndCopyNextWord(wordBuffer, bufPtr, WORD_BUFFER_LENGTH, bufEnd);
-	vec.Z=core::fast_atof(wordBuffer);
+	// the buffer is zero terminated, so the numbers can be parsed in place
+	bufPtr = goNextWord(bufPtr, bufEnd, false);
+	vec.X=-core::fast_atof(bufPtr); // change handedness
+	bufPtr = goNextWord(bufPtr, bufEnd, false);
+	vec.Y=core::fast_atof(bufPtr);
+	bufPtr = goNextWord(bufPtr, bufEnd, false);
+	vec.Z=core::fast_atof(bufPtr);
 	return bufPtr;
 }
 
@@ -737,13 +737,11 @@ const c8* COBJMeshFileLoader::readVec3(const c8* bufPtr, core::vector3df& vec, c
 //! Read 2d vector of floats
 const c8* COBJMeshFileLoader::readUV(const c8* bufPtr, core::vector2df& vec, const c8* const bufEnd)
 {
-	const u32 WORD_BUFFER_LENGTH = 256;
-	c8 wordBuffer[WORD_BUFFER_LENGTH];
-
-	bufPtr = goAndCopyNextWord(wordBuffer, bufPtr, WORD_BUFFER_LENGTH, bufEnd);
-	vec.X=core::fast_atof(wordBuffer);
-	bufPtr = goAndCopyNextWord(wordBuffer, bufPtr, WORD_BUFFER_LENGTH, bufEnd);
-	vec.Y=1-core::fast_atof(wordBuffer); // change handedness
+	// the buffer is zero terminated, so the numbers can be parsed in place
+	bufPtr = goNextWord(bufPtr, bufEnd, false);
+	vec.X=core::fast_atof(bufPtr);
+	bufPtr = goNextWord(bufPtr, bufEnd, false);
+	vec.Y=1-core::fast_atof(bufPtr); // change handedness
 	return bufPtr;
 }
 
@@ -886,21 +884,24 @@ const c8* COBJMeshFileLoader::goAndCopyNextWord(c8* outBuf, const c8* inBuf, u32
 }
 
 
-bool COBJMeshFileLoader::retrieveVertexIndices(c8* vertexData, s32* idx, const c8* bufEnd, u32 vbsize, u32 vtsize, u32 vnsize)
+bool COBJMeshFileLoader::retrieveVertexIndices(const c8* vertexData, s32* idx, const c8* bufEnd, u32 vbsize, u32 vtsize, u32 vnsize)
 {
 	c8 word[16] = "";
 	const c8* p = goFirstWord(vertexData, bufEnd);
 	u32 idxType = 0;	// 0 = posIdx, 1 = texcoordIdx, 2 = normalIdx
 
 	u32 i = 0;
-	while ( p != bufEnd )
+	for (;;)
 	{
-		if ( ( core::isdigit(*p)) || (*p == '-') )
+		// the end of the vertex data is treated like a terminating zero
+		const c8 c = ( p != bufEnd ) ? *p : '\0';
+		if ( ( core::isdigit(c)) || (c == '-') )
 		{
 			// build up the number
-			word[i++] = *p;
+			if ( i < sizeof(word)-1 )
+				word[i++] = c;
 		}
-		else if ( *p == '/' || *p == ' ' || *p == '\0' )
+		else if ( c == '/' || core::isspace(c) || c == '\0' )
 		{
 			// number is completed. Convert and store it
 			word[i] = '\0';
@@ -929,7 +930,7 @@ bool COBJMeshFileLoader::retrieveVertexIndices(c8* vertexData, s32* idx, const c
 			i = 0;
 
 			// go to the next kind of index type
-			if (*p == '/')
+			if (c == '/')
 			{
 				if ( ++idxType > 2 )
 				{
@@ -942,8 +943,7 @@ bool COBJMeshFileLoader::retrieveVertexIndices(c8* vertexData, s32* idx, const c
 				// set all missing values to disable (=-1)
 				while (++idxType < 3)
 					idx[idxType]=-1;
-				++p;
-				break; // while
+				break; // for
 			}
 		}
 
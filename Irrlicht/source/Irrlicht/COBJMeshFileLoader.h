@@ -40,6 +40,118 @@ public:
 
 private:
 
+	//! Open addressing hash over the vertices of a meshbuffer
+	/** Vertices are compared with S3DVertex::operator== (with rounding tolerance) like the former
+	core::map<S3DVertex, int>. Only the position quantized to cells of 1/CellsPerUnit is hashed,
+	if a coordinate is within the tolerance of a cell border the neighbouring cell is searched, too.
+	If several vertices are equal the one which has been added first is used. */
+	struct SVertexHash
+	{
+		SVertexHash() : Used(0) {}
+
+		//! returns the index of the vertex in vertices or -1 if not found
+		s32 find(const video::S3DVertex& v, const core::array<video::S3DVertex>& vertices) const
+		{
+			if (Slots.empty())
+				return -1;
+			s32 x[2], y[2], z[2];
+			const u32 xCount = getCells(v.Pos.X, x);
+			const u32 yCount = getCells(v.Pos.Y, y);
+			const u32 zCount = getCells(v.Pos.Z, z);
+			const u32 mask = Slots.size()-1;
+			s32 found = -1;
+			for (u32 i = 0; i < xCount; ++i)
+				for (u32 j = 0; j < yCount; ++j)
+					for (u32 k = 0; k < zCount; ++k)
+						for (u32 l = hash(x[i], y[j], z[k]) & mask; Slots[l] >= 0; l = (l+1) & mask)
+						{
+							const s32 idx = Slots[l];
+							if ((found < 0 || idx < found) && vertices[idx] == v)
+								found = idx;
+						}
+			return found;
+		}
+
+		//! index must be the position of v in vertices
+		void insert(const video::S3DVertex& v, s32 index, const core::array<video::S3DVertex>& vertices)
+		{
+			if ((Used+1)*2 > Slots.size())
+				rehash(Slots.empty() ? 1024 : Slots.size()*2, vertices);
+			insertNoGrow(hash(v), index);
+			++Used;
+		}
+
+	private:
+
+		static const s32 CellsPerUnit = 4096;
+
+		static s32 getCell(f32 f)
+		{
+			const f64 cell = floor((f64)f*CellsPerUnit);
+			if (!(cell > -2147483647.0)) // also NaN
+				return -2147483647;
+			return cell < 2147483647.0 ? (s32)cell : 2147483647;
+		}
+
+		//! cell of f and the neighbouring cell if f is close to the border, returns the amount of cells
+		static u32 getCells(f32 f, s32* cells)
+		{
+			// f+tolerance is rounded, therefore values up to 2*tolerance apart may be equal
+			const f64 margin = 2.0*core::ROUNDING_ERROR_f32;
+			cells[0] = getCell(f);
+			const f64 lower = (f64)cells[0]/CellsPerUnit;
+			if ((f64)f-lower <= margin && cells[0] > -2147483647)
+			{
+				cells[1] = cells[0]-1;
+				return 2;
+			}
+			if (lower+1.0/CellsPerUnit-(f64)f <= margin && cells[0] < 2147483647)
+			{
+				cells[1] = cells[0]+1;
+				return 2;
+			}
+			return 1;
+		}
+
+		static u32 hash(s32 x, s32 y, s32 z)
+		{
+			u32 h = 2166136261u;
+			h = (h ^ (u32)x) * 16777619u;
+			h = (h ^ (u32)y) * 16777619u;
+			h = (h ^ (u32)z) * 16777619u;
+			return h ^ (h >> 15);
+		}
+
+		static u32 hash(const video::S3DVertex& v)
+		{
+			return hash(getCell(v.Pos.X), getCell(v.Pos.Y), getCell(v.Pos.Z));
+		}
+
+		void insertNoGrow(u32 h, s32 index)
+		{
+			const u32 mask = Slots.size()-1;
+			u32 i = h & mask;
+			while (Slots[i] >= 0)
+				i = (i+1) & mask;
+			Slots[i] = index;
+		}
+
+		void rehash(u32 newSize, const core::array<video::S3DVertex>& vertices)
+		{
+			core::array<s32> old;
+			old.swap(Slots);
+			Slots.set_used(newSize);
+			for (u32 i = 0; i < newSize; ++i)
+				Slots[i] = -1;
+			for (u32 i = 0; i < old.size(); ++i)
+				if (old[i] >= 0)
+					insertNoGrow(hash(vertices[old[i]]), old[i]);
+		}
+
+		core::array<s32> Slots;
+		u32 Used;
+	};
+
 	struct SObjMtl
 	{
 		SObjMtl() : Meshbuffer(0), Bumpiness (1.0f), Illumination(0),
@@ -61,7 +173,7 @@ private:
 			Meshbuffer->Material = o.Meshbuffer->Material;
 		}
 
-		core::map<video::S3DVertex, int> VertMap;
+		SVertexHash VertHash;
 		scene::SMeshBuffer *Meshbuffer;
 		core::stringc Name;
 		core::stringc Group;
@@ -105,7 +217,7 @@ private:
 	// reads and convert to integer the vertex indices in a line of obj file's face statement
 	// -1 for the index if it doesn't exist
 	// indices are changed to 0-based index instead of 1-based from the obj file
-	bool retrieveVertexIndices(c8* vertexData, s32* idx, const c8* bufEnd, u32 vbsize, u32 vtsize, u32 vnsize);
+	bool retrieveVertexIndices(const c8* vertexData, s32* idx, const c8* bufEnd, u32 vbsize, u32 vtsize, u32 vnsize);
 
 	void cleanUp();
 
@@ -30,6 +30,10 @@
 #include "CIrrMeshFileLoader.h"
 #endif
 
+#ifdef _IRR_COMPILE_WITH_IRR_BINARY_MESH_LOADER_
+#include "CIrrBinaryMeshFileLoader.h"
+#endif
+
 #ifdef _IRR_COMPILE_WITH_BSP_LOADER_
 #include "CBSPMeshFileLoader.h"
 #endif
@@ -122,6 +126,10 @@
 #include "CIrrMeshWriter.h"
 #endif
 
+#ifdef _IRR_COMPILE_WITH_IRR_BINARY_WRITER_
+#include "CIrrBinaryMeshWriter.h"
+#endif
+
 #ifdef _IRR_COMPILE_WITH_STL_WRITER_
 #include "CSTLMeshWriter.h"
 #endif
@@ -307,6 +315,9 @@ CSceneManager::CSceneManager(video::IVideoDriver* driver, io::IFileSystem* fs,
 	#ifdef _IRR_COMPILE_WITH_IRR_MESH_LOADER_
 	MeshLoaderList.push_back(new CIrrMeshFileLoader(this, FileSystem));
 	#endif
+	#ifdef _IRR_COMPILE_WITH_IRR_BINARY_MESH_LOADER_
+	MeshLoaderList.push_back(new CIrrBinaryMeshFileLoader(this));
+	#endif
 	#ifdef _IRR_COMPILE_WITH_BSP_LOADER_
 	MeshLoaderList.push_back(new CBSPMeshFileLoader(this, FileSystem));
 	#endif
@@ -434,6 +445,17 @@ IAnimatedMesh* CSceneManager::getMesh(const io::path& filename, const io::path&
 	if (msh)
 		return msh;
 
+	// the file info is determined before loading, a file changed during loading is not cached with the new time
+	io::path sourcePath, cacheFile;
+	u64 modificationTime, size;
+	const bool binaryCache = getBinaryMeshCacheFile(filename, sourcePath, cacheFile, modificationTime, size);
+	if (binaryCache)
+	{
+		msh = getMeshFromBinaryCache(cacheFile, sourcePath, modificationTime, size, cacheName);
+		if (msh)
+			return msh;
+	}
+
 	io::IReadFile* file = FileSystem->createAndOpenFile(filename);
 	if (!file)
 	{
@@ -445,6 +467,9 @@ IAnimatedMesh* CSceneManager::getMesh(const io::path& filename, const io::path&
 
 	file->drop();
 
+	if (msh && binaryCache)
+		writeMeshToBinaryCache(cacheFile, sourcePath, modificationTime, size, msh);
+
 	return msh;
 }
 
@@ -496,6 +521,92 @@ IAnimatedMesh* CSceneManager::getUncachedMesh(io::IReadFile* file, const io::pat
 	return msh;
 }
 
+bool CSceneManager::getBinaryMeshCacheFile(const io::path& filename, io::path& sourcePath, io::path& cacheFile, u64& modificationTime, u64& size) const
+{
+#if defined(_IRR_COMPILE_WITH_IRR_BINARY_MESH_LOADER_) && defined(_IRR_COMPILE_WITH_IRR_BINARY_WRITER_)
+	const io::path cacheDir = Parameters->getAttributeAsString(MESH_BINARY_CACHE_DIRECTORY);
+	if (cacheDir.empty() || core::hasFileExtension(filename, "irrbmesh"))
+		return false;
+
+	// only files in the native file system have a modification time
+	sourcePath = FileSystem->getAbsolutePath(filename);
+	if (!CIrrBinaryMeshFileLoader::getFileInfo(sourcePath, modificationTime, size))
+		return false;
+
+	// FNV-1a hash of the absolute path, collisions are detected by the path stored in the cached file
+	u32 hash = 2166136261u;
+	for (u32 i=0; i<sourcePath.size(); ++i)
+	{
+		hash ^= (u32)sourcePath[i];
+		hash *= 16777619u;
+	}
+	c8 hashStr[16];
+	snprintf(hashStr, sizeof(hashStr), "%08x", hash);
+
+	cacheFile = cacheDir;
+	if (cacheFile.lastChar() != '/' && cacheFile.lastChar() != '\\')
+		cacheFile += '/';
+	cacheFile += FileSystem->getFileBasename(sourcePath, false);
+	cacheFile += '_';
+	cacheFile += hashStr;
+	cacheFile += ".irrbmesh";
+	return true;
+#else
+	return false;
+#endif
+}
+
+
+IAnimatedMesh* CSceneManager::getMeshFromBinaryCache(const io::path& cacheFile, const io::path& sourcePath, u64 modificationTime, u64 size, const io::path& cachename)
+{
+#if defined(_IRR_COMPILE_WITH_IRR_BINARY_MESH_LOADER_) && defined(_IRR_COMPILE_WITH_IRR_BINARY_WRITER_)
+	if (!FileSystem->existFile(cacheFile))
+		return 0;
+
+	io::IReadFile* file = FileSystem->createAndOpenFile(cacheFile);
+	if (!file)
+		return 0;
+
+	IAnimatedMesh* msh = 0;
+	io::path cachedSourcePath;
+	u64 cachedModificationTime, cachedSize;
+	if (CIrrBinaryMeshFileLoader::readSourceInfo(file, cachedSourcePath, cachedModificationTime, cachedSize) &&
+		cachedSourcePath == sourcePath && cachedModificationTime == modificationTime && cachedSize == size)
+	{
+		file->seek(0);
+		CIrrBinaryMeshFileLoader loader(this);
+		msh = loader.createMesh(file);
+		if (msh)
+		{
+			MeshCache->addMesh(cachename, msh);
+			msh->drop();
+			os::Printer::log("Loaded mesh from binary cache", sourcePath, ELL_DEBUG);
+		}
+	}
+
+	file->drop();
+	return msh;
+#else
+	return 0;
+#endif
+}
+
+
+void CSceneManager::writeMeshToBinaryCache(const io::path& cacheFile, const io::path& sourcePath, u64 modificationTime, u64 size, IAnimatedMesh* mesh)
+{
+#if defined(_IRR_COMPILE_WITH_IRR_BINARY_MESH_LOADER_) && defined(_IRR_COMPILE_WITH_IRR_BINARY_WRITER_)
+	// only static meshes are supported by the binary format
+	if (mesh->getMeshType() == EAMT_SKINNED || mesh->getFrameCount() > 1 || !mesh->getMesh(0))
+		return;
+
+	CIrrBinaryMeshWriter writer;
+	writer.setSourceInfo(sourcePath, modificationTime, size);
+	if (!writer.writeMeshReplacingFile(FileSystem, cacheFile, mesh->getMesh(0)))
+		os::Printer::log("Could not write binary mesh cache file", cacheFile, ELL_WARNING);
+#endif
+}
+
+
 //! returns the video driver
 video::IVideoDriver* CSceneManager::getVideoDriver()
 {
@@ -2613,6 +2724,12 @@ IMeshWriter* CSceneManager::createMeshWriter(EMESH_WRITER_TYPE type)
 		return new CIrrMeshWriter(Driver, FileSystem);
 #else
 		return 0;
+#endif
+	case EMWT_IRR_BINARY_MESH:
+#ifdef _IRR_COMPILE_WITH_IRR_BINARY_WRITER_
+		return new CIrrBinaryMeshWriter();
+#else
+		return 0;
 #endif
 	case EMWT_COLLADA:
 #ifdef _IRR_COMPILE_WITH_COLLADA_WRITER_
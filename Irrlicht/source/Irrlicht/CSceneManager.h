@@ -539,6 +539,16 @@ namespace scene
 		// load and create a mesh which we know already isn't in the cache and put it in there
 		IAnimatedMesh* getUncachedMesh(io::IReadFile* file, const io::path& filename, const io::path& cachename);
 
+		//! gets the file in the binary mesh cache directory for a mesh file
+		//! returns false if the binary mesh cache is disabled or not usable for this file
+		bool getBinaryMeshCacheFile(const io::path& filename, io::path& sourcePath, io::path& cacheFile, u64& modificationTime, u64& size) const;
+
+		// loads a mesh from the binary mesh cache if it is up to date and puts it in the mesh cache
+		IAnimatedMesh* getMeshFromBinaryCache(const io::path& cacheFile, const io::path& sourcePath, u64 modificationTime, u64 size, const io::path& cachename);
+
+		// writes a static mesh to the binary mesh cache, modificationTime and size must have been determined before loading the source file
+		void writeMeshToBinaryCache(const io::path& cacheFile, const io::path& sourcePath, u64 modificationTime, u64 size, IAnimatedMesh* mesh);
+
 		//! clears the deletion list
 		void clearDeletionList();
 
@@ -27,6 +27,9 @@ namespace irr
 		EPID_SM_RENDER_EFFECT,
 		EPID_SM_REGISTER,
 
+		//! gui environment
+		EPID_GUI_DRAW_ALL,
+
 		//! octrees
 		EPID_OC_RENDER,
 		EPID_OC_CALCPOLYS,
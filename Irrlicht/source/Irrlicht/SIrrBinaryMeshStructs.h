@@ -0,0 +1,142 @@
+// This file is part of the "Irrlicht Engine".
+// For conditions of distribution and use, see copyright notice in irrlicht.h
+
+// Structures of the .irrbmesh format, a binary format for static meshes.
+// It is meant as a fast loading cache and not as an exchange format:
+// vertices and indices are stored exactly as laid out in memory, therefore
+// files are only valid for the same endianness and vertex layout.
+//
+// Layout (all blocks are 4 byte aligned):
+// SIrrBinaryMeshHeader
+// source path characters (SourcePathLength, padded to 4 bytes)
+// MeshBufferCount times:
+//   SIrrBinaryMeshBufferHeader
+//   SIrrBinaryMeshMaterial
+//   TextureLayerCount times: SIrrBinaryMeshTextureLayer + texture name characters (padded)
+//   vertices (VertexCount * vertex size)
+//   indices (IndexCount * index size, padded)
+
+#ifndef __S_IRR_BINARY_MESH_STRUCTS_H_INCLUDED__
+#define __S_IRR_BINARY_MESH_STRUCTS_H_INCLUDED__
+
+#include "irrTypes.h"
+#include "S3DVertex.h"
+
+namespace irr
+{
+namespace scene
+{
+
+	//! 'irrb' in the first 4 bytes of the file
+	const u32 IRR_BINARY_MESH_MAGIC = MAKE_IRR_ID('i','r','r','b');
+
+	//! Increment on every change of the structures below
+	const u32 IRR_BINARY_MESH_VERSION = 1;
+
+	//! Read as different value if the file has been written with a different endianness
+	const u32 IRR_BINARY_MESH_ENDIAN_CHECK = 0x01020304;
+
+	//! Sizes of the vertex types packed into one value to detect incompatible vertex layouts
+	const u32 IRR_BINARY_MESH_VERTEX_SIZES = sizeof(video::S3DVertex) |
+		(sizeof(video::S3DVertex2TCoords) << 8) | (sizeof(video::S3DVertexTangents) << 16);
+
+	struct SIrrBinaryMeshHeader
+	{
+		u32 Magic;
+		u32 Version;
+		u32 EndianCheck;
+		u32 VertexSizes;
+		//! Modification time of the file the mesh has been created from (see CIrrBinaryMeshFileLoader::getFileInfo, 0 if unknown)
+		u64 SourceModificationTime;
+		//! Size of the file the mesh has been created from in bytes (0 if unknown)
+		u64 SourceSize;
+		//! Length of the absolute path of the file the mesh has been created from (may be 0)
+		u32 SourcePathLength;
+		u32 MeshBufferCount;
+		f32 BoundingBox[6];
+	};
+
+	struct SIrrBinaryMeshBufferHeader
+	{
+		u32 VertexType;
+		u32 IndexType;
+		u32 VertexCount;
+		u32 IndexCount;
+		u32 PrimitiveType;
+		u32 HardwareMappingHintVertex;
+		u32 HardwareMappingHintIndex;
+		u32 Reserved;
+		f32 BoundingBox[6];
+	};
+
+	//! Flags of SIrrBinaryMeshMaterial::Flags
+	enum E_IRR_BINARY_MESH_MATERIAL_FLAGS
+	{
+		EIBMMF_WIREFRAME = 0x1,
+		EIBMMF_POINT_CLOUD = 0x2,
+		EIBMMF_GOURAUD_SHADING = 0x4,
+		EIBMMF_LIGHTING = 0x8,
+		EIBMMF_BACKFACE_CULLING = 0x10,
+		EIBMMF_FRONTFACE_CULLING = 0x20,
+		EIBMMF_FOG_ENABLE = 0x40,
+		EIBMMF_NORMALIZE_NORMALS = 0x80,
+		EIBMMF_USE_MIPMAPS = 0x100
+	};
+
+	struct SIrrBinaryMeshMaterial
+	{
+		u32 MaterialType;
+		u32 AmbientColor;
+		u32 DiffuseColor;
+		u32 EmissiveColor;
+		u32 SpecularColor;
+		f32 Shininess;
+		f32 MaterialTypeParam;
+		f32 MaterialTypeParam2;
+		f32 Thickness;
+		u32 ZBuffer;
+		u32 AntiAliasing;
+		u32 ColorMask;
+		u32 ColorMaterial;
+		u32 BlendOperation;
+		f32 BlendFactor;
+		u32 PolygonOffsetFactor;
+		u32 PolygonOffsetDirection;
+		f32 PolygonOffsetDepthBias;
+		f32 PolygonOffsetSlopeScale;
+		u32 ZWriteEnable;
+		u32 Flags;
+		u32 TextureLayerCount;
+	};
+
+	//! Flags of SIrrBinaryMeshTextureLayer::Flags
+	enum E_IRR_BINARY_MESH_LAYER_FLAGS
+	{
+		EIBMLF_BILINEAR_FILTER = 0x1,
+		EIBMLF_TRILINEAR_FILTER = 0x2,
+		EIBMLF_TEXTURE_MATRIX = 0x4
+	};
+
+	struct SIrrBinaryMeshTextureLayer
+	{
+		u32 TextureWrapU;
+		u32 TextureWrapV;
+		u32 TextureWrapW;
+		u32 Flags;
+		u32 AnisotropicFilter;
+		s32 LODBias;
+		f32 TextureMatrix[16];
+		//! Length of the texture name following this structure, 0 if no texture
+		u32 TextureNameLength;
+	};
+
+	//! Returns the number of bytes required to pad size to a multiple of 4
+	inline u32 getIrrBinaryMeshPadding(u32 size)
+	{
+		return (4 - (size & 3)) & 3;
+	}
+
+} // end namespace scene
+} // end namespace irr
+
+#endif
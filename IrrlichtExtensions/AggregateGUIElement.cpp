@@ -4,6 +4,7 @@
 #include "AggregateSkinExtension.h"
 
 #include <timing.h>
+#include <Profiler.h>
 
 #include <IVideoDriver.h>
 #include <IGUIEnvironment.h>
@@ -240,6 +241,7 @@ irr::f32 AggregateGUIElement::getScrollStepSize() const{
 
 void AggregateGUIElement::draw(){
 	if(isVisible()){
+		PROFILE_SCOPE("AggregateGUIElement::draw");
 		if(absPosDirty){updateAbsolutePosition();}
 		updateScrollSpeed();
 		IGUISkin* skin = Environment->getSkin();
@@ -2,7 +2,6 @@
 #include "utilities.h"
 #include "mathUtils.h"
 #include "MaterialWorkaround.h"
-#include "Triangulate.h"
 
 #include <IrrlichtDevice.h>
 #include <ISceneManager.h>
@@ -223,7 +222,7 @@ Drawer2D::Drawer2D(irr::IrrlichtDevice* device):cCalc(16.f/9.f){
 	imgMb.Indices.push_back(3);
 	imgMb.MappingHint_Index = EHM_STATIC;
 	autoResetEnabled = true;
-	triangulated.reallocate(MAX_VERTICES);
+	triangulated.reallocate(3*MAX_VERTICES);
 	if(polyMatType==EMT_TRANSPARENT_ALPHA_CHANNEL && (driver->getDriverType()==EDT_OGLES2 || driver->getDriverType()==EDT_OPENGL)){//TODO other drivers
 		pcbk.init(device);
 		pwtcbk.init(device);
@@ -236,6 +235,10 @@ Drawer2D::Drawer2D(irr::IrrlichtDevice* device):cCalc(16.f/9.f){
 	defaultPolyAAValue = 0.f;
 	overridePolyMatType = EMT_TRANSPARENT_ALPHA_CHANNEL;
 	useOverridePolyMatType = false;
+	batchingEnabled = false;
+	batchMb.MappingHint_Index = EHM_NEVER;
+	batchMb.MappingHint_Vertex = EHM_NEVER;
+	resetStatistics();
 }
 
 void Drawer2D::setOverridePolygonMaterialType(E_MATERIAL_TYPE* overrideMatType){
@@ -287,7 +290,6 @@ void Drawer2D::drawLine(irr::video::ITexture* tex, irr::core::position2d<f32> st
 void Drawer2D::draw(ITexture* tex, position2d<irr::f32> pos, dimension2d<f32> size, float rotation, vector2d<f32> origin, irr::core::vector2d<irr::f32>* customTCoords){
 	if(size.Width>FLOAT_EPS && size.Height>FLOAT_EPS){
 		irr::core::vector2d<irr::f32>* tc = customTCoords==NULL?tcoords:customTCoords;
-		cCalc.set2DTransforms(device);
 		imgMb.Vertices.set_used(0);
 		imgMb.Material = SMaterial(stdMat);
 		f32 cosphi = cosf(rotation/DEG_RAD), sinphi = sinf(rotation/DEG_RAD);
@@ -301,13 +303,7 @@ void Drawer2D::draw(ITexture* tex, position2d<irr::f32> pos, dimension2d<f32> si
 		imgMb.setDirty(EBT_VERTEX);
 		imgMb.Material.TextureLayer[0].Texture = tex;//NULL also fine
 		imgMb.Material.BackfaceCulling = false;//otherwise index order is important
-		driver->setMaterial(imgMb.Material);
-		SET_MATERIAL_WORKAROUND(driver, imgMb.Material)
-		driver->drawMeshBuffer(&imgMb);
-		UNSET_MATERIAL_WORKAROUND
-		if(autoResetEnabled){
-			cCalc.reset2DTransforms(device);
-		}
+		draw2DMeshBuffer(&imgMb);
 	}
 }
 
@@ -414,18 +410,19 @@ void Drawer2D::drawRectWithCorner(const irr::core::rect<irr::f32>& rectangle, ir
 }
 
 void Drawer2D::drawFilledPolygon(irr::core::array< irr::core::vector2d<irr::f32> >& p, irr::video::SColor color, irr::core::vector2d<irr::f32> bbMin, irr::core::vector2d<irr::f32> bbMax, irr::video::ITexture* tex, float texScale){
-	cCalc.set2DTransforms(device);	
 	//Triangulieren
+	int vc = p.size();
+	if(vc>MAX_VERTICES){return;}//TODO writeLog("Too many vertices: ");writeLog(vc);writeLog("\n");
 	triangulated.set_used(0);
-	Triangulate::Process(p, triangulated);//bool success = 
+	triangulator.clear();
+	triangulator.addContour(p);
+	triangulator.triangulate(triangulated);//bool success = 
 	//Meshbuffer aufbauen
 	mb.MappingHint_Index = EHM_NEVER;
 	mb.MappingHint_Vertex = EHM_NEVER;
 	mb.Material = SMaterial(stdMat);//gleiches Material wie für Linien
 	mb.Material.TextureLayer[0].Texture = tex;//NULL auch ok
 	mb.Material.BackfaceCulling = false;//da Backfaces ggf. verwendet beim Indizieren
-	int vc = triangulated.size();
-	if(vc>MAX_VERTICES){return;}//TODO writeLog("Too many vertices: ");writeLog(vc);writeLog("\n");
 	//Vertices aufbauen
 	mb.Vertices.set_used(vc);
 	f32 bbW = bbMax.X-bbMin.X;
@@ -434,23 +431,17 @@ void Drawer2D::drawFilledPolygon(irr::core::array< irr::core::vector2d<irr::f32>
 		S3DVertex& v = mb.Vertices[i];
 		v.Color = color;
 		v.Normal = vector3d<f32>(0.f,0.f,-1.f);
-		v.Pos = vector3d<f32>(triangulated[i].X, triangulated[i].Y, 1.f);
-		v.TCoords = vector2d<f32>((triangulated[i].X-bbMin.X)/bbW*texScale, (triangulated[i].Y-bbMin.Y)/bbH*texScale);
+		v.Pos = vector3d<f32>(p[i].X, p[i].Y, 1.f);
+		v.TCoords = vector2d<f32>((p[i].X-bbMin.X)/bbW*texScale, (p[i].Y-bbMin.Y)/bbH*texScale);
 	}
 	//Indices aufbauen
-	mb.Indices.set_used(0);
-	for(int i=0; i<vc; i++){
-		mb.Indices.push_back(i);
+	mb.Indices.set_used(triangulated.size());
+	for(u32 i=0; i<triangulated.size(); i++){
+		mb.Indices[i] = triangulated[i];
 	}
 	mb.setDirty();
-	//ViewParameter setzen + Rendern #2
-	driver->setMaterial(mb.Material);
-	SET_MATERIAL_WORKAROUND(driver, mb.Material)
-	driver->drawMeshBuffer(&mb);
-	UNSET_MATERIAL_WORKAROUND
-	if(autoResetEnabled){
-		cCalc.reset2DTransforms(device);
-	}
+	//Rendern
+	draw2DMeshBuffer(&mb);
 }
 
 static vector2d<f32> calcArcPoint(const irr::core::vector2d<irr::f32>& center, irr::f32 radius, irr::f32 angle){
@@ -865,12 +856,21 @@ irr::f32 Drawer2D::getDefaultPolygonAAValue() const{
 	return defaultPolyAAValue;
 }
 
+void Drawer2D::drawWithDriver(irr::scene::SMeshBuffer* mb){
+	driver->setMaterial(mb->Material);
+	SET_MATERIAL_WORKAROUND(driver, mb->Material)
+	driver->drawMeshBuffer(mb);
+	UNSET_MATERIAL_WORKAROUND
+	statistics.drawCalls++;
+	statistics.vertexCount += mb->Vertices.size();
+}
+
 void Drawer2D::draw2DMeshBuffer(irr::scene::SMeshBuffer* mb, const irr::core::vector2d<irr::f32>& translation, const irr::core::vector2d<irr::f32>& scale, irr::f32 angle, const irr::core::vector2d<irr::f32>& origin, const irr::core::rect<irr::s32>* clip){
+	statistics.drawRequests++;
 	irr::core::rect<s32> oldVport = driver->getViewPort();
 	irr::core::rect<s32> vport(oldVport);
 	vector2d<irr::f32> finalTranslation(translation);
 	if(clip){
-		driver->setViewPort(*clip);
 		finalTranslation.X -= clip->UpperLeftCorner.X;
 		finalTranslation.Y -= clip->UpperLeftCorner.Y;
 		vport = *clip;
@@ -878,11 +878,18 @@ void Drawer2D::draw2DMeshBuffer(irr::scene::SMeshBuffer* mb, const irr::core::ve
 	dimension2d<u32> vdim(vport.getWidth(), vport.getHeight());
 	cCalc.setAspectRatio((f32)vdim.Width/(f32)vdim.Height);
 	irr::core::matrix4 T = createOptimized2DTransform(finalTranslation, scale, angle/DEG_RAD, origin, cCalc.getCameraScreenParameters(), vdim, cCalc.getRecommendedInverseProjectionDistance());
+	if(batchingEnabled && mb->getPrimitiveType()==EPT_TRIANGLES){
+		appendToBatch(mb, T, vport);
+		return;
+	}
+	if(batchingEnabled){//the batched geometry must be drawn first to keep the painter's order
+		flush();
+	}
+	if(clip){
+		driver->setViewPort(*clip);
+	}
 	cCalc.set2DTransforms(device, &T, true);
-	driver->setMaterial(mb->Material);
-	SET_MATERIAL_WORKAROUND(driver, mb->Material)
-	driver->drawMeshBuffer(mb);
-	UNSET_MATERIAL_WORKAROUND
+	drawWithDriver(mb);
 	if(autoResetEnabled || clip){
 		cCalc.reset2DTransforms(device);
 	}
@@ -892,16 +899,92 @@ void Drawer2D::draw2DMeshBuffer(irr::scene::SMeshBuffer* mb, const irr::core::ve
 }
 
 void Drawer2D::draw2DMeshBuffer(irr::scene::SMeshBuffer* mb){
+	statistics.drawRequests++;
+	if(batchingEnabled && mb->getPrimitiveType()==EPT_TRIANGLES){
+		irr::core::rect<s32> vport = driver->getViewPort();
+		dimension2d<u32> vdim(vport.getWidth(), vport.getHeight());
+		cCalc.setAspectRatio((f32)vdim.Width/(f32)vdim.Height);
+		appendToBatch(mb, create2DInverseProjection(cCalc.getCameraScreenParameters(), vdim, cCalc.getRecommendedInverseProjectionDistance()), vport);
+		return;
+	}
+	if(batchingEnabled){
+		flush();
+	}
 	cCalc.set2DTransforms(device);
-	driver->setMaterial(mb->Material);
-	SET_MATERIAL_WORKAROUND(driver, mb->Material)
-	driver->drawMeshBuffer(mb);
-	UNSET_MATERIAL_WORKAROUND
+	drawWithDriver(mb);
 	if(autoResetEnabled){
 		cCalc.reset2DTransforms(device);
 	}
 }
 
+void Drawer2D::appendToBatch(const irr::scene::SMeshBuffer* source, const irr::core::matrix4& worldTransform, const irr::core::rect<irr::s32>& viewPort){
+	u32 vertexOffset = batchMb.Vertices.size();
+	u32 sourceVertexCount = source->Vertices.size();
+	if(vertexOffset>0 && (vertexOffset+sourceVertexCount>MAX_VERTICES || viewPort!=batchViewPort || batchMb.Material!=source->Material)){
+		flush();
+		vertexOffset = 0;
+	}
+	if(sourceVertexCount>MAX_VERTICES){return;}
+	if(vertexOffset==0){
+		batchMb.Material = source->Material;
+		batchViewPort = viewPort;
+	}
+	batchMb.Vertices.set_used(vertexOffset+sourceVertexCount);
+	for(u32 i=0; i<sourceVertexCount; i++){
+		S3DVertex& v = batchMb.Vertices[vertexOffset+i];
+		v = source->Vertices[i];
+		worldTransform.transformVect(v.Pos);
+	}
+	u32 indexOffset = batchMb.Indices.size();
+	u32 sourceIndexCount = source->Indices.size();
+	batchMb.Indices.set_used(indexOffset+sourceIndexCount);
+	for(u32 i=0; i<sourceIndexCount; i++){
+		batchMb.Indices[indexOffset+i] = vertexOffset+source->Indices[i];
+	}
+}
+
+void Drawer2D::beginBatch(){
+	batchingEnabled = true;
+}
+
+void Drawer2D::flush(){
+	if(batchMb.Indices.size()==0){return;}
+	irr::core::rect<s32> oldVport = driver->getViewPort();
+	bool changeVport = oldVport!=batchViewPort;
+	if(changeVport){
+		driver->setViewPort(batchViewPort);
+	}
+	static const irr::core::matrix4 identity;
+	cCalc.set2DTransforms(device, &identity, true);
+	batchMb.setDirty();
+	drawWithDriver(&batchMb);
+	if(autoResetEnabled || changeVport){
+		cCalc.reset2DTransforms(device);
+	}
+	if(changeVport){
+		driver->setViewPort(oldVport);
+	}
+	batchMb.Vertices.set_used(0);
+	batchMb.Indices.set_used(0);
+}
+
+void Drawer2D::endBatch(){
+	flush();
+	batchingEnabled = false;
+}
+
+bool Drawer2D::isBatching() const{
+	return batchingEnabled;
+}
+
+const Drawer2D::Statistics& Drawer2D::getStatistics() const{
+	return statistics;
+}
+
+void Drawer2D::resetStatistics(){
+	statistics = Statistics{0, 0, 0};
+}
+
 void Drawer2D::setFiltering(bool bilinear,bool trilinear, int anisotropic){
 	for(u32 j=0; j<MATERIAL_MAX_TEXTURES; j++){
 		stdMat.TextureLayer[j].TrilinearFilter = trilinear;
@@ -2,6 +2,7 @@
 #define Drawer2D_H_INCLUDED
 
 #include "Transformation2DHelpers.h"
+#include "Triangulate.h"
 
 #include <SMeshBuffer.h>
 #include <SColor.h>
@@ -28,6 +29,15 @@ namespace irr{
 //! Draw 2D Images, Polygons, Arcs with 3D geometry (e.g. useful for Shading, Transformation)
 class Drawer2D{
 
+	public:
+	
+	//! Counters to measure the effect of batching (see resetStatistics)
+	struct Statistics{
+		irr::u32 drawRequests;//! calls of draw2DMeshBuffer (all draw methods use it)
+		irr::u32 drawCalls;//! meshbuffers passed to the video driver
+		irr::u32 vertexCount;//! vertices passed to the video driver
+	};
+
 	private:
 
 	irr::IrrlichtDevice* device;
@@ -42,7 +52,8 @@ class Drawer2D{
 	irr::core::vector2d<irr::f32> v[4];
 	irr::core::vector2d<irr::f32> tcoords[4];
 
-	irr::core::array< irr::core::vector2d<irr::f32> > triangulated;
+	MonotoneTriangulator triangulator;
+	irr::core::array<irr::u32> triangulated;//triangle indices of the polygon points
 	
 	Camera2DParameterCalculator cCalc;
 	
@@ -54,6 +65,16 @@ class Drawer2D{
 	bool useOverridePolyMatType;
 	
 	irr::core::array< irr::core::vector2d<irr::f32> > preprocessedPoly;//common intermediate representation for preprocessed polys to prevent large reallocations
+	
+	bool batchingEnabled;
+	irr::scene::SMeshBuffer batchMb;//collected geometry in batching mode, vertices are already transformed by the world transformation
+	irr::core::rect<irr::s32> batchViewPort;
+	
+	Statistics statistics;
+	
+	void appendToBatch(const irr::scene::SMeshBuffer* source, const irr::core::matrix4& worldTransform, const irr::core::rect<irr::s32>& viewPort);
+	
+	void drawWithDriver(irr::scene::SMeshBuffer* mb);
 
 	public:
 
@@ -167,6 +188,24 @@ class Drawer2D{
 	//! set to true if transformations of active camera shall be restored automatically after drawing
 	void setAutoResetTransformEnabled(bool enabled = true);
 
+	//! In batching mode the geometry of all draw methods is collected in a large meshbuffer (the vertices are transformed on the cpu) instead of being drawn immediately.
+	//! The collected geometry is drawn with a single draw call if the state (material including textures, viewport/clip) changes, if the meshbuffer is full and on flush.
+	//! flush must be called before anything else is drawn in between (e.g. fonts or gui elements) and before the end of the frame.
+	//! Meshbuffers which are no triangle lists flush the collected geometry and are drawn immediately.
+	void beginBatch();
+	
+	//! draws the geometry collected in batching mode
+	void flush();
+	
+	//! flushes and leaves the batching mode
+	void endBatch();
+	
+	bool isBatching() const;
+	
+	const Statistics& getStatistics() const;
+	
+	void resetStatistics();
+
 	//! MUST be called (on Android and on any OS which do not reinit (global) static variables on restart) before using a Drawer2D for the first time after app start
 	static void initStaticVars();
 
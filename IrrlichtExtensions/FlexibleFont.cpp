@@ -14,6 +14,7 @@
 #include <cassert>
 #include <iostream>
 #include <csignal>
+#include <cstring>
 
 using namespace irr;
 using namespace core;
@@ -421,6 +422,80 @@ FlexibleFont* BMFontLoader::loadFont(irr::io::IReadFile* file){
 	return font;
 }
 
+static inline u32 hashKerningKey(u64 key){
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdULL;
+	key ^= key >> 33;
+	return (u32)key;
+}
+
+static inline u64 createKerningKey(u32 first, u32 second){
+	return (((u64)first) << 32) | second;
+}
+
+void IFontLoader::Font::updateLookupTables(){
+	//dense table for the basic multilingual plane, the map is used for other characters
+	u32 bmpSize = 0;
+	for(auto it = characters.getIterator(); !it.atEnd(); it++){
+		u32 id = it->getKey();
+		if(id<65536 && id>=bmpSize){bmpSize = id+1;}
+	}
+	bmpCharacterIndices.set_used(bmpSize);
+	for(u32 i=0; i<bmpSize; i++){bmpCharacterIndices[i] = -1;}
+	characterArray.set_used(0);
+	characterArray.reallocate(characters.size());
+	for(auto it = characters.getIterator(); !it.atEnd(); it++){
+		u32 id = it->getKey();
+		if(id<65536){
+			bmpCharacterIndices[id] = characterArray.size();
+			characterArray.push_back(it->getValue());
+		}
+	}
+	//kerning hash table with load factor <= 0.5
+	u32 tableSize = 0;
+	if(kerning.size()>0){
+		tableSize = 16;
+		while(tableSize<2*kerning.size()){tableSize *= 2;}
+	}
+	kerningTable.set_used(tableSize);
+	for(u32 i=0; i<tableSize; i++){kerningTable[i] = KerningEntry{0, 0};}
+	for(auto it = kerning.getIterator(); !it.atEnd(); it++){
+		const stringw& pair = it->getKey();
+		if(pair.size()==2){
+			u64 key = createKerningKey((u32)pair[0], (u32)pair[1]);
+			u32 idx = hashKerningKey(key) & (tableSize-1);
+			while(kerningTable[idx].key!=0 && kerningTable[idx].key!=key){idx = (idx+1) & (tableSize-1);}
+			kerningTable[idx] = KerningEntry{key, it->getValue()};
+		}
+	}
+}
+
+const IFontLoader::FontCharacter* IFontLoader::Font::findCharacter(u32 id) const{
+	if(id<bmpCharacterIndices.size()){
+		s32 idx = bmpCharacterIndices[id];
+		return idx<0?NULL:&(characterArray[idx]);
+	}
+	irr::core::map<irr::u32, FontCharacter>::Node* node = characters.find(id);
+	return node?&(node->getValue()):NULL;
+}
+
+irr::s32 IFontLoader::Font::getKerning(u32 first, u32 second) const{
+	u32 tableSize = kerningTable.size();
+	if(tableSize>0){
+		u64 key = createKerningKey(first, second);
+		u32 idx = hashKerningKey(key) & (tableSize-1);
+		while(kerningTable[idx].key!=0){
+			if(kerningTable[idx].key==key){return kerningTable[idx].amount;}
+			idx = (idx+1) & (tableSize-1);
+		}
+	}else if(kerning.size()>0){//lookup tables not updated
+		wchar_t pair[3] = {(wchar_t)first, (wchar_t)second, L'\0'};
+		irr::core::map<irr::core::stringw, irr::s32>::Node* node = kerning.find(pair);
+		if(node){return node->getValue();}
+	}
+	return 0;
+}
+
 void convertFontCoords2TexCoords(IFontLoader::Font& fontDef, bool offsetForFiltering){
 	assert(fontDef.page!=NULL);
 	dimension2d<u32> tDim = fontDef.page->getOriginalSize();
@@ -433,6 +508,7 @@ void convertFontCoords2TexCoords(IFontLoader::Font& fontDef, bool offsetForFilte
 		fc.maxTexBB.X = (fc.x+fc.width)*mulX;
 		fc.maxTexBB.Y = (fc.y+fc.height)*mulY;
 	}
+	fontDef.updateLookupTables();
 }
 
 FlexibleFont::FlexibleFont(FlexibleFontManager* fmgr):irr::gui::IGUIFont(),
@@ -448,11 +524,16 @@ FlexibleFont::FlexibleFont(FlexibleFontManager* fmgr):irr::gui::IGUIFont(),
 	defaultBorderColor(255,0,0,0),
 	defaultScale(1.f,1.f),
 	defaultShadow{vector2df(0,0), 0.2f, SColor(255,0,0,0)},
-	defaultMaterialType(EMT_TRANSPARENT_ALPHA_CHANNEL){
+	defaultMaterialType(EMT_TRANSPARENT_ALPHA_CHANNEL),
+	maxCachedLayouts(1024){
 	defaultMeshBuffer.Material = SMaterial();
 	defaultMeshBuffer.setHardwareMappingHint(EHM_NEVER);
 }
 
+FlexibleFont::~FlexibleFont(){
+	clearLayoutCache();
+}
+
 void FlexibleFont::setDefaultTabSize(irr::s32 tabSize){
 	defaultTabSize = tabSize;
 }
@@ -541,7 +622,7 @@ class ICharacterCallback{
 	
 	public:
 	
-	virtual void OnCharacter(IFontLoader::FontCharacter& fc, s32 idxInString, s32 finalX, s32 finalY) = 0;
+	virtual void OnCharacter(const IFontLoader::FontCharacter& fc, s32 idxInString, s32 finalX, s32 finalY) = 0;
 	
 	virtual void OnLineFinished(s32 curX){}
 	
@@ -550,15 +631,15 @@ class ICharacterCallback{
 };
 
 static void iterateOverString(const wchar_t* text, size_t textLen, irr::s32 tabSize, const IFontLoader::Font& fontDefinition, ICharacterCallback& cbk){
-	irr::core::stringw kerningKey(L"\1\1");
-	irr::core::map<irr::u32, IFontLoader::FontCharacter>::Node* fallbackNode = fontDefinition.characters.find((u32)L'\'');
-	assert(fallbackNode!=NULL);
-	u32 spaceAdvance = fallbackNode->getValue().xadvance;
+	const IFontLoader::FontCharacter* fallback = fontDefinition.findCharacter((u32)L'\'');
+	assert(fallback!=NULL);
+	u32 spaceAdvance = fallback->xadvance;
 	s32 curX = 0, curY = 0;
+	wchar_t previous = L'\1';
 	for(size_t i=0; i<textLen; i++){
 		wchar_t c = text[i];
-		kerningKey[0] = kerningKey[1];
-		kerningKey[1] = c;
+		u32 first = (u32)previous;
+		previous = c;
 		if(c==L'\n'){
 			curY += fontDefinition.base;
 			cbk.OnLineFinished(curX);
@@ -569,13 +650,9 @@ static void iterateOverString(const wchar_t* text, size_t textLen, irr::s32 tabS
 			u32 tabsInLine = (curX/spaceAdvance)/tabSize;
 			curX = (tabsInLine+1)*tabSize*spaceAdvance;
 		}else{
-			irr::core::map<irr::u32, IFontLoader::FontCharacter>::Node* node = fontDefinition.characters.find((u32)c);
-			if(node==NULL){node = fallbackNode;}
-			IFontLoader::FontCharacter& fc = node->getValue();
-			irr::core::map<irr::core::stringw, irr::s32>::Node* kerningNode = fontDefinition.kerning.find(kerningKey);
-			if(kerningNode){
-				curX += kerningNode->getValue();
-			}
+			const IFontLoader::FontCharacter* character = fontDefinition.findCharacter((u32)c);
+			const IFontLoader::FontCharacter& fc = character?*character:*fallback;
+			curX += fontDefinition.getKerning(first, (u32)c);
 			s32 finalX = curX + fc.xoffset;
 			s32 finalY = curY + fc.yoffset;
 			cbk.OnCharacter(fc, i, finalX, finalY);
@@ -599,7 +676,7 @@ class FillMeshBufferCharacterCallback : public ICharacterCallback{
 	
 	FillMeshBufferCharacterCallback(irr::scene::SMeshBuffer& mb, irr::core::matrix4* transformation, irr::video::SColor color, irr::f32 italicGradient, irr::s32 wholeWidth):mb(mb),transformation(transformation),color(color),italicGradient(italicGradient),wholeWidth(wholeWidth),lineStartVertex(mb.Vertices.size()){}
 	
-	void OnCharacter(IFontLoader::FontCharacter& fc, s32 idxInString, s32 finalX, s32 finalY){
+	void OnCharacter(const IFontLoader::FontCharacter& fc, s32 idxInString, s32 finalX, s32 finalY){
 		u32 upperLeft = mb.Vertices.size();
 		u32 lowerLeft = upperLeft+1, upperRight = upperLeft+2, lowerRight = upperLeft+3;
 		f32 italicOffset = italicGradient*fc.height;
@@ -722,7 +799,7 @@ class DimensionFinderCallback : public ICharacterCallback{
 	
 	DimensionFinderCallback(const IFontLoader::Font& fontDefinition):maxX(0),maxY(0),fontDefinition(fontDefinition){}
 	
-	void OnCharacter(IFontLoader::FontCharacter& fc, s32 idxInString, s32 finalX, s32 finalY){
+	void OnCharacter(const IFontLoader::FontCharacter& fc, s32 idxInString, s32 finalX, s32 finalY){
 		s32 newMaxX = finalX-fc.xoffset+fc.xadvance;
 		s32 newMaxY = finalY-fc.yoffset;
 		if(newMaxX>maxX){maxX = newMaxX;}
@@ -755,7 +832,95 @@ static inline void clipPos(irr::core::rect<irr::s32>& position, const irr::core:
 	if(position.LowerRightCorner.Y>=clip.UpperLeftCorner.Y && position.LowerRightCorner.Y<=clip.LowerRightCorner.Y){position.LowerRightCorner.Y = clip.LowerRightCorner.Y;}
 }
 
+static inline u64 hashLayout(const irr::core::stringw& text, s32 tabSize, f32 italicGradient, bool newLinesCentered){//FNV-1a
+	const u64 prime = 1099511628211ULL;
+	u64 h = 14695981039346656037ULL;
+	const wchar_t* str = text.c_str();
+	for(u32 i=0; i<text.size(); i++){
+		h = (h ^ (u32)str[i]) * prime;
+	}
+	u32 italicBits;
+	memcpy(&italicBits, &italicGradient, sizeof(u32));
+	h = (h ^ (u32)tabSize) * prime;
+	h = (h ^ italicBits) * prime;
+	h = (h ^ (newLinesCentered?1u:0u)) * prime;
+	return h;
+}
+
+FlexibleFont::CachedLayout& FlexibleFont::getCachedLayout(const irr::core::stringw& text, bool newLinesCentered, irr::video::SColor color){
+	u64 hash = hashLayout(text, defaultTabSize, defaultItalicGradient, newLinesCentered);
+	std::list<CachedLayout>::iterator it;
+	auto found = layoutCache.find(hash);
+	if(found!=layoutCache.end()){
+		it = found->second;
+		cachedLayouts.splice(cachedLayouts.begin(), cachedLayouts, it);
+		if(it->text==text && it->tabSize==defaultTabSize && it->italicGradient==defaultItalicGradient && it->newLinesCentered==newLinesCentered){
+			SMeshBuffer& mb = *(it->mb);
+			if(it->color!=color){
+				for(u32 i=0; i<mb.Vertices.size(); i++){mb.Vertices[i].Color = color;}
+				mb.setDirty(EBT_VERTEX);
+				it->color = color;
+			}
+			mb.getMaterial().MaterialType = defaultMaterialType;
+			return *it;
+		}
+		//else: hash collision => replace the entry
+	}else if(cachedLayouts.size()>=maxCachedLayouts){//reuse the least recently used entry
+		it = std::prev(cachedLayouts.end());
+		layoutCache.erase(it->hash);
+		cachedLayouts.splice(cachedLayouts.begin(), cachedLayouts, it);
+		layoutCache[hash] = it;
+	}else{
+		SMeshBuffer* mb = new SMeshBuffer();
+		mb->setHardwareMappingHint(EHM_STATIC);
+		cachedLayouts.push_front(CachedLayout{hash, L"", 0, 0.f, false, color, mb, dimension2d<u32>(0,0)});
+		it = cachedLayouts.begin();
+		layoutCache[hash] = it;
+	}
+	it->hash = hash;
+	it->text = text;
+	it->tabSize = defaultTabSize;
+	it->italicGradient = defaultItalicGradient;
+	it->newLinesCentered = newLinesCentered;
+	it->color = color;
+	it->mb->Vertices.set_used(0);
+	it->mb->Indices.set_used(0);
+	fillMeshBuffer(*(it->mb), text.c_str(), defaultTabSize, newLinesCentered, color, defaultItalicGradient, NULL, defaultMaterialType);
+	it->textSize = getDimensionWithTabs(text.c_str(), defaultTabSize);
+	return *it;
+}
+
+void FlexibleFont::removeLeastRecentlyUsedLayout(){
+	CachedLayout& layout = cachedLayouts.back();
+	device->getVideoDriver()->removeHardwareBuffer(layout.mb);
+	layout.mb->drop();
+	layoutCache.erase(layout.hash);
+	cachedLayouts.pop_back();
+}
+
+void FlexibleFont::setLayoutCacheSize(irr::u32 maxLayouts){
+	maxCachedLayouts = maxLayouts;
+	while(cachedLayouts.size()>maxCachedLayouts){
+		removeLeastRecentlyUsedLayout();
+	}
+}
+
+irr::u32 FlexibleFont::getLayoutCacheSize() const{
+	return maxCachedLayouts;
+}
+
+void FlexibleFont::clearLayoutCache(){
+	while(!cachedLayouts.empty()){
+		removeLeastRecentlyUsedLayout();
+	}
+}
+
 void FlexibleFont::draw(const irr::core::stringw& text, const irr::core::rect<irr::s32>& position, irr::video::SColor color, bool hcenter, bool vcenter, const irr::core::rect<irr::s32>* clip){
+	if(maxCachedLayouts>0){
+		CachedLayout& layout = getCachedLayout(text, hcenter, color);
+		drawFontMeshBuffer(*(layout.mb), layout.textSize, position, hcenter, vcenter, clip);
+		return;
+	}
 	//Fill MeshBuffer
 	defaultMeshBuffer.Vertices.set_used(0);
 	defaultMeshBuffer.Indices.set_used(0);
@@ -793,7 +958,7 @@ class CharPosFinderCallback : public ICharacterCallback{
 	
 	CharPosFinderCallback(s32 pos):pos(pos),resultIdx(-1){}
 	
-	void OnCharacter(IFontLoader::FontCharacter& fc, s32 idxInString, s32 finalX, s32 finalY){
+	void OnCharacter(const IFontLoader::FontCharacter& fc, s32 idxInString, s32 finalX, s32 finalY){
 		if(finalX>pos && resultIdx==-1){
 			resultIdx = idxInString-1;
 		}
@@ -824,11 +989,7 @@ void FlexibleFont::setKerningHeight(irr::s32 kerning){
 irr::s32 FlexibleFont::getKerningWidth(const wchar_t* thisLetter, const wchar_t* previousLetter) const{
 	s32 kerningWidth = 0;
 	if(thisLetter!=NULL && previousLetter!=NULL){
-		stringw kerningKey(L"  ");
-		kerningKey[0] = *previousLetter;
-		kerningKey[1] = *thisLetter;
-		irr::core::map<irr::core::stringw, irr::s32>::Node* kerningNode = fontDefinition.kerning.find(kerningKey);
-		if(kerningNode){kerningWidth += kerningNode->getValue();}
+		kerningWidth += fontDefinition.getKerning((u32)*previousLetter, (u32)*thisLetter);
 	}
 	return round_(defaultScale.X*kerningWidth);
 }
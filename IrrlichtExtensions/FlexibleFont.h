@@ -13,6 +13,9 @@
 #include "ForwardDeclarations.h"
 #include "Transformation2DHelpers.h"
 
+#include <list>
+#include <unordered_map>
+
 class FlexibleFont;
 class FlexibleFontManager;
 
@@ -37,6 +40,11 @@ class IFontLoader : public irr::IReferenceCounted{
 		irr::u32 xadvance; //! How much the x position should be altered after drawing a character
 	};
 	
+	struct KerningEntry{
+		irr::u64 key; //! (first << 32) | second, 0 if unused
+		irr::s32 amount;
+	};
+	
 	//! The whole font, all in pixels
 	struct Font{
 		irr::u32 lineHeight; //! Total Height of a line
@@ -46,6 +54,20 @@ class IFontLoader : public irr::IReferenceCounted{
 		irr::core::map<irr::core::stringw, irr::s32> kerning; //! String of two characters -> kerning offset in x
 		irr::video::ITexture* page;//texture with glyphs
 		irr::core::stringw name;
+		
+		//! Lookup tables used for the layout of text, they are generated from characters and kerning by updateLookupTables
+		irr::core::array<FontCharacter> characterArray; //! copy of all characters
+		irr::core::array<irr::s32> bmpCharacterIndices; //! Unicode ID < 65536 -> index in characterArray or -1 if not in font
+		irr::core::array<KerningEntry> kerningTable; //! open addressing hash table (size is 0 or a power of 2)
+		
+		//! must be called after characters or kerning have been changed (convertFontCoords2TexCoords calls it)
+		void updateLookupTables();
+		
+		//! returns NULL if the character is not in the font
+		const FontCharacter* findCharacter(irr::u32 id) const;
+		
+		//! returns 0 if there is no kerning for the pair
+		irr::s32 getKerning(irr::u32 first, irr::u32 second) const;
 	};
 
 	virtual bool isALoadableFileExtension(const irr::io::path& filename) = 0;
@@ -61,7 +83,7 @@ class IFontLoader : public irr::IReferenceCounted{
 
 };
 
-//! converts x,y,width,height -> minTexBB, maxTexBB
+//! converts x,y,width,height -> minTexBB, maxTexBB and updates the lookup tables
 void convertFontCoords2TexCoords(IFontLoader::Font& fontDef, bool offsetForFiltering = false);
 
 //! Loader for AngelCode BMFonts (format documentation see: http://www.angelcode.com/products/bmfont/doc/file_format.html)
@@ -189,11 +211,33 @@ class FlexibleFont : public irr::gui::IGUIFont{
 	irr::video::E_MATERIAL_TYPE defaultMaterialType;
 	irr::scene::SMeshBuffer defaultMeshBuffer;
 	
+	//! Mesh buffer created by draw for a text, reused as long as the text and the layout parameters don't change
+	struct CachedLayout{
+		irr::u64 hash;
+		irr::core::stringw text;
+		irr::s32 tabSize;
+		irr::f32 italicGradient;
+		bool newLinesCentered;
+		irr::video::SColor color;
+		irr::scene::SMeshBuffer* mb;
+		irr::core::dimension2d<irr::u32> textSize;
+	};
+	
+	irr::u32 maxCachedLayouts;
+	std::list<CachedLayout> cachedLayouts;//most recently used first
+	std::unordered_map<irr::u64, std::list<CachedLayout>::iterator> layoutCache;
+	
+	CachedLayout& getCachedLayout(const irr::core::stringw& text, bool newLinesCentered, irr::video::SColor color);
+	
+	void removeLeastRecentlyUsedLayout();
+	
 
 	public:
 	
 	FlexibleFont(FlexibleFontManager* fmgr);
 	
+	~FlexibleFont();
+	
 	FlexibleFontManager* getFontManager(){return fmgr;}
 	
 	//--- Methods for creating and drawing meshbuffers for text ---
@@ -267,6 +311,15 @@ class FlexibleFont : public irr::gui::IGUIFont{
 	
 	irr::video::E_MATERIAL_TYPE getDefaultMaterialType();
 	
+	//! Maximum amount of texts for which draw keeps the mesh buffers (least recently used ones are replaced), 0 disables the cache.
+	//! The key is the text with the layout parameters (tab size, italic gradient, centering), the scale is applied while drawing and does not invalidate cached layouts.
+	void setLayoutCacheSize(irr::u32 maxLayouts = 1024);
+	
+	irr::u32 getLayoutCacheSize() const;
+	
+	//! must be called if the font definition has been changed after drawing
+	void clearLayoutCache();
+	
 	//! draws the text with the best fitting scale without permanently changing ht default scale
 	void drawWithOptimalScale(const irr::core::stringw& text, irr::video::SColor color, const irr::core::rect<irr::s32>& labelRect, const irr::core::rect<irr::s32>* clip = NULL, bool useCurrentScaleIfLarger = true);
 	
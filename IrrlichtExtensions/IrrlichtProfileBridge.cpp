@@ -0,0 +1,43 @@
+#include "IrrlichtProfileBridge.h"
+
+#include <Profiler.h>
+#include <utf8.h>
+
+using namespace irr;
+
+IrrlichtProfileBridge::IrrlichtProfileBridge(IProfiler& profiler):profiler(profiler){
+	profiler.setListener(this);
+}
+
+IrrlichtProfileBridge::~IrrlichtProfileBridge(){
+	if(profiler.getListener()==this){
+		profiler.setListener(NULL);
+	}
+}
+
+const char* IrrlichtProfileBridge::getName(s32 id){
+	auto it = names.find(id);
+	if(it==names.end()){
+		std::string name;
+		const SProfileData* data = profiler.getProfileDataById(id);
+		if(data){
+			const SProfileData& group = profiler.getGroupData(data->getGroupIndex());
+			name = convertWStringToUtf8String(group.getName().c_str()) + "/" + convertWStringToUtf8String(data->getName().c_str());
+		}else{
+			name = std::string("irrlicht/") + std::to_string(id);
+		}
+		it = names.insert(std::make_pair(id, name)).first;
+	}
+	return it->second.c_str();//stays valid since the map entries are never removed
+}
+
+void IrrlichtProfileBridge::onProfileStart(s32 id){
+	startTimes[id] = getProfileTime();
+}
+
+void IrrlichtProfileBridge::onProfileStop(s32 id){
+	auto it = startTimes.find(id);
+	if(it!=startTimes.end()){
+		recordProfileEvent(getName(id), it->second, getProfileTime());
+	}
+}
@@ -0,0 +1,37 @@
+#ifndef IrrlichtProfileBridge_H_INCLUDED
+#define IrrlichtProfileBridge_H_INCLUDED
+
+#include <IProfiler.h>
+
+#include <map>
+#include <string>
+#include <cstdint>
+
+//! Forwards the engine internal profiling (IRR_PROFILE scopes e.g. of the scene manager render passes and the gui, requires _IRR_COMPILE_WITH_PROFILING_) into the Profiler of Common
+//! Event names are "<group>/<name>" of the irrlicht profile data.
+class IrrlichtProfileBridge : public irr::IProfileListener{
+
+	private:
+	
+	irr::IProfiler& profiler;
+	
+	std::map<irr::s32, std::string> names;
+	std::map<irr::s32, uint64_t> startTimes;
+	
+	const char* getName(irr::s32 id);
+	
+	public:
+	
+	//! registers itself as listener
+	IrrlichtProfileBridge(irr::IProfiler& profiler = irr::getProfiler());
+	
+	//! unregisters itself
+	~IrrlichtProfileBridge();
+	
+	void onProfileStart(irr::s32 id);
+	
+	void onProfileStop(irr::s32 id);
+
+};
+
+#endif
@@ -3,8 +3,10 @@
 #include <Threading.h>
 
 #include <limits>
-#include <list>
 #include <iostream>
+#include <thread>
+#include <algorithm>
+#include <functional>
 
 using namespace irr;
 using namespace core;
@@ -21,39 +23,103 @@ static inline T calcOverlapping(T a1, T a2, T b1, T b2){
 	return b1>a1?(a2-b1):(b2-a1);
 }
 
-//! A quadtree implementation for rectangles to quickly find the overlapping area
+//! A flat quadtree for rectangles (items) to quickly find the overlapping area. Nodes are pool allocated in a vector and reference each other by index.
+//! Items are updated incrementally. A node gets subdivided as soon as it contains a second item and stays subdivided, the items of a node are stored contiguously and sorted by id.
+//! Therefore the overlapping areas are summed in the same order as in a tree which is built from scratch by inserting the items in the order of their ids (same floating point results).
 class RectangleQuadTree{
 
 	private:
 	
-	typedef RectangleGradientDescent::RectanglePair RectanglePair;
 	typedef RectangleGradientDescent::Rectangle Rectangle;
 	
-	irr::core::rect<double> quadRect;
-	
-	std::list<rect<double>*> rects;//Rectangles in this list are the ones which are too big for the subQuads, except if there is only one rectangle in the tree (starting from this).
+	static const uint32_t NONE = 0xFFFFFFFF;
 	
 	enum SUBQUAD{UPPER_LEFT, LOWER_LEFT, LOWER_RIGHT, UPPER_RIGHT, SUBQUAD_COUNT};
 	
-	RectangleQuadTree* subQuads[SUBQUAD_COUNT];
+	struct NodeItem{
+		rect<double> r;
+		uint32_t id;
+	};
+	
+	struct Node{
+		rect<double> quadRect;
+		uint32_t firstChild;//NONE if not subdivided, the subquads are stored consecutively in SUBQUAD order
+		std::vector<NodeItem> items;//sorted by id; Items of a node are the ones which are too big for the subquads, except if there is only one item in the tree (starting from this node).
+	};
+	
+	std::vector<Node> nodes;
+	std::vector<uint32_t> itemNodes;//node index per item id, NONE if not inserted
+	
+	void subdivide(uint32_t n){
+		rect<double> quadRect = nodes[n].quadRect;
+		vector2d<double> center = quadRect.getCenter();
+		nodes[n].firstChild = nodes.size();
+		nodes.push_back(Node{rect<double>(quadRect.UpperLeftCorner, center), NONE, {}});//UPPER_LEFT
+		nodes.push_back(Node{rect<double>(quadRect.UpperLeftCorner.X, center.Y, center.X, quadRect.LowerRightCorner.Y), NONE, {}});//LOWER_LEFT
+		nodes.push_back(Node{rect<double>(center, quadRect.LowerRightCorner), NONE, {}});//LOWER_RIGHT
+		nodes.push_back(Node{rect<double>(center.X, quadRect.UpperLeftCorner.Y, quadRect.LowerRightCorner.X, center.Y), NONE, {}});//UPPER_RIGHT
+	}
+	
+	void link(uint32_t n, const NodeItem& item){
+		std::vector<NodeItem>& items = nodes[n].items;
+		auto it = items.end();
+		while(it!=items.begin() && (it-1)->id>item.id){--it;}
+		items.insert(it, item);
+		itemNodes[item.id] = n;
+	}
+	
+	//! returns the removed item
+	NodeItem unlink(uint32_t id){
+		std::vector<NodeItem>& items = nodes[itemNodes[id]].items;
+		auto it = items.begin();
+		while(it->id!=id){++it;}
+		NodeItem res = *it;
+		items.erase(it);
+		itemNodes[id] = NONE;
+		return res;
+	}
 	
 	//! O(logn) in case of evenly distributed rectangles
-	double calcOverlappingArea(rect<double>* r, const rect<double>& newRectangle){
+	void insert(uint32_t n, const NodeItem& item){
+		if(nodes[n].firstChild==NONE){
+			if(nodes[n].items.empty()){
+				link(n, item);//allow one rect without creating subQuads to avoid crazy trees in case of small rects in a huge overall space
+				return;
+			}
+			NodeItem prev = unlink(nodes[n].items[0].id);
+			subdivide(n);
+			insert(n, prev);
+		}
+		uint32_t firstChild = nodes[n].firstChild;
+		for(uint32_t i=0; i<SUBQUAD_COUNT; i++){
+			if(isRectInside(item.r, nodes[firstChild+i].quadRect)){
+				insert(firstChild+i, item);
+				return;
+			}
+		}
+		link(n, item);
+	}
+	
+	//! O(logn) in case of evenly distributed rectangles
+	double calcOverlappingArea(uint32_t n, uint32_t id, const rect<double>& newRectangle) const{
 		double area = 0.0;
-		for(auto it = rects.begin(); it != rects.end(); ++it){
-			rect<double>* other = *it;
-			if(other != r){
-				double overlapX = calcOverlapping(newRectangle.UpperLeftCorner.X, newRectangle.LowerRightCorner.X, other->UpperLeftCorner.X, other->LowerRightCorner.X);//second.
-				double overlapY = calcOverlapping(newRectangle.UpperLeftCorner.Y, newRectangle.LowerRightCorner.Y, other->UpperLeftCorner.Y, other->LowerRightCorner.Y);//second.
-				if(overlapX>0.0 && overlapY>0.0){
-					area += (overlapX*overlapY);
+		const Node& node = nodes[n];
+		for(const NodeItem& item : node.items){
+			if(item.id != id){
+				const rect<double>& other = item.r;
+				double overlapX = calcOverlapping(newRectangle.UpperLeftCorner.X, newRectangle.LowerRightCorner.X, other.UpperLeftCorner.X, other.LowerRightCorner.X);
+				if(overlapX>0.0){
+					double overlapY = calcOverlapping(newRectangle.UpperLeftCorner.Y, newRectangle.LowerRightCorner.Y, other.UpperLeftCorner.Y, other.LowerRightCorner.Y);
+					if(overlapY>0.0){
+						area += (overlapX*overlapY);
+					}
 				}
 			}
 		}
-		if(subQuads[0]!=NULL){
-			for(int i=0; i<SUBQUAD_COUNT; i++){
-				if(newRectangle.isRectCollided(subQuads[i]->quadRect)){
-					area += subQuads[i]->calcOverlappingArea(r, newRectangle);
+		if(node.firstChild!=NONE){
+			for(uint32_t i=0; i<SUBQUAD_COUNT; i++){
+				if(newRectangle.isRectCollided(nodes[node.firstChild+i].quadRect)){
+					area += calcOverlappingArea(node.firstChild+i, id, newRectangle);
 				}
 			}
 		}
@@ -62,53 +128,34 @@ class RectangleQuadTree{
 
 	public:
 	
-	RectangleQuadTree(irr::core::rect<double> quadRect):quadRect(quadRect){
-		for(int i=0; i<(int)SUBQUAD_COUNT; i++){subQuads[i] = NULL;}
+	RectangleQuadTree(irr::core::rect<double> quadRect, uint32_t itemCount):itemNodes(itemCount, NONE){
+		nodes.push_back(Node{quadRect, NONE, {}});
 	}
 	
-	~RectangleQuadTree(){
-		for(int i=0; i<(int)SUBQUAD_COUNT; i++){
-			if(subQuads[i]!=NULL){delete subQuads[i];}
-		}
+	uint32_t getItemCount() const{
+		return itemNodes.size();
 	}
 	
-	const irr::core::rect<double>& getQuadRect() const{
-		return quadRect;
+	uint32_t getNodeCount() const{
+		return nodes.size();
 	}
 	
-	//! O(logn) in case of evenly distributed rectangles
-	void insert(rect<double>* r){
-		if(subQuads[0]==NULL){
-			if(rects.empty()){
-				rects.push_back(r);//allow one rect without creating subQuads to avoid crazy trees in case of small rects in a huge overall space
-			}else{
-				vector2d<double> center = quadRect.getCenter();
-				subQuads[UPPER_LEFT] = new RectangleQuadTree(rect<double>(quadRect.UpperLeftCorner, center));
-				subQuads[LOWER_LEFT] = new RectangleQuadTree(rect<double>(quadRect.UpperLeftCorner.X, center.Y, center.X, quadRect.LowerRightCorner.Y));
-				subQuads[LOWER_RIGHT] = new RectangleQuadTree(rect<double>(center, quadRect.LowerRightCorner));
-				subQuads[UPPER_RIGHT] = new RectangleQuadTree(rect<double>(center.X, quadRect.UpperLeftCorner.Y, quadRect.LowerRightCorner.X, center.Y));
-				rect<double>* prev = rects.back();
-				rects.clear();
-				insert(prev);
-				insert(r);
+	//! inserts the item or moves it if the rectangle changed, O(logn) in case of evenly distributed rectangles
+	void update(uint32_t id, const rect<double>& r){
+		if(itemNodes[id]!=NONE){
+			for(const NodeItem& item : nodes[itemNodes[id]].items){
+				if(item.id==id && item.r==r){return;}
 			}
-		}else{
-			for(int i=0; i<SUBQUAD_COUNT; i++){
-				if(isRectInside(*r, subQuads[i]->quadRect)){//r->second
-					subQuads[i]->insert(r);
-					return;
-				}
-			}
-			rects.push_back(r);
+			unlink(id);
 		}
+		insert(0, NodeItem{r, id});
 	}
 	
-	//! O(logn) in case of evenly distributed rectangles
-	double calcOverlappingArea(RectanglePair* r, double deltaAngle){
-		Rectangle rCopy(r->first);
+	//! O(logn) in case of evenly distributed rectangles, thread safe if the tree is not modified concurrently
+	double calcOverlappingArea(uint32_t id, const Rectangle& r, double deltaAngle) const{
+		Rectangle rCopy(r);
 		rCopy.angle += deltaAngle;
-		rect<double> newRectangle = rCopy.convertToRect();
-		return calcOverlappingArea(&(r->second), newRectangle);//r
+		return calcOverlappingArea(0, id, rCopy.convertToRect());
 	}
 
 };
@@ -158,7 +205,12 @@ irr::core::rect<double> RectangleGradientDescent::Rectangle::convertToRect() con
 	return res;
 }
 
-RectangleGradientDescent::RectangleGradientDescent(irr::core::rect<double> availableSpace):availableSpace(availableSpace){}
+RectangleGradientDescent::RectangleGradientDescent(irr::core::rect<double> availableSpace):
+	availableSpace(availableSpace),
+	tree(NULL),
+	treeHasPivotRectangles(false),
+	treeNodeCountAfterBuild(0),
+	threadCount(std::max(std::thread::hardware_concurrency(), 1u)){}
 
 RectangleGradientDescent::~RectangleGradientDescent(){
 	clear();
@@ -179,38 +231,78 @@ void RectangleGradientDescent::clear(){
 		delete rectangles[i];
 	}
 	rectangles.clear();
+	delete tree;
+	tree = NULL;
+}
+
+void RectangleGradientDescent::setThreadCount(uint32_t threadCount){
+	this->threadCount = std::max(threadCount, (uint32_t)1);
+}
+
+uint32_t RectangleGradientDescent::getThreadCount() const{
+	return threadCount;
+}
+
+void RectangleGradientDescent::updateTree(bool avoidPivotRectangles){
+	uint32_t n = rectangles.size();
+	uint32_t itemCount = avoidPivotRectangles?2*n:n;
+	//Rebuild if rectangles have been added or too many empty subquads remain from moved rectangles
+	bool rebuild = tree==NULL || tree->getItemCount()!=itemCount || treeHasPivotRectangles!=avoidPivotRectangles || tree->getNodeCount()>2*treeNodeCountAfterBuild+64;
+	if(rebuild){
+		delete tree;
+		tree = new RectangleQuadTree(availableSpace, itemCount);
+		treeHasPivotRectangles = avoidPivotRectangles;
+	}
+	//Only changed rectangles get reinserted (the rectangles may also have been changed from outside since the last call):
+	for(uint32_t j=0; j<n; j++){
+		tree->update(j, rectangles[j]->second);
+	}
+	//Fixed rectangles (pivot rectangles) get ids after the moving ones
+	if(avoidPivotRectangles){
+		for(uint32_t j=0; j<n; j++){
+			Rectangle& r = rectangles[j]->first;
+			tree->update(n+j, rect<double>(r.pivot.X-0.5*r.rectWidth, r.pivot.Y-0.5*r.rectHeight, r.pivot.X+0.5*r.rectWidth, r.pivot.Y+0.5*r.rectHeight));
+		}
+	}
+	if(rebuild){
+		treeNodeCountAfterBuild = tree->getNodeCount();
+	}
+}
+
+void RectangleGradientDescent::calcGradient(std::vector<double>& gradient, uint32_t begin, uint32_t end, double deltaAngle) const{
+	double halfDeltaAngle = 0.5*deltaAngle;
+	for(uint32_t j=begin; j<end; j++){
+		const Rectangle& r = rectangles[j]->first;
+		gradient[j] = (tree->calcOverlappingArea(j, r, halfDeltaAngle)-tree->calcOverlappingArea(j, r, -halfDeltaAngle))/deltaAngle;//O(logn) (evenly distributed rectangles)
+	}
 }
 
 bool RectangleGradientDescent::optimize(uint32_t maxStepCount, double deltaAngle, double gradientEps, bool avoidPivotRectangles){
 	double halfDeltaAngle = 0.5*deltaAngle;
+	std::vector<double> gradient(rectangles.size(), 0.0);
+	uint32_t usedThreadCount = std::max(std::min(threadCount, (uint32_t)(rectangles.size()/minRectanglesPerThread)), (uint32_t)1);
+	std::vector<std::thread> threads;
+	threads.reserve(usedThreadCount-1);
 	for(uint32_t i=0; i<maxStepCount; i++){
-		//Insert into Quadtree:
-		RectangleQuadTree* tree = new RectangleQuadTree(availableSpace);
-		for(uint32_t j=0; j<rectangles.size(); j++){//O(nlogn) (evenly distributed rectangles)
-			tree->insert(&(rectangles[j]->second));
+		updateTree(avoidPivotRectangles);//O(mlogn) for m moved rectangles (evenly distributed rectangles)
+		//Calculate gradient (O(nlogn) (evenly distributed rectangles), the tree is read only meanwhile):
+		uint32_t chunkSize = gradient.size()/usedThreadCount;
+		for(uint32_t t=1; t<usedThreadCount; t++){
+			uint32_t begin = t*chunkSize;
+			uint32_t end = (t+1==usedThreadCount)?gradient.size():(begin+chunkSize);
+			threads.push_back(std::thread(&RectangleGradientDescent::calcGradient, this, std::ref(gradient), begin, end, deltaAngle));
 		}
-		//Calculate fixed rectangles (pivot rectangles) and insert them into the tree
-		std::list<rect<double>> pivotRectangles;//pointers must still live outside the if
-		if(avoidPivotRectangles){
-			for(uint32_t j=0; j<rectangles.size(); j++){
-				Rectangle& r = rectangles[j]->first;
-				pivotRectangles.push_back(rect<double>(r.pivot.X-0.5*r.rectWidth, r.pivot.Y-0.5*r.rectHeight, r.pivot.X+0.5*r.rectWidth, r.pivot.Y+0.5*r.rectHeight));
-				tree->insert(&(pivotRectangles.back()));
-			}
-		}
-		//Calculate gradient:
-		std::vector<double> gradient(rectangles.size(), 0.0);
+		calcGradient(gradient, 0, usedThreadCount>1?chunkSize:gradient.size(), deltaAngle);
+		for(std::thread& t : threads){t.join();}
+		threads.clear();
 		bool allSmallerEps = true;
-		for(uint32_t j=0; j<gradient.size(); j++){//O(nlogn) (evenly distributed rectangles)
-			RectanglePair* r = rectangles[j];
-			gradient[j] = (tree->calcOverlappingArea(r, halfDeltaAngle)-tree->calcOverlappingArea(r, -halfDeltaAngle))/deltaAngle;//O(logn) (evenly distributed rectangles)
+		for(uint32_t j=0; j<gradient.size(); j++){
 			allSmallerEps = allSmallerEps && fabs(gradient[j])<gradientEps;
 		}
-		//Follow (negative) gradient:
 		if(allSmallerEps){
-			delete tree;
 			return true;
 		}
+		//Follow (negative) gradient:
 		for(uint32_t j=0; j<gradient.size(); j++){//O(n) (evenly distributed rectangles)
 			if(fabs(gradient[j])>=gradientEps){
 				RectanglePair* r = rectangles[j];
@@ -218,7 +310,6 @@ bool RectangleGradientDescent::optimize(uint32_t maxStepCount, double deltaAngle
 				r->second = r->first.convertToRect();
 			}
 		}
-		delete tree;
 	}
 	return false;
 }
@@ -9,6 +9,8 @@
 #include <cstdint>
 #include <pthread.h>
 
+class RectangleQuadTree;
+
 //! Representation of a distribution of rectangles (e.g. used as labels) with a minimization of overlapping rectangles via gradient descent
 class RectangleGradientDescent{
 	
@@ -36,6 +38,21 @@ class RectangleGradientDescent{
 	
 	irr::core::rect<double> availableSpace;
 	
+	RectangleQuadTree* tree;//kept between steps and optimize calls, only changed rectangles are updated
+	bool treeHasPivotRectangles;
+	uint32_t treeNodeCountAfterBuild;
+	
+	uint32_t threadCount;
+	
+	//! minimum amount of rectangles per thread for the gradient calculation (overhead of starting threads)
+	static const uint32_t minRectanglesPerThread = 256;
+	
+	//! (re)builds the tree if required and updates the changed rectangles
+	void updateTree(bool avoidPivotRectangles);
+	
+	//! calculates the gradient for the rectangles [begin, end)
+	void calcGradient(std::vector<double>& gradient, uint32_t begin, uint32_t end, double deltaAngle) const;
+	
 	public:
 	
 	//! availableSpace defines the area on which the rects can be placed/moved.
@@ -50,11 +67,15 @@ class RectangleGradientDescent{
 	
 	void clear();
 	
+	//! amount of threads used for the gradient calculation (default: hardware concurrency), results do not depend on the thread count
+	void setThreadCount(uint32_t threadCount);
+	
+	uint32_t getThreadCount() const;
 	
 	//! there are some cases where gradient descent does not halt if there's no maximum amount of steps (e.g. all rects overlap each other exactly)
 	//! deltaAngle in rad, defines the step with and the delta for gradient calculation
 	//! gradientEps defines a threshold value for the gradient which is considere "good enough" (unit: overlapping area / angle)
-	//! O(maxStepCount*nlogn)
+	//! O(maxStepCount*nlogn), the quadtree is kept between steps and calls (only changed rectangles are updated)
 	//! returns true if finished (no significant gradient found)
 	bool optimize(uint32_t maxStepCount, double deltaAngle, double gradientEps, bool avoidPivotRectangles = true);
 	
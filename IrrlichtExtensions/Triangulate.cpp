@@ -3,6 +3,8 @@
 #include <string.h>
 #include <assert.h>
 
+#include <algorithm>
+
 #include "Triangulate.h"
 
 static const float EPSILON=0.0000000001f;
@@ -143,3 +145,369 @@ bool Triangulate::Process(const Vector2dVector &contour,Vector2dVector &result)
 
   return true;
 }
+
+using namespace irr;
+using namespace core;
+
+typedef vector2d<f64> Vector2d64;
+
+enum MONOTONE_VERTEX_TYPE{
+	MVT_REGULAR,
+	MVT_START,
+	MVT_END,
+	MVT_SPLIT,
+	MVT_MERGE
+};
+
+//! sweep order: the sweep line moves downwards, points with the same y are ordered from right to left
+static inline bool isBelow(const Vector2d64& a, const Vector2d64& b){
+	return a.Y<b.Y || (a.Y==b.Y && a.X<b.X);
+}
+
+//! true if p1, p2, p3 is a counter clockwise (left) turn
+static inline bool isConvex(const Vector2d64& p1, const Vector2d64& p2, const Vector2d64& p3){
+	return (p3.Y-p1.Y)*(p2.X-p1.X)-(p3.X-p1.X)*(p2.Y-p1.Y) > 0.0;
+}
+
+bool MonotoneTriangulator::Edge::operator<(const Edge& other) const{
+	if(other.p1.Y==other.p2.Y){
+		if(p1.Y==p2.Y){
+			return p1.Y<other.p1.Y;
+		}
+		return isConvex(p1, p2, other.p1);
+	}else if(p1.Y==p2.Y){
+		return !isConvex(other.p1, other.p2, p1);
+	}else if(p1.Y<other.p1.Y){
+		return !isConvex(other.p1, other.p2, p1);
+	}
+	return isConvex(p1, p2, other.p1);
+}
+
+void MonotoneTriangulator::clear(){
+	points.set_used(0);
+	contourStarts.set_used(0);
+}
+
+void MonotoneTriangulator::addContour(const array< vector2d<f32> >& contour){
+	contourStarts.push_back(points.size());
+	for(u32 i=0; i<contour.size(); i++){
+		points.push_back(contour[i]);
+	}
+}
+
+const array< vector2d<f32> >& MonotoneTriangulator::getPoints() const{
+	return points;
+}
+
+//! The copy of index1 continues with the old next vertex of index1, the copy of index2 with the old previous vertex of index2.
+//! Therefore index1 keeps its incoming edge and the copy of index1 receives the outgoing edge (and its sweep line status).
+void MonotoneTriangulator::addDiagonal(s32 index1, s32 index2){
+	s32 copy1 = vertices.size();
+	s32 copy2 = copy1+1;
+	Vertex v1 = vertices[index1];
+	Vertex v2 = vertices[index2];
+	v1.prev = copy2;
+	v2.next = copy1;
+	vertices.push_back(v1);
+	vertices.push_back(v2);
+	vertices[v1.next].prev = copy1;
+	vertices[v2.prev].next = copy2;
+	vertices[index1].next = index2;
+	vertices[index2].prev = index1;
+	types.push_back(types[index1]);
+	types.push_back(types[index2]);
+	helpers.push_back(helpers[index1]);
+	helpers.push_back(helpers[index2]);
+	edgeIterators.push_back(edgeIterators[index1]);
+	edgeIterators.push_back(edges.end());
+	edgeIterators[index1] = edges.end();
+	if(edgeIterators[copy1]!=edges.end()){
+		edgeIterators[copy1]->index = copy1;
+	}
+}
+
+bool MonotoneTriangulator::partition(){
+	vertices.clear();
+	ranges.clear();
+	//remove duplicated points and degenerated contours
+	for(u32 c=0; c<contourStarts.size(); c++){
+		u32 start = contourStarts[c];
+		u32 end = c+1<contourStarts.size()?contourStarts[c+1]:points.size();
+		s32 first = vertices.size();
+		for(u32 i=start; i<end; i++){
+			Vertex v;
+			v.p.set(points[i].X, points[i].Y);
+			if((s32)vertices.size()>first && vertices.back().p==v.p){continue;}
+			v.pointIndex = i;
+			v.prev = v.next = -1;
+			vertices.push_back(v);
+		}
+		while((s32)vertices.size()-first>1 && vertices.back().p==vertices[first].p){
+			vertices.pop_back();
+		}
+		f64 area = 0.0;
+		for(s32 i=first, j=vertices.size()-1; i<(s32)vertices.size(); j=i++){
+			area += vertices[j].p.X*vertices[i].p.Y - vertices[i].p.X*vertices[j].p.Y;
+		}
+		if((s32)vertices.size()-first<3 || area==0.0){
+			vertices.resize(first);
+		}else{
+			ranges.push_back(first);
+			ranges.push_back(vertices.size());
+		}
+	}
+	//orient outer contours counter clockwise and holes clockwise (interior always left of the edges)
+	for(u32 r=0; r<ranges.size(); r+=2){
+		s32 first = ranges[r], end = ranges[r+1];
+		const Vector2d64& p = vertices[first].p;
+		u32 depth = 0;
+		for(u32 r2=0; r2<ranges.size(); r2+=2){
+			if(r2==r){continue;}
+			bool inside = false;
+			for(s32 i=ranges[r2], j=ranges[r2+1]-1; i<ranges[r2+1]; j=i++){
+				const Vector2d64& pi = vertices[i].p;
+				const Vector2d64& pj = vertices[j].p;
+				if((pi.Y>p.Y)!=(pj.Y>p.Y) && p.X<(pj.X-pi.X)*(p.Y-pi.Y)/(pj.Y-pi.Y)+pi.X){
+					inside = !inside;
+				}
+			}
+			depth += inside?1:0;
+		}
+		f64 area = 0.0;
+		for(s32 i=first, j=end-1; i<end; j=i++){
+			area += vertices[j].p.X*vertices[i].p.Y - vertices[i].p.X*vertices[j].p.Y;
+		}
+		bool reverse = (area>0.0)!=(depth%2==0);
+		for(s32 i=first; i<end; i++){
+			s32 prev = i==first?(end-1):(i-1);
+			s32 next = i+1==end?first:(i+1);
+			vertices[i].prev = reverse?next:prev;
+			vertices[i].next = reverse?prev:next;
+		}
+	}
+	s32 n = vertices.size();
+	vertices.reserve(3*n);//diagonals add two vertices each, at most n diagonals
+	types.resize(n);
+	for(s32 i=0; i<n; i++){
+		const Vector2d64& p = vertices[i].p;
+		const Vector2d64& prev = vertices[vertices[i].prev].p;
+		const Vector2d64& next = vertices[vertices[i].next].p;
+		if(isBelow(prev, p) && isBelow(next, p)){
+			types[i] = isConvex(next, prev, p)?MVT_START:MVT_SPLIT;
+		}else if(isBelow(p, prev) && isBelow(p, next)){
+			types[i] = isConvex(next, prev, p)?MVT_END:MVT_MERGE;
+		}else{
+			types[i] = MVT_REGULAR;
+		}
+	}
+	sorted.resize(n);
+	for(s32 i=0; i<n; i++){sorted[i] = i;}
+	std::sort(sorted.begin(), sorted.end(), [this](s32 a, s32 b){return isBelow(vertices[b].p, vertices[a].p);});
+	edges.clear();
+	edgeIterators.assign(n, edges.end());
+	helpers.assign(n, -1);
+	Edge edge;
+	EdgeSet::iterator it;
+	for(s32 i=0; i<n; i++){
+		s32 v = sorted[i];
+		s32 v2 = v;//copy of v which receives further diagonals from below
+		s32 prev = vertices[v].prev;
+		edge.p1 = edge.p2 = vertices[v].p;
+		switch(types[v]){
+			case MVT_START:
+				edge.p2 = vertices[vertices[v].next].p;
+				edge.index = v;
+				edgeIterators[v] = edges.insert(edge).first;
+				helpers[v] = v;
+				break;
+			case MVT_END:
+				if(edgeIterators[prev]==edges.end()){return false;}
+				if(types[helpers[prev]]==MVT_MERGE){
+					addDiagonal(v, helpers[prev]);
+				}
+				edges.erase(edgeIterators[prev]);
+				edgeIterators[prev] = edges.end();
+				break;
+			case MVT_SPLIT:
+				it = edges.lower_bound(edge);
+				if(it==edges.begin()){return false;}
+				--it;
+				addDiagonal(v, helpers[it->index]);
+				v2 = vertices.size()-2;
+				helpers[it->index] = v;
+				edge.p2 = vertices[vertices[v2].next].p;
+				edge.index = v2;
+				edgeIterators[v2] = edges.insert(edge).first;
+				helpers[v2] = v2;
+				break;
+			case MVT_MERGE:
+				if(edgeIterators[prev]==edges.end()){return false;}
+				if(types[helpers[prev]]==MVT_MERGE){
+					addDiagonal(v, helpers[prev]);
+					v2 = vertices.size()-2;
+				}
+				edges.erase(edgeIterators[prev]);
+				edgeIterators[prev] = edges.end();
+				it = edges.lower_bound(edge);
+				if(it==edges.begin()){return false;}
+				--it;
+				if(types[helpers[it->index]]==MVT_MERGE){
+					addDiagonal(v2, helpers[it->index]);
+				}
+				helpers[it->index] = v2;
+				break;
+			default:
+				if(isBelow(vertices[v].p, vertices[prev].p)){//interior right of v
+					if(edgeIterators[prev]==edges.end()){return false;}
+					if(types[helpers[prev]]==MVT_MERGE){
+						addDiagonal(v, helpers[prev]);
+						v2 = vertices.size()-2;
+					}
+					edges.erase(edgeIterators[prev]);
+					edgeIterators[prev] = edges.end();
+					edge.p2 = vertices[vertices[v2].next].p;
+					edge.index = v2;
+					edgeIterators[v2] = edges.insert(edge).first;
+					helpers[v2] = v2;
+				}else{
+					it = edges.lower_bound(edge);
+					if(it==edges.begin()){return false;}
+					--it;
+					if(types[helpers[it->index]]==MVT_MERGE){
+						addDiagonal(v, helpers[it->index]);
+					}
+					helpers[it->index] = v;
+				}
+				break;
+		}
+	}
+	return true;
+}
+
+void MonotoneTriangulator::triangulateMonotone(array<u32>& indices){
+	s32 n = monotone.size();
+	if(n<3){return;}
+	const Vertex* v = &(vertices[0]);
+	if(n==3){
+		indices.push_back(v[monotone[0]].pointIndex);
+		indices.push_back(v[monotone[1]].pointIndex);
+		indices.push_back(v[monotone[2]].pointIndex);
+		return;
+	}
+	s32 top = 0, bottom = 0;
+	for(s32 i=1; i<n; i++){
+		if(isBelow(v[monotone[i]].p, v[monotone[bottom]].p)){bottom = i;}
+		if(isBelow(v[monotone[top]].p, v[monotone[i]].p)){top = i;}
+	}
+	//merge the left (1) and right (-1) chain from top to bottom
+	monotoneSorted.resize(n);
+	chains.resize(n);
+	monotoneSorted[0] = top;
+	chains[top] = 0;
+	s32 left = (top+1)%n;
+	s32 right = (top+n-1)%n;
+	s32 i = 1;
+	for(; i<n-1; i++){
+		if(left!=bottom && (right==bottom || !isBelow(v[monotone[left]].p, v[monotone[right]].p))){
+			monotoneSorted[i] = left;
+			chains[left] = 1;
+			left = (left+1)%n;
+		}else{
+			monotoneSorted[i] = right;
+			chains[right] = -1;
+			right = (right+n-1)%n;
+		}
+	}
+	monotoneSorted[i] = bottom;
+	chains[bottom] = 0;
+	#define MONOTONE_TRIANGLE(A, B, C) {indices.push_back(v[monotone[A]].pointIndex); indices.push_back(v[monotone[B]].pointIndex); indices.push_back(v[monotone[C]].pointIndex);}
+	stack.resize(n);
+	stack[0] = monotoneSorted[0];
+	stack[1] = monotoneSorted[1];
+	s32 stackSize = 2;
+	for(i=2; i<n-1; i++){
+		s32 cur = monotoneSorted[i];
+		if(chains[cur]!=chains[stack[stackSize-1]]){
+			for(s32 j=0; j<stackSize-1; j++){
+				if(chains[cur]==1){
+					MONOTONE_TRIANGLE(stack[j+1], stack[j], cur)
+				}else{
+					MONOTONE_TRIANGLE(stack[j], stack[j+1], cur)
+				}
+			}
+			stack[0] = monotoneSorted[i-1];
+			stack[1] = cur;
+			stackSize = 2;
+		}else{
+			stackSize--;
+			while(stackSize>0){
+				const Vector2d64& pCur = v[monotone[cur]].p;
+				const Vector2d64& pLast = v[monotone[stack[stackSize]]].p;
+				const Vector2d64& pBefore = v[monotone[stack[stackSize-1]]].p;
+				if(chains[cur]==1 && isConvex(pCur, pBefore, pLast)){
+					MONOTONE_TRIANGLE(cur, stack[stackSize-1], stack[stackSize])
+				}else if(chains[cur]==-1 && isConvex(pCur, pLast, pBefore)){
+					MONOTONE_TRIANGLE(cur, stack[stackSize], stack[stackSize-1])
+				}else{
+					break;
+				}
+				stackSize--;
+			}
+			stackSize++;
+			stack[stackSize] = cur;
+			stackSize++;
+		}
+	}
+	s32 cur = monotoneSorted[i];
+	for(s32 j=0; j<stackSize-1; j++){
+		if(chains[stack[j+1]]==1){
+			MONOTONE_TRIANGLE(stack[j], stack[j+1], cur)
+		}else{
+			MONOTONE_TRIANGLE(stack[j+1], stack[j], cur)
+		}
+	}
+	#undef MONOTONE_TRIANGLE
+}
+
+bool MonotoneTriangulator::triangulate(array<u32>& indices){
+	u32 oldSize = indices.size();
+	if(!partition()){
+		indices.set_used(oldSize);
+		return false;
+	}
+	used.assign(vertices.size(), false);
+	for(u32 i=0; i<vertices.size(); i++){
+		if(used[i]){continue;}
+		monotone.clear();
+		s32 v = i;
+		do{
+			if(used[v]){//broken links (invalid polygon)
+				indices.set_used(oldSize);
+				return false;
+			}
+			used[v] = true;
+			monotone.push_back(v);
+			v = vertices[v].next;
+		}while(v!=(s32)i);
+		triangulateMonotone(indices);
+	}
+	return true;
+}
+
+bool MonotoneTriangulator::triangulate(array< vector2d<f32> >& result){
+	tmpIndices.set_used(0);
+	if(!triangulate(tmpIndices)){
+		return false;
+	}
+	result.reallocate(result.size()+tmpIndices.size());
+	for(u32 i=0; i<tmpIndices.size(); i++){
+		result.push_back(points[tmpIndices[i]]);
+	}
+	return true;
+}
+
+bool MonotoneTriangulator::process(const array< vector2d<f32> >& contour, array< vector2d<f32> >& result){
+	clear();
+	addContour(contour);
+	return triangulate(result);
+}
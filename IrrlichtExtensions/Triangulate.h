@@ -6,6 +6,9 @@
 #include <irrArray.h>
 #include <vector2d.h>
 
+#include <set>
+#include <vector>
+
 // a polygon/contour and a series of triangles.
 typedef irr::core::array< irr::core::vector2d<irr::f32> > Vector2dVector;
 
@@ -16,6 +19,7 @@ public:
 
   // triangulate a contour/polygon, places results in array
   // as series of triangles. (array allocated size must be large enough)
+  // ear clipping with O(n^3) worst case, see MonotoneTriangulator for large polygons
   static bool Process(const Vector2dVector &contour,
                       Vector2dVector &result);
 
@@ -35,5 +39,75 @@ private:
 
 };
 
+//! O(n log n) triangulation of polygons with holes: a sweep line partitions the polygon into y-monotone polygons which are triangulated in linear time.
+//! The contours are interpreted with the even-odd rule (their orientation does not matter). They must not intersect each other or themselves.
+//! Duplicated consecutive points and collinear points are allowed.
+//! The internal buffers are reused, therefore an instance should be kept if polygons are triangulated repeatedly.
+class MonotoneTriangulator{
+
+	private:
+	
+	struct Vertex{
+		irr::core::vector2d<irr::f64> p;
+		irr::u32 pointIndex;//index in points
+		irr::s32 prev, next;
+	};
+	
+	//! edge from p1 (upper) to p2 (lower) in the sweep line status
+	struct Edge{
+		irr::core::vector2d<irr::f64> p1, p2;
+		mutable irr::s32 index;//vertex where the edge starts
+		
+		//! true if this edge is left of the other edge
+		bool operator<(const Edge& other) const;
+	};
+	
+	typedef std::set<Edge> EdgeSet;
+	
+	irr::core::array< irr::core::vector2d<irr::f32> > points;//all contour points in order of addition
+	irr::core::array<irr::u32> contourStarts;
+	
+	std::vector<Vertex> vertices;//vertices of the contours followed by copies created by diagonals
+	std::vector<irr::s32> ranges;//begin and end of each valid contour in vertices
+	std::vector<irr::u8> types;
+	std::vector<irr::s32> helpers;
+	std::vector<irr::s32> sorted;
+	std::vector<EdgeSet::iterator> edgeIterators;
+	EdgeSet edges;
+	std::vector<bool> used;
+	std::vector<irr::s32> monotone;
+	std::vector<irr::s32> monotoneSorted;
+	std::vector<irr::s8> chains;
+	std::vector<irr::s32> stack;
+	
+	void addDiagonal(irr::s32 index1, irr::s32 index2);
+	
+	bool partition();
+	
+	void triangulateMonotone(irr::core::array<irr::u32>& indices);
+	
+	irr::core::array<irr::u32> tmpIndices;
+	
+	public:
+	
+	//! removes all contours
+	void clear();
+	
+	//! adds the outer contour or a hole
+	void addContour(const irr::core::array< irr::core::vector2d<irr::f32> >& contour);
+	
+	//! all points of the added contours in order of addition
+	const irr::core::array< irr::core::vector2d<irr::f32> >& getPoints() const;
+	
+	//! appends the triangles of the added contours as indices of getPoints(), returns false if the polygon is invalid
+	bool triangulate(irr::core::array<irr::u32>& indices);
+	
+	//! appends the triangles of the added contours as series of points, returns false if the polygon is invalid
+	bool triangulate(irr::core::array< irr::core::vector2d<irr::f32> >& result);
+	
+	//! like Triangulate::Process: appends the triangles of a polygon without holes to result
+	bool process(const irr::core::array< irr::core::vector2d<irr::f32> >& contour, irr::core::array< irr::core::vector2d<irr::f32> >& result);
+
+};
 
 #endif
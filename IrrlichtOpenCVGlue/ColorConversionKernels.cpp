@@ -0,0 +1,346 @@
+#include "ColorConversionKernels.h"
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+#define COLOR_CONVERSION_USE_SSE2
+#include <emmintrin.h>
+#if defined(__SSSE3__)
+#define COLOR_CONVERSION_USE_SSSE3
+#include <tmmintrin.h>
+#endif
+#elif defined(__ARM_NEON)
+#define COLOR_CONVERSION_USE_NEON
+#include <arm_neon.h>
+#endif
+
+using namespace irr;
+using namespace video;
+
+static inline uint8_t toGray(uint32_t r, uint32_t g, uint32_t b){
+	return (30*r + 59*g + 11*b)/100;
+}
+
+static inline uint32_t readA8R8G8B8(const uint8_t* p){
+	uint32_t c;
+	memcpy(&c, p, 4);
+	return c;
+}
+
+static inline uint16_t readR5G6B5(const uint8_t* p){
+	uint16_t c;
+	memcpy(&c, p, 2);
+	return c;
+}
+
+#if defined(COLOR_CONVERSION_USE_SSE2)
+
+//! r, g, b in 16 bit lanes, returns the gray values in 16 bit lanes
+static inline __m128i calcGray16(__m128i r, __m128i g, __m128i b){
+	__m128i sum = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(r, _mm_set1_epi16(30)), _mm_mullo_epi16(g, _mm_set1_epi16(59))), _mm_mullo_epi16(b, _mm_set1_epi16(11)));
+	return _mm_srli_epi16(_mm_mulhi_epu16(sum, _mm_set1_epi16(5243)), 3);//(sum*5243)>>19 == sum/100 for sum<=25500
+}
+
+//! 8 pixels to 16 bit lanes
+static inline void unpackA8R8G8B8(__m128i p0, __m128i p1, __m128i& r, __m128i& g, __m128i& b){
+	__m128i mask = _mm_set1_epi32(0xFF);
+	b = _mm_packs_epi32(_mm_and_si128(p0, mask), _mm_and_si128(p1, mask));
+	g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 8), mask), _mm_and_si128(_mm_srli_epi32(p1, 8), mask));
+	r = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 16), mask), _mm_and_si128(_mm_srli_epi32(p1, 16), mask));
+}
+
+//! 8 pixels to 16 bit lanes (same expansion as R5G6B5toA8R8G8B8)
+static inline void unpackR5G6B5(__m128i p, __m128i& r, __m128i& g, __m128i& b){
+	r = _mm_srli_epi16(_mm_and_si128(p, _mm_set1_epi16((short)0xF800)), 8);
+	g = _mm_srli_epi16(_mm_and_si128(p, _mm_set1_epi16(0x07E0)), 3);
+	b = _mm_slli_epi16(_mm_and_si128(p, _mm_set1_epi16(0x001F)), 3);
+}
+
+#endif
+
+#if defined(COLOR_CONVERSION_USE_SSSE3)
+
+//! shuffle mask which gathers the given channel of 16 pixels with bytesPerPixel from the 16 byte block with the given index
+static inline __m128i createGatherMask(int32_t bytesPerPixel, int32_t channel, int32_t block){
+	int8_t m[16];
+	for(int32_t j=0; j<16; j++){
+		int32_t index = bytesPerPixel*j+channel-16*block;
+		m[j] = (index>=0 && index<16)?index:-128;
+	}
+	return _mm_loadu_si128((const __m128i*)m);
+}
+
+//! shuffle mask which scatters the values of the given channel of 16 pixels into the 16 byte block with the given index of interleaved 3 byte pixels
+static inline __m128i createScatterMask(int32_t channel, int32_t block){
+	int8_t m[16];
+	for(int32_t j=0; j<16; j++){
+		int32_t n = 16*block+j;
+		m[j] = (n%3==channel)?(n/3):-128;
+	}
+	return _mm_loadu_si128((const __m128i*)m);
+}
+
+//! 16 pixels of interleaved channels (3 or 4 bytes) to one register per channel
+template <int32_t TBytesPerPixel>
+class Deinterleaver{
+
+	private:
+
+	__m128i masks[3][TBytesPerPixel];
+
+	public:
+
+	Deinterleaver(){
+		for(int32_t c=0; c<3; c++){
+			for(int32_t k=0; k<TBytesPerPixel; k++){masks[c][k] = createGatherMask(TBytesPerPixel, c, k);}
+		}
+	}
+
+	inline __m128i get(const __m128i* blocks, int32_t channel) const{
+		__m128i res = _mm_shuffle_epi8(blocks[0], masks[channel][0]);
+		for(int32_t k=1; k<TBytesPerPixel; k++){res = _mm_or_si128(res, _mm_shuffle_epi8(blocks[k], masks[channel][k]));}
+		return res;
+	}
+
+};
+
+//! one register per channel (16 pixels) to interleaved 3 byte pixels
+class Interleaver{
+
+	private:
+
+	__m128i masks[3][3];
+
+	public:
+
+	Interleaver(){
+		for(int32_t c=0; c<3; c++){
+			for(int32_t k=0; k<3; k++){masks[c][k] = createScatterMask(c, k);}
+		}
+	}
+
+	inline void store(uint8_t* dst, __m128i c0, __m128i c1, __m128i c2) const{
+		for(int32_t k=0; k<3; k++){
+			__m128i block = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(c0, masks[0][k]), _mm_shuffle_epi8(c1, masks[1][k])), _mm_shuffle_epi8(c2, masks[2][k]));
+			_mm_storeu_si128((__m128i*)(dst+16*k), block);
+		}
+	}
+
+};
+
+#endif
+
+#if defined(COLOR_CONVERSION_USE_NEON)
+
+//! returns the gray values of 16 pixels
+static inline uint8x16_t calcGray8(uint8x16_t r, uint8x16_t g, uint8x16_t b){
+	uint16x8_t sumLow = vmlal_u8(vmlal_u8(vmull_u8(vget_low_u8(r), vdup_n_u8(30)), vget_low_u8(g), vdup_n_u8(59)), vget_low_u8(b), vdup_n_u8(11));
+	uint16x8_t sumHigh = vmlal_u8(vmlal_u8(vmull_u8(vget_high_u8(r), vdup_n_u8(30)), vget_high_u8(g), vdup_n_u8(59)), vget_high_u8(b), vdup_n_u8(11));
+	uint16x8_t grayLow = vshrq_n_u16(vcombine_u16(vshrn_n_u32(vmull_u16(vget_low_u16(sumLow), vdup_n_u16(5243)), 16), vshrn_n_u32(vmull_u16(vget_high_u16(sumLow), vdup_n_u16(5243)), 16)), 3);
+	uint16x8_t grayHigh = vshrq_n_u16(vcombine_u16(vshrn_n_u32(vmull_u16(vget_low_u16(sumHigh), vdup_n_u16(5243)), 16), vshrn_n_u32(vmull_u16(vget_high_u16(sumHigh), vdup_n_u16(5243)), 16)), 3);
+	return vcombine_u8(vmovn_u16(grayLow), vmovn_u16(grayHigh));
+}
+
+//! 16 pixels to one register per channel
+static inline void unpackR5G6B5(const uint8_t* src, uint8x16_t& r, uint8x16_t& g, uint8x16_t& b){
+	uint16x8_t p0 = vld1q_u16((const uint16_t*)src);
+	uint16x8_t p1 = vld1q_u16((const uint16_t*)(src+16));
+	r = vcombine_u8(vshrn_n_u16(p0, 8), vshrn_n_u16(p1, 8));
+	r = vandq_u8(r, vdupq_n_u8(0xF8));
+	g = vcombine_u8(vmovn_u16(vshrq_n_u16(vandq_u16(p0, vdupq_n_u16(0x07E0)), 3)), vmovn_u16(vshrq_n_u16(vandq_u16(p1, vdupq_n_u16(0x07E0)), 3)));
+	b = vcombine_u8(vmovn_u16(vshlq_n_u16(vandq_u16(p0, vdupq_n_u16(0x001F)), 3)), vmovn_u16(vshlq_n_u16(vandq_u16(p1, vdupq_n_u16(0x001F)), 3)));
+}
+
+#endif
+
+static void convertA8R8G8B8ToGray(const uint8_t* src, uint8_t* dst, uint32_t width, bool inverse){
+	uint32_t i = 0;
+	#if defined(COLOR_CONVERSION_USE_SSE2)
+	__m128i invertMask = inverse?_mm_set1_epi8((char)0xFF):_mm_setzero_si128();
+	for(; i+16<=width; i+=16){
+		const __m128i* s = (const __m128i*)(src+4*i);
+		__m128i r0, g0, b0, r1, g1, b1;
+		unpackA8R8G8B8(_mm_loadu_si128(s), _mm_loadu_si128(s+1), r0, g0, b0);
+		unpackA8R8G8B8(_mm_loadu_si128(s+2), _mm_loadu_si128(s+3), r1, g1, b1);
+		__m128i gray = _mm_packus_epi16(calcGray16(r0, g0, b0), calcGray16(r1, g1, b1));
+		_mm_storeu_si128((__m128i*)(dst+i), _mm_xor_si128(gray, invertMask));
+	}
+	#elif defined(COLOR_CONVERSION_USE_NEON)
+	for(; i+16<=width; i+=16){
+		uint8x16x4_t p = vld4q_u8(src+4*i);//B, G, R, A
+		uint8x16_t gray = calcGray8(p.val[2], p.val[1], p.val[0]);
+		vst1q_u8(dst+i, inverse?vmvnq_u8(gray):gray);
+	}
+	#endif
+	uint8_t invertMaskScalar = inverse?0xFF:0x00;
+	for(; i<width; i++){
+		uint32_t c = readA8R8G8B8(src+4*i);
+		dst[i] = toGray((c>>16)&0xFF, (c>>8)&0xFF, c&0xFF) ^ invertMaskScalar;
+	}
+}
+
+static void convertR8G8B8ToGray(const uint8_t* src, uint8_t* dst, uint32_t width, bool inverse){
+	uint32_t i = 0;
+	#if defined(COLOR_CONVERSION_USE_SSSE3)
+	static const Deinterleaver<3> deinterleaver;
+	__m128i invertMask = inverse?_mm_set1_epi8((char)0xFF):_mm_setzero_si128();
+	__m128i zero = _mm_setzero_si128();
+	for(; i+16<=width; i+=16){
+		const __m128i* s = (const __m128i*)(src+3*i);
+		__m128i blocks[3] = {_mm_loadu_si128(s), _mm_loadu_si128(s+1), _mm_loadu_si128(s+2)};
+		__m128i r = deinterleaver.get(blocks, 0);
+		__m128i g = deinterleaver.get(blocks, 1);
+		__m128i b = deinterleaver.get(blocks, 2);
+		__m128i grayLow = calcGray16(_mm_unpacklo_epi8(r, zero), _mm_unpacklo_epi8(g, zero), _mm_unpacklo_epi8(b, zero));
+		__m128i grayHigh = calcGray16(_mm_unpackhi_epi8(r, zero), _mm_unpackhi_epi8(g, zero), _mm_unpackhi_epi8(b, zero));
+		_mm_storeu_si128((__m128i*)(dst+i), _mm_xor_si128(_mm_packus_epi16(grayLow, grayHigh), invertMask));
+	}
+	#elif defined(COLOR_CONVERSION_USE_NEON)
+	for(; i+16<=width; i+=16){
+		uint8x16x3_t p = vld3q_u8(src+3*i);//R, G, B
+		uint8x16_t gray = calcGray8(p.val[0], p.val[1], p.val[2]);
+		vst1q_u8(dst+i, inverse?vmvnq_u8(gray):gray);
+	}
+	#endif
+	uint8_t invertMaskScalar = inverse?0xFF:0x00;
+	for(; i<width; i++){
+		const uint8_t* p = src+3*i;
+		dst[i] = toGray(p[0], p[1], p[2]) ^ invertMaskScalar;
+	}
+}
+
+static void convertR5G6B5ToGray(const uint8_t* src, uint8_t* dst, uint32_t width, bool inverse){
+	uint32_t i = 0;
+	#if defined(COLOR_CONVERSION_USE_SSE2)
+	__m128i invertMask = inverse?_mm_set1_epi8((char)0xFF):_mm_setzero_si128();
+	for(; i+16<=width; i+=16){
+		const __m128i* s = (const __m128i*)(src+2*i);
+		__m128i r0, g0, b0, r1, g1, b1;
+		unpackR5G6B5(_mm_loadu_si128(s), r0, g0, b0);
+		unpackR5G6B5(_mm_loadu_si128(s+1), r1, g1, b1);
+		__m128i gray = _mm_packus_epi16(calcGray16(r0, g0, b0), calcGray16(r1, g1, b1));
+		_mm_storeu_si128((__m128i*)(dst+i), _mm_xor_si128(gray, invertMask));
+	}
+	#elif defined(COLOR_CONVERSION_USE_NEON)
+	for(; i+16<=width; i+=16){
+		uint8x16_t r, g, b;
+		unpackR5G6B5(src+2*i, r, g, b);
+		uint8x16_t gray = calcGray8(r, g, b);
+		vst1q_u8(dst+i, inverse?vmvnq_u8(gray):gray);
+	}
+	#endif
+	uint8_t invertMaskScalar = inverse?0xFF:0x00;
+	for(; i<width; i++){
+		uint32_t c = R5G6B5toA8R8G8B8(readR5G6B5(src+2*i));
+		dst[i] = toGray((c>>16)&0xFF, (c>>8)&0xFF, c&0xFF) ^ invertMaskScalar;
+	}
+}
+
+static void convertA8R8G8B8ToBGR(const uint8_t* src, uint8_t* dst, uint32_t width){
+	uint32_t i = 0;
+	#if defined(COLOR_CONVERSION_USE_SSSE3)
+	static const Deinterleaver<4> deinterleaver;
+	static const Interleaver interleaver;
+	for(; i+16<=width; i+=16){
+		const __m128i* s = (const __m128i*)(src+4*i);
+		__m128i blocks[4] = {_mm_loadu_si128(s), _mm_loadu_si128(s+1), _mm_loadu_si128(s+2), _mm_loadu_si128(s+3)};
+		interleaver.store(dst+3*i, deinterleaver.get(blocks, 0), deinterleaver.get(blocks, 1), deinterleaver.get(blocks, 2));
+	}
+	#elif defined(COLOR_CONVERSION_USE_NEON)
+	for(; i+16<=width; i+=16){
+		uint8x16x4_t p = vld4q_u8(src+4*i);//B, G, R, A
+		uint8x16x3_t out = {{p.val[0], p.val[1], p.val[2]}};
+		vst3q_u8(dst+3*i, out);
+	}
+	#endif
+	for(; i<width; i++){
+		uint32_t c = readA8R8G8B8(src+4*i);
+		uint8_t* d = dst+3*i;
+		d[0] = c&0xFF;
+		d[1] = (c>>8)&0xFF;
+		d[2] = (c>>16)&0xFF;
+	}
+}
+
+static void convertR8G8B8ToBGR(const uint8_t* src, uint8_t* dst, uint32_t width){
+	uint32_t i = 0;
+	#if defined(COLOR_CONVERSION_USE_SSSE3)
+	static const Deinterleaver<3> deinterleaver;
+	static const Interleaver interleaver;
+	for(; i+16<=width; i+=16){
+		const __m128i* s = (const __m128i*)(src+3*i);
+		__m128i blocks[3] = {_mm_loadu_si128(s), _mm_loadu_si128(s+1), _mm_loadu_si128(s+2)};
+		interleaver.store(dst+3*i, deinterleaver.get(blocks, 2), deinterleaver.get(blocks, 1), deinterleaver.get(blocks, 0));
+	}
+	#elif defined(COLOR_CONVERSION_USE_NEON)
+	for(; i+16<=width; i+=16){
+		uint8x16x3_t p = vld3q_u8(src+3*i);//R, G, B
+		uint8x16x3_t out = {{p.val[2], p.val[1], p.val[0]}};
+		vst3q_u8(dst+3*i, out);
+	}
+	#endif
+	for(; i<width; i++){
+		const uint8_t* p = src+3*i;
+		uint8_t* d = dst+3*i;
+		d[0] = p[2];
+		d[1] = p[1];
+		d[2] = p[0];
+	}
+}
+
+static void convertR5G6B5ToBGR(const uint8_t* src, uint8_t* dst, uint32_t width){
+	uint32_t i = 0;
+	#if defined(COLOR_CONVERSION_USE_SSSE3)
+	static const Interleaver interleaver;
+	for(; i+16<=width; i+=16){
+		const __m128i* s = (const __m128i*)(src+2*i);
+		__m128i r0, g0, b0, r1, g1, b1;
+		unpackR5G6B5(_mm_loadu_si128(s), r0, g0, b0);
+		unpackR5G6B5(_mm_loadu_si128(s+1), r1, g1, b1);
+		interleaver.store(dst+3*i, _mm_packus_epi16(b0, b1), _mm_packus_epi16(g0, g1), _mm_packus_epi16(r0, r1));
+	}
+	#elif defined(COLOR_CONVERSION_USE_NEON)
+	for(; i+16<=width; i+=16){
+		uint8x16x3_t out;
+		unpackR5G6B5(src+2*i, out.val[2], out.val[1], out.val[0]);
+		vst3q_u8(dst+3*i, out);
+	}
+	#endif
+	for(; i<width; i++){
+		uint32_t c = R5G6B5toA8R8G8B8(readR5G6B5(src+2*i));
+		uint8_t* d = dst+3*i;
+		d[0] = c&0xFF;
+		d[1] = (c>>8)&0xFF;
+		d[2] = (c>>16)&0xFF;
+	}
+}
+
+bool isColorConversionKernelAvailable(ECOLOR_FORMAT format){
+	return format==ECF_A8R8G8B8 || format==ECF_R8G8B8 || format==ECF_R5G6B5;
+}
+
+bool convertRowToGray(ECOLOR_FORMAT format, const uint8_t* src, uint8_t* dst, uint32_t width, bool inverse){
+	if(format==ECF_A8R8G8B8){
+		convertA8R8G8B8ToGray(src, dst, width, inverse);
+	}else if(format==ECF_R8G8B8){
+		convertR8G8B8ToGray(src, dst, width, inverse);
+	}else if(format==ECF_R5G6B5){
+		convertR5G6B5ToGray(src, dst, width, inverse);
+	}else{
+		return false;
+	}
+	return true;
+}
+
+bool convertRowToBGR(ECOLOR_FORMAT format, const uint8_t* src, uint8_t* dst, uint32_t width){
+	if(format==ECF_A8R8G8B8){
+		convertA8R8G8B8ToBGR(src, dst, width);
+	}else if(format==ECF_R8G8B8){
+		convertR8G8B8ToBGR(src, dst, width);
+	}else if(format==ECF_R5G6B5){
+		convertR5G6B5ToBGR(src, dst, width);
+	}else{
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,21 @@
+#ifndef ColorConversionKernels_H_INCLUDED
+#define ColorConversionKernels_H_INCLUDED
+
+#include <SColor.h>
+
+#include <cstdint>
+
+//! Row conversion kernels from Irrlicht color formats to 8 bit grayscale and 8 bit BGR (channel order of OpenCV), independent of OpenCV.
+//! SIMD implementations for ECF_A8R8G8B8, ECF_R8G8B8 and ECF_R5G6B5 (SSE2, SSSE3 if enabled by the compiler flags e.g. -mssse3, NEON), scalar otherwise.
+//! gray = (30*R + 59*G + 11*B)/100 (integer division) like the per pixel conversion of convertImageToGrayscaleMat
+
+//! true if the format is supported by the kernels
+bool isColorConversionKernelAvailable(irr::video::ECOLOR_FORMAT format);
+
+//! converts width pixels, inverse: 255-gray, returns false if the format is not supported
+bool convertRowToGray(irr::video::ECOLOR_FORMAT format, const uint8_t* src, uint8_t* dst, uint32_t width, bool inverse);
+
+//! converts width pixels to interleaved B, G, R bytes, returns false if the format is not supported
+bool convertRowToBGR(irr::video::ECOLOR_FORMAT format, const uint8_t* src, uint8_t* dst, uint32_t width);
+
+#endif
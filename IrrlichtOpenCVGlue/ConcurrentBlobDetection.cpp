@@ -8,6 +8,11 @@
 
 #include <opencv2/features2d.hpp>
 
+#include <map>
+#include <list>
+#include <algorithm>
+#include <cassert>
+
 using namespace cv;
 using namespace irr;
 using namespace core;
@@ -17,74 +22,250 @@ class ConcurrentBlobDetectionPrivate{
 	
 	public:
 	
-	//! input
-	struct BlobDetectionParameters{
+	//! input and output of a frame in the pipeline
+	struct Job{
 		ConcurrentBlobDetection* detection;
+		uint64_t sequenceNumber;
 		irr::video::IImage* img;
 		cv::SimpleBlobDetector::Params params;
 		bool whiteOnBlack;//if false black on white
 		Matrix<2,3,double> homogenousCamTransform;
+		std::vector<rect<s32>> regions;//empty => full detection
+		double requestTime;
+		double startTime;
+		double conversionTime;
+		double detectionTime;
+		double finishTime;
+		std::vector<cv::KeyPoint> keypoints;//in image coordinates
+		std::vector<ConcurrentBlobDetection::Blob> blobs;
 	};
 	
-	ThreadPool pool;
+	uint32_t maxFramesInFlight;
 	
-	//may only be changed by the blob thread or if it is idle:
-	bool isNew;
-	std::vector<ConcurrentBlobDetection::Blob>* intermediateBlobs;
+	ThreadPool pool;
 	
-	BlobDetectionParameters* params;
+	Job* pendingJob;//not yet started
 	
 	cv::SimpleBlobDetector::Params paramsToCopy;
 	bool whiteOnBlackToCopy;
 	double camRotationDegrees;
 	irr::f32 minArea, maxArea;
 	
-	std::vector<ConcurrentBlobDetection::Blob>* currentBlobs;
+	bool roiEnabled;
+	irr::f32 roiMargin;
+	uint32_t fullDetectionInterval;
+	uint64_t lastFullDetectionSequenceNumber;
+	
+	uint64_t nextStartSequenceNumber;
+	uint64_t nextDeliverySequenceNumber;
 	
-	static void* detectBlobs(void* params);
+	std::vector<ConcurrentBlobDetection::Blob> currentBlobs;
+	uint64_t currentSequenceNumber;
 	
-	ConcurrentBlobDetectionPrivate():pool(1),isNew(false),intermediateBlobs(new std::vector<ConcurrentBlobDetection::Blob>()),params(NULL),paramsToCopy(),whiteOnBlackToCopy(false),camRotationDegrees(0.0),minArea(3.17891e-05),maxArea(0.0625),currentBlobs(new std::vector<ConcurrentBlobDetection::Blob>()){}
+	//shared with the detection threads:
+	Mutex m;
+	uint32_t framesInFlight;
+	std::map<uint64_t, Job*> finishedJobs;
+	std::list<cv::Mat> freeMats;//reused grayscale buffers
+	std::vector<cv::KeyPoint> latestKeypoints;
+	uint64_t latestKeypointsSequenceNumber;
+	ConcurrentBlobDetection::Statistics stats;
+	double statsResetTime;
+	
+	static void* detectBlobs(void* data);
+	
+	ConcurrentBlobDetectionPrivate(uint32_t maxFramesInFlight):
+		maxFramesInFlight(std::max(maxFramesInFlight, (uint32_t)1)),
+		pool(this->maxFramesInFlight),
+		pendingJob(NULL),
+		paramsToCopy(),
+		whiteOnBlackToCopy(false),
+		camRotationDegrees(0.0),
+		minArea(3.17891e-05),
+		maxArea(0.0625),
+		roiEnabled(false),
+		roiMargin(2.f),
+		fullDetectionInterval(30),
+		lastFullDetectionSequenceNumber(0),
+		nextStartSequenceNumber(1),
+		nextDeliverySequenceNumber(1),
+		currentSequenceNumber(0),
+		framesInFlight(0),
+		latestKeypointsSequenceNumber(0){
+		initMutex(m);
+		resetStatistics();
+	}
 	
 	~ConcurrentBlobDetectionPrivate(){
-		while(pool.hasRunningThreads()){//wait until all is done
+		while(getFramesInFlight()>0){//wait until all is done
 			delay(10);
 		}
-		delete intermediateBlobs;
-		delete currentBlobs;
-		delete params;
+		while(pool.hasRunningThreads()){//the threads return to the pool after the job has been finished
+			delay(1);
+		}
+		deleteJob(pendingJob);
+		for(auto it = finishedJobs.begin(); it!=finishedJobs.end(); ++it){
+			delete it->second;
+		}
+		deleteMutex(m);
+	}
+	
+	void deleteJob(Job* job){
+		if(job){
+			if(job->img){job->img->drop();}
+			delete job;
+		}
+	}
+	
+	uint32_t getFramesInFlight(){
+		lockMutex(m);
+		uint32_t res = framesInFlight;
+		unlockMutex(m);
+		return res;
+	}
+	
+	void resetStatistics(){
+		lockMutex(m);
+		stats = ConcurrentBlobDetection::Statistics();
+		for(uint32_t i=0; i<ConcurrentBlobDetection::STAGE_COUNT; i++){
+			stats.stages[i] = ConcurrentBlobDetection::StageStatistics{0, 0.0, 0.0};
+		}
+		stats.requestedFrames = stats.droppedFrames = stats.deliveredFrames = stats.regionOfInterestFrames = 0;
+		stats.throughput = 0.0;
+		statsResetTime = getSecs();
+		unlockMutex(m);
+	}
+	
+	//! mutex must be locked
+	void addStageTime(ConcurrentBlobDetection::Stage stage, double time){
+		ConcurrentBlobDetection::StageStatistics& s = stats.stages[stage];
+		s.count++;
+		s.sumTime += time;
+		s.maxTime = std::max(s.maxTime, time);
+	}
+	
+	cv::Mat acquireMat(){
+		cv::Mat res;
+		lockMutex(m);
+		if(!freeMats.empty()){
+			res = freeMats.front();
+			freeMats.pop_front();
+		}
+		unlockMutex(m);
+		return res;
+	}
+	
+	void releaseMat(const cv::Mat& mat){
+		lockMutex(m);
+		freeMats.push_back(mat);
+		unlockMutex(m);
+	}
+	
+	//! regions around the blobs of the latest result, merged if overlapping, empty if a full detection is required
+	std::vector<rect<s32>> calcRegionsOfInterest(uint64_t sequenceNumber, const dimension2d<u32>& imgSize){
+		std::vector<rect<s32>> regions;
+		if(!roiEnabled || sequenceNumber-lastFullDetectionSequenceNumber>=fullDetectionInterval){
+			return regions;
+		}
+		lockMutex(m);
+		for(const cv::KeyPoint& kp : latestKeypoints){
+			s32 radius = (s32)(roiMargin*kp.size+1.f);
+			rect<s32> r((s32)kp.pt.x-radius, (s32)kp.pt.y-radius, (s32)kp.pt.x+radius+1, (s32)kp.pt.y+radius+1);
+			r.clipAgainst(rect<s32>(0, 0, imgSize.Width, imgSize.Height));
+			if(r.isValid() && r.getArea()>0){regions.push_back(r);}
+		}
+		unlockMutex(m);
+		bool merged = true;
+		while(merged){//blobs in overlapping regions would be detected twice
+			merged = false;
+			for(uint32_t i=0; i<regions.size() && !merged; i++){
+				for(uint32_t j=i+1; j<regions.size() && !merged; j++){
+					if(regions[i].isRectCollided(regions[j])){
+						regions[i].addInternalPoint(regions[j].UpperLeftCorner);
+						regions[i].addInternalPoint(regions[j].LowerRightCorner);
+						regions.erase(regions.begin()+j);
+						merged = true;
+					}
+				}
+			}
+		}
+		return regions;
+	}
+	
+	void startPendingJob(){
+		if(pendingJob!=NULL){
+			lockMutex(m);
+			bool canStart = framesInFlight<maxFramesInFlight;
+			if(canStart){framesInFlight++;}
+			unlockMutex(m);
+			if(canStart){
+				Job* job = pendingJob;
+				pendingJob = NULL;
+				job->sequenceNumber = nextStartSequenceNumber;
+				nextStartSequenceNumber++;
+				job->regions = calcRegionsOfInterest(job->sequenceNumber, job->img->getDimension());
+				if(job->regions.empty()){lastFullDetectionSequenceNumber = job->sequenceNumber;}
+				job->startTime = getSecs();
+				if(pool.startThreadedFunction(detectBlobs, job)==NULL){
+					lockMutex(m);
+					framesInFlight--;
+					unlockMutex(m);
+					deleteJob(job);
+					nextStartSequenceNumber--;
+				}
+			}
+		}
 	}
 	
 };
 
-ConcurrentBlobDetection::ConcurrentBlobDetection(){
-	prv = new ConcurrentBlobDetectionPrivate();
+ConcurrentBlobDetection::ConcurrentBlobDetection(uint32_t maxFramesInFlight){
+	prv = new ConcurrentBlobDetectionPrivate(maxFramesInFlight);
 }
 	
 bool ConcurrentBlobDetection::update(){
-	bool running = prv->pool.hasRunningThreads();
-	if(!running){
-		if(prv->isNew){
-			auto tmp = prv->intermediateBlobs;
-			prv->intermediateBlobs = prv->currentBlobs;
-			prv->currentBlobs = tmp;
-			prv->isNew = false;
-		}
-		if(prv->params!=NULL){
-			running = prv->pool.startThreadedFunction(prv->detectBlobs, prv->params)!=NULL;
-			prv->params = NULL;
+	std::vector<ConcurrentBlobDetectionPrivate::Job*> delivered;
+	lockMutex(prv->m);
+	auto it = prv->finishedJobs.begin();
+	while(it!=prv->finishedJobs.end() && it->first==prv->nextDeliverySequenceNumber){//in order of the requests
+		delivered.push_back(it->second);
+		it = prv->finishedJobs.erase(it);
+		prv->nextDeliverySequenceNumber++;
+	}
+	double t = getSecs();
+	for(ConcurrentBlobDetectionPrivate::Job* job : delivered){
+		prv->addStageTime(DELIVERY, t-job->finishTime);
+		prv->addStageTime(TOTAL, t-job->requestTime);
+		prv->stats.deliveredFrames++;
+	}
+	unlockMutex(prv->m);
+	if(!delivered.empty()){
+		ConcurrentBlobDetectionPrivate::Job* latest = delivered.back();
+		prv->currentBlobs.swap(latest->blobs);
+		prv->currentSequenceNumber = latest->sequenceNumber;
+		for(ConcurrentBlobDetectionPrivate::Job* job : delivered){
+			delete job;
 		}
 	}
-	return !running;
+	prv->startPendingJob();
+	return prv->getFramesInFlight()<prv->maxFramesInFlight;
 }
 	
 const std::vector<ConcurrentBlobDetection::Blob>& ConcurrentBlobDetection::getCurrentBlobs() const{
-	return *prv->currentBlobs;
+	return prv->currentBlobs;
+}
+
+uint64_t ConcurrentBlobDetection::getCurrentSequenceNumber() const{
+	return prv->currentSequenceNumber;
 }
 	
 void ConcurrentBlobDetection::requestBlobDetection(irr::video::IImage* img){
 	assert(img->getReferenceCount()==1);
-	if(prv->params){prv->params->img->drop();}
-	delete prv->params;//delete old request
+	lockMutex(prv->m);
+	prv->stats.requestedFrames++;
+	if(prv->pendingJob){prv->stats.droppedFrames++;}
+	unlockMutex(prv->m);
+	prv->deleteJob(prv->pendingJob);//delete old request
 	u32 totalArea = img->getDimension().getArea();
 	prv->paramsToCopy.minArea = prv->minArea*totalArea;
 	prv->paramsToCopy.maxArea = prv->maxArea*totalArea;
@@ -96,7 +277,35 @@ void ConcurrentBlobDetection::requestBlobDetection(irr::video::IImage* img){
 		cosPhi, -sinPhi,  -sinPhi*t_y+cosPhi*t_x-t_x,
 		sinPhi,	cosPhi,	cosPhi*t_y-t_y+sinPhi*t_x,
 	};
-	prv->params = new ConcurrentBlobDetectionPrivate::BlobDetectionParameters{this, img, prv->paramsToCopy, prv->whiteOnBlackToCopy, homoTransform};
+	prv->pendingJob = new ConcurrentBlobDetectionPrivate::Job{this, 0, img, prv->paramsToCopy, prv->whiteOnBlackToCopy, homoTransform};
+	prv->pendingJob->requestTime = getSecs();
+}
+
+uint32_t ConcurrentBlobDetection::getMaxFramesInFlight() const{
+	return prv->maxFramesInFlight;
+}
+
+void ConcurrentBlobDetection::setRegionOfInterestMode(bool enabled, irr::f32 margin, uint32_t fullDetectionInterval){
+	prv->roiEnabled = enabled;
+	prv->roiMargin = margin;
+	prv->fullDetectionInterval = std::max(fullDetectionInterval, (uint32_t)1);
+}
+
+bool ConcurrentBlobDetection::isRegionOfInterestModeEnabled() const{
+	return prv->roiEnabled;
+}
+
+ConcurrentBlobDetection::Statistics ConcurrentBlobDetection::getStatistics() const{
+	lockMutex(prv->m);
+	Statistics res = prv->stats;
+	double t = getSecs()-prv->statsResetTime;
+	unlockMutex(prv->m);
+	res.throughput = t>0.0?(res.deliveredFrames/t):0.0;
+	return res;
+}
+
+void ConcurrentBlobDetection::resetStatistics(){
+	prv->resetStatistics();
 }
 
 void ConcurrentBlobDetection::setCameraRotationDegrees(double degrees){
@@ -128,25 +337,61 @@ void ConcurrentBlobDetection::setFilterAreaEnabled(bool enabled){
 	prv->paramsToCopy.filterByArea = enabled;
 }
 
-void* ConcurrentBlobDetectionPrivate::detectBlobs(void* params){
-	BlobDetectionParameters* p = (BlobDetectionParameters*)params;
-	std::vector<ConcurrentBlobDetection::Blob>& blobs = *(p->detection->prv->intermediateBlobs);
-	blobs.clear();
-	Mat blobMat = p->whiteOnBlack?convertInverseImageToGrayscaleMat(p->img):convertImageToGrayscaleMat(p->img);
-	std::vector<KeyPoint> keypoints;// Detect blobs.
-	cv::Ptr<cv::SimpleBlobDetector> detector = cv::SimpleBlobDetector::create(p->params); 
-	detector->detect(blobMat, keypoints);
-	blobs.reserve(keypoints.size());
-	//std::cout << "found blobs: " << keypoints.size() << std::endl;
-	for(uint32_t i=0; i<keypoints.size(); i++){
-		KeyPoint& kp = keypoints[i];
-		Vector2D<double> transformedBlob = p->homogenousCamTransform * Vector3D<double>(kp.pt.x, kp.pt.y, 1.0);
+void* ConcurrentBlobDetectionPrivate::detectBlobs(void* data){
+	Job* job = (Job*)data;
+	ConcurrentBlobDetectionPrivate* p = job->detection->prv;
+	double t = getSecs();
+	Mat blobMat = p->acquireMat();
+	void (*convert)(IImage*, Mat&, const rect<s32>*) = convertImageToGrayscaleMat;
+	if(job->whiteOnBlack){convert = convertInverseImageToGrayscaleMat;}
+	if(job->regions.empty()){
+		convert(job->img, blobMat, NULL);
+	}else{
+		for(const rect<s32>& r : job->regions){convert(job->img, blobMat, &r);}
+	}
+	job->conversionTime = getSecs()-t;
+	t = getSecs();
+	cv::Ptr<cv::SimpleBlobDetector> detector = cv::SimpleBlobDetector::create(job->params);
+	if(job->regions.empty()){
+		detector->detect(blobMat, job->keypoints);
+	}else{
+		std::vector<KeyPoint> regionKeypoints;
+		for(const rect<s32>& r : job->regions){
+			Mat region = blobMat(cv::Rect(r.UpperLeftCorner.X, r.UpperLeftCorner.Y, r.getWidth(), r.getHeight()));//no copy
+			detector->detect(region, regionKeypoints);
+			for(KeyPoint& kp : regionKeypoints){
+				kp.pt.x += r.UpperLeftCorner.X;
+				kp.pt.y += r.UpperLeftCorner.Y;
+				job->keypoints.push_back(kp);
+			}
+		}
+	}
+	std::vector<ConcurrentBlobDetection::Blob>& blobs = job->blobs;
+	blobs.reserve(job->keypoints.size());
+	//std::cout << "found blobs: " << job->keypoints.size() << std::endl;
+	for(uint32_t i=0; i<job->keypoints.size(); i++){
+		KeyPoint& kp = job->keypoints[i];
+		Vector2D<double> transformedBlob = job->homogenousCamTransform * Vector3D<double>(kp.pt.x, kp.pt.y, 1.0);
 		blobs.push_back(ConcurrentBlobDetection::Blob{vector2d<f32>(transformedBlob[0], transformedBlob[1]), kp.size});
 		//std::cout << "blob " << i << ": " << kp.pt.x << ", " << kp.pt.y << " angle: " << p.angle << " response: " << p.response << " size: " << p.size << std::endl;
 	}
-	p->detection->prv->isNew = true;
-	p->img->drop();
-	delete p;
+	job->detectionTime = getSecs()-t;
+	p->releaseMat(blobMat);
+	job->img->drop();
+	job->img = NULL;
+	job->finishTime = getSecs();
+	lockMutex(p->m);
+	if(job->sequenceNumber>p->latestKeypointsSequenceNumber){//regions of interest for the following frames
+		p->latestKeypoints = job->keypoints;
+		p->latestKeypointsSequenceNumber = job->sequenceNumber;
+	}
+	p->addStageTime(ConcurrentBlobDetection::QUEUE, job->startTime-job->requestTime);
+	p->addStageTime(ConcurrentBlobDetection::CONVERSION, job->conversionTime);
+	p->addStageTime(ConcurrentBlobDetection::DETECTION, job->detectionTime);
+	if(!job->regions.empty()){p->stats.regionOfInterestFrames++;}
+	p->finishedJobs[job->sequenceNumber] = job;
+	p->framesInFlight--;
+	unlockMutex(p->m);
 	return NULL;
 }
 
@@ -6,10 +6,12 @@
 #include <vector2d.h>
 
 #include <vector>
+#include <cstdint>
 
 class ConcurrentBlobDetectionPrivate;
 
 //! Useful to avoid the low framerate caused by serial execution of rendering and blob detection.
+//! Several frames can be detected in parallel (pipeline), the results are delivered in the order of the requests.
 class ConcurrentBlobDetection{
 	friend class ConcurrentBlobDetectionPrivate;
 	
@@ -21,28 +23,70 @@ class ConcurrentBlobDetection{
 		irr::f32 size;//! relevant size of the blob, e.g. it's diameter
 	};
 	
+	enum Stage{
+		QUEUE,//! from the request until the detection starts
+		CONVERSION,//! image to grayscale conversion
+		DETECTION,//! blob detection
+		DELIVERY,//! from the end of the detection until the result is available in update (includes waiting for previous frames)
+		TOTAL,//! from the request until the result is available
+		STAGE_COUNT
+	};
+	
+	//! times in s
+	struct StageStatistics{
+		uint64_t count;
+		double sumTime;
+		double maxTime;
+	};
+	
+	struct Statistics{
+		StageStatistics stages[STAGE_COUNT];
+		uint64_t requestedFrames;
+		uint64_t droppedFrames;//! replaced by a newer request before the detection started
+		uint64_t deliveredFrames;
+		uint64_t regionOfInterestFrames;//! frames detected only around previous blobs
+		double throughput;//! delivered frames per second since the last reset
+	};
+	
 	private:
 	
 	ConcurrentBlobDetectionPrivate* prv;
 	
 	public:
 	
-	ConcurrentBlobDetection();
+	//! maxFramesInFlight: maximum amount of frames which are detected in parallel
+	ConcurrentBlobDetection(uint32_t maxFramesInFlight = 1);
 	
 	~ConcurrentBlobDetection();
 	
-	//! must be called to exchange the current blobs if new blobs are available
-	//! returns true if the blob thread is ready for new stuff
+	//! must be called to exchange the current blobs if new blobs are available and to start pending requests
+	//! returns true if less than maxFramesInFlight frames are being detected (ready for new stuff)
 	bool update();
 	
 	//! gets the current blobs (MUST NOT be used after a follwing call of update())
 	const std::vector<Blob>& getCurrentBlobs() const;
 	
-	//! if the thread is not idle any other pending request will be deleted
+	//! sequence number of the detected frame which resulted in the current blobs (frames are numbered when the detection starts, 0 if none yet)
+	uint64_t getCurrentSequenceNumber() const;
+	
+	//! if maxFramesInFlight frames are being detected any other pending request will be deleted
 	//! The image is provided to the thread via pointer and dropped after done, therefore the reference counter should be 1 here. The image must not be used simultaneously by anything else for thread safety.
 	//TODO: other blob detection parameters
 	void requestBlobDetection(irr::video::IImage* img);
 	
+	uint32_t getMaxFramesInFlight() const;
+	
+	//! if enabled only regions around the blobs of the latest result are converted and detected, this is faster but new blobs are only found by the full detections
+	//! margin: size of the regions relative to the blob size
+	//! fullDetectionInterval: every fullDetectionInterval frames a full detection is done
+	void setRegionOfInterestMode(bool enabled, irr::f32 margin = 2.f, uint32_t fullDetectionInterval = 30);
+	
+	bool isRegionOfInterestModeEnabled() const;
+	
+	Statistics getStatistics() const;
+	
+	void resetStatistics();
+	
 	irr::f32 getMinAreaProportion() const;
 	
 	irr::f32 getMaxAreaProportion() const;
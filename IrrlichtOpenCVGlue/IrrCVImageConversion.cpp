@@ -1,26 +1,80 @@
 #include "IrrCVImageConversion.h"
+#include "ColorConversionKernels.h"
 
 using namespace cv;
 using namespace irr;
 using namespace video;
 using namespace core;
 
+//! converts the (clipped) region row by row using convertRow, returns false if the color format is not supported by the kernels
+static bool convertImageWithKernel(IImage* img, Mat& out, int cvType, u32 outBytesPerPixel, const rect<s32>* region, const std::function<void(const uint8_t* src, uint8_t* dst, uint32_t width)>& convertRow){
+	if(!isColorConversionKernelAvailable(img->getColorFormat())){return false;}
+	dimension2d<u32> size = img->getDimension();
+	out.create(size.Height, size.Width, cvType);
+	rect<s32> r(0, 0, size.Width, size.Height);
+	if(region){r.clipAgainst(*region);}
+	if(r.getWidth()<=0 || r.getHeight()<=0){return true;}
+	const uint8_t* data = (const uint8_t*)img->getData();
+	u32 pitch = img->getPitch();
+	u32 bytesPerPixel = img->getBytesPerPixel();
+	for(s32 y=r.UpperLeftCorner.Y; y<r.LowerRightCorner.Y; y++){
+		convertRow(data + y*pitch + r.UpperLeftCorner.X*bytesPerPixel, out.ptr<uint8_t>(y) + r.UpperLeftCorner.X*outBytesPerPixel, r.getWidth());
+	}
+	return true;
+}
+
 Mat convertImageToGrayscaleMat(IImage* img){
-//	dimension2d<u32> size = img->getDimension();
-//	Mat res(size.Height, size.Width, CV_8U);
-//	for(u32 x=0; x<size.Width; x++){
-//		for(u32 y=0; y<size.Height; y++){
-//			SColor c = img->getPixel(x,y);
-//			u32 gray = (30*c.getRed() + 59*c.getGreen() + 11*c.getBlue())/100;
-//			res.at<uint8_t>(y,x) = gray;
-//		}
-//	}
-//	return res;
-	return convertImageToMat<uint8_t,CV_8U>(img, [](irr::video::SColor c){return (30*c.getRed() + 59*c.getGreen() + 11*c.getBlue())/100;});
+	Mat res;
+	convertImageToGrayscaleMat(img, res);
+	return res;
 }
 
 cv::Mat convertInverseImageToGrayscaleMat(irr::video::IImage* img){
-	return convertImageToMat<uint8_t,CV_8U>(img, [](irr::video::SColor c){return 255-(30*c.getRed() + 59*c.getGreen() + 11*c.getBlue())/100;});
+	Mat res;
+	convertInverseImageToGrayscaleMat(img, res);
+	return res;
+}
+
+void convertImageToGrayscaleMat(IImage* img, Mat& out, const rect<s32>* region){
+	ECOLOR_FORMAT format = img->getColorFormat();
+	if(!convertImageWithKernel(img, out, CV_8U, 1, region, [format](const uint8_t* src, uint8_t* dst, uint32_t width){convertRowToGray(format, src, dst, width, false);})){
+		convertImageToMat<uint8_t,CV_8U>(img, [](irr::video::SColor c){return (30*c.getRed() + 59*c.getGreen() + 11*c.getBlue())/100;}, out, region);
+	}
+}
+
+void convertInverseImageToGrayscaleMat(IImage* img, Mat& out, const rect<s32>* region){
+	ECOLOR_FORMAT format = img->getColorFormat();
+	if(!convertImageWithKernel(img, out, CV_8U, 1, region, [format](const uint8_t* src, uint8_t* dst, uint32_t width){convertRowToGray(format, src, dst, width, true);})){
+		convertImageToMat<uint8_t,CV_8U>(img, [](irr::video::SColor c){return 255-(30*c.getRed() + 59*c.getGreen() + 11*c.getBlue())/100;}, out, region);
+	}
+}
+
+Mat convertImageToBGRMat(IImage* img){
+	Mat res;
+	convertImageToBGRMat(img, res);
+	return res;
+}
+
+void convertImageToBGRMat(IImage* img, Mat& out, const rect<s32>* region){
+	ECOLOR_FORMAT format = img->getColorFormat();
+	if(!convertImageWithKernel(img, out, CV_8UC3, 3, region, [format](const uint8_t* src, uint8_t* dst, uint32_t width){convertRowToBGR(format, src, dst, width);})){
+		convertImageToMat<Vec3b,CV_8UC3>(img, [](irr::video::SColor c){return Vec3b(c.getBlue(), c.getGreen(), c.getRed());}, out, region);
+	}
+}
+
+Mat wrapImageAsMat(IImage* img){
+	dimension2d<u32> size = img->getDimension();
+	ECOLOR_FORMAT format = img->getColorFormat();
+	int type = -1;
+	if(format==ECF_A8R8G8B8){
+		type = CV_8UC4;
+	}else if(format==ECF_R8G8B8){
+		type = CV_8UC3;
+	}else if(format==ECF_R5G6B5){
+		type = CV_16UC1;
+	}
+	if(type<0){return Mat();}
+	return Mat(size.Height, size.Width, type, img->getData(), img->getPitch());
 }
 
 Mat convertTextureToMat(IVideoDriver* driver, ITexture* tex, Mat(*conversionFunction)(IImage*)){
@@ -5,6 +5,7 @@
 #include <IImage.h>
 #include <ITexture.h>
 #include <IVideoDriver.h>
+#include <rect.h>
 
 #include <functional>
 #include <cstdint>
@@ -24,10 +25,41 @@ cv::Mat convertImageToMat(irr::video::IImage* img, const std::function<TPrimitiv
 	return res;
 }
 
+//! like convertImageToMat but writes into out which is only reallocated if the size or type differs (useful to reuse buffers)
+//! region: only the pixels inside are converted (clipped to the image), the whole image if NULL
+template <typename TPrimitiveType, int TCVType>
+void convertImageToMat(irr::video::IImage* img, const std::function<TPrimitiveType(irr::video::SColor)>& convertPixel, cv::Mat& out, const irr::core::rect<irr::s32>* region = NULL){
+	irr::core::dimension2d<irr::u32> size = img->getDimension();
+	out.create(size.Height, size.Width, TCVType);
+	irr::core::rect<irr::s32> r(0, 0, size.Width, size.Height);
+	if(region){r.clipAgainst(*region);}
+	for(irr::s32 y=r.UpperLeftCorner.Y; y<r.LowerRightCorner.Y; y++){
+		TPrimitiveType* row = out.ptr<TPrimitiveType>(y);
+		for(irr::s32 x=r.UpperLeftCorner.X; x<r.LowerRightCorner.X; x++){
+			row[x] = convertPixel(img->getPixel(x,y));
+		}
+	}
+}
+
+//! The following conversions use SIMD kernels for ECF_A8R8G8B8, ECF_R8G8B8 and ECF_R5G6B5 (see ColorConversionKernels.h) and convertImageToMat for other formats.
+
 cv::Mat convertImageToGrayscaleMat(irr::video::IImage* img);
 
 cv::Mat convertInverseImageToGrayscaleMat(irr::video::IImage* img);
 
+void convertImageToGrayscaleMat(irr::video::IImage* img, cv::Mat& out, const irr::core::rect<irr::s32>* region = NULL);
+
+void convertInverseImageToGrayscaleMat(irr::video::IImage* img, cv::Mat& out, const irr::core::rect<irr::s32>* region = NULL);
+
+//! CV_8UC3 with B, G, R channels
+cv::Mat convertImageToBGRMat(irr::video::IImage* img);
+
+void convertImageToBGRMat(irr::video::IImage* img, cv::Mat& out, const irr::core::rect<irr::s32>* region = NULL);
+
+//! creates a Mat header which uses the memory of the image without copy, the image must not be dropped or changed while the Mat is used
+//! ECF_A8R8G8B8: CV_8UC4 with B, G, R, A channels (little endian), ECF_R8G8B8: CV_8UC3 with R, G, B channels, ECF_R5G6B5: CV_16UC1, other formats: empty Mat
+cv::Mat wrapImageAsMat(irr::video::IImage* img);
+
 cv::Mat convertTextureToMat(irr::video::IVideoDriver* driver, irr::video::ITexture* tex, cv::Mat(*conversionFunction)(irr::video::IImage*));
 
 #endif
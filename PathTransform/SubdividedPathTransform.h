@@ -3,11 +3,20 @@
 
 #include "IPathTransform.h"
 
-#include <list>
+#include <vector>
+#include <thread>
+#include <iterator>
+#include <algorithm>
 
 template <typename TPath, typename TFloat>
 class SubdividedPathTransform : public IPathTransform<TPath>{
 	
+	public:
+	
+	typedef IPathTransform<TPath> Super;
+	typedef typename Super::Vector Vector;
+	typedef typename Super::Scalar Scalar;
+	
 	protected:
 	
 	TFloat minTriangleAreaWithNeigbors;//Threshold to determine wether the new transformed point shall be really created
@@ -20,66 +29,147 @@ class SubdividedPathTransform : public IPathTransform<TPath>{
 		return offset;
 	}
 	
-	public:
-	
-	typedef IPathTransform<TPath> Super;
-	typedef typename Super::Vector Vector;
-	typedef typename Super::Scalar Scalar;
+	//! Transformed points of a path in order, removed points are skipped by the prev/next links
+	struct SubdivisionState{
+		std::vector<Vector> points;
+		std::vector<uint32_t> prev, next;
+		uint32_t hint;//state of transformSingle(Vector&, uint32_t&)
+		
+		SubdivisionState():hint(0){}
+		
+		void push(const Vector& v){
+			uint32_t i = points.size();
+			points.push_back(v);
+			prev.push_back(i-1);
+			next.push_back(i+1);
+		}
+		
+		//! only points which are neither the first nor the last one can be removed
+		void remove(uint32_t i){
+			next[prev[i]] = next[i];
+			prev[next[i]] = prev[i];
+		}
+		
+		//! appends the remaining points to out, skips the first one if requested
+		void appendTo(std::vector<Vector>& out, bool skipFirst) const{
+			for(uint32_t i=skipFirst?next[0]:0; i<points.size(); i=next[i]){
+				out.push_back(points[i]);
+			}
+		}
+	};
 	
-	static_assert(std::is_floating_point<TFloat>::value);
+	uint32_t threadCount;
 	
-	SubdividedPathTransform(TFloat lineDistance, TFloat minTriangleAreaWithNeigbors):minTriangleAreaWithNeigbors(minTriangleAreaWithNeigbors),lineDistance(lineDistance){}
+	//! paths with less points per thread are transformed sequentially
+	static const uint32_t minPointsPerThread = 4096;
 	
-	//! subdivides a line if applicable, assumes measStart has already been added and adds transformed additional points if required and adds measEnd
-	void subdivide(std::list<Vector>& l, const Vector& sourceStart, const Vector& sourceEnd, const Vector& measStart, const Vector& measEnd){
+	//! subdivides a line if applicable, assumes the transformed start has already been added and adds transformed additional points if required and adds measEnd
+	void subdivide(SubdivisionState& s, const Vector& sourceStart, const Vector& sourceEnd, const Vector& measEnd){
 		Vector d = sourceEnd-sourceStart;
 		TFloat len = calcFrobeniusNorm<Vector,TFloat>(d);
 		if(len>lineDistance){
 			auto newPoint = convertMatrix<TFloat>(sourceStart)+((TFloat)0.5)*convertMatrix<TFloat>(d);
 			auto newPointRd = rdMatrix<Scalar>(newPoint);
 			auto newPointTransformedRd = newPointRd;
-			transformSingle(newPointTransformedRd);
-			subdivide(l, sourceStart, newPointRd, measStart, newPointTransformedRd);
-			auto it = l.end();
-			--it;//points to newPointTransformed pushed back by recursive subdivide call
-			--it;//points to first vertex in triangle
-			Vector& first = *it;
-			subdivide(l, newPointRd, sourceEnd, newPointTransformedRd, measEnd);
-			++it;
-			++it;//points to last vertex in triangle
-			Vector& third = *it;
+			transformSingle(newPointTransformedRd, s.hint);
+			subdivide(s, sourceStart, newPointRd, newPointTransformedRd);
+			uint32_t middle = s.points.size()-1;//newPointTransformed pushed back by recursive subdivide call
+			subdivide(s, newPointRd, sourceEnd, measEnd);
+			const Vector& first = s.points[s.prev[middle]];
+			const Vector& third = s.points[s.next[middle]];
 			Vector m1m0 = third-first;
 			Vector m2m0 = newPointTransformedRd-first;
 			TFloat triangleArea = ((TFloat)0.5)*fabs(calcDeterminant(Matrix<2,2,TFloat>{
 				(TFloat)m1m0.get(0),	(TFloat)m2m0.get(0),
 				(TFloat)m1m0.get(1),	(TFloat)m2m0.get(1)}));
 			if(triangleArea<minTriangleAreaWithNeigbors){
-				--it;
-				l.erase(it);
+				s.remove(middle);
 			}//else{std::cout << "triangleArea: " << triangleArea << " minTriangleAreaWithNeigbors: " << minTriangleAreaWithNeigbors << std::endl;}
 		}else{
-			l.push_back(measEnd);
+			s.push(measEnd);
 		}
 	}
 	
-	virtual TPath transform(const TPath& path){
-		std::list<Vector> l;
-		auto it = path.begin();
-		if(it!=path.end()){
-			const Vector* last = &(*it);
-			Vector start = *it;
-			transformSingle(start);
-			l.push_back(start);
-			++it;
-			for(; it!=path.end(); ++it){
+	//! transforms and subdivides the points from begin until end (exclusive)
+	template <typename TIterator>
+	void transformRange(TIterator begin, TIterator end, SubdivisionState& s){
+		if(begin!=end){
+			TIterator last = begin;
+			Vector start = *begin;
+			transformSingle(start, s.hint);
+			s.push(start);
+			for(TIterator it = ++begin; it!=end; ++it){
 				Vector current = *it;
-				transformSingle(current);
-				subdivide(l, *last, *it, l.back(), current);
-				last = &(*it);
+				transformSingle(current, s.hint);
+				subdivide(s, *last, *it, current);
+				last = it;
 			}
 		}
-		//std::cout << "added vertices: " << (l.size()-path.size()) << std::endl;
-		return TPath(l.begin(), l.end());
+	}
+	
+	public:
+	
+	static_assert(std::is_floating_point<TFloat>::value);
+	
+	SubdividedPathTransform(TFloat lineDistance, TFloat minTriangleAreaWithNeigbors):minTriangleAreaWithNeigbors(minTriangleAreaWithNeigbors),lineDistance(lineDistance),threadCount(1){}
+	
+	//! Uses up to threadCount threads for very long paths in transform. This requires a thread safe transformSingle(Vector&, uint32_t&).
+	void setThreadCount(uint32_t threadCount){
+		this->threadCount = threadCount>0?threadCount:1;
+	}
+	
+	uint32_t getThreadCount() const{
+		return threadCount;
+	}
+	
+	//! Transforms and subdivides the path into a contiguous output (out is cleared first)
+	void transform(const TPath& path, std::vector<Vector>& out){
+		out.clear();
+		size_t size = std::distance(path.begin(), path.end());
+		uint32_t chunkCount = std::max((size_t)1, std::min((size_t)threadCount, size/minPointsPerThread));
+		if(chunkCount==1){
+			SubdivisionState s;
+			transformRange(path.begin(), path.end(), s);
+			out.reserve(s.points.size());
+			s.appendTo(out, false);
+		}else{
+			//each chunk starts with the last point of the previous chunk to subdivide the line in between
+			std::vector<typename TPath::const_iterator> chunkStarts(chunkCount+1, path.end());
+			auto it = path.begin();
+			for(uint32_t i=0; i<chunkCount; i++){
+				chunkStarts[i] = it;
+				std::advance(it, i+1<chunkCount?(size/chunkCount):0);
+			}
+			std::vector<SubdivisionState> states(chunkCount);
+			std::vector<std::thread> threads;
+			for(uint32_t i=1; i<chunkCount; i++){
+				threads.emplace_back([this, &chunkStarts, &states, i](){
+					transformRange(chunkStarts[i], i+1<chunkStarts.size()-1?std::next(chunkStarts[i+1]):chunkStarts[i+1], states[i]);
+				});
+			}
+			transformRange(chunkStarts[0], std::next(chunkStarts[1]), states[0]);
+			for(std::thread& t : threads){
+				t.join();
+			}
+			size_t totalSize = 0;
+			for(uint32_t i=0; i<chunkCount; i++){totalSize += states[i].points.size();}
+			out.reserve(totalSize);
+			for(uint32_t i=0; i<chunkCount; i++){
+				states[i].appendTo(out, i>0);
+			}
+		}
+		//std::cout << "added vertices: " << (out.size()-size) << std::endl;
+	}
+	
+	virtual TPath transform(const TPath& path){
+		std::vector<Vector> out;
+		transform(path, out);
+		return TPath(out.begin(), out.end());
+	}
+	
+	//! Like transformSingle(Vector&) but with a state owned by the caller (e.g. a search hint, initially 0). Implementations which support the parallel transformation must be thread safe if called with different states.
+	virtual void transformSingle(Vector& vector, uint32_t& state){
+		transformSingle(vector);
 	}
 	
 	virtual void transformSingle(Vector& vector) = 0;
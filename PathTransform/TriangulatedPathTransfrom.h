@@ -11,11 +11,14 @@
 #include <cmath>
 #include <limits>
 #include <algorithm>
+#include <array>
 
 #define MIN_TRIANGLE_AREA 0.00001
+#define MAX_TRIANGLE_WALK_STEPS 32
 
 //! use TFloat to specify the floating point scalar precision e.g. double
 //! if it is constructed without a given triangulation the triangulation is calculated via opencv
+//! The triangle of a point is found by walking from the previously found triangle, a uniform grid is used otherwise.
 template <typename TPath, typename TFloat>
 class TriangulatedPathTransfrom : public SubdividedPathTransform<TPath, TFloat>{
 
@@ -36,8 +39,180 @@ class TriangulatedPathTransfrom : public SubdividedPathTransform<TPath, TFloat>{
 	std::vector<MatchedPoint<Scalar>> points;
 	std::vector<uint32_t> indices;//! a triangle is formed every 3 indices
 	std::vector<TriangleTransformation> transformations;
+	
+	//! neighbors[i][j]: valid triangle which shares the edge opposite of vertex j with triangle i, -1 if none
+	std::vector<std::array<int32_t,3>> neighbors;
+	
+	//! uniform grid over the source space bounding boxes of the valid triangles (triangleArea>MIN_TRIANGLE_AREA)
+	//! the triangles of cell i are gridTriangles[gridCellStarts[i]] until gridTriangles[gridCellStarts[i+1]]
+	TFloat gridMinX, gridMinY, gridCellWidth, gridCellHeight;
+	int32_t gridWidth, gridHeight;
+	std::vector<uint32_t> gridCellStarts;
+	std::vector<uint32_t> gridTriangles;
+	
+	uint32_t lastTriangle;//start of the search in transformSingle(Vector&)
+	
+	bool isValidTriangle(uint32_t i) const{
+		return transformations[i].triangleArea>MIN_TRIANGLE_AREA;
+	}
+	
+	void calcGridCell(TFloat x, TFloat y, int32_t& cx, int32_t& cy) const{
+		cx = std::max(0, std::min(gridWidth-1, (int32_t)std::floor((x-gridMinX)/gridCellWidth)));
+		cy = std::max(0, std::min(gridHeight-1, (int32_t)std::floor((y-gridMinY)/gridCellHeight)));
+	}
+	
+	void recalculateSpatialIndex(){
+		uint32_t tcnt = transformations.size();
+		//neighbors via sorted edges
+		neighbors.assign(tcnt, std::array<int32_t,3>{-1,-1,-1});
+		std::vector<std::array<uint32_t,3>> edges;//vertex indices as key, triangle*3+j
+		edges.reserve(3*tcnt);
+		for(uint32_t i=0; i<tcnt; i++){
+			if(isValidTriangle(i)){
+				for(uint32_t j=0; j<3; j++){
+					uint32_t a = indices[3*i+(j+1)%3], b = indices[3*i+(j+2)%3];
+					edges.push_back(std::array<uint32_t,3>{std::min(a,b), std::max(a,b), 3*i+j});
+				}
+			}
+		}
+		std::sort(edges.begin(), edges.end());
+		for(uint32_t i=1; i<edges.size(); i++){
+			if(edges[i][0]==edges[i-1][0] && edges[i][1]==edges[i-1][1]){
+				neighbors[edges[i][2]/3][edges[i][2]%3] = edges[i-1][2]/3;
+				neighbors[edges[i-1][2]/3][edges[i-1][2]%3] = edges[i][2]/3;
+			}
+		}
+		//grid with approximately one cell per triangle
+		TFloat minX, minY, maxX, maxY;
+		minX = minY = std::numeric_limits<TFloat>::max();
+		maxX = maxY = std::numeric_limits<TFloat>::lowest();
+		uint32_t validCount = 0;
+		for(uint32_t i=0; i<tcnt; i++){
+			if(isValidTriangle(i)){
+				const TriangleTransformation& t = transformations[i];
+				minX = std::min({minX, t.m0[0], t.m1[0], t.m2[0]});
+				maxX = std::max({maxX, t.m0[0], t.m1[0], t.m2[0]});
+				minY = std::min({minY, t.m0[1], t.m1[1], t.m2[1]});
+				maxY = std::max({maxY, t.m0[1], t.m1[1], t.m2[1]});
+				validCount++;
+			}
+		}
+		if(validCount==0){
+			minX = minY = (TFloat)0;
+			maxX = maxY = (TFloat)1;
+		}
+		TFloat w = std::max(maxX-minX, (TFloat)MIN_TRIANGLE_AREA), h = std::max(maxY-minY, (TFloat)MIN_TRIANGLE_AREA);
+		gridWidth = std::max(1, std::min((int32_t)validCount, (int32_t)std::ceil(std::sqrt(validCount*w/h))));
+		gridHeight = std::max(1, (int32_t)std::ceil((TFloat)validCount/gridWidth));
+		gridMinX = minX;
+		gridMinY = minY;
+		gridCellWidth = w/gridWidth;
+		gridCellHeight = h/gridHeight;
+		gridCellStarts.assign(gridWidth*gridHeight+1, 0);
+		for(uint32_t pass=0; pass<2; pass++){//count, then fill
+			for(uint32_t i=0; i<tcnt; i++){
+				if(isValidTriangle(i)){
+					const TriangleTransformation& t = transformations[i];
+					int32_t x0, y0, x1, y1;
+					calcGridCell(std::min({t.m0[0], t.m1[0], t.m2[0]}), std::min({t.m0[1], t.m1[1], t.m2[1]}), x0, y0);
+					calcGridCell(std::max({t.m0[0], t.m1[0], t.m2[0]}), std::max({t.m0[1], t.m1[1], t.m2[1]}), x1, y1);
+					for(int32_t y=y0; y<=y1; y++){
+						for(int32_t x=x0; x<=x1; x++){
+							uint32_t cell = y*gridWidth+x;
+							if(pass==0){
+								gridCellStarts[cell+1]++;
+							}else{
+								gridTriangles[gridCellStarts[cell]++] = i;
+							}
+						}
+					}
+				}
+			}
+			if(pass==0){
+				for(uint32_t i=1; i<gridCellStarts.size(); i++){gridCellStarts[i] += gridCellStarts[i-1];}
+				gridTriangles.resize(gridCellStarts.back());
+			}else{
+				for(uint32_t i=gridCellStarts.size()-1; i>0; i--){gridCellStarts[i] = gridCellStarts[i-1];}//restore the starts shifted by filling
+				gridCellStarts[0] = 0;
+			}
+		}
+		lastTriangle = 0;
+	}
+	
+	//! Returns a valid triangle which contains the point or -1.
+	//! Walks from startTriangle towards the point (usually few steps for consecutive points of a path) and uses the grid if the walk fails.
+	int32_t findContainingTriangle(const Vector3D<TFloat>& v, uint32_t startTriangle, Vector3D<TFloat>& barycentric) const{
+		int32_t current = startTriangle<transformations.size() && isValidTriangle(startTriangle)?startTriangle:-1;
+		for(uint32_t step=0; step<MAX_TRIANGLE_WALK_STEPS && current>=0; step++){
+			barycentric = transformations[current].toBarycentric * v;
+			if(isInsideTriangle(barycentric)){
+				return current;
+			}
+			uint32_t j = barycentric[0]<barycentric[1]?(barycentric[0]<barycentric[2]?0:2):(barycentric[1]<barycentric[2]?1:2);
+			current = neighbors[current][j];//across the edge opposite of the most negative coordinate
+		}
+		TFloat fx = (v[0]-gridMinX)/gridCellWidth, fy = (v[1]-gridMinY)/gridCellHeight;
+		if(fx>=0 && fy>=0 && fx<=gridWidth && fy<=gridHeight){
+			int32_t cx, cy;
+			calcGridCell(v[0], v[1], cx, cy);
+			uint32_t cell = cy*gridWidth+cx;
+			for(uint32_t i=gridCellStarts[cell]; i<gridCellStarts[cell+1]; i++){
+				barycentric = transformations[gridTriangles[i]].toBarycentric * v;
+				if(isInsideTriangle(barycentric)){
+					return gridTriangles[i];
+				}
+			}
+		}
+		return -1;
+	}
+	
+	//! distance from the point to the rectangle of the cells x0,y0 until x1,y1 (inclusive)
+	TFloat calcDistanceFromGridCells(const Vector2D<TFloat>& point, int32_t x0, int32_t y0, int32_t x1, int32_t y1) const{
+		TFloat dx = std::max({gridMinX+x0*gridCellWidth-point[0], point[0]-(gridMinX+(x1+1)*gridCellWidth), (TFloat)0});
+		TFloat dy = std::max({gridMinY+y0*gridCellHeight-point[1], point[1]-(gridMinY+(y1+1)*gridCellHeight), (TFloat)0});
+		return std::sqrt(dx*dx+dy*dy);
+	}
+	
+	//! Returns the valid triangle with the smallest distance from one of its edges to the point or -1 if there are no valid triangles.
+	//! Searches rings of grid cells around the point until no closer triangle is possible.
+	int32_t findClosestTriangle(const Vector2D<TFloat>& point) const{
+		int32_t cx, cy;
+		calcGridCell(point[0], point[1], cx, cy);
+		TFloat smallestDist = std::numeric_limits<TFloat>::max();
+		int32_t closest = -1;
+		for(int32_t r=0;; r++){
+			int32_t x0 = cx-r, x1 = cx+r, y0 = cy-r, y1 = cy+r;
+			for(int32_t y=std::max(y0,0); y<=std::min(y1,gridHeight-1); y++){
+				bool isBorderRow = y==y0 || y==y1;
+				for(int32_t x=std::max(x0,0); x<=std::min(x1,gridWidth-1); x+=(isBorderRow||x==x1)?1:(x1-x)){
+					uint32_t cell = y*gridWidth+x;
+					for(uint32_t i=gridCellStarts[cell]; i<gridCellStarts[cell+1]; i++){
+						int32_t t = gridTriangles[i];
+						const TriangleTransformation& tt = transformations[t];
+						TFloat dx = std::max({std::min({tt.m0[0], tt.m1[0], tt.m2[0]})-point[0], point[0]-std::max({tt.m0[0], tt.m1[0], tt.m2[0]}), (TFloat)0});
+						TFloat dy = std::max({std::min({tt.m0[1], tt.m1[1], tt.m2[1]})-point[1], point[1]-std::max({tt.m0[1], tt.m1[1], tt.m2[1]}), (TFloat)0});
+						if(dx*dx+dy*dy>smallestDist*smallestDist*(TFloat)1.0001){continue;}//bounding box too far away (tolerance keeps equally distant triangles, e.g. at a shared vertex)
+						TFloat minDist = getMatrixMin(calcDistancesFromEdges(point, tt));
+						if(minDist<smallestDist || (minDist==smallestDist && t<closest)){
+							closest = t;
+							smallestDist = minDist;
+						}
+					}
+				}
+			}
+			//lower bound of the distance to the cells outside of the searched rectangle
+			TFloat outsideDist = std::numeric_limits<TFloat>::max();
+			if(x0>0){outsideDist = std::min(outsideDist, calcDistanceFromGridCells(point, 0, 0, x0-1, gridHeight-1));}
+			if(x1<gridWidth-1){outsideDist = std::min(outsideDist, calcDistanceFromGridCells(point, x1+1, 0, gridWidth-1, gridHeight-1));}
+			if(y0>0){outsideDist = std::min(outsideDist, calcDistanceFromGridCells(point, 0, 0, gridWidth-1, y0-1));}
+			if(y1<gridHeight-1){outsideDist = std::min(outsideDist, calcDistanceFromGridCells(point, 0, y1+1, gridWidth-1, gridHeight-1));}
+			if(outsideDist>=smallestDist){
+				return closest;
+			}
+		}
+	}
 
-	TFloat calcDistanceFromLine(const Vector2D<TFloat>& point, const Vector2D<TFloat>& start, const Vector2D<TFloat>& end, TFloat endStartLength, const Vector2D<TFloat>& endStartNormalized){
+	TFloat calcDistanceFromLine(const Vector2D<TFloat>& point, const Vector2D<TFloat>& start, const Vector2D<TFloat>& end, TFloat endStartLength, const Vector2D<TFloat>& endStartNormalized) const{
 		Vector2D<TFloat> dps = point-start;
 		TFloat projLength = calcDotProduct(dps,endStartNormalized);
 		if(projLength<0){
@@ -49,7 +224,7 @@ class TriangulatedPathTransfrom : public SubdividedPathTransform<TPath, TFloat>{
 		}
 	}
 	
-	Vector3D<TFloat> calcDistancesFromEdges(const Vector2D<TFloat>& point, const TriangleTransformation& t){
+	Vector3D<TFloat> calcDistancesFromEdges(const Vector2D<TFloat>& point, const TriangleTransformation& t) const{
 		return Vector3D<TFloat>{calcDistanceFromLine(point, t.m1, t.m2, t.m2m1Len, t.m2m1), calcDistanceFromLine(point, t.m0, t.m2, t.m2m0Len, t.m2m0), calcDistanceFromLine(point, t.m0, t.m1, t.m1m0Len, t.m1m0)};
 	}
 	
@@ -173,6 +348,7 @@ class TriangulatedPathTransfrom : public SubdividedPathTransform<TPath, TFloat>{
 			t.m2m1Len = calcFrobeniusNorm<decltype(t.m2m1), TFloat>(t.m2m1);
 			t.m2m1 = t.m2m1 * ((TFloat)1)/t.m2m1Len;
 		}
+		recalculateSpatialIndex();
 	}
 	
 	static const std::string id;
@@ -197,34 +373,30 @@ class TriangulatedPathTransfrom : public SubdividedPathTransform<TPath, TFloat>{
 		fill2d = rdMatrix<typename IPathTransform<TPath>::Scalar>(t.toTransformedCartesian * barycentric);
 	}
 	
-	void transformSingle(typename IPathTransform<TPath>::Vector& vector){
+	//! thread safe for different hints (initially 0), the hint is the last found triangle
+	void transformSingle(typename IPathTransform<TPath>::Vector& vector, uint32_t& hint){
 		if(!transformations.empty()){
 			Vector3D<TFloat> v{vector[0], vector[1], (TFloat)1};
-			Vector2D<TFloat> v2d{vector[0], vector[1]};
-			TFloat smallestDist = std::numeric_limits<TFloat>::max();
-			Vector3D<TFloat> closestBary(MatrixInit::IDENTITY);
-			uint32_t closestIndex = 0;
-			for(uint32_t i=0; i<transformations.size(); i++){
-				TriangleTransformation& t = transformations[i];
-				if(t.triangleArea>MIN_TRIANGLE_AREA){
-					Vector3D<TFloat> barycentric = t.toBarycentric * v;
-					if(isInsideTriangle(barycentric)){
-						fillResult(vector, t, barycentric);//vector = rdMatrix<typename IPathTransform<TPath>::Scalar>(t.toTransformedCartesian * barycentric);
-						return;
-					}else{
-						TFloat minDist = getMatrixMin(calcDistancesFromEdges(v2d, t));
-						if(minDist<smallestDist){
-							closestBary = barycentric;
-							closestIndex = i;
-							smallestDist = minDist;
-						}
-					}
-				}
+			Vector3D<TFloat> barycentric;
+			int32_t index = findContainingTriangle(v, hint, barycentric);
+			if(index>=0){
+				hint = index;
+				fillResult(vector, transformations[index], barycentric);//vector = rdMatrix<typename IPathTransform<TPath>::Scalar>(t.toTransformedCartesian * barycentric);
+				return;
 			}
 			//Fallback: Use the transformation of the triangle with the smallest distance to one of the edges
-			fillResult(vector, transformations[closestIndex], closestBary);//vector = rdMatrix<typename IPathTransform<TPath>::Scalar>(transformations[closestIndex].toTransformedCartesian * closestBary);
+			index = findClosestTriangle(Vector2D<TFloat>{vector[0], vector[1]});
+			if(index>=0){
+				fillResult(vector, transformations[index], transformations[index].toBarycentric * v);
+			}else{
+				fillResult(vector, transformations[0], Vector3D<TFloat>(MatrixInit::IDENTITY));
+			}
 		}
 	}
+	
+	void transformSingle(typename IPathTransform<TPath>::Vector& vector){
+		transformSingle(vector, lastTriangle);
+	}
 
 };
 
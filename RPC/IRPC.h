@@ -472,6 +472,10 @@ class IMetaProtocolHandler{
 	
 	//! returns true if a compression feature of the underlying protocol shall be used (e.g. ZSocket), this flag may be determined during protocol negotiation
 	virtual bool useCompression() const{return false;}
+	
+	//! name of the ZSocket codec (see createZSocket) if useCompression() is true, may be agreed upon during protocol negotiation
+	//! empty: classic zlib stream which is compatible with older peers
+	virtual std::string getCompressionCodec() const{return "";}
 
 };
 
@@ -4,6 +4,7 @@
 #include <timing.h>
 #include <StringHelpers.h>
 #include <ZSocket.h>
+#include <Profiler.h>
 
 #include <cmath>
 #include <cstring>
@@ -69,13 +70,29 @@ void* JSONRPC2Client::clientMain(void* p){
 	const bool sendPing = client->pingSendPeriod != PING_DISABLE_SEND_PERIOD;
 	const double pingSendPeriod = ((double)client->pingSendPeriod)/1000.0;
 	if(client->socket==NULL){
-		client->socket = connectSocketForAddressList(std::list<IIPAddress*>(1, client->address), client->connectTimeout);
+		if(client->address){
+			client->socket = connectSocketForAddressList(std::list<IIPAddress*>(1, client->address), client->connectTimeout);
+		}else{
+			double t = getSecs();
+			std::list<IIPAddress*> l = queryIPAddressesForHostName(client->hostName, client->port, client->connectTimeout);
+			uint32_t elapsed = (uint32_t)(1000.0*(getSecs()-t));
+			if(elapsed<client->connectTimeout){
+				client->socket = connectSocketForAddressList(l, client->connectTimeout-elapsed);
+			}
+			deleteAddressList(l);
+		}
 	}
 	bool runThread = client->socket!=NULL;
 	if(client->metaProtocolHandler!=NULL && runThread){
 		runThread = client->metaProtocolHandler->tryNegotiate(client->socket);
 		if(runThread && client->metaProtocolHandler->useCompression()){
-			client->socket = new ZSocket(client->socket);
+			ZSocket* z = createZSocket(client->socket, client->metaProtocolHandler->getCompressionCodec());
+			if(z){
+				client->socket = z;
+			}else{
+				std::cerr << "Unknown compression codec: " << client->metaProtocolHandler->getCompressionCodec() << std::endl;
+				runThread = false;
+			}
 		}
 	}
 	lockMutex(client->mutexSync);
@@ -300,6 +317,22 @@ void JSONRPC2Client::connect(const IIPAddress& address, uint32_t pingSendPeriod,
 	assert(res);
 }
 
+void JSONRPC2Client::connect(const std::string& hostName, uint16_t port, uint32_t pingSendPeriod, uint32_t pingTimeout, uint32_t connectTimeout, IMetaProtocolHandler* metaProtocolHandler){
+	disconnect();
+	this->socket = NULL;
+	this->pingSendPeriod = pingSendPeriod;
+	this->pingTimeout = pingTimeout;
+	this->connectTimeout = connectTimeout;
+	this->address = NULL;
+	this->hostName = hostName;
+	this->port = port;
+	this->metaProtocolHandler = metaProtocolHandler;
+	syncedState = state = IRPCClient::CONNECTING;
+	mustJoin = syncExit = false;
+	bool res = createThread(clientThread, JSONRPC2Client::clientMain, (void*)this, true);
+	assert(res);
+}
+
 void JSONRPC2Client::useSocket(ICommunicationEndpoint* socket, uint32_t pingTimeout, uint32_t pingSendPeriod){
 	disconnect();
 	this->socket = socket;
@@ -444,6 +477,7 @@ void JSONRPC2Client::removeProcedureCaller(IRemoteProcedureCaller* caller){
 }
 
 void JSONRPC2Client::update(){
+	PROFILE_SCOPE("JSONRPC2Client::update");
 	//Sync
 	lockMutex(mutexSync);
 	syncedLastReceived = lastReceived;
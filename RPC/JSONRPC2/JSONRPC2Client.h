@@ -73,6 +73,8 @@ class JSONRPC2Client : public IRPCClient{
 	std::list<IRPCValue*> clientToReceive;
 	JSONParser* parser;
 	IIPAddress* address;
+	std::string hostName;//only used if address is NULL
+	uint16_t port;
 	ICommunicationEndpoint* socket;
 	uint32_t pingSendPeriod, pingTimeout, connectTimeout;
 	
@@ -101,6 +103,9 @@ class JSONRPC2Client : public IRPCClient{
 
 	void connect(const IIPAddress& address, uint32_t pingSendPeriod, uint32_t pingTimeout, uint32_t connectTimeout, IMetaProtocolHandler* metaProtocolHandler = NULL);
 	
+	//! resolves the host name in the client thread, connectTimeout includes the host name resolution, all resolved addresses are tried (see connectSocketForAddressList)
+	void connect(const std::string& hostName, uint16_t port, uint32_t pingSendPeriod, uint32_t pingTimeout, uint32_t connectTimeout, IMetaProtocolHandler* metaProtocolHandler = NULL);
+	
 	//! Alternative to connect, also works with arbitrary communication endpoints (only need to implement send and recv)
 	//! socket will be deleted on exit
 	void useSocket(ICommunicationEndpoint* socket, uint32_t pingTimeout, uint32_t pingSendPeriod = PING_DISABLE_SEND_PERIOD);
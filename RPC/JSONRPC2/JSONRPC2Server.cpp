@@ -3,21 +3,62 @@
 
 #include <SimpleSockets.h>
 #include <ZSocket.h>
+#include <TCPAcceptor.h>
 
 #include <iostream>
+#include <chrono>
+#include <algorithm>
 
-JSONRPC2Server::JSONRPC2Server(uint16_t port, uint32_t pingTimeout, IMetaProtocolHandler* handler, int maxPendingConnections){
-	serverSocket = new IPv6TCPSocket();
-	good = serverSocket->bind(port);
-	if(good){
-		good = serverSocket->listen(maxPendingConnections);
-	}
+JSONRPC2Server::JSONRPC2Server(uint16_t port, uint32_t pingTimeout, IMetaProtocolHandler* handler, int maxPendingConnections, uint32_t acceptThreadCount, uint32_t negotiationThreadCount){
 	this->pingTimeout = pingTimeout;
 	this->handler = handler;
+	serverSocket = NULL;
+	acceptor = NULL;
+	stopping = false;
+	if(acceptThreadCount>0){
+		if(handler){
+			for(uint32_t i=0; i<std::max(negotiationThreadCount, (uint32_t)1); i++){
+				negotiationThreads.emplace_back([this](){negotiationMain();});
+			}
+		}
+		acceptor = new TCPAcceptor(port, acceptThreadCount, maxPendingConnections, [this](IPv6TCPSocket* s, const IPv6Address& address){
+			if(this->handler){//the negotiation may block, the accept threads only hand over the socket
+				{
+					std::lock_guard<std::mutex> lock(m);
+					unnegotiatedSockets.emplace_back(s, new IPv6Address(address));
+				}
+				negotiationCV.notify_one();
+			}else{
+				addAcceptedClient(createClient(s), new IPv6Address(address));
+			}
+		});
+		good = acceptor->isGood();
+	}else{
+		serverSocket = new IPv6TCPSocket();
+		good = serverSocket->bind(port);
+		if(good){
+			good = serverSocket->listen(maxPendingConnections);
+		}
+	}
 }
 	
 JSONRPC2Server::~JSONRPC2Server(){
+	delete acceptor;//joins
+	{
+		std::lock_guard<std::mutex> lock(m);
+		stopping = true;
+	}
+	negotiationCV.notify_all();
+	for(std::thread& t : negotiationThreads){t.join();}//the running negotiations finish first
+	for(auto& s : unnegotiatedSockets){
+		delete s.first;
+		delete s.second;
+	}
 	delete serverSocket;
+	for(auto& c : acceptedClients){
+		delete c.first;
+		delete c.second;
+	}
 }
 	
 bool JSONRPC2Server::isGood(){
@@ -25,22 +66,66 @@ bool JSONRPC2Server::isGood(){
 }
 	
 JSONRPC2Client* JSONRPC2Server::accept(uint32_t timeout, IPv6Address* peerAddress){
+	if(acceptor){
+		std::unique_lock<std::mutex> lock(m);
+		if(timeout>0){
+			cv.wait_for(lock, std::chrono::milliseconds(timeout), [this](){return !acceptedClients.empty();});
+		}
+		if(acceptedClients.empty()){return NULL;}
+		JSONRPC2Client* client = acceptedClients.front().first;
+		if(peerAddress){*peerAddress = *(acceptedClients.front().second);}
+		delete acceptedClients.front().second;
+		acceptedClients.pop_front();
+		return client;
+	}
 	ICommunicationEndpoint* clientSocket = serverSocket->accept(timeout, peerAddress);
-	if(clientSocket){
-		if(handler){
-			bool res = handler->tryNegotiate(clientSocket);
-			if(!res){
-				std::cerr << "Negotiation unsuccessful" << std::endl;
+	return clientSocket?createClient(clientSocket):NULL;
+}
+
+void JSONRPC2Server::addAcceptedClient(JSONRPC2Client* client, IPv6Address* address){
+	if(!client){
+		delete address;
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(m);
+		acceptedClients.emplace_back(client, address);
+	}
+	cv.notify_one();
+}
+
+void JSONRPC2Server::negotiationMain(){
+	std::unique_lock<std::mutex> lock(m);
+	while(true){
+		negotiationCV.wait(lock, [this](){return stopping || !unnegotiatedSockets.empty();});
+		if(stopping){return;}
+		std::pair<IPv6TCPSocket*, IPv6Address*> s = unnegotiatedSockets.front();
+		unnegotiatedSockets.pop_front();
+		lock.unlock();
+		addAcceptedClient(createClient(s.first), s.second);
+		lock.lock();
+	}
+}
+
+JSONRPC2Client* JSONRPC2Server::createClient(ICommunicationEndpoint* clientSocket){
+	if(handler){
+		bool res = handler->tryNegotiate(clientSocket);
+		if(!res){
+			std::cerr << "Negotiation unsuccessful" << std::endl;
+			delete clientSocket;
+			return NULL;
+		}
+		if(handler->useCompression()){
+			ZSocket* z = createZSocket(clientSocket, handler->getCompressionCodec());
+			if(!z){
+				std::cerr << "Unknown compression codec: " << handler->getCompressionCodec() << std::endl;
 				delete clientSocket;
 				return NULL;
 			}
-			if(handler->useCompression()){
-				clientSocket = new ZSocket(clientSocket);
-			}
+			clientSocket = z;
 		}
-		JSONRPC2Client* client = new JSONRPC2Client();
-		client->useSocket(clientSocket, pingTimeout, PING_DISABLE_SEND_PERIOD);
-		return client;
 	}
-	return NULL;
+	JSONRPC2Client* client = new JSONRPC2Client();
+	client->useSocket(clientSocket, pingTimeout, PING_DISABLE_SEND_PERIOD);
+	return client;
 }
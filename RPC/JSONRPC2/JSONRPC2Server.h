@@ -3,8 +3,15 @@
 
 #include <IRPC.h>
 
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+#include <list>
+
 class JSONRPC2Client;
 class IPv6TCPSocket;
+class TCPAcceptor;
 
 //! Listens for connections, negotiates the protocol if applicable and returns the server-side JSONRPC2Client representation for a newly connected client
 //! To create servers over arbitrary protocols use the client implementation for a server side representation of a client together with the useSocket function instead (see this implementation as example).
@@ -13,14 +20,34 @@ class JSONRPC2Server{
 	private:
 	
 	IPv6TCPSocket* serverSocket;
+	TCPAcceptor* acceptor;
 	bool good;
 	IMetaProtocolHandler* handler;
 	uint32_t pingTimeout;
 	
+	std::mutex m;
+	std::condition_variable cv;
+	std::list<std::pair<JSONRPC2Client*, IPv6Address*> > acceptedClients;//by the accept or negotiation threads
+	
+	std::condition_variable negotiationCV;
+	std::list<std::pair<IPv6TCPSocket*, IPv6Address*> > unnegotiatedSockets;//accepted, waiting for a negotiation thread
+	std::vector<std::thread> negotiationThreads;
+	bool stopping;
+	
+	//! negotiates if applicable, NULL if unsuccessful (socket deleted)
+	JSONRPC2Client* createClient(ICommunicationEndpoint* clientSocket);
+	
+	void addAcceptedClient(JSONRPC2Client* client, IPv6Address* address);
+	
+	void negotiationMain();
+	
 	public:
 	
 	//! creates the server socket, binds and starts listening
-	JSONRPC2Server(uint16_t port, uint32_t pingTimeout, IMetaProtocolHandler* handler = NULL, int maxPendingConnections = 10);
+	//! acceptThreadCount: 0: accept polls the server socket in the calling thread, >0: connections are accepted in background threads with one listening socket each (SO_REUSEPORT, see TCPAcceptor), accept returns the ready clients
+	//! negotiationThreadCount: if acceptThreadCount>0 and a handler is given the accepted connections are negotiated by these threads (at least 1), a slow peer only blocks one of them and never the accept threads
+	//! handler must be thread safe if acceptThreadCount>0 and negotiationThreadCount>1
+	JSONRPC2Server(uint16_t port, uint32_t pingTimeout, IMetaProtocolHandler* handler = NULL, int maxPendingConnections = 10, uint32_t acceptThreadCount = 0, uint32_t negotiationThreadCount = 4);
 	
 	//! note: handler won't be deleted
 	~JSONRPC2Server();
@@ -5,6 +5,11 @@
 #include <Threading.h>
 #include <timing.h>
 #include <StringHelpers.h>
+#include <SimpleSockets.h>
+
+#ifdef __linux__
+#include <netinet/tcp.h>
+#endif
 
 #ifndef NO_CURL
 #include <platforms.h>
@@ -17,6 +22,15 @@
 #include <cassert>
 #include <iostream>
 #include <sstream>
+#include <set>
+#include <map>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
 
 #ifdef DEBUG
 #define PRINT_DEBUG_INFO
@@ -29,14 +43,30 @@ struct JSONRequest{
 	std::vector<IRPCValue*> values;
 	uint32_t jsonId;
 	bool deleteValues;
+	uint64_t enqueueTime;//µs, pipelining mode only
+	uint64_t deadline;//µs, 0: no deadline
+};
+
+struct CallerInfo{
+	IRemoteProcedureCaller* caller;
+	uint32_t id;//id from caller
+	uint64_t deadline;//µs, 0: no deadline
 };
 
 static const std::string requestSenderErrorMessage[IRequestSender::RESPONSE_TYPE_COUNT] = {
 	"Success",
 	"Sending of request unsuccessful.",
-	"Bad response from server."
+	"Bad response from server.",
+	"Request aborted after the deadline of another call."
 };
 
+static const std::string missingResponseErrorMessage = "Missing response from server.";
+static const std::string deadlineErrorMessage = "Deadline exceeded.";
+
+static IRPCValue* createErrorResponse(uint32_t jsonId, int32_t code, const std::string& message){
+	return new ObjectValue({{"jsonrpc", new StringValue("2.0")}, {"id", new IntegerValue(jsonId)}, {"error", new ObjectValue({{"code", new IntegerValue(code)}, {"message", new StringValue(message)}})}});
+}
+
 class RequestBasedJSONRPC2ClientPrivate{
 	
 	public:
@@ -44,7 +74,9 @@ class RequestBasedJSONRPC2ClientPrivate{
 	//main thread only
 	Thread t;
 	UniqueIdentifierGenerator<uint32_t> jsonIdGen;
-	std::map<uint32_t, std::pair<IRemoteProcedureCaller*, uint32_t> > jsonId2Caller;//jsonId -> (Caller, idFromCaller)
+	std::map<uint32_t, CallerInfo> jsonId2Caller;//jsonId -> (Caller, idFromCaller, deadline)
+	std::list<std::pair<uint64_t, uint32_t> > deadlines;//(deadline, jsonId) in call order
+	std::set<uint32_t> abandonedIds;//json ids without caller (deadline exceeded / caller removed) which are returned as soon as the response (or error) arrives
 	std::list<JSONRequest> mainToSend;
 	std::list<IRPCValue*> mainToReceive;
 	
@@ -53,25 +85,71 @@ class RequestBasedJSONRPC2ClientPrivate{
 	bool mustExit;
 	std::list<JSONRequest> syncToSend;
 	std::list<IRPCValue*> syncToReceive;
+	std::atomic<uint32_t> pendingCallCount;
 	
-	//rpc thread only
+	//rpc thread(s) only
 	IRequestSender* sender;
 	uint32_t maxSendCount;
 	bool escapeNonPrintableChars;
 	
-	RequestBasedJSONRPC2ClientPrivate(IRequestSender* sender, uint32_t autoRetries, bool escapeNonPrintableChars):sender(sender),maxSendCount(autoRetries+1),escapeNonPrintableChars(escapeNonPrintableChars){
+	//pipelining mode
+	bool pipelining;
+	RequestBasedJSONRPC2Client::PipeliningParams params;
+	std::vector<IRequestSender*> senders;
+	std::vector<Thread> workers;
+	std::mutex queueMutex;
+	std::condition_variable queueCondition;
+	std::deque<JSONRequest> queue;//guarded by queueMutex
+	uint32_t nextSenderIndex;//guarded by queueMutex
+	bool mustExitWorkers;//guarded by queueMutex
+	
+	RequestBasedJSONRPC2ClientPrivate(IRequestSender* sender, uint32_t autoRetries, bool escapeNonPrintableChars):pendingCallCount(0),sender(sender),maxSendCount(autoRetries+1),escapeNonPrintableChars(escapeNonPrintableChars),pipelining(false){
 		initMutex(m);
 		mustExit = false;
 		bool success = createThread(t, threadWrapper, this, true);
 		assert(success);
 	}
 	
+	RequestBasedJSONRPC2ClientPrivate(const RequestSenderFactory& senderFactory, uint32_t autoRetries, const RequestBasedJSONRPC2Client::PipeliningParams& params, bool escapeNonPrintableChars):pendingCallCount(0),sender(NULL),maxSendCount(autoRetries+1),escapeNonPrintableChars(escapeNonPrintableChars),pipelining(true),params(params),nextSenderIndex(0),mustExitWorkers(false){
+		initMutex(m);
+		mustExit = false;
+		this->params.connectionCount = std::max(this->params.connectionCount, 1u);
+		this->params.maxCallsPerRequest = std::max(this->params.maxCallsPerRequest, 1u);
+		for(uint32_t i=0; i<this->params.connectionCount; i++){
+			senders.push_back(senderFactory());
+		}
+		for(uint32_t i=0; i<senders.size(); i++){
+			Thread w;
+			if(createThread(w, workerWrapper, this, true)){
+				workers.push_back(w);
+			}else{
+				std::cerr << "Error: Unable to create RPC worker thread." << std::endl;
+			}
+		}
+	}
+	
 	~RequestBasedJSONRPC2ClientPrivate(){
-		lockMutex(m);
-		mustExit = true;
-		unlockMutex(m);
-		bool success = joinThread(t);
-		assert(success);
+		if(pipelining){
+			std::unique_lock<std::mutex> lock(queueMutex);
+			mustExitWorkers = true;
+			queueCondition.notify_all();
+			lock.unlock();
+			for(Thread& w : workers){
+				if(!joinThread(w)){
+					std::cerr << "Error: Unable to join RPC worker thread." << std::endl;
+				}
+			}
+			for(JSONRequest& r : queue){
+				if(r.deleteValues){deleteAllElements(r.values);}
+			}
+			deleteAllElements(senders);
+		}else{
+			lockMutex(m);
+			mustExit = true;
+			unlockMutex(m);
+			bool success = joinThread(t);
+			assert(success);
+		}
 		deleteMutex(m);
 		deleteAllElements(syncToReceive);
 		for(JSONRequest& r : syncToSend){deleteAllElements(r.values);}
@@ -79,6 +157,71 @@ class RequestBasedJSONRPC2ClientPrivate{
 		for(JSONRequest& r : mainToSend){deleteAllElements(r.values);}
 	}
 	
+	//! sends the requests of the batch as a single request and appends the responses to out, there is exactly one response or error for each request with json id
+	void processBatch(IRequestSender* sender, std::list<JSONRequest>& batch, JSONParser& parser, std::list<IRPCValue*>& out){
+		uint64_t now = getMicroSecs();
+		uint64_t deadline = 0;
+		std::map<uint32_t, uint64_t> expectedIds;//json id -> deadline
+		std::stringstream ss;
+		for(JSONRequest& v : batch){
+			if(v.deadline!=0 && v.deadline<=now){//not worth sending
+				if(v.jsonId!=invalidJSONId){out.push_back(createErrorResponse(v.jsonId, -32000, deadlineErrorMessage));}
+			}else{
+				if(v.deadline!=0 && (deadline==0 || v.deadline<deadline)){deadline = v.deadline;}
+				ss << makeJSONRPCRequest(v.procedure, v.values, v.jsonId==invalidJSONId?NULL:&v.jsonId, escapeNonPrintableChars);
+				if(v.jsonId!=invalidJSONId){expectedIds[v.jsonId] = v.deadline;}
+			}
+			if(v.deleteValues){deleteAllElements(v.values);}
+		}
+		std::string toSend = ss.str();
+		if(toSend.empty()){return;}
+		#ifdef PRINT_DEBUG_INFO
+		std::cout << "send: " << toSend << std::endl;//TODO for debugging
+		#endif
+		IRequestSender::ResponseType t = IRequestSender::ERROR_NO_CONNECTION;
+		std::string result;
+		for(uint32_t i=0; i<maxSendCount && t==IRequestSender::ERROR_NO_CONNECTION; i++){
+			if(deadline!=0){
+				now = getMicroSecs();
+				if(now>=deadline){break;}
+				sender->setTimeout((deadline-now+999)/1000);
+			}
+			t = sender->sendRequest(toSend, result);
+		}
+		if(t==IRequestSender::SUCCESS){
+			parser.reset();
+			for(uint32_t i=0; i<result.size(); i++){
+				IJSONParser::State state = parser.parse(result[i], result[i+1]);//i+1 safe since result[result.size()]=='\0' (guranteed in c++11)
+				if(state==IJSONParser::SUCCESS){
+					IRPCValue* v = parser.stealResult();
+					if(v->getType()==IRPCValue::OBJECT){
+						IntegerValue* id = getObjectField<IntegerValue>((ObjectValue*)v, "id");
+						if(id){expectedIds.erase(id->value);}
+					}
+					out.push_back(v);
+					#ifdef PRINT_DEBUG_INFO
+					std::cout << "receive: " << convertRPCValueToJSONString(*v, true) << std::endl;//TODO for debugging
+					#endif
+					parser.reset();
+				}else if(state==IJSONParser::ERROR){
+					parser.reset();
+				}
+			}
+			for(auto& e : expectedIds){
+				out.push_back(createErrorResponse(e.first, -32603, missingResponseErrorMessage));
+			}
+		}else{
+			now = getMicroSecs();
+			for(auto& e : expectedIds){
+				if(e.second!=0 && (e.second<=now || (t==IRequestSender::ERROR_TIMEOUT && e.second<=deadline))){//the sender measures the timeout in ms and may give up slightly before the deadline
+					out.push_back(createErrorResponse(e.first, -32000, deadlineErrorMessage));
+				}else{
+					out.push_back(createErrorResponse(e.first, -32603, requestSenderErrorMessage[t]));
+				}
+			}
+		}
+	}
+	
 	void threadMain(){
 		std::list<JSONRequest> clientToSend;
 		std::list<IRPCValue*> clientToReceive;
@@ -92,42 +235,10 @@ class RequestBasedJSONRPC2ClientPrivate{
 			unlockMutex(m);
 			if(running){
 				if(!clientToSend.empty()){
-					std::stringstream ss;
-					for(JSONRequest& v : clientToSend){
-						ss << makeJSONRPCRequest(v.procedure, v.values, v.jsonId==invalidJSONId?NULL:&v.jsonId, escapeNonPrintableChars);
-						if(v.deleteValues){deleteAllElements(v.values);}
-					}
-					std::string toSend = ss.str();
-					#ifdef PRINT_DEBUG_INFO
-					std::cout << "send: " << toSend << std::endl;//TODO for debugging
-					#endif
-					IRequestSender::ResponseType t = IRequestSender::ERROR_NO_CONNECTION;
-					std::string result;
-					for(uint32_t i=0; i<maxSendCount && t==IRequestSender::ERROR_NO_CONNECTION; i++){
-						t = sender->sendRequest(toSend, result);
-					}
-					if(t==IRequestSender::SUCCESS){
-						parser.reset();
-						for(uint32_t i=0; i<result.size(); i++){
-							IJSONParser::State state = parser.parse(result[i], result[i+1]);//i+1 safe since result[result.size()]=='\0' (guranteed in c++11)
-							if(state==IJSONParser::SUCCESS){
-								clientToReceive.push_back(parser.stealResult());
-								#ifdef PRINT_DEBUG_INFO
-								std::cout << "receive: " << convertRPCValueToJSONString(*clientToReceive.back(), true) << std::endl;//TODO for debugging
-								#endif
-								parser.reset();
-							}else if(state==IJSONParser::ERROR){
-								parser.reset();
-							}
-						}
-					}else{
-						for(JSONRequest& v : clientToSend){
-							if(v.jsonId!=invalidJSONId){
-								clientToReceive.push_back(new ObjectValue({{"jsonrpc", new StringValue("2.0")}, {"id", new IntegerValue(v.jsonId)}, {"error", new ObjectValue({{"code", new IntegerValue(-32603)}, {"message", new StringValue(requestSenderErrorMessage[t])}})}}));
-							}
-						}
-					}
+					uint32_t callCount = clientToSend.size();
+					processBatch(sender, clientToSend, parser, clientToReceive);
 					clientToSend.clear();
+					pendingCallCount -= callCount;
 				}else{
 					delay(5);
 				}
@@ -142,6 +253,62 @@ class RequestBasedJSONRPC2ClientPrivate{
 		return NULL;
 	}
 	
+	//! takes up to maxCallsPerRequest calls from the queue as soon as the coalescing window of the oldest call has elapsed or enough calls are queued
+	void workerMain(){
+		JSONParser parser;
+		std::unique_lock<std::mutex> lock(queueMutex);
+		IRequestSender* workerSender = senders[nextSenderIndex++];
+		while(!mustExitWorkers){
+			if(queue.empty()){
+				queueCondition.wait(lock);
+				continue;
+			}
+			uint64_t now = getMicroSecs();
+			uint64_t sendTime = queue.front().enqueueTime+1000*(uint64_t)params.coalescingWindow;
+			if(queue.size()<params.maxCallsPerRequest && now<sendTime){
+				queueCondition.wait_for(lock, std::chrono::microseconds(sendTime-now));
+				continue;
+			}
+			std::list<JSONRequest> batch;
+			while(!queue.empty() && batch.size()<params.maxCallsPerRequest){
+				batch.push_back(std::move(queue.front()));
+				queue.pop_front();
+			}
+			if(!queue.empty()){queueCondition.notify_one();}
+			lock.unlock();
+			uint32_t callCount = batch.size();
+			std::list<IRPCValue*> received;
+			processBatch(workerSender, batch, parser, received);
+			lockMutex(m);
+			syncToReceive.splice(syncToReceive.end(), received);
+			unlockMutex(m);
+			pendingCallCount -= callCount;
+			lock.lock();
+		}
+	}
+	
+	static void* workerWrapper(void* data){
+		((RequestBasedJSONRPC2ClientPrivate*)data)->workerMain();
+		return NULL;
+	}
+	
+	void enqueue(JSONRequest&& request){
+		pendingCallCount++;
+		if(pipelining){
+			request.enqueueTime = getMicroSecs();
+			std::unique_lock<std::mutex> lock(queueMutex);
+			queue.push_back(std::move(request));
+			queueCondition.notify_one();
+		}else{
+			mainToSend.push_back(std::move(request));
+		}
+	}
+	
+	//! returns the id as soon as no more responses can arrive for it
+	void abandonId(uint32_t jsonId){
+		abandonedIds.insert(jsonId);
+	}
+	
 	void updateMainThread(){
 		lockMutex(m);
 		syncToSend.splice(syncToSend.end(), mainToSend);
@@ -159,19 +326,26 @@ class RequestBasedJSONRPC2ClientPrivate{
 					if(id){
 						uint32_t jsonId = id->value;
 						auto it = jsonId2Caller.find(jsonId);
-						if(it != jsonId2Caller.end()){
+						auto abandonedIt = abandonedIds.find(jsonId);
+						if(abandonedIt != abandonedIds.end()){
+							abandonedIds.erase(abandonedIt);
+							jsonIdGen.returnId(jsonId);
+							delete result;
+						}else if(it != jsonId2Caller.end()){
 							if(!result && error){
 								IntegerValue* code = getObjectField<IntegerValue>(error, "code");
 								StringValue* msg = getObjectField<StringValue>(error, "message");
 								if(code && msg){
-									it->second.first->OnProcedureError(code->value, msg->value, stealObjectField(error, "data"), it->second.second);
+									CallerInfo c = it->second;
 									jsonIdGen.returnId(jsonId);
 									jsonId2Caller.erase(it);
+									c.caller->OnProcedureError(code->value, msg->value, stealObjectField(error, "data"), c.id);
 								}
 							}else if(result && !error){
-								it->second.first->OnProcedureResult(result, it->second.second);
+								CallerInfo c = it->second;
 								jsonIdGen.returnId(jsonId);
 								jsonId2Caller.erase(it);
+								c.caller->OnProcedureResult(result, c.id);
 							}else{
 								if(result){o->values["result"] = result;}//put back for proper error output and delete later on
 								std::cerr << "Error: Invalid / unsupported JSON-RPC: " << convertRPCValueToJSONString(*o, true) << std::endl;
@@ -192,6 +366,18 @@ class RequestBasedJSONRPC2ClientPrivate{
 			}
 			delete v;
 		}
+		uint64_t now = getMicroSecs();
+		while(!deadlines.empty() && deadlines.front().first<=now){
+			std::pair<uint64_t, uint32_t> d = deadlines.front();
+			deadlines.pop_front();
+			auto it = jsonId2Caller.find(d.second);
+			if(it != jsonId2Caller.end() && it->second.deadline==d.first){//otherwise already answered (and the json id may have been reused)
+				CallerInfo c = it->second;
+				jsonId2Caller.erase(it);
+				abandonId(d.second);
+				c.caller->OnProcedureError(-32000, deadlineErrorMessage, NULL, c.id);
+			}
+		}
 	}
 	
 };
@@ -199,18 +385,34 @@ class RequestBasedJSONRPC2ClientPrivate{
 RequestBasedJSONRPC2Client::RequestBasedJSONRPC2Client(IRequestSender* sender, uint32_t autoRetries, bool escapeNonPrintableChars){
 	p = new RequestBasedJSONRPC2ClientPrivate(sender, autoRetries, escapeNonPrintableChars);
 }
+
+RequestBasedJSONRPC2Client::RequestBasedJSONRPC2Client(const RequestSenderFactory& senderFactory, uint32_t autoRetries, const PipeliningParams& params, bool escapeNonPrintableChars){
+	p = new RequestBasedJSONRPC2ClientPrivate(senderFactory, autoRetries, params, escapeNonPrintableChars);
+}
 	
 RequestBasedJSONRPC2Client::~RequestBasedJSONRPC2Client(){
 	delete p;
 }
 
+uint32_t RequestBasedJSONRPC2Client::getPendingCallCount() const{
+	return p->pendingCallCount;
+}
+
 bool RequestBasedJSONRPC2Client::callRemoteProcedure(const std::string& procedure, const std::vector<IRPCValue*>& values, IRemoteProcedureCaller* caller, uint32_t id, bool deleteValues){
+	if(p->pipelining && p->pendingCallCount>=p->params.maxPendingCalls){
+		if(deleteValues){
+			for(IRPCValue* v : values){delete v;}
+		}
+		return false;
+	}
+	uint64_t deadline = (p->pipelining && p->params.deadline>0)?(getMicroSecs()+1000*(uint64_t)p->params.deadline):0;
 	if(caller!=NULL){
 		uint32_t jsonId = p->jsonIdGen.getUniqueId();
-		p->mainToSend.push_back(JSONRequest{procedure, values, jsonId, deleteValues});
-		p->jsonId2Caller[jsonId] = std::make_pair(caller, id);
+		p->jsonId2Caller[jsonId] = CallerInfo{caller, id, deadline};
+		if(deadline!=0){p->deadlines.push_back(std::make_pair(deadline, jsonId));}
+		p->enqueue(JSONRequest{procedure, values, jsonId, deleteValues, 0, deadline});
 	}else{
-		p->mainToSend.push_back(JSONRequest{procedure, values, invalidJSONId, deleteValues});
+		p->enqueue(JSONRequest{procedure, values, invalidJSONId, deleteValues, 0, deadline});
 	}
 	return true;
 }
@@ -226,9 +428,9 @@ void RequestBasedJSONRPC2Client::unregisterCallReceiver(const std::string& proce
 void RequestBasedJSONRPC2Client::removeProcedureCaller(IRemoteProcedureCaller* caller){
 	auto it = p->jsonId2Caller.begin();
 	while(it != p->jsonId2Caller.end()){//inefficient, but ok since this method should be called when the caller is deleted which usually occurs at the end of the program
-		if(it->second.first == caller){
+		if(it->second.caller == caller){
 			auto it2 = it; ++it2;
-			p->jsonIdGen.returnId(it->second.second);
+			p->abandonId(it->first);//the request may still be in flight
 			p->jsonId2Caller.erase(it);
 			it = it2;
 		}else{
@@ -318,8 +520,150 @@ IRequestSender::ResponseType CURLRequestSender::sendRequest(const std::string& t
 	CURLcode r = curl_easy_perform(curl);
 	result = response.str();
 	response.str("");
+	if(r==CURLE_OPERATION_TIMEDOUT){return IRequestSender::ERROR_TIMEOUT;}
 	return r==0?(isGoodResponse?(IRequestSender::SUCCESS):(IRequestSender::ERROR_BAD_RESPONSE)):(IRequestSender::ERROR_NO_CONNECTION);
 	#endif
 }
 
+void CURLRequestSender::setTimeout(uint32_t timeout){
+	#ifndef IOS_SIMULATOR
+	curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, (long)timeout);
+	#endif
+}
+
 #endif
+
+//! a persistent connection is not reused after this amount of requests
+static constexpr uint32_t maxRequestsPerConnection = 1000;
+
+//! case insensitive header lookup in the (lower case) header, returns the trimmed value or an empty string
+static std::string getHeaderValue(const std::string& lowerCaseHeader, const std::string& lowerCaseName){
+	size_t pos = lowerCaseHeader.find("\r\n"+lowerCaseName+":");
+	if(pos==std::string::npos){return "";}
+	size_t start = pos+lowerCaseName.size()+3;
+	size_t end = lowerCaseHeader.find("\r\n", start);
+	std::string value = lowerCaseHeader.substr(start, end-start);
+	size_t first = value.find_first_not_of(" \t");
+	size_t last = value.find_last_not_of(" \t");
+	return first==std::string::npos?"":value.substr(first, last-first+1);
+}
+
+HTTPRequestSender::HTTPRequestSender(const std::string& url, uint32_t connectTimeout):port(80),connectTimeout(connectTimeout),timeout(0),socket(NULL),requestsOnConnection(0),connectionCount(0){
+	std::string rest = isPrefixEqual(url, "http://")?url.substr(7):url;
+	size_t pathStart = rest.find('/');
+	std::string path = pathStart==std::string::npos?"/":rest.substr(pathStart);
+	std::string hostPort = rest.substr(0, pathStart);
+	size_t portStart = hostPort.rfind(':');
+	if(portStart!=std::string::npos && hostPort.find(']', portStart)==std::string::npos){
+		port = atoi(hostPort.substr(portStart+1).c_str());
+		hostName = hostPort.substr(0, portStart);
+	}else{
+		hostName = hostPort;
+	}
+	if(hostName.size()>=2 && hostName[0]=='[' && hostName[hostName.size()-1]==']'){hostName = hostName.substr(1, hostName.size()-2);}
+	requestHeader = "POST "+path+" HTTP/1.1\r\nHost: "+hostPort+"\r\nContent-Type: application/json\r\nAccept: application/json\r\nConnection: keep-alive\r\nContent-Length: ";
+}
+
+HTTPRequestSender::~HTTPRequestSender(){
+	closeConnection();
+}
+
+void HTTPRequestSender::closeConnection(){
+	delete socket;
+	socket = NULL;
+	requestsOnConnection = 0;
+}
+
+void HTTPRequestSender::setTimeout(uint32_t timeout){
+	this->timeout = timeout;
+}
+
+uint32_t HTTPRequestSender::getConnectionCount() const{
+	return connectionCount;
+}
+
+IRequestSender::ResponseType HTTPRequestSender::sendRequest(const std::string& toSend, std::string& result){
+	uint64_t deadline = timeout==0?0:(getMilliSecs()+timeout);
+	bool mayRetry = false;
+	bool reused = socket!=NULL;
+	IRequestSender::ResponseType res = exchange(toSend, result, deadline, mayRetry);
+	if(res!=IRequestSender::SUCCESS && reused && mayRetry){//the server may close idle connections at any time
+		res = exchange(toSend, result, deadline, mayRetry);
+	}
+	return res;
+}
+
+IRequestSender::ResponseType HTTPRequestSender::exchange(const std::string& toSend, std::string& result, uint64_t deadline, bool& mayRetry){
+	mayRetry = false;
+	if(socket==NULL){
+		uint32_t t = connectTimeout;
+		if(deadline!=0){
+			uint64_t now = getMilliSecs();
+			if(now>=deadline){return IRequestSender::ERROR_TIMEOUT;}
+			t = std::min(t, (uint32_t)(deadline-now));
+		}
+		socket = createSocketForHostName(true, hostName, port, t, t);
+		if(socket==NULL){return (deadline!=0 && getMilliSecs()>=deadline)?IRequestSender::ERROR_TIMEOUT:IRequestSender::ERROR_NO_CONNECTION;}
+		connectionCount++;
+		#ifdef __linux__
+		int enable = 1;
+		setsockopt(socket->getSocketHandle(), IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+		#endif
+	}
+	std::string request = requestHeader+std::to_string(toSend.size())+"\r\n\r\n"+toSend;
+	if(!socket->send(request.c_str(), request.size())){
+		closeConnection();
+		mayRetry = true;
+		return IRequestSender::ERROR_NO_CONNECTION;
+	}
+	requestsOnConnection++;
+	std::string response;
+	size_t headerEnd = std::string::npos;
+	size_t contentLength = std::numeric_limits<size_t>::max();
+	bool closeAfterResponse = false;
+	bool isGoodResponse = true;
+	char buf[16384];
+	while(headerEnd==std::string::npos || response.size()<headerEnd+contentLength){
+		uint32_t waitTime = 1000;
+		if(deadline!=0){
+			uint64_t now = getMilliSecs();
+			if(now>=deadline){
+				closeConnection();//the response would be received by the next request otherwise
+				return IRequestSender::ERROR_TIMEOUT;
+			}
+			waitTime = std::min(waitTime, (uint32_t)(deadline-now));
+		}
+		#ifdef __linux__
+		int enable = 1;//servers often send header and body separately, without quick ack the body may be delayed by nagle's algorithm on the server side until the delayed ack
+		setsockopt(socket->getSocketHandle(), IPPROTO_TCP, TCP_QUICKACK, &enable, sizeof(enable));
+		#endif
+		if(!socket->waitForReceive(waitTime)){continue;}
+		uint32_t received = socket->recv(buf, sizeof(buf), false);
+		if(received==0){//closed by peer
+			closeConnection();
+			if(headerEnd!=std::string::npos && contentLength==std::numeric_limits<size_t>::max()){break;}//response terminated by closing the connection
+			mayRetry = response.empty();
+			return IRequestSender::ERROR_NO_CONNECTION;
+		}
+		response.append(buf, received);
+		if(headerEnd==std::string::npos){
+			size_t pos = response.find("\r\n\r\n");
+			if(pos!=std::string::npos){
+				headerEnd = pos+4;
+				std::string header = response.substr(0, headerEnd);
+				std::transform(header.begin(), header.end(), header.begin(), ::tolower);
+				if(!getHeaderValue(header, "transfer-encoding").empty()){
+					closeConnection();
+					return IRequestSender::ERROR_BAD_RESPONSE;
+				}
+				std::string length = getHeaderValue(header, "content-length");
+				if(!length.empty()){contentLength = strtoull(length.c_str(), NULL, 10);}
+				closeAfterResponse = getHeaderValue(header, "connection")=="close" || isPrefixEqual(header, "http/1.0");
+				isGoodResponse = getHeaderValue(header, "content-type").find("application/json")!=std::string::npos;
+			}
+		}
+	}
+	result = response.substr(headerEnd, contentLength);
+	if(closeAfterResponse || requestsOnConnection>=maxRequestsPerConnection){closeConnection();}
+	return isGoodResponse?(IRequestSender::SUCCESS):(IRequestSender::ERROR_BAD_RESPONSE);
+}
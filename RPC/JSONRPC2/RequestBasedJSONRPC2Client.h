@@ -15,6 +15,7 @@ class IRequestSender{
 		SUCCESS,
 		ERROR_NO_CONNECTION,
 		ERROR_BAD_RESPONSE,
+		ERROR_TIMEOUT,//! aborted because the timeout (see setTimeout) expired
 		RESPONSE_TYPE_COUNT
 	};
 	
@@ -24,8 +25,14 @@ class IRequestSender{
 	//! may be called in a separate thread
 	virtual ResponseType sendRequest(const std::string& toSend, std::string& result) = 0;
 	
+	//! max duration of the following sendRequest calls in ms (0: no limit, ERROR_TIMEOUT if exceeded), senders which are not able to limit it may ignore it
+	virtual void setTimeout(uint32_t timeout){}
+	
 };
 
+//! creates a new sender (e.g. with its own connection), used by the pipelining mode of RequestBasedJSONRPC2Client
+typedef std::function<IRequestSender*()> RequestSenderFactory;
+
 class RequestBasedJSONRPC2ClientPrivate;
 
 //! A JSON-RPC2 Client over a request-response based protocol. Only the client can call methods, the server just replies.
@@ -39,12 +46,28 @@ class RequestBasedJSONRPC2Client : public IRPC{
 	
 	public:
 	
+	struct PipeliningParams{
+		uint32_t connectionCount;//! max amount of requests in flight, each one uses its own sender
+		uint32_t coalescingWindow;//! time in ms to wait for further calls before a request with less than maxCallsPerRequest calls is sent
+		uint32_t maxCallsPerRequest;//! max amount of calls which are combined into a single request
+		uint32_t deadline;//! time in ms after callRemoteProcedure until OnProcedureError is called if no response has been received (0: no deadline)
+		uint32_t maxPendingCalls;//! callRemoteProcedure returns false if this amount of calls is queued or in flight (backpressure)
+		PipeliningParams():connectionCount(4),coalescingWindow(2),maxCallsPerRequest(32),deadline(30000),maxPendingCalls(1024){}
+	};
+	
 	//! autoRetries: in case of a unsuccessful request: how many times shall it be retried automatically before calling IRemoteProcedureCaller::OnProcedureError
 	//! escapeNonPrintableChars: if true it is standard compliant, however it works with this parser also if they are not escaped (==false, more efficient in case binary data is sent as strings)
 	RequestBasedJSONRPC2Client(IRequestSender* sender, uint32_t autoRetries, bool escapeNonPrintableChars = true);
 	
+	//! pipelining mode: calls are coalesced into requests which are sent concurrently by params.connectionCount senders created by senderFactory, a slow request does not block the following ones
+	//! the senders are deleted by the client
+	RequestBasedJSONRPC2Client(const RequestSenderFactory& senderFactory, uint32_t autoRetries, const PipeliningParams& params = PipeliningParams(), bool escapeNonPrintableChars = true);
+	
 	~RequestBasedJSONRPC2Client();
 	
+	//! calls which are queued or in flight
+	uint32_t getPendingCallCount() const;
+	
 	bool callRemoteProcedure(const std::string& procedure, const std::vector<IRPCValue*>& values, IRemoteProcedureCaller* caller = NULL, uint32_t id = 0, bool deleteValues = true);
 	
 	void registerCallReceiver(const std::string& procedure, IRemoteProcedureCallReceiver* receiver);
@@ -83,8 +106,48 @@ class CURLRequestSender : public IRequestSender{
 	
 	ResponseType sendRequest(const std::string& toSend, std::string& result);
 	
+	void setTimeout(uint32_t timeout);
+	
 };
 
 #endif
 
+class ASocket;
+
+//! A minimal HTTP/1.1 request sender (POST, persistent connection, no TLS) which does not require curl
+//! responses must contain a Content-Length or must be terminated by closing the connection (chunked transfer encoding is not supported)
+class HTTPRequestSender : public IRequestSender{
+
+	private:
+	
+	std::string hostName;
+	uint16_t port;
+	std::string requestHeader;
+	uint32_t connectTimeout;
+	uint32_t timeout;
+	ASocket* socket;
+	uint32_t requestsOnConnection;
+	uint32_t connectionCount;
+	
+	//! mayRetry: true if the connection has been closed before any response data has been received
+	ResponseType exchange(const std::string& toSend, std::string& result, uint64_t deadline, bool& mayRetry);
+	
+	void closeConnection();
+	
+	public:
+	
+	//! url: http://host[:port]/path, connectTimeout in ms
+	HTTPRequestSender(const std::string& url, uint32_t connectTimeout = 10000);
+	
+	~HTTPRequestSender();
+	
+	ResponseType sendRequest(const std::string& toSend, std::string& result);
+	
+	void setTimeout(uint32_t timeout);
+	
+	//! amount of established connections so far
+	uint32_t getConnectionCount() const;
+	
+};
+
 #endif
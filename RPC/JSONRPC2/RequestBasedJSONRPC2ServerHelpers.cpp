@@ -2,65 +2,175 @@
 #include <JSONParser.h>
 #include <JSONRPC2Client.h>
 
+#include <Threading.h>
+
 #include <sstream>
 #include <iostream>
+#include <mutex>
+#include <condition_variable>
 
-static void handleEntity(std::stringstream& ss, IRPCValue* entity, const std::unordered_map<std::string, IRemoteProcedureCallReceiver*>& receivers, bool escapeNonPrintableChars){
+//! collects the calls of the entity (recursively for batch arrays)
+static void collectCalls(std::vector<ObjectValue*>& calls, IRPCValue* entity){
 	if(entity){
 		if(entity->getType()==IRPCValue::ARRAY){
 			ArrayValue* array = (ArrayValue*)entity;
 			for(IRPCValue* r:array->values){
-				handleEntity(ss, r, receivers, escapeNonPrintableChars);
+				collectCalls(calls, r);
 			}
-			array->values.clear();//clear before delete since they already have been deleted in the callback methods as required
-			return;
 		}else if(entity->getType()==IRPCValue::OBJECT){
-			ObjectValue* o = (ObjectValue*)entity;
-			if(StringValue* method = getObjectField<StringValue>(o, "method")){//requests and notifications
-				IntegerValue* id = getObjectField<IntegerValue>(o, "id");//only integer ids allowed in our case
-				//std::cout << "handling: " << (method->value) << std::endl;
-				auto it = receivers.find(method->value);
-				if(it != receivers.end()){
-					ArrayValue* params = getObjectField<ArrayValue>(o, "params");
-					IRPCValue* result = params?it->second->callProcedure(method->value, params->values):it->second->callProcedure(method->value, {});
-					if(id){
-						if(result){
-							ss << convertRPCValueToJSONResult(*result, id->value, escapeNonPrintableChars);
-							delete result;
-						}else{//return null
-							NULLValue nullVal;
-							ss << convertRPCValueToJSONResult(nullVal, id->value, escapeNonPrintableChars);
-						}
-					}else{
-						delete result;
-					}
-				}else if(id){
-					ss << "{\"jsonrpc\": \"2.0\", \"error\": {\"code\":-32601, \"message\": \"Method not found\", \"data\": \"" << method->value << "\"}, \"id\": " << id->value << "}";
+			calls.push_back((ObjectValue*)entity);
+		}else{
+			std::cerr << "Error: Unexpected JSON-RPC type: " << convertRPCValueToJSONString(*entity, true) << std::endl;
+		}
+	}
+}
+
+//! returns the response (empty for notifications)
+static std::string handleCall(ObjectValue* o, const std::unordered_map<std::string, IRemoteProcedureCallReceiver*>& receivers, bool escapeNonPrintableChars){
+	std::stringstream ss;
+	if(StringValue* method = getObjectField<StringValue>(o, "method")){//requests and notifications
+		IntegerValue* id = getObjectField<IntegerValue>(o, "id");//only integer ids allowed in our case
+		//std::cout << "handling: " << (method->value) << std::endl;
+		auto it = receivers.find(method->value);
+		if(it != receivers.end()){
+			ArrayValue* params = getObjectField<ArrayValue>(o, "params");
+			IRPCValue* result = params?it->second->callProcedure(method->value, params->values):it->second->callProcedure(method->value, {});
+			if(id){
+				if(result){
+					ss << convertRPCValueToJSONResult(*result, id->value, escapeNonPrintableChars);
+					delete result;
+				}else{//return null
+					NULLValue nullVal;
+					ss << convertRPCValueToJSONResult(nullVal, id->value, escapeNonPrintableChars);
 				}
 			}else{
-				std::cerr << "Error: Invalid / unsupported JSON-RPC: " << convertRPCValueToJSONString(*entity, true) << std::endl;
+				delete result;
 			}
+		}else if(id){
+			ss << "{\"jsonrpc\": \"2.0\", \"error\": {\"code\":-32601, \"message\": \"Method not found\", \"data\": \"" << method->value << "\"}, \"id\": " << id->value << "}";
+		}
+	}else{
+		std::cerr << "Error: Invalid / unsupported JSON-RPC: " << convertRPCValueToJSONString(*o, true) << std::endl;
+	}
+	return ss.str();
+}
+
+//! shared by the threads which execute the calls of a request
+struct ParallelExecution{
+	const std::vector<ObjectValue*>& calls;
+	const std::unordered_map<std::string, IRemoteProcedureCallReceiver*>& receivers;
+	bool escapeNonPrintableChars;
+	std::mutex m;
+	std::condition_variable cv;
+	uint32_t nextCall;//guarded by m
+	uint32_t writtenCount;//guarded by m
+	uint32_t window;//max amount of calls which are started before the previous responses have been written
+	uint32_t runningHelpers;//guarded by m
+	std::vector<std::string> responses;//responses[i] guarded by m until done[i]
+	std::vector<bool> done;//guarded by m
+	
+	ParallelExecution(const std::vector<ObjectValue*>& calls, const std::unordered_map<std::string, IRemoteProcedureCallReceiver*>& receivers, bool escapeNonPrintableChars, uint32_t window):calls(calls),receivers(receivers),escapeNonPrintableChars(escapeNonPrintableChars),nextCall(0),writtenCount(0),window(window),runningHelpers(0),responses(calls.size()),done(calls.size(), false){}
+	
+	//! executes the next call, false if there are no more calls or the window is full, lock must be locked (unlocked during the call)
+	bool executeNext(std::unique_lock<std::mutex>& lock){
+		if(nextCall>=calls.size() || nextCall>=writtenCount+window){return false;}
+		uint32_t i = nextCall++;
+		lock.unlock();
+		std::string response = handleCall(calls[i], receivers, escapeNonPrintableChars);
+		lock.lock();
+		responses[i] = std::move(response);
+		done[i] = true;
+		cv.notify_all();
+		return true;
+	}
+	
+	static void* helperMain(void* data){
+		ParallelExecution* e = (ParallelExecution*)data;
+		std::unique_lock<std::mutex> lock(e->m);
+		while(e->nextCall<e->calls.size()){
+			if(!e->executeNext(lock)){e->cv.wait(lock);}//slow writer
+		}
+		e->runningHelpers--;
+		e->cv.notify_all();
+		return NULL;
+	}
+	
+};
+
+static bool processCalls(const std::vector<ObjectValue*>& calls, const std::unordered_map<std::string, IRemoteProcedureCallReceiver*>& receivers, const JSONRPC2ResponseWriter& writer, bool escapeNonPrintableChars, ThreadPool* pool, uint32_t maxParallelCalls){
+	if(maxParallelCalls<=1 || calls.size()<=1){
+		for(ObjectValue* o : calls){
+			std::string response = handleCall(o, receivers, escapeNonPrintableChars);
+			if(!response.empty() && !writer(response.c_str(), response.size())){return false;}
+		}
+		return true;
+	}
+	ParallelExecution e(calls, receivers, escapeNonPrintableChars, 2*maxParallelCalls);//limits the memory usage for large responses
+	std::unique_lock<std::mutex> lock(e.m);
+	uint32_t helperCount = std::min(maxParallelCalls, (uint32_t)calls.size())-1;
+	for(uint32_t i=0; i<helperCount; i++){
+		e.runningHelpers++;
+		bool started = false;
+		if(pool){
+			started = pool->startThreadedFunction(ParallelExecution::helperMain, &e)!=NULL;
 		}else{
-			std::cerr << "Error: Unexpected JSON-RPC type: " << convertRPCValueToJSONString(*entity, true) << std::endl;
+			Thread t;
+			started = createThread(t, ParallelExecution::helperMain, &e, false);
+		}
+		if(!started){e.runningHelpers--;}
+	}
+	bool success = true;
+	while(e.writtenCount<calls.size()){
+		if(e.done[e.writtenCount]){//write in order
+			std::string response = std::move(e.responses[e.writtenCount]);
+			e.writtenCount++;
+			e.cv.notify_all();
+			if(!response.empty()){
+				lock.unlock();
+				success = writer(response.c_str(), response.size());
+				lock.lock();
+				if(!success){
+					e.nextCall = calls.size();//no more calls
+					e.cv.notify_all();
+					break;
+				}
+			}
+		}else if(!e.executeNext(lock)){
+			e.cv.wait(lock);
 		}
 	}
+	while(e.runningHelpers>0){//e must not be deleted before
+		e.cv.wait(lock);
+	}
+	return success;
 }
 
-std::string processJSONRPC2Request(const std::string& request, const std::unordered_map<std::string, IRemoteProcedureCallReceiver*>& receivers, bool escapeNonPrintableChars){
-	std::stringstream ss;
+bool processJSONRPC2Request(const std::string& request, const std::unordered_map<std::string, IRemoteProcedureCallReceiver*>& receivers, const JSONRPC2ResponseWriter& writer, bool escapeNonPrintableChars, ThreadPool* pool, uint32_t maxParallelCalls){
+	std::vector<IRPCValue*> entities;
+	std::vector<ObjectValue*> calls;
 	if(request.size()>=2){//at least {}
 		JSONParser parser;
 		for(uint32_t i=0; i<request.size(); i++){
 			IJSONParser::State state = parser.parse(request[i], request[i+1]);//i+1 safe since request[request.size()]=='\0' (guranteed in c++11)
 			if(state==IJSONParser::SUCCESS){
-				IRPCValue* v = parser.stealResult();
-				handleEntity(ss, v, receivers, escapeNonPrintableChars);
-				delete v;
+				entities.push_back(parser.stealResult());
+				collectCalls(calls, entities.back());
 				parser.reset();
 			}else if(state==IJSONParser::ERROR){
 				parser.reset();
 			}
 		}
 	}
-	return ss.str();
+	bool success = processCalls(calls, receivers, writer, escapeNonPrintableChars, pool, maxParallelCalls);
+	for(IRPCValue* v : entities){delete v;}
+	return success;
+}
+
+std::string processJSONRPC2Request(const std::string& request, const std::unordered_map<std::string, IRemoteProcedureCallReceiver*>& receivers, bool escapeNonPrintableChars, ThreadPool* pool, uint32_t maxParallelCalls){
+	std::string res;
+	processJSONRPC2Request(request, receivers, [&res](const char* data, uint32_t size){
+		res.append(data, size);
+		return true;
+	}, escapeNonPrintableChars, pool, maxParallelCalls);
+	return res;
 }
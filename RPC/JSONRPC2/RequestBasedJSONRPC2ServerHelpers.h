@@ -3,9 +3,21 @@
 
 #include <IRPC.h>
 
+#include <functional>
+
+class ThreadPool;
+
+//! receives the response piece by piece (one JSON-RPC response per call), returns false to abort (e.g. if the connection has been lost)
+typedef std::function<bool(const char* data, uint32_t size)> JSONRPC2ResponseWriter;
+
 //! depending on the underlying protocol implementation, this function might be called concurrently, also the receiver will be called concurrently then
 //! returns the response, at least c++11 required
 //! receivers: probably concurrently (therefore constant) map: methode name -> call receiver
-std::string processJSONRPC2Request(const std::string& request, const std::unordered_map<std::string, IRemoteProcedureCallReceiver*>& receivers, bool escapeNonPrintableChars);
+//! maxParallelCalls: if > 1 the calls of a request with multiple calls (batch array or concatenated objects) are executed concurrently by up to maxParallelCalls threads (the calling thread and threads from pool or new threads if pool is NULL), the responses keep the order of the calls
+std::string processJSONRPC2Request(const std::string& request, const std::unordered_map<std::string, IRemoteProcedureCallReceiver*>& receivers, bool escapeNonPrintableChars, ThreadPool* pool = NULL, uint32_t maxParallelCalls = 1);
+
+//! like processJSONRPC2Request but each response is passed to writer as soon as it and all previous responses are available instead of concatenating them
+//! returns false if aborted by the writer
+bool processJSONRPC2Request(const std::string& request, const std::unordered_map<std::string, IRemoteProcedureCallReceiver*>& receivers, const JSONRPC2ResponseWriter& writer, bool escapeNonPrintableChars, ThreadPool* pool = NULL, uint32_t maxParallelCalls = 1);
 
 #endif
@@ -0,0 +1,146 @@
+#include "MappedWaveFile.h"
+
+#include <BitFunctions.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <iostream>
+
+#define MIN_WAVE_HEADER_SIZE 44
+#define MIN_FMT_CHUNK_SIZE 16
+
+MappedWaveFile::MappedWaveFile(const char* path):mapping(NULL),mappingSize(0),data(NULL),dataSize(0),format(ISoundSource::MONO8),sampleRate(8000),bytesPerFrame(1),good(false){
+	std::cout << "Mapping wave file: " << path << std::endl;
+	int fd = open(path, O_RDONLY);
+	if(fd>=0){
+		struct stat st;
+		if(fstat(fd, &st)==0 && st.st_size>MIN_WAVE_HEADER_SIZE && (uint64_t)st.st_size<=UINT32_MAX){
+			mappingSize = st.st_size;
+			void* m = mmap(NULL, mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+			if(m!=MAP_FAILED){
+				mapping = (uint8_t*)m;
+				madvise(mapping, mappingSize, MADV_SEQUENTIAL);
+				good = parseHeader();
+			}else{
+				std::cerr << "Unable to map wave file." << std::endl;
+			}
+		}else{
+			std::cerr << "Wave too small or too big." << std::endl;
+		}
+		close(fd);//the mapping stays valid
+	}else{
+		std::cerr << "Unable to open wave file." << std::endl;
+	}
+	if(!good){
+		std::cerr << "Error while parsing wave file." << std::endl;
+	}
+}
+
+MappedWaveFile::~MappedWaveFile(){
+	if(mapping){
+		munmap(mapping, mappingSize);
+	}
+}
+
+bool MappedWaveFile::parseHeader(){
+	if(strncmp((const char*)mapping, "RIFF", 4)!=0 || strncmp((const char*)&(mapping[8]), "WAVE", 4)!=0){
+		std::cerr << "RIFF / WAVE header identification missing." << std::endl;
+		return false;
+	}
+	bool fmtFound = false;
+	uint32_t offset = 12;
+	while(offset+8<=mappingSize){
+		const char* chunkId = (const char*)&(mapping[offset]);
+		uint32_t chunkOffset = offset+4;
+		uint32_t chunkSize = readLittleEndian<uint32_t>(mapping, chunkOffset);
+		uint32_t availableSize = mappingSize-chunkOffset;
+		if(strncmp(chunkId, "fmt ", 4)==0 && chunkSize>=MIN_FMT_CHUNK_SIZE && availableSize>=MIN_FMT_CHUNK_SIZE){
+			uint32_t fmtOffset = chunkOffset+2;//channel count offset inside fmt chunk
+			uint16_t channelCount = readLittleEndian<uint16_t>(mapping, fmtOffset);
+			sampleRate = readLittleEndian<uint32_t>(mapping, fmtOffset);
+			fmtOffset += 6;
+			uint16_t bitsPerSample = readLittleEndian<uint16_t>(mapping, fmtOffset);
+			std::cout << "bitsPerSample=" << bitsPerSample << " channelCount=" << channelCount << " sampleRate=" << sampleRate << std::endl;//useful for compatibility checks
+			if(!((bitsPerSample==8 || bitsPerSample==16) && (channelCount==1 || channelCount==2) && sampleRate>0 && sampleRate<100000)){//more than 100000 not plausible
+				std::cerr << "Unsupported pcm format." << std::endl;
+				return false;
+			}
+			if(channelCount==1){
+				format = bitsPerSample==8?ISoundSource::MONO8:ISoundSource::MONO16;
+			}else{
+				format = bitsPerSample==8?ISoundSource::STEREO8:ISoundSource::STEREO16;
+			}
+			bytesPerFrame = channelCount*bitsPerSample/8;
+			fmtFound = true;
+		}else if(strncmp(chunkId, "data", 4)==0){
+			if(!fmtFound){
+				std::cerr << "\"fmt \" chunk not found or invalid." << std::endl;
+				return false;
+			}
+			data = &(mapping[chunkOffset]);
+			dataSize = chunkSize<availableSize?chunkSize:availableSize;//truncated files are accepted
+			dataSize = (dataSize/bytesPerFrame)*bytesPerFrame;
+			return true;
+		}
+		if(chunkSize>=availableSize){break;}
+		offset = chunkOffset+chunkSize+(chunkSize&1);//chunks are word aligned
+	}
+	std::cerr << "\"data\" chunk not found." << std::endl;
+	return false;
+}
+
+bool MappedWaveFile::getPageRange(uint32_t offset, uint32_t size, uint8_t*& begin, size_t& length) const{
+	if(offset>=dataSize || size==0){return false;}
+	if(size>dataSize-offset){size = dataSize-offset;}
+	static const size_t pageSize = sysconf(_SC_PAGESIZE);
+	size_t first = (size_t)(data-mapping)+offset;
+	size_t end = first+size;
+	first -= first%pageSize;
+	begin = mapping+first;
+	length = end-first;
+	return true;
+}
+
+bool MappedWaveFile::isGood() const{
+	return good;
+}
+
+const uint8_t* MappedWaveFile::getData() const{
+	return data;
+}
+
+uint32_t MappedWaveFile::getDataSize() const{
+	return dataSize;
+}
+
+ISoundSource::PCMFormat MappedWaveFile::getPCMFormat() const{
+	return format;
+}
+
+uint32_t MappedWaveFile::getSampleRate() const{
+	return sampleRate;
+}
+
+uint32_t MappedWaveFile::getBytesPerFrame() const{
+	return bytesPerFrame;
+}
+
+void MappedWaveFile::prefetch(uint32_t offset, uint32_t size) const{
+	uint8_t* begin;
+	size_t length;
+	if(getPageRange(offset, size, begin, length)){
+		madvise(begin, length, MADV_WILLNEED);
+	}
+}
+
+void MappedWaveFile::release(uint32_t offset, uint32_t size) const{
+	uint8_t* begin;
+	size_t length;
+	if(getPageRange(offset, size, begin, length)){
+		madvise(begin, length, MADV_DONTNEED);
+	}
+}
@@ -0,0 +1,63 @@
+#ifndef MappedWaveFile_H_INCLUDED
+#define MappedWaveFile_H_INCLUDED
+
+#include "ISoundSource.h"
+
+#include <cstdint>
+#include <cstddef>
+
+//! Read only memory mapping of a pcm wave file (8 or 16 bit mono or stereo)
+//! Only the header is read on construction, the pcm data is loaded on demand by the OS and can be shared by several sources (see SoundManager::getMappedWaveFile).
+//! All methods are const and thread safe.
+class MappedWaveFile{
+
+	private:
+	
+	uint8_t* mapping;
+	size_t mappingSize;
+	
+	const uint8_t* data;
+	uint32_t dataSize;
+	
+	ISoundSource::PCMFormat format;
+	uint32_t sampleRate;
+	uint32_t bytesPerFrame;
+	
+	bool good;
+	
+	bool parseHeader();
+	
+	//! page aligned range of the mapping which covers the given range of the pcm data, false if empty
+	bool getPageRange(uint32_t offset, uint32_t size, uint8_t*& begin, size_t& length) const;
+	
+	public:
+	
+	MappedWaveFile(const char* path);
+	
+	~MappedWaveFile();
+	
+	//! true if the wave file has been mapped and parsed successfully
+	bool isGood() const;
+	
+	//! beginning of the pcm data (interleaved frames)
+	const uint8_t* getData() const;
+	
+	//! size of the pcm data in bytes (integer amount of frames)
+	uint32_t getDataSize() const;
+	
+	ISoundSource::PCMFormat getPCMFormat() const;
+	
+	uint32_t getSampleRate() const;
+	
+	uint32_t getBytesPerFrame() const;
+	
+	//! hints the OS to load the given range of the pcm data in background
+	void prefetch(uint32_t offset, uint32_t size) const;
+	
+	//! hints the OS that the given range of the pcm data is not required in the near future, the memory may be reclaimed (it is loaded again on demand)
+	//! The range is dropped for all users of this mapping, therefore it should only be called if no other user reads the range.
+	void release(uint32_t offset, uint32_t size) const;
+	
+};
+
+#endif
@@ -1,18 +1,47 @@
 #include "NoSoundDriver.h"
+#include "ISoundSource.h"
 
+#include <timing.h>
+
+#include <vector>
+#include <cstring>
+
+//! Consumes the pcm data in real time like a device without any output (useful to measure latency and cpu usage)
 class NoSoundPlaybackContext: public IPCMPlaybackContext{
 public:
 
-    NoSoundPlaybackContext(ISoundSource* source):IPCMPlaybackContext(source){}
+    static const uint32_t periodFrameCount = 256;
+
+    std::vector<uint8_t> buffer;
+    double filledUntilTime;
+    double framesPerSecond;
+
+    NoSoundPlaybackContext(ISoundSource* source):IPCMPlaybackContext(source){
+        buffer.resize(periodFrameCount*source->getBytesPerFrame());
+        filledUntilTime = getSecs();
+        framesPerSecond = source->getSampleRate();
+    }
 
     virtual ~NoSoundPlaybackContext(){}
 
     virtual uint32_t update(bool pause, uint32_t maxBytes){
-        return 0;
+        if(maxBytes>buffer.size()){maxBytes = buffer.size();}
+        uint32_t filledBytes;
+        if(pause){
+            filledBytes = source->alignBytesToFrames(maxBytes);
+            memset(buffer.data(), 0, filledBytes);
+        }else{
+            filledBytes = source->fillNextBytes(buffer.data(), maxBytes);
+        }
+        double t = getSecs();
+        if(filledUntilTime<t){filledUntilTime = t;}//underrun
+        filledUntilTime += filledBytes/source->getBytesPerFrame()/framesPerSecond;
+        return filledBytes;
     }
 
     virtual uint32_t getDelayFrameCount(){
-        return 0;
+        double frames = (filledUntilTime-getSecs())*framesPerSecond;
+        return frames<=0.0?0:(uint32_t)(frames+0.5);
     }
 
 };
@@ -3,15 +3,19 @@
 #include "AlsaSoundDriver.h"
 #include "OpenSLESSoundDriver.h"
 #include "NoSoundDriver.h"
+#include "SoundMixer.h"
+#include "MappedWaveFile.h"
 
 #include <Threading.h>
 #include <platforms.h>
 #include <timing.h>
+#include <Profiler.h>
 
-#include <map>
+#include <atomic>
 #include <cassert>
-#include <set>
 #include <iostream>
+#include <set>
+#include <map>
 
 class SoundManagerPrivate{
 	
@@ -20,35 +24,31 @@ class SoundManagerPrivate{
 	ISoundDriver* driver;
 	double maxBufferTime;
 	
-	struct ThreadContext{
-		Thread t;
-		Mutex m;
-		double maxBufferTime;
-		ISoundDriver* driver;
-		ISoundSource* source;
-		bool isPause;
-		bool mustExit;
-	};
+	SoundMixer* mixer;
+	
+	Thread mixerThread;
+	bool mixerThreadRunning;
+	std::atomic<bool> mustExit;
 	
-	static void* threadMain(void* data){
-		ThreadContext* tc = (ThreadContext*)data;
-		IPCMPlaybackContext* c = tc->driver->createPlaybackContext(tc->source);
-		double maxBufferTime = tc->maxBufferTime;
-		uint32_t bytesPerSecond = tc->source->getChannelCount()*tc->source->getSampleRate();
-		uint32_t maxBytesUpdate = bytesPerSecond*maxBufferTime;
-		double secondsPerFrame = 1.0/tc->source->getSampleRate();
-		bool running = true;
-		bool isPause = false;
-		while(running){
-			lockMutex(tc->m);
-			isPause = tc->isPause;
-			running = !tc->mustExit;
-			unlockMutex(tc->m);
+	std::set<ISoundSource*> playing;//played but not yet stopped
+	std::set<ISoundSource*> pool;
+	
+	Mutex mappedFilesMutex;
+	std::map<std::string, std::weak_ptr<MappedWaveFile>> mappedFiles;
+	
+	static void* mixerMain(void* data){
+		SoundManagerPrivate* p = (SoundManagerPrivate*)data;
+		PROFILE_THREAD_NAME("Sound");
+		setCurrentThreadRealtimePriority();//continues with the default priority if not permitted
+		IPCMPlaybackContext* c = p->driver->createPlaybackContext(p->mixer);
+		uint32_t bytesPerFrame = p->mixer->getBytesPerFrame();
+		uint32_t maxFrameCount = p->mixer->getSampleRate()*p->maxBufferTime;
+		while(!p->mustExit.load(std::memory_order_acquire)){
 			uint32_t bytesUpdated = 0;
-			double bufferTime = c->getDelayFrameCount()*secondsPerFrame;
-			//std::cout << "bufferTime: " << bufferTime << std::endl;
-			if(bufferTime<maxBufferTime){
-				bytesUpdated = c->update(isPause, maxBytesUpdate);
+			uint32_t delayFrameCount = c->getDelayFrameCount();
+			if(delayFrameCount<maxFrameCount){
+				PROFILE_SCOPE("SoundManager::update");
+				bytesUpdated = c->update(false, (maxFrameCount-delayFrameCount)*bytesPerFrame);
 			}
 			if(bytesUpdated==0){delay(1);}//avoid busy wait if no update
 		}
@@ -56,47 +56,68 @@ class SoundManagerPrivate{
 		return NULL;
 	}
 	
-	std::map<ISoundSource*, ThreadContext> c;
-	std::set<ISoundSource*> pool;
+	SoundManagerPrivate(SoundManager* soundmgr, double maxBufferTime, ISoundDriver* driver):driver(driver),maxBufferTime(maxBufferTime),mixerThreadRunning(false),mustExit(false){
+		if(driver==NULL){
+			#ifdef LINUX_PLATFORM
+			this->driver = new AlsaSoundDriver();
+			#elif defined(ANDROID_PLATFORM)
+			this->driver = new OpenSLESSoundDriver();
+			#elif defined(__APPLE__) && defined(__MACH__)
+			this->driver = new NoSoundDriver();
+			#else
+			#error Unsupported Operating System: Missing ISoundDriver implementation
+			#endif
+		}
+		mixer = new SoundMixer(soundmgr, this->driver->getNextAcceptableSamplingFrequency(44100));
+		initMutex(mappedFilesMutex);
+	}
 	
-	void stop(ThreadContext* tc){
-		lockMutex(tc->m);
-		tc->mustExit = true;
-		unlockMutex(tc->m);
-		bool success = joinThread(tc->t);
-		assert(success);
-		deleteMutex(tc->m);
+	~SoundManagerPrivate(){
+		stopMixerThread();
+		delete mixer;
+		delete driver;
+		deleteMutex(mappedFilesMutex);
 	}
 	
-	SoundManagerPrivate(double maxBufferTime):maxBufferTime(maxBufferTime){
-		#ifdef LINUX_PLATFORM
-		driver = new AlsaSoundDriver();
-		#elif defined(ANDROID_PLATFORM)
-		driver = new OpenSLESSoundDriver();
-		#elif defined(__APPLE__) && defined(__MACH__)
-		driver = new NoSoundDriver();
-		#else
-		#error Unsupported Operating System: Missing ISoundDriver implementation
-		#endif
+	void startMixerThread(){
+		if(!mixerThreadRunning){
+			mustExit.store(false, std::memory_order_relaxed);
+			mixerThreadRunning = createThread(mixerThread, mixerMain, this, true);
+			assert(mixerThreadRunning);
+		}
 	}
 	
-	~SoundManagerPrivate(){
-		for(auto it = c.begin(); it!=c.end(); ++it){
-			stop(&(it->second));
+	//! joins the mixing thread, the playback context is deleted by the thread
+	void stopMixerThread(){
+		if(mixerThreadRunning){
+			mustExit.store(true, std::memory_order_release);
+			if(!joinThread(mixerThread)){
+				std::cerr << "Error: Unable to join the sound mixer thread." << std::endl;
+			}
+			mixerThreadRunning = false;
 		}
-		delete driver;
+	}
+	
+	//! blocks until the mixing thread has processed the command
+	void waitForMixer(uint64_t commandNumber){
+		while(mixerThreadRunning && !mixer->isProcessed(commandNumber)){delay(1);}
 	}
 	
 };
 
 SoundManager::SoundManager(double maxBufferTime){
-	p = new SoundManagerPrivate(maxBufferTime);
+	p = new SoundManagerPrivate(this, maxBufferTime, NULL);
+}
+
+SoundManager::SoundManager(double maxBufferTime, ISoundDriver* driver){
+	p = new SoundManagerPrivate(this, maxBufferTime, driver);
 }
 	
 SoundManager::~SoundManager(){
 	for(auto it = p->pool.begin(); it!=p->pool.end(); ++it){//first stop everything then delete (because of SoundSource reuse e.g. in SoundEffectQueue)
 		stop(*it);
 	}
+	p->stopMixerThread();//no source is accessed by the mixer anymore
 	for(auto it = p->pool.begin(); it!=p->pool.end(); ++it){
 		delete *it;
 	}
@@ -104,55 +125,42 @@ SoundManager::~SoundManager(){
 }
 	
 void SoundManager::play(ISoundSource* source){
-	auto it = p->c.find(source);
-	if(it==p->c.end()){
+	if(p->playing.insert(source).second){
 		source->seek(0.f);
-		p->c[source] = SoundManagerPrivate::ThreadContext();
-		SoundManagerPrivate::ThreadContext& tc = p->c[source];
-		initMutex(tc.m);
-		tc.driver = p->driver;
-		tc.source = source;
-		tc.mustExit = tc.isPause = false;
-		tc.maxBufferTime = p->maxBufferTime;
-		bool success = createThread(tc.t, SoundManagerPrivate::threadMain, &tc, true);
-		assert(success);
-	}else{
-		lockMutex(it->second.m);
-		it->second.isPause = false;
-		unlockMutex(it->second.m);
 	}
+	p->mixer->play(source);
+	p->startMixerThread();
 }
 
 void SoundManager::pause(ISoundSource* source){
-	auto it = p->c.find(source);
-	if(it!=p->c.end()){
-		lockMutex(it->second.m);
-		it->second.isPause = true;
-		unlockMutex(it->second.m);
-	}
+	p->mixer->pause(source);
 }
 
 void SoundManager::stop(ISoundSource* source){
-	auto it = p->c.find(source);
-	if(it!=p->c.end()){
-		p->stop(&(it->second));
-		p->c.erase(it);
+	if(p->playing.erase(source)>0){
+		p->waitForMixer(p->mixer->stop(source));
 	}
 }
 
+void SoundManager::setGain(ISoundSource* source, float gain){
+	p->mixer->setGain(source, gain);
+}
+
+SoundMixer* SoundManager::getMixer() const{
+	return p->mixer;
+}
+
 ISoundDriver* SoundManager::getSoundDriver() const{
 	return p->driver;
 }
 
 void SoundManager::update(){
-	auto it=p->c.begin();
-	while(it!=p->c.end()){
-		if(it->first->isPlayingOrReady()){
-			++it;
-		}else{
-			p->stop(&(it->second));
-			p->c.erase(it);
-			it = p->c.begin();
+	auto it=p->playing.begin();
+	while(it!=p->playing.end()){
+		ISoundSource* source = *it;
+		++it;
+		if(!source->isPlayingOrReady()){
+			stop(source);
 		}
 	}
 }
@@ -166,3 +174,22 @@ void SoundManager::deleteSource(ISoundSource* source){
 	delete source;
 	p->pool.erase(source);
 }
+
+std::shared_ptr<MappedWaveFile> SoundManager::getMappedWaveFile(const std::string& path){
+	lockMutex(p->mappedFilesMutex);
+	std::weak_ptr<MappedWaveFile>& entry = p->mappedFiles[path];
+	std::shared_ptr<MappedWaveFile> res = entry.lock();
+	if(!res){
+		res = std::make_shared<MappedWaveFile>(path.c_str());
+		entry = res;
+	}
+	for(auto it = p->mappedFiles.begin(); it!=p->mappedFiles.end();){//remove unused entries
+		if(it->second.expired()){
+			it = p->mappedFiles.erase(it);
+		}else{
+			++it;
+		}
+	}
+	unlockMutex(p->mappedFilesMutex);
+	return res;
+}
@@ -3,8 +3,13 @@
 
 #include "ISoundSource.h"
 
+#include <memory>
+#include <string>
+
 class SoundManagerPrivate;
 class ISoundDriver;
+class SoundMixer;
+class MappedWaveFile;
 
 class SoundManager{
 	friend class SoundManagerPrivate;
@@ -17,8 +22,13 @@ class SoundManager{
 	
 	public:
 	
+	//! all sources are mixed by a SoundMixer which is played by a single thread
+	//! maxBufferTime: maximum buffered time in s (trade-off between latency and robustness against underruns)
 	SoundManager(double maxBufferTime = 0.1);
 	
+	//! uses the given driver instead of the platform default (e.g. NoSoundDriver for measurements), the driver is deleted by the SoundManager
+	SoundManager(double maxBufferTime, ISoundDriver* driver);
+	
 	~SoundManager();
 	
 	ISoundDriver* getSoundDriver() const;
@@ -31,6 +41,12 @@ class SoundManager{
 	//! completely deallocate everything related
 	void stop(ISoundSource* source);
 	
+	//! linear gain of a playing source, 1 is the original volume
+	void setGain(ISoundSource* source, float gain);
+	
+	//! useful for statistics
+	SoundMixer* getMixer() const;
+	
 	//! should be regularly called to clean up old data (e.g. stops finished sounds)
 	void update();
 	
@@ -45,6 +61,9 @@ class SoundManager{
 	//! stops and deletes a source explicitly from the pool
 	void deleteSource(ISoundSource* source);
 	
+	//! maps a wave file or returns the existing mapping if the file is still mapped for another source (thread safe)
+	std::shared_ptr<MappedWaveFile> getMappedWaveFile(const std::string& path);
+	
 };
 
 #endif
@@ -0,0 +1,333 @@
+#include "SoundMixer.h"
+
+#include <timing.h>
+
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+#define SOUND_MIXER_USE_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define SOUND_MIXER_USE_NEON
+#include <arm_neon.h>
+#endif
+
+static const float s16Scale = 32768.f;
+
+//! little endian int16 samples to float samples in [-1,1)
+static void convertS16ToFloat(const int16_t* in, float* out, uint32_t sampleCount){
+	uint32_t i = 0;
+	#if defined(SOUND_MIXER_USE_SSE2)
+	__m128 scale = _mm_set1_ps(1.f/s16Scale);
+	for(; i+8<=sampleCount; i+=8){
+		__m128i v = _mm_loadu_si128((const __m128i*)(in+i));
+		__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);//sign extension
+		__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+		_mm_storeu_ps(out+i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+		_mm_storeu_ps(out+i+4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+	}
+	#elif defined(SOUND_MIXER_USE_NEON)
+	for(; i+8<=sampleCount; i+=8){
+		int16x8_t v = vld1q_s16(in+i);
+		vst1q_f32(out+i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), 1.f/s16Scale));
+		vst1q_f32(out+i+4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), 1.f/s16Scale));
+	}
+	#endif
+	for(; i<sampleCount; i++){
+		out[i] = in[i]/s16Scale;
+	}
+}
+
+//! mix += gain*in
+static void mixSamples(float* mix, const float* in, float gain, uint32_t sampleCount){
+	uint32_t i = 0;
+	#if defined(SOUND_MIXER_USE_SSE2)
+	__m128 g = _mm_set1_ps(gain);
+	for(; i+4<=sampleCount; i+=4){
+		_mm_storeu_ps(mix+i, _mm_add_ps(_mm_loadu_ps(mix+i), _mm_mul_ps(g, _mm_loadu_ps(in+i))));
+	}
+	#elif defined(SOUND_MIXER_USE_NEON)
+	for(; i+4<=sampleCount; i+=4){
+		vst1q_f32(mix+i, vmlaq_n_f32(vld1q_f32(mix+i), vld1q_f32(in+i), gain));
+	}
+	#endif
+	for(; i<sampleCount; i++){
+		mix[i] += gain*in[i];
+	}
+}
+
+//! float samples to int16 samples with saturation (rounded to nearest)
+static void convertFloatToS16(const float* in, int16_t* out, uint32_t sampleCount){
+	uint32_t i = 0;
+	#if defined(SOUND_MIXER_USE_SSE2)
+	__m128 scale = _mm_set1_ps(s16Scale);
+	__m128 minValue = _mm_set1_ps(-s16Scale);
+	__m128 maxValue = _mm_set1_ps(s16Scale);//avoids integer overflow, saturated by _mm_packs_epi32
+	for(; i+8<=sampleCount; i+=8){
+		__m128 a = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in+i), scale), minValue), maxValue);
+		__m128 b = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(in+i+4), scale), minValue), maxValue);
+		_mm_storeu_si128((__m128i*)(out+i), _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b)));
+	}
+	#elif defined(SOUND_MIXER_USE_NEON)
+	for(; i+8<=sampleCount; i+=8){
+		int32x4_t a = vcvtnq_s32_f32(vmulq_n_f32(vld1q_f32(in+i), s16Scale));
+		int32x4_t b = vcvtnq_s32_f32(vmulq_n_f32(vld1q_f32(in+i+4), s16Scale));
+		vst1q_s16(out+i, vcombine_s16(vqmovn_s32(a), vqmovn_s32(b)));
+	}
+	#endif
+	for(; i<sampleCount; i++){
+		float v = std::max(std::min(in[i]*s16Scale, 32767.f), -s16Scale);
+		out[i] = (int16_t)lrintf(v);
+	}
+}
+
+//! converts frames of any supported format to interleaved float stereo frames
+static void convertToStereoFloat(ISoundSource::PCMFormat format, const uint8_t* in, float* out, uint32_t frameCount){
+	if(format==ISoundSource::STEREO16){
+		convertS16ToFloat((const int16_t*)in, out, 2*frameCount);
+	}else if(format==ISoundSource::MONO16){
+		const int16_t* in16 = (const int16_t*)in;
+		for(uint32_t i=0; i<frameCount; i++){
+			out[2*i] = out[2*i+1] = in16[i]/s16Scale;
+		}
+	}else if(format==ISoundSource::STEREO8){
+		for(uint32_t i=0; i<2*frameCount; i++){
+			out[i] = (in[i]-128)/128.f;
+		}
+	}else{//MONO8
+		for(uint32_t i=0; i<frameCount; i++){
+			out[2*i] = out[2*i+1] = (in[i]-128)/128.f;
+		}
+	}
+}
+
+const uint32_t SoundMixer::blockFrameCount;
+const uint32_t SoundMixer::commandQueueSize;
+
+struct SoundMixer::Channel{
+
+	ISoundSource* source;
+	ISoundSource::PCMFormat format;
+	uint32_t bytesPerFrame;
+	float gain;
+	bool paused;
+
+	double step;//source frames per output frame
+	double position;//position of the next output frame relative to the first buffered frame
+
+	std::vector<uint8_t> raw;//pcm data of the source
+	std::vector<float> frames;//buffered source frames (interleaved stereo)
+	uint32_t frameCount;//amount of buffered frames
+
+	Channel(ISoundSource* source, uint32_t outputSampleRate):
+		source(source),
+		format(source->getPCMFormat()),
+		bytesPerFrame(source->getBytesPerFrame()),
+		gain(1.f),
+		paused(false),
+		step((double)source->getSampleRate()/outputSampleRate),
+		position(0.0),
+		frameCount(0){
+		uint32_t maxFrameCount = (uint32_t)(step*blockFrameCount)+4;
+		raw.resize(maxFrameCount*bytesPerFrame);
+		frames.resize(2*maxFrameCount);
+	}
+
+	//! pulls from the source until frameCount buffered frames are available, missing data (e.g. end of source) is filled with silence
+	void fill(uint32_t neededFrameCount){
+		uint32_t missing = neededFrameCount-frameCount;
+		uint32_t received = 0;
+		while(received<missing){
+			uint32_t bytes = source->fillNextBytes(&(raw[received*bytesPerFrame]), (missing-received)*bytesPerFrame);
+			if(bytes==0){break;}
+			received += bytes/bytesPerFrame;
+		}
+		convertToStereoFloat(format, raw.data(), &(frames[2*frameCount]), received);
+		memset(&(frames[2*(frameCount+received)]), 0, 2*(missing-received)*sizeof(float));
+		frameCount = neededFrameCount;
+	}
+
+	//! removes the consumed frames from the buffer
+	void consume(uint32_t consumedFrameCount){
+		frameCount -= consumedFrameCount;
+		memmove(frames.data(), &(frames[2*consumedFrameCount]), 2*frameCount*sizeof(float));
+	}
+
+};
+
+SoundMixer::SoundMixer(SoundManager* soundmgr, uint32_t sampleRate):
+	ISoundSource(soundmgr),
+	sampleRate(sampleRate),
+	commandWriteIndex(0),
+	commandReadIndex(0),
+	processedCommandCount(0),
+	postedCommandCount(0),
+	mixBuffer(2*blockFrameCount){
+	initMutex(producerMutex);
+	initMutex(statsMutex);
+	stats = Statistics{0, 0, 0.0, 0, 0.0, 0.0};
+	publishedStats = stats;
+	channels.reserve(64);
+}
+
+SoundMixer::~SoundMixer(){
+	processCommands();//the mixing thread is not running any longer, pending channels get deleted below
+	for(Channel* c : channels){delete c;}
+	deleteMutex(producerMutex);
+	deleteMutex(statsMutex);
+}
+
+uint64_t SoundMixer::postCommand(CommandType type, ISoundSource* source, Channel* channel, float gain){
+	uint32_t writeIndex = commandWriteIndex.load(std::memory_order_relaxed);
+	while(writeIndex-commandReadIndex.load(std::memory_order_acquire)>=commandQueueSize){delay(1);}//full: wait for the mixing thread
+	commands[writeIndex%commandQueueSize] = Command{type, source, channel, gain, getSecs()};
+	commandWriteIndex.store(writeIndex+1, std::memory_order_release);
+	postedCommandCount++;
+	return postedCommandCount;
+}
+
+uint64_t SoundMixer::play(ISoundSource* source){
+	lockMutex(producerMutex);
+	uint64_t res;
+	if(activeSources.insert(source).second){
+		res = postCommand(PLAY, source, new Channel(source, sampleRate));
+	}else{
+		res = postCommand(RESUME, source);
+	}
+	unlockMutex(producerMutex);
+	return res;
+}
+
+uint64_t SoundMixer::pause(ISoundSource* source){
+	lockMutex(producerMutex);
+	uint64_t res = activeSources.count(source)>0?postCommand(PAUSE, source):postedCommandCount;
+	unlockMutex(producerMutex);
+	return res;
+}
+
+uint64_t SoundMixer::stop(ISoundSource* source){
+	lockMutex(producerMutex);
+	uint64_t res = activeSources.erase(source)>0?postCommand(STOP, source):postedCommandCount;
+	unlockMutex(producerMutex);
+	return res;
+}
+
+uint64_t SoundMixer::setGain(ISoundSource* source, float gain){
+	lockMutex(producerMutex);
+	uint64_t res = activeSources.count(source)>0?postCommand(SET_GAIN, source, NULL, gain):postedCommandCount;
+	unlockMutex(producerMutex);
+	return res;
+}
+
+bool SoundMixer::isProcessed(uint64_t commandNumber) const{
+	return processedCommandCount.load(std::memory_order_acquire)>=commandNumber;
+}
+
+SoundMixer::Statistics SoundMixer::getStatistics(){
+	lockMutex(statsMutex);
+	Statistics res = publishedStats;
+	unlockMutex(statsMutex);
+	return res;
+}
+
+void SoundMixer::processCommands(){
+	uint32_t readIndex = commandReadIndex.load(std::memory_order_relaxed);
+	uint32_t writeIndex = commandWriteIndex.load(std::memory_order_acquire);
+	if(readIndex==writeIndex){return;}
+	double now = getSecs();
+	for(; readIndex!=writeIndex; readIndex++){
+		const Command& cmd = commands[readIndex%commandQueueSize];
+		if(cmd.type==PLAY){
+			channels.push_back(cmd.channel);
+		}else{
+			for(uint32_t i=0; i<channels.size(); i++){
+				Channel* c = channels[i];
+				if(c->source==cmd.source){
+					if(cmd.type==RESUME){
+						c->paused = false;
+					}else if(cmd.type==PAUSE){
+						c->paused = true;
+					}else if(cmd.type==SET_GAIN){
+						c->gain = cmd.gain;
+					}else if(cmd.type==STOP){
+						delete c;
+						channels.erase(channels.begin()+i);
+					}
+					break;
+				}
+			}
+		}
+		double latency = now-cmd.postTime;
+		stats.commandCount++;
+		stats.sumCommandLatency += latency;
+		stats.maxCommandLatency = std::max(stats.maxCommandLatency, latency);
+	}
+	commandReadIndex.store(readIndex, std::memory_order_release);
+	processedCommandCount.store(stats.commandCount, std::memory_order_release);
+}
+
+void SoundMixer::mixChannel(Channel* c, float* mix, uint32_t frameCount){
+	if(c->step==1.0){//same sample rate: no interpolation required, position stays 0
+		if(c->frameCount<frameCount){c->fill(frameCount);}
+		mixSamples(mix, c->frames.data(), c->gain, 2*frameCount);
+		c->consume(frameCount);
+	}else{//linear interpolation
+		double endPosition = c->position+frameCount*c->step;
+		uint32_t needed = std::max((uint32_t)(c->position+(frameCount-1)*c->step)+2, (uint32_t)endPosition);
+		if(c->frameCount<needed){c->fill(needed);}
+		const float* frames = c->frames.data();
+		float gain = c->gain;
+		double position = c->position;
+		for(uint32_t i=0; i<frameCount; i++){
+			uint32_t index = (uint32_t)position;
+			float t = (float)(position-index);
+			const float* a = &(frames[2*index]);
+			mix[2*i] += gain*(a[0]+t*(a[2]-a[0]));
+			mix[2*i+1] += gain*(a[1]+t*(a[3]-a[1]));
+			position += c->step;
+		}
+		uint32_t consumed = (uint32_t)position;
+		c->position = position-consumed;
+		c->consume(consumed);
+	}
+}
+
+ISoundSource::PCMFormat SoundMixer::getPCMFormat() const{
+	return ISoundSource::STEREO16;
+}
+
+uint32_t SoundMixer::getSampleRate() const{
+	return sampleRate;
+}
+
+uint32_t SoundMixer::fillNextBytes(uint8_t* buffer, uint32_t bufferSize){
+	double startTime = getSecs();
+	processCommands();
+	uint32_t frameCount = bufferSize/4;
+	int16_t* out = (int16_t*)buffer;
+	for(uint32_t done=0; done<frameCount; done+=blockFrameCount){
+		uint32_t blockSize = std::min(blockFrameCount, frameCount-done);
+		float* mix = mixBuffer.data();
+		memset(mix, 0, 2*blockSize*sizeof(float));
+		for(Channel* c : channels){
+			if(!c->paused){
+				mixChannel(c, mix, blockSize);
+			}
+		}
+		convertFloatToS16(mix, out+2*done, 2*blockSize);
+	}
+	stats.mixedFrameCount += frameCount;
+	stats.activeSourceCount = channels.size();
+	stats.mixingTime += getSecs()-startTime;
+	if(tryLockMutex(statsMutex)){
+		publishedStats = stats;
+		unlockMutex(statsMutex);
+	}
+	return frameCount*4;
+}
+
+bool SoundMixer::isPlayingOrReady(){
+	return true;
+}
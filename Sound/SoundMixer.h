@@ -0,0 +1,109 @@
+#ifndef SoundMixer_H_INCLUDED
+#define SoundMixer_H_INCLUDED
+
+#include "ISoundSource.h"
+
+#include <Threading.h>
+
+#include <atomic>
+#include <vector>
+#include <set>
+#include <cstdint>
+
+//! Software mixer which pulls from all active sources, converts them to float stereo (including sample rate conversion by linear interpolation),
+//! applies a gain per source and mixes them into a single STEREO16 stream. The mixer is a sound source itself which is played by one playback context.
+//! play/pause/stop/setGain can be called from any thread, they are passed to the mixing thread via a lock-free queue.
+//! fillNextBytes must always be called from the same (mixing) thread, it never blocks.
+class SoundMixer : public ISoundSource{
+
+	public:
+
+	struct Statistics{
+		uint64_t mixedFrameCount;
+		uint32_t activeSourceCount;
+		double mixingTime;//! accumulated time in s spent in fillNextBytes
+		uint64_t commandCount;//! amount of processed commands
+		double sumCommandLatency;//! accumulated time in s between posting and processing of the commands
+		double maxCommandLatency;
+	};
+
+	private:
+
+	struct Channel;
+
+	enum CommandType{PLAY, RESUME, PAUSE, STOP, SET_GAIN, COMMAND_COUNT};
+
+	struct Command{
+		CommandType type;
+		ISoundSource* source;
+		Channel* channel;//new channel in case of PLAY
+		float gain;
+		double postTime;
+	};
+
+	//! amount of frames mixed at once, requests are split into blocks of this size
+	static const uint32_t blockFrameCount = 256;
+
+	uint32_t sampleRate;
+
+	//single producer single consumer ring buffer, the producers are serialized by producerMutex:
+	static const uint32_t commandQueueSize = 256;//power of 2
+	Command commands[commandQueueSize];
+	std::atomic<uint32_t> commandWriteIndex;
+	std::atomic<uint32_t> commandReadIndex;
+	std::atomic<uint64_t> processedCommandCount;
+
+	//producer only:
+	Mutex producerMutex;
+	uint64_t postedCommandCount;
+	std::set<ISoundSource*> activeSources;
+
+	//mixing thread only:
+	std::vector<Channel*> channels;
+	std::vector<float> mixBuffer;
+	Statistics stats;
+
+	Mutex statsMutex;//never blocks the mixing thread (trylock)
+	Statistics publishedStats;
+
+	//! returns the command number
+	uint64_t postCommand(CommandType type, ISoundSource* source, Channel* channel = NULL, float gain = 1.f);
+
+	void processCommands();
+
+	void mixChannel(Channel* c, float* mix, uint32_t frameCount);
+
+	public:
+
+	SoundMixer(SoundManager* soundmgr, uint32_t sampleRate);
+
+	~SoundMixer();
+
+	//! starts or resumes a source, returns the command number (see isProcessed)
+	uint64_t play(ISoundSource* source);
+
+	uint64_t pause(ISoundSource* source);
+
+	//! the source is no longer used by the mixer after the command has been processed
+	uint64_t stop(ISoundSource* source);
+
+	//! linear gain, 1 is the original volume
+	uint64_t setGain(ISoundSource* source, float gain);
+
+	//! true if the command with the given number has been processed by the mixing thread
+	bool isProcessed(uint64_t commandNumber) const;
+
+	//! statistics of the mixing thread (updated after each fillNextBytes)
+	Statistics getStatistics();
+
+	ISoundSource::PCMFormat getPCMFormat() const;
+
+	uint32_t getSampleRate() const;
+
+	uint32_t fillNextBytes(uint8_t* buffer, uint32_t bufferSize);
+
+	bool isPlayingOrReady();
+
+};
+
+#endif
@@ -0,0 +1,111 @@
+#include "StreamingWaveFileSource.h"
+#include "MappedWaveFile.h"
+#include "SoundManager.h"
+
+#include <cstring>
+#include <algorithm>
+
+const uint32_t StreamingWaveFileSource::minReadAheadSize;
+
+StreamingWaveFileSource::StreamingWaveFileSource(SoundManager* soundmgr, const char* path, double readAheadTime):
+	StreamingWaveFileSource(soundmgr, soundmgr->getMappedWaveFile(path), readAheadTime){}
+
+StreamingWaveFileSource::StreamingWaveFileSource(SoundManager* soundmgr, const std::shared_ptr<MappedWaveFile>& file, double readAheadTime):ISoundSource(soundmgr),file(file){
+	initMutex(m);
+	good = file && file->isGood();
+	readAheadSize = good?std::max(((uint32_t)(readAheadTime*file->getSampleRate())+1)*file->getBytesPerFrame(), minReadAheadSize):0;
+	loop = false;
+	ready = good;
+	offsetToSet = -1;
+	offset = readAheadOffset = releasedOffset = 0;
+	if(good){
+		file->prefetch(0, readAheadSize);
+	}
+}
+
+StreamingWaveFileSource::~StreamingWaveFileSource(){
+	deleteMutex(m);
+}
+
+void StreamingWaveFileSource::updateReadAhead(){
+	if(offset<readAheadOffset || offset>=readAheadOffset+readAheadSize/2){//seeked back or half of the window played
+		//played data is released one window behind the playback position because the OS maps neighbouring pages on page faults (fault-around)
+		uint32_t releaseEnd = offset<readAheadOffset?(readAheadOffset+readAheadSize):(offset>readAheadSize?(offset-readAheadSize):0);
+		if(releaseEnd>releasedOffset && file.use_count()==1){//other sources of the same mapping may still play the data, otherwise eviction is left to the OS
+			file->release(releasedOffset, releaseEnd-releasedOffset);
+		}
+		releasedOffset = offset>readAheadSize?(offset-readAheadSize):0;
+		readAheadOffset = offset;
+		file->prefetch(readAheadOffset, readAheadSize);
+	}
+}
+
+void StreamingWaveFileSource::setLoop(bool loop){
+	lockMutex(m);
+	this->loop = loop;
+	ready = good && (ready || loop);
+	unlockMutex(m);
+}
+
+bool StreamingWaveFileSource::isGood() const{
+	return good;
+}
+
+ISoundSource::PCMFormat StreamingWaveFileSource::getPCMFormat() const{
+	return file?file->getPCMFormat():ISoundSource::MONO8;
+}
+
+uint32_t StreamingWaveFileSource::getSampleRate() const{
+	return file?file->getSampleRate():8000;
+}
+
+uint32_t StreamingWaveFileSource::fillNextBytes(uint8_t* buffer, uint32_t bufferSize){
+	if(good){
+		lockMutex(m);
+		bool isLoop = loop;
+		if(offsetToSet>=0){
+			offset = offsetToSet;
+			offsetToSet = -1;
+		}
+		unlockMutex(m);
+		uint32_t dataSize = file->getDataSize();
+		if(offset>=dataSize){
+			if(isLoop){
+				offset = 0;
+			}else{
+				lockMutex(m);
+				ready = false;
+				unlockMutex(m);
+			}
+		}
+		uint32_t bytesPerFrame = file->getBytesPerFrame();
+		uint32_t bytesToCopy = (bufferSize/bytesPerFrame)*bytesPerFrame;
+		uint32_t bytesRemaining = dataSize-offset;
+		if(bytesToCopy>bytesRemaining){bytesToCopy = bytesRemaining;}
+		if(bytesToCopy>0){
+			updateReadAhead();
+			memcpy(buffer, file->getData()+offset, bytesToCopy);
+			offset += bytesToCopy;
+		}
+		return bytesToCopy;
+	}
+	return 0;
+}
+
+bool StreamingWaveFileSource::isPlayingOrReady(){
+	bool result = false;
+	lockMutex(m);
+	result = ready;
+	unlockMutex(m);
+	return result;
+}
+
+void StreamingWaveFileSource::seek(float position){
+	if(good){
+		uint32_t frameCount = (uint32_t)(position*(file->getDataSize()/file->getBytesPerFrame()));
+		lockMutex(m);
+		offsetToSet = std::min(frameCount*file->getBytesPerFrame(), file->getDataSize());
+		ready = true;
+		unlockMutex(m);
+	}
+}
@@ -0,0 +1,68 @@
+#ifndef StreamingWaveFileSource_H_INCLUDED
+#define StreamingWaveFileSource_H_INCLUDED
+
+#include "ISoundSource.h"
+
+#include <Threading.h>
+
+#include <memory>
+
+class MappedWaveFile;
+
+//! A sound source which streams a memory mapped wave file instead of loading it into memory
+//! Playback starts as soon as the header is parsed, the OS reads a bounded window ahead of the playback position and already played data is released.
+//! Sources created for the same path by the same SoundManager share the mapping, played data is only released while a source is the only user of the mapping.
+//! Currently only pcm wave files with 8 or 16 bit mono or stereo are supported
+class StreamingWaveFileSource : public ISoundSource{
+
+	private:
+	
+	static const uint32_t minReadAheadSize = 65536;
+	
+	//read only:
+	std::shared_ptr<MappedWaveFile> file;
+	uint32_t readAheadSize;
+	bool good;
+	
+	//exchange:
+	Mutex m;
+	bool loop;
+	bool ready;
+	int64_t offsetToSet;//-1 if no change
+	
+	//thread only:
+	uint32_t offset;
+	uint32_t readAheadOffset;//beginning of the current read ahead window
+	uint32_t releasedOffset;//data before this offset has been released
+	
+	void updateReadAhead();
+	
+	public:
+	
+	//! maps the wave file from a given path (shared with other sources of the same SoundManager)
+	//! readAheadTime: time in s which is loaded ahead of the playback position
+	StreamingWaveFileSource(SoundManager* soundmgr, const char* path, double readAheadTime = 0.5);
+	
+	//! uses an already mapped wave file
+	StreamingWaveFileSource(SoundManager* soundmgr, const std::shared_ptr<MappedWaveFile>& file, double readAheadTime = 0.5);
+	
+	~StreamingWaveFileSource();
+	
+	void setLoop(bool loop);
+	
+	//! true if wave file good and can be parsed
+	bool isGood() const;
+	
+	ISoundSource::PCMFormat getPCMFormat() const;
+	
+	uint32_t getSampleRate() const;
+	
+	uint32_t fillNextBytes(uint8_t* buffer, uint32_t bufferSize);
+	
+	bool isPlayingOrReady();
+	
+	void seek(float position);
+	
+};
+
+#endif
@@ -4,6 +4,7 @@
 #include <ZSocket.h>
 #include <SSLSocket.h>
 #include <SimpleSockets.h>
+#include <TCPAcceptor.h>
 #include <JSONRPC2Client.h>
 
 #include <mutex>
@@ -11,9 +12,21 @@
 #include <thread>
 #include <atomic>
 #include <list>
+#include <deque>
+#include <map>
+#include <unordered_map>
+#include <algorithm>
 #include <cstdint>
 #include <iostream>
 
+#include <openssl/rand.h>
+
+struct PendingStreamRequest{
+	std::string service;
+	std::string stream;
+	StreamProxyAPI::StreamConnectionSpec spec;
+};
+
 struct ControlClient : public IRemoteProcedureCaller, IRemoteProcedureCallReceiver{
 
 	//constant
@@ -28,6 +41,7 @@ struct ControlClient : public IRemoteProcedureCaller, IRemoteProcedureCallReceiv
 	
 	std::mutex mPending;
 	std::list<std::string> pendingServices;
+	std::list<PendingStreamRequest> pendingStreamRequests;
 	
 	//Thread only
 	IPv6TCPSocket* control;
@@ -68,6 +82,108 @@ struct TCPConnection{
 	
 };
 
+//! immutable datagram including the stream header, shared by all subscribers of a stream
+typedef std::shared_ptr<const std::vector<char> > StreamPacket;
+
+//! relays the datagrams of a stream from a single connection of the service to all subscribers
+struct UDPStreamRelay{
+	
+	struct Subscriber{
+		std::shared_ptr<IPv6TCPSocket> socket;
+		std::deque<StreamPacket> queue;
+		uint32_t offset;//already sent bytes of queue.front()
+	};
+	
+	static constexpr uint32_t maxQueuedPackets = 1024;//per subscriber, the oldest packets are dropped if a subscriber is too slow
+	static constexpr uint32_t maxPacketsPerSend = 64;
+	static constexpr uint32_t receiveSize = 256*1024;
+	
+	//main thread only
+	std::unique_ptr<std::thread> t;
+	StreamProxyPrivate* p;
+	
+	//exchange
+	std::atomic<uint8_t> state;//0: running, 1: must exit, 2: thread done
+	std::atomic<uint32_t> subscriberCount;
+	std::atomic<uint64_t> receivedDatagrams;
+	std::atomic<uint64_t> sentDatagrams;
+	std::atomic<uint64_t> droppedDatagrams;
+	
+	std::mutex mNew;
+	std::shared_ptr<IPv6TCPSocket> newUpstream;
+	std::list<std::shared_ptr<IPv6TCPSocket>> newSubscribers;
+	
+	//Thread only
+	std::shared_ptr<IPv6TCPSocket> upstream;
+	std::list<Subscriber> subscribers;
+	std::vector<char> in;
+	
+	UDPStreamRelay(StreamProxyPrivate* p);
+	
+	~UDPStreamRelay();
+	
+	//! may be called from any thread
+	void addUpstream(std::shared_ptr<IPv6TCPSocket> socket){
+		std::lock_guard<std::mutex> lock(mNew);
+		newUpstream = socket;
+	}
+	
+	//! may be called from any thread
+	void addSubscriber(std::shared_ptr<IPv6TCPSocket> socket){
+		std::lock_guard<std::mutex> lock(mNew);
+		newSubscribers.emplace_back(socket);
+	}
+	
+	//! splits the received data into packets, each one is copied once and shared by all subscribers
+	void distributeReceived(){
+		size_t pos = 0;
+		while(in.size()-pos>=StreamProxyAPI::streamHeaderSize){
+			uint32_t size = StreamProxyAPI::streamHeaderSize+((((uint8_t)in[pos])<<8) | ((uint8_t)in[pos+1]));
+			if(in.size()-pos<size){break;}
+			StreamPacket packet = std::make_shared<const std::vector<char> >(in.begin()+pos, in.begin()+pos+size);
+			receivedDatagrams++;
+			for(Subscriber& s : subscribers){
+				if(s.queue.size()>=maxQueuedPackets){
+					s.queue.erase(s.queue.begin()+(s.offset>0?1:0));//a partially sent packet must be completed
+					droppedDatagrams++;
+				}
+				s.queue.push_back(packet);
+			}
+			pos += size;
+		}
+		in.erase(in.begin(), in.begin()+pos);
+	}
+	
+	//! sends as many queued packets as possible with a single system call, false if the subscriber is gone
+	bool flush(Subscriber& s){
+		if(s.queue.empty()){return true;}
+		const char* bufs[maxPacketsPerSend];
+		uint32_t sizes[maxPacketsPerSend];
+		uint32_t count = 0;
+		for(auto it=s.queue.begin(); it!=s.queue.end() && count<maxPacketsPerSend; ++it, count++){
+			uint32_t offset = count==0?s.offset:0;
+			bufs[count] = (*it)->data()+offset;
+			sizes[count] = (*it)->size()-offset;
+		}
+		int64_t sent = s.socket->sendBuffers(bufs, sizes, count, false);
+		if(sent<0){return false;}
+		while(sent>0){
+			uint32_t rest = s.queue.front()->size()-s.offset;
+			if(sent>=rest){
+				sent -= rest;
+				s.offset = 0;
+				s.queue.pop_front();
+				sentDatagrams++;
+			}else{
+				s.offset += sent;
+				sent = 0;
+			}
+		}
+		return true;
+	}
+	
+};
+
 class StreamProxyPrivate{
 	
 	public:
@@ -78,14 +194,50 @@ class StreamProxyPrivate{
 		IPv6Address second;
 		std::shared_ptr<IPv6TCPSocket> firstSocket;
 		std::shared_ptr<IPv6TCPSocket> secondSocket;
+		bool done;//both sockets connected
 		
-		PendingTCPConnection(const IPv6Address& first, const IPv6Address& second):first(first),second(second),firstSocket(std::shared_ptr<IPv6TCPSocket>(nullptr)),secondSocket(std::shared_ptr<IPv6TCPSocket>(nullptr)){
+		PendingTCPConnection(const IPv6Address& first, const IPv6Address& second):first(first),second(second),firstSocket(std::shared_ptr<IPv6TCPSocket>(nullptr)),secondSocket(std::shared_ptr<IPv6TCPSocket>(nullptr)),done(false){
 			this->first.setPort(0);
 			this->second.setPort(0);
 			startTime = getSecs();
 		}
 	};
 	
+	//! new connections of a port, accepted in background threads (SO_REUSEPORT sharding, see TCPAcceptor) or polled in update
+	class Listener{
+		
+		TCPAcceptor::OnAccept onAccept;
+		std::unique_ptr<IPv6TCPSocket> socket;
+		std::unique_ptr<TCPAcceptor> acceptor;
+		
+		public:
+		
+		static constexpr int maxPendingConnections = 128;//many peers may reconnect at once (e.g. after a network outage)
+		
+		Listener(uint16_t port, uint32_t acceptThreadCount, const TCPAcceptor::OnAccept& onAccept):onAccept(onAccept){
+			if(acceptThreadCount>0){
+				acceptor = std::unique_ptr<TCPAcceptor>(new TCPAcceptor(port, acceptThreadCount, maxPendingConnections, onAccept));
+			}else{
+				socket = std::unique_ptr<IPv6TCPSocket>(new IPv6TCPSocket());
+				socket->bind(port);
+				socket->listen(maxPendingConnections);
+			}
+		}
+		
+		//! polling only, passes all pending connections to onAccept
+		void poll(){
+			if(socket){
+				IPv6Address address;
+				IPv6TCPSocket* s = socket->accept(0, &address);
+				while(s!=NULL){
+					onAccept(s, address);
+					s = socket->accept(0, &address);
+				}
+			}
+		}
+		
+	};
+	
 	struct Service{
 		IPv6Address address;
 		std::string password;
@@ -97,7 +249,26 @@ class StreamProxyPrivate{
 	std::map<ControlClient*, std::list<std::string>> controlClient2Services;
 	
 	std::mutex mPendingConnections;
-	std::list<PendingTCPConnection> pendingTCP;
+	std::deque<std::shared_ptr<PendingTCPConnection> > pendingTCP;//in order of creation for the timeouts
+	std::unordered_map<IPv6Address, std::deque<std::shared_ptr<PendingTCPConnection> >, IPv6AddressHash> pendingTCPByAddress;//peer address (port 0) -> connections waiting for a socket from this address (one entry per open slot) in order of creation
+	std::list<std::shared_ptr<TCPConnection> > newDataClients;
+	
+	struct PendingStreamConnection{
+		double startTime;
+		std::shared_ptr<UDPStreamRelay> relay;
+		bool isUpstream;
+	};
+	
+	struct StreamHandshake{
+		std::shared_ptr<IPv6TCPSocket> socket;
+		std::string token;
+		double startTime;
+	};
+	
+	std::mutex mStreams;
+	std::map<std::string, std::shared_ptr<UDPStreamRelay> > streamRelays;//service + '\n' + stream -> relay
+	std::list<std::shared_ptr<UDPStreamRelay> > replacedRelays;//done, to be joined
+	std::map<std::string, PendingStreamConnection> pendingStreams;//token -> connection
 	
 	//constant data
 	SSLContext sslContext;
@@ -106,27 +277,58 @@ class StreamProxyPrivate{
 	const std::string password;
 	const uint16_t controlPort;
 	const uint16_t dataPort;
+	const uint16_t streamPort;
 	
 	//main thread only
-	IPv6TCPSocket control;
-	IPv6TCPSocket data;
+	std::list<StreamHandshake> streamHandshakes;
 	
 	std::list<std::shared_ptr<ControlClient>> controlClients;
 	std::list<std::shared_ptr<TCPConnection>> dataClients;
 	
-	StreamProxyPrivate(const std::string password, uint16_t controlPort, uint16_t dataPort, uint32_t pingTimeout, uint32_t dataExchangeTimeout):sslContext(SSLContext::SERVER),pingTimeout(pingTimeout),dataExchangeTimeout(dataExchangeTimeout/1000.0),password(password),controlPort(controlPort),dataPort(dataPort){
-		control.bind(controlPort);
-		control.listen(10);
-		data.bind(dataPort);
-		data.listen(10);
+	//exchange with the accept threads
+	std::mutex mAccepted;
+	std::list<std::shared_ptr<ControlClient>> newControlClients;
+	std::list<StreamHandshake> newStreamHandshakes;
+	
+	std::unique_ptr<Listener> control;
+	std::unique_ptr<Listener> data;
+	std::unique_ptr<Listener> streamListener;
+	
+	StreamProxyPrivate(const std::string password, uint16_t controlPort, uint16_t dataPort, uint32_t pingTimeout, uint32_t dataExchangeTimeout, uint16_t streamPort, uint32_t acceptThreadCount):sslContext(SSLContext::SERVER),pingTimeout(pingTimeout),dataExchangeTimeout(dataExchangeTimeout/1000.0),password(password),controlPort(controlPort),dataPort(dataPort),streamPort(streamPort){
+		control = std::unique_ptr<Listener>(new Listener(controlPort, acceptThreadCount, [this](IPv6TCPSocket* s, const IPv6Address& address){
+			std::shared_ptr<ControlClient> c = std::make_shared<ControlClient>(this, s, address);//TLS handshake in the thread of the control client
+			std::lock_guard<std::mutex> lock(mAccepted);
+			newControlClients.emplace_back(c);
+		}));
+		data = std::unique_ptr<Listener>(new Listener(dataPort, acceptThreadCount, [this](IPv6TCPSocket* s, const IPv6Address& address){
+			addDataSocket(s, address);
+		}));
+		if(streamPort!=0){
+			streamListener = std::unique_ptr<Listener>(new Listener(streamPort, acceptThreadCount, [this](IPv6TCPSocket* s, const IPv6Address& address){
+				std::lock_guard<std::mutex> lock(mAccepted);
+				newStreamHandshakes.emplace_back(StreamHandshake{std::shared_ptr<IPv6TCPSocket>(s), "", getSecs()});
+			}));
+		}
+	}
+	
+	~StreamProxyPrivate(){
+		control.reset();//no more new connections
+		data.reset();
+		streamListener.reset();
+		std::lock_guard<std::mutex> lock(mStreams);
+		pendingStreams.clear();
+		streamRelays.clear();//joins
+		replacedRelays.clear();
 	}
 	
 	void update(){
+		control->poll();
+		data->poll();
+		if(streamListener){streamListener->poll();}
 		//new control clients
-		IPv6Address address;
-		IPv6TCPSocket* newControl = control.accept(0, &address);
-		if(newControl!=NULL){
-			controlClients.emplace_back(std::make_shared<ControlClient>(this, newControl, address));
+		{
+			std::lock_guard<std::mutex> lock(mAccepted);
+			controlClients.splice(controlClients.end(), newControlClients);
 		}
 		//update control clients
 		auto cit = controlClients.begin();
@@ -147,28 +349,9 @@ class StreamProxyPrivate{
 			}
 		}
 		//new data clients
-		IPv6Address dataAddress;
-		IPv6TCPSocket* newData = data.accept(0, &dataAddress);
-		if(newData!=NULL){
-			dataAddress.setPort(0);//to compare
+		{
 			std::lock_guard<std::mutex> lock(mPendingConnections);
-			auto it = pendingTCP.begin();
-			bool notUsed = true;
-			while(notUsed && it!=pendingTCP.end()){
-				if(!it->firstSocket && it->first==dataAddress){
-					it->firstSocket = std::shared_ptr<IPv6TCPSocket>(newData);
-					notUsed = false;
-				}else if(!it->secondSocket && it->second==dataAddress){
-					it->secondSocket = std::shared_ptr<IPv6TCPSocket>(newData);
-					notUsed = false;
-				}
-				if(it->firstSocket && it->secondSocket){
-					dataClients.emplace_back(std::shared_ptr<TCPConnection>(new TCPConnection(this, it->firstSocket, it->secondSocket)));
-					it = pendingTCP.erase(it);
-				}else{
-					++it;
-				}
-			}
+			dataClients.splice(dataClients.end(), newDataClients);
 		}
 		//update data clients
 		auto dit = dataClients.begin();
@@ -179,22 +362,58 @@ class StreamProxyPrivate{
 				++dit;
 			}
 		}
+		if(streamPort!=0){
+			updateStreams();
+		}
 		//timeout for pending connections
 		{
 			double t = getSecs();
 			std::lock_guard<std::mutex> lock(mPendingConnections);
-			auto it = pendingTCP.begin();
-			while(it!=pendingTCP.end()){
-				if(t-it->startTime>dataExchangeTimeout){
+			while(!pendingTCP.empty() && (pendingTCP.front()->done || t-pendingTCP.front()->startTime>dataExchangeTimeout)){
+				std::shared_ptr<PendingTCPConnection>& c = pendingTCP.front();
+				if(!c->done){
 					std::cout << "Connection timeout." << std::endl;
-					it = pendingTCP.erase(it);
-				}else{
-					++it;
+					removePendingSlot(c, c->first);
+					if(!(c->second==c->first)){removePendingSlot(c, c->second);}
 				}
+				pendingTCP.pop_front();
 			}
 		}
 	}
 	
+	//! mPendingConnections must be locked
+	void removePendingSlot(const std::shared_ptr<PendingTCPConnection>& c, const IPv6Address& address){
+		auto it = pendingTCPByAddress.find(address);
+		if(it!=pendingTCPByAddress.end()){
+			it->second.erase(std::remove(it->second.begin(), it->second.end(), c), it->second.end());
+			if(it->second.empty()){pendingTCPByAddress.erase(it);}
+		}
+	}
+	
+	//! may be called from any thread, assigns the socket to the oldest pending connection which waits for a socket from this address
+	void addDataSocket(IPv6TCPSocket* s, IPv6Address address){
+		std::shared_ptr<IPv6TCPSocket> socket(s);
+		address.setPort(0);//to compare
+		std::lock_guard<std::mutex> lock(mPendingConnections);
+		auto it = pendingTCPByAddress.find(address);
+		if(it!=pendingTCPByAddress.end()){
+			std::shared_ptr<PendingTCPConnection> c = it->second.front();
+			it->second.pop_front();
+			if(it->second.empty()){pendingTCPByAddress.erase(it);}
+			if(!c->firstSocket && c->first==address){
+				c->firstSocket = socket;
+			}else{
+				c->secondSocket = socket;
+			}
+			if(c->firstSocket && c->secondSocket){
+				newDataClients.emplace_back(std::shared_ptr<TCPConnection>(new TCPConnection(this, c->firstSocket, c->secondSocket)));
+				c->firstSocket.reset();
+				c->secondSocket.reset();
+				c->done = true;
+			}
+		}//otherwise unexpected => closed
+	}
+	
 	//! returns true if successful, may be called from any thread
 	bool authenticate(const std::string& service, const std::string& password){
 		std::lock_guard<std::mutex> lock(mService);
@@ -225,7 +444,10 @@ class StreamProxyPrivate{
 		if(it!=services.end()){
 			{
 				std::lock_guard<std::mutex> lock(mPendingConnections);
-				pendingTCP.emplace_back(PendingTCPConnection(address, it->second->address));
+				std::shared_ptr<PendingTCPConnection> c = std::make_shared<PendingTCPConnection>(address, it->second->address);
+				pendingTCP.emplace_back(c);
+				pendingTCPByAddress[c->first].emplace_back(c);
+				pendingTCPByAddress[c->second].emplace_back(c);
 			}
 			{
 				std::lock_guard<std::mutex> lock(it->second->client->mPending);
@@ -236,13 +458,114 @@ class StreamProxyPrivate{
 		return 0;
 	}
 	
-	/*
+	//! new stream connections, handshakes and finished relays
+	void updateStreams(){
+		double t = getSecs();
+		{
+			std::lock_guard<std::mutex> lock(mAccepted);
+			streamHandshakes.splice(streamHandshakes.end(), newStreamHandshakes);
+		}
+		auto hit = streamHandshakes.begin();
+		while(hit!=streamHandshakes.end()){
+			char buf[StreamProxyAPI::streamTokenSize];
+			uint32_t received = hit->socket->recv(buf, StreamProxyAPI::streamTokenSize-hit->token.size(), false);//no more than the token
+			hit->token.append(buf, received);
+			if(hit->token.size()==StreamProxyAPI::streamTokenSize){
+				std::lock_guard<std::mutex> lock(mStreams);
+				auto pit = pendingStreams.find(hit->token);
+				if(pit!=pendingStreams.end()){
+					if(pit->second.isUpstream){
+						pit->second.relay->addUpstream(hit->socket);
+					}else{
+						pit->second.relay->addSubscriber(hit->socket);
+					}
+					pendingStreams.erase(pit);
+				}else{
+					std::cout << "Unknown stream token." << std::endl;
+				}
+				hit = streamHandshakes.erase(hit);
+			}else if(t-hit->startTime>dataExchangeTimeout){
+				hit = streamHandshakes.erase(hit);
+			}else{
+				++hit;
+			}
+		}
+		std::lock_guard<std::mutex> lock(mStreams);
+		auto pit = pendingStreams.begin();
+		while(pit!=pendingStreams.end()){
+			if(t-pit->second.startTime>dataExchangeTimeout){
+				pit = pendingStreams.erase(pit);
+			}else{
+				++pit;
+			}
+		}
+		auto rit = streamRelays.begin();
+		while(rit!=streamRelays.end()){
+			if(rit->second->state==2){
+				rit = streamRelays.erase(rit);
+			}else{
+				++rit;
+			}
+		}
+		replacedRelays.clear();
+	}
+	
+	//! hex encoded random bytes from OpenSSL's CSPRNG (tokens must not be predictable), empty if unsuccessful
+	std::string createStreamToken(){
+		static const char* hex = "0123456789abcdef";
+		unsigned char r[StreamProxyAPI::streamTokenSize/2];
+		if(RAND_bytes(r, sizeof(r))!=1){
+			std::cerr << "Unable to create a stream token." << std::endl;
+			return "";
+		}
+		std::string token(StreamProxyAPI::streamTokenSize, '0');
+		for(uint32_t i=0; i<token.size(); i++){
+			token[i] = hex[(r[i/2]>>(4*(i%2)))&0xF];
+		}
+		return token;
+	}
+	
+	//! can be called from any thread, port 0 if unsuccessful
+	//! the first subscriber of a stream creates the relay and requests the stream from the service
+	StreamProxyAPI::StreamConnectionSpec addMCStreamConnection(const std::string& service, const std::string& stream){
+		StreamProxyAPI::StreamConnectionSpec spec{0, ""};
+		if(streamPort==0){return spec;}
+		std::string upstreamToken = createStreamToken(), token = createStreamToken();
+		if(upstreamToken.empty() || token.empty()){return spec;}
+		std::lock_guard<std::mutex> lock(mService);
+		auto it = services.find(service);
+		if(it!=services.end()){
+			std::lock_guard<std::mutex> lock(mStreams);
+			std::shared_ptr<UDPStreamRelay>& relay = streamRelays[service+"\n"+stream];
+			if(!relay || relay->state!=0){
+				if(relay){replacedRelays.emplace_back(relay);}
+				relay = std::make_shared<UDPStreamRelay>(this);
+				pendingStreams[upstreamToken] = PendingStreamConnection{getSecs(), relay, true};
+				std::lock_guard<std::mutex> lock(it->second->client->mPending);
+				it->second->client->pendingStreamRequests.emplace_back(PendingStreamRequest{service, stream, StreamProxyAPI::StreamConnectionSpec{streamPort, upstreamToken}});
+			}
+			spec.port = streamPort;
+			spec.token = token;
+			pendingStreams[spec.token] = PendingStreamConnection{getSecs(), relay, false};
+		}
+		return spec;
+	}
+	
 	//! can be called from any thread
-	uint16_t addMCStreamConnection(const std::string& service, const std::string& streamName, const IPv6Address& address){
-		//TODO
-		return streamPort;
+	StreamProxy::StreamStatistics getStreamStatistics(){
+		StreamProxy::StreamStatistics stats{0, 0, 0, 0, 0};
+		std::lock_guard<std::mutex> lock(mStreams);
+		for(auto& r : streamRelays){
+			if(r.second->state==0){
+				stats.relayCount++;
+				stats.subscriberCount += r.second->subscriberCount;
+				stats.receivedDatagrams += r.second->receivedDatagrams;
+				stats.sentDatagrams += r.second->sentDatagrams;
+				stats.droppedDatagrams += r.second->droppedDatagrams;
+			}
+		}
+		return stats;
 	}
-	*/
 	
 	//! overrides existing service, may be called from any thread
 	void addService(ControlClient* client, const IPv6Address& address, StreamProxyAPI::ServiceSpec& spec){
@@ -288,12 +611,95 @@ TCPConnection::TCPConnection(StreamProxyPrivate* p, std::shared_ptr<IPv6TCPSocke
 	}));
 }
 
+UDPStreamRelay::UDPStreamRelay(StreamProxyPrivate* p):p(p){
+	state = 0;
+	subscriberCount = 0;
+	receivedDatagrams = 0;
+	sentDatagrams = 0;
+	droppedDatagrams = 0;
+	t = std::unique_ptr<std::thread>(new std::thread([this](){
+		double startTime = getSecs();
+		double lastSubscriberTime = startTime;
+		double lastCloseCheck = startTime;
+		bool running = true;
+		while(running){
+			double t = getSecs();
+			running = state==0;
+			{
+				std::lock_guard<std::mutex> lock(mNew);
+				if(newUpstream){
+					upstream = newUpstream;
+					newUpstream.reset();
+				}
+				for(std::shared_ptr<IPv6TCPSocket>& s : newSubscribers){
+					subscribers.emplace_back(Subscriber{s, std::deque<StreamPacket>(), 0});
+				}
+				newSubscribers.clear();
+			}
+			bool pendingOutput = false;
+			for(Subscriber& s : subscribers){pendingOutput = pendingOutput || !s.queue.empty();}
+			if(upstream){
+				if(upstream->waitForReceive(pendingOutput?1:10)){
+					size_t used = in.size();
+					in.resize(used+receiveSize);
+					uint32_t received = upstream->recv(&in[used], receiveSize, false);
+					in.resize(used+received);
+					if(received==0){
+						std::cout << "Stream closed by service." << std::endl;
+						running = false;
+					}else{
+						distributeReceived();
+					}
+				}
+			}else{
+				running = running && t-startTime<this->p->dataExchangeTimeout;
+				delay(10);
+			}
+			auto it = subscribers.begin();
+			while(it!=subscribers.end()){
+				if(flush(*it)){
+					++it;
+				}else{
+					it = subscribers.erase(it);
+				}
+			}
+			if(t-lastCloseCheck>0.1){//subscribers don't send anything => readable means closed
+				lastCloseCheck = t;
+				it = subscribers.begin();
+				while(it!=subscribers.end()){
+					if(it->socket->waitForReceive(0) && it->socket->getAvailableBytes()==0){
+						it = subscribers.erase(it);
+					}else{
+						++it;
+					}
+				}
+			}
+			subscriberCount = subscribers.size();
+			if(!subscribers.empty()){
+				lastSubscriberTime = t;
+			}else{
+				running = running && t-lastSubscriberTime<this->p->dataExchangeTimeout;
+			}
+		}
+		upstream.reset();
+		subscribers.clear();
+		subscriberCount = 0;
+		std::cout << "Stream relay terminated." << std::endl;
+		state = 2;
+	}));
+}
+
+UDPStreamRelay::~UDPStreamRelay(){
+	if(state==0){state = 1;}
+	t->join();
+}
+
 ControlClient::ControlClient(StreamProxyPrivate* p, IPv6TCPSocket* control, const IPv6Address& address):address(address),p(p),control(control){
 	state = 0;
 	loginSuccess = false;
 	t = std::unique_ptr<std::thread>(new std::thread([this, control](){
-		bool running = true;
 		ssl = new SSLSocket(&(this->p->sslContext), control, true);
+		bool running = ssl->accept();
 		z = new ZSocket(ssl);
 		JSONRPC2Client client;
 		client.useSocket(z, this->p->pingTimeout, PING_DISABLE_SEND_PERIOD);
@@ -301,7 +707,7 @@ ControlClient::ControlClient(StreamProxyPrivate* p, IPv6TCPSocket* control, cons
 		client.registerCallReceiver("authenticate", this);//authenticate for service
 		client.registerCallReceiver("getServiceList", this);
 		client.registerCallReceiver("connectTCP", this);//connect to service @ specific port
-//		client.registerCallReceiver("subscribeToMCStream", this);//subscribes to a multicast stream of a service (service name, stream name)
+		client.registerCallReceiver("subscribeToMCStream", this);//subscribes to a multicast stream of a service (service name, stream name)
 		client.registerCallReceiver("registerService", this);
 		while(running){
 			running = state != 1;
@@ -313,6 +719,11 @@ ControlClient::ControlClient(StreamProxyPrivate* p, IPv6TCPSocket* control, cons
 					StreamProxyAPI::OnNewTCPClient(&client, pendingServices.front(), this->p->dataPort, this);
 					pendingServices.pop_front();
 				}
+				while(!pendingStreamRequests.empty()){
+					PendingStreamRequest& r = pendingStreamRequests.front();
+					StreamProxyAPI::OnMCStreamRequested(&client, r.service, r.stream, r.spec, this);
+					pendingStreamRequests.pop_front();
+				}
 			}
 			delay(10);//long delay since control does not need speed
 		}
@@ -343,7 +754,7 @@ IRPCValue* ControlClient::callProcedure(const std::string& procedure, const std:
 	static const std::vector<IRPCValue::Type> authenticateSignature{IRPCValue::STRING, IRPCValue::STRING};
 	static const std::vector<IRPCValue::Type> getServiceListSignature{};
 	static const std::vector<IRPCValue::Type> connectTCPSignature{IRPCValue::STRING};
-//	static const std::vector<IRPCValue::Type> subscribeToMCStreamSignature{IRPCValue::STRING, IRPCValue::STRING};
+	static const std::vector<IRPCValue::Type> subscribeToMCStreamSignature{IRPCValue::STRING, IRPCValue::STRING};
 	static const std::vector<IRPCValue::Type> registerServiceSignature{IRPCValue::OBJECT};
 	if(procedure=="login" && hasValidRPCSignature(values, loginSignature)){
 		loginSuccess = ((StringValue*)(values[0]))->value == p->password;
@@ -371,16 +782,14 @@ IRPCValue* ControlClient::callProcedure(const std::string& procedure, const std:
 			}
 		}
 		return createRPCValue<uint16_t>(0);
-		/*
 	}else if(procedure=="subscribeToMCStream" && hasValidRPCSignature(values, subscribeToMCStreamSignature)){
 		if(loginSuccess){
 			const std::string& service = ((StringValue*)(values[0]))->value;
 			if(authenticatedServices.find(service)!=authenticatedServices.end()){
-				return createRPCValue<uint16_t>(p->addMCStreamConnection(service, ((StringValue*)(values[1]))->value, address));
+				return createRPCValue(p->addMCStreamConnection(service, ((StringValue*)(values[1]))->value));
 			}
 		}
-		return createRPCValue<uint16_t>(0);
-	*/
+		return createRPCValue(StreamProxyAPI::StreamConnectionSpec{0, ""});
 	}else if(procedure=="registerService" && hasValidRPCSignature(values, registerServiceSignature)){//check object signature not required due to FILL_NATIVE_FIELD_IF_AVAILABLE
 		if(loginSuccess){
 			StreamProxyAPI::ServiceSpec spec = createNativeValue<StreamProxyAPI::ServiceSpec>(values[0]);
@@ -391,8 +800,8 @@ IRPCValue* ControlClient::callProcedure(const std::string& procedure, const std:
 	return NULL;
 }
 
-StreamProxy::StreamProxy(const std::string password, uint16_t controlPort, uint16_t dataPort, uint32_t pingTimeout, uint32_t dataExchangeTimeout){
-	p = new StreamProxyPrivate(password, controlPort, dataPort, pingTimeout, dataExchangeTimeout);
+StreamProxy::StreamProxy(const std::string password, uint16_t controlPort, uint16_t dataPort, uint32_t pingTimeout, uint32_t dataExchangeTimeout, uint16_t streamPort, uint32_t acceptThreadCount){
+	p = new StreamProxyPrivate(password, controlPort, dataPort, pingTimeout, dataExchangeTimeout, streamPort, acceptThreadCount);
 }
 	
 StreamProxy::~StreamProxy(){
@@ -418,3 +827,7 @@ bool StreamProxy::useCertificateFromFile(const std::string& path){
 void StreamProxy::update(){
 	p->update();
 }
+
+StreamProxy::StreamStatistics StreamProxy::getStreamStatistics(){
+	return p->getStreamStatistics();
+}
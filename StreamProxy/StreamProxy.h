@@ -16,11 +16,21 @@ class StreamProxy{
 	
 	public:
 	
+	struct StreamStatistics{
+		uint32_t relayCount;//! active streams (one connection from the service each)
+		uint32_t subscriberCount;
+		uint64_t receivedDatagrams;//! from the services
+		uint64_t sentDatagrams;//! to the subscribers
+		uint64_t droppedDatagrams;//! for slow subscribers
+	};
+	
 	//! password required for each peer to connect
 	//! controlPort: listens for incoming control connections
 	//! dataPort: listens for incoming connections for data transfer
 	//! pingTimeout: in milliseconds
-	StreamProxy(const std::string password, uint16_t controlPort, uint16_t dataPort, uint32_t pingTimeout = StreamProxyAPI::proxyPingTimeout, uint32_t dataExchangeTimeout = StreamProxyAPI::dataExchangeTimeout);
+	//! streamPort: listens for incoming connections for UDP streams (0: streams disabled)
+	//! acceptThreadCount: 0: new connections are polled in update, >0: accepted in background threads per port with one listening socket each (SO_REUSEPORT, see TCPAcceptor)
+	StreamProxy(const std::string password, uint16_t controlPort, uint16_t dataPort, uint32_t pingTimeout = StreamProxyAPI::proxyPingTimeout, uint32_t dataExchangeTimeout = StreamProxyAPI::dataExchangeTimeout, uint16_t streamPort = 0, uint32_t acceptThreadCount = 0);
 	
 	~StreamProxy();
 	
@@ -42,6 +52,8 @@ class StreamProxy{
 	
 	void update();
 	
+	StreamStatistics getStreamStatistics();
+	
 };
 
 #endif
@@ -8,6 +8,11 @@ namespace StreamProxyAPI{
 constexpr uint32_t proxyPingTimeout = 4000;
 constexpr uint32_t dataExchangeTimeout = 4000;
 
+//! a stream connection (TCP @ stream port) starts with the token, then the datagrams follow, each one prefixed with its size (2 bytes, big endian)
+constexpr uint32_t streamTokenSize = 32;//hex characters (128 bit)
+constexpr uint32_t streamHeaderSize = 2;
+constexpr uint32_t maxDatagramSize = 65507;
+
 class ServiceSpec{
 	
 	public:
@@ -26,6 +31,24 @@ class ServiceSpec{
 	CREATE_NATIVE_END
 };
 
+class StreamConnectionSpec{
+	
+	public:
+	
+	uint16_t port;//! stream port @ proxy, 0 if unsuccessful
+	std::string token;//! streamTokenSize characters to be sent first
+	
+	CREATE_BEGIN(StreamConnectionSpec)
+		FILL_FIELD(port)
+		FILL_FIELD(token)
+	CREATE_END
+	
+	CREATE_NATIVE_BEGIN(StreamConnectionSpec)
+		FILL_NATIVE_FIELD_IF_AVAILABLE(port, (uint16_t)0)
+		FILL_NATIVE_FIELD_IF_AVAILABLE(token, std::string(""))
+	CREATE_NATIVE_END
+};
+
 enum RemoteApiFunctions{
 	//@Server:
 	LOGIN,
@@ -33,8 +56,10 @@ enum RemoteApiFunctions{
 	GETSERVICELIST,
 	CONNECTTCP,
 	REGISTERSERVICE,
+	SUBSCRIBETOMCSTREAM,
 	//@Client:
 	ONNEWTCPCLIENT,
+	ONMCSTREAMREQUESTED,
 	REMOTE_API_FUNCTION_COUNT
 };
 
@@ -63,6 +88,18 @@ inline void registerService(IRPC* rpc, const ServiceSpec& spec, IRemoteProcedure
 	rpc->callRemoteProcedure("registerService", std::vector<IRPCValue*>{createRPCValue(spec)}, caller, id);
 }
 
+//! subscribes to a UDP (multicast) stream of a service, prior authentication required, returns a StreamConnectionSpec
+//! the stream is relayed only once from the service to the proxy regardless of the amount of subscribers
+inline void subscribeToMCStream(IRPC* rpc, const std::string& service, const std::string& stream, IRemoteProcedureCaller* caller, uint32_t id = SUBSCRIBETOMCSTREAM){
+	rpc->callRemoteProcedure("subscribeToMCStream", std::vector<IRPCValue*>{createRPCValue(service), createRPCValue(stream)}, caller, id);
+}
+
+//! called @ service by the proxy if the first subscriber of a stream arrives, the service shall connect to spec.port @ proxy, send the token and then the datagrams
+//! the proxy closes the connection if there are no more subscribers
+inline void OnMCStreamRequested(IRPC* rpc, const std::string& service, const std::string& stream, const StreamConnectionSpec& spec, IRemoteProcedureCaller* caller, uint32_t id = ONMCSTREAMREQUESTED){
+	rpc->callRemoteProcedure("OnMCStreamRequested", std::vector<IRPCValue*>{createRPCValue(service), createRPCValue(stream), createRPCValue(spec)}, caller, id);
+}
+
 //! called @ proxy client / server from other point of view to establish a new tcp connection
 //! port: port to connect @ proxy (TLS over Z over TCP)
 inline void OnNewTCPClient(IRPC* rpc, const std::string& service, uint16_t port, IRemoteProcedureCaller* caller, uint32_t id = ONNEWTCPCLIENT){
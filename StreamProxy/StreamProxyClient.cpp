@@ -2,12 +2,113 @@
 
 #include <ProcedureCallAdapter.h>
 #include <SSLSocket.h>
+#include <ZSocket.h>
 #include <SimpleSockets.h>
 #include <JSONRPC2Client.h>
 #include <timing.h>
 
 #include <iostream>
 #include <unordered_map>
+#include <map>
+#include <thread>
+#include <atomic>
+
+//! forwards a stream between a connection to the proxy and UDP in a separate thread
+struct StreamForwarder{
+	
+	static constexpr uint32_t batchSize = 32;//datagrams per system call
+	static constexpr uint32_t receiveSize = 256*1024;
+	static constexpr uint32_t udpReceiveBufferSize = 4*1024*1024;//bursts while the proxy connection is busy
+	
+	std::unique_ptr<std::thread> t;
+	std::atomic<uint8_t> state;//0: running, 1: must exit, 2: thread done
+	
+	//! service side: UDP => proxy, ends if the proxy closes the connection (no more subscribers)
+	StreamForwarder(ASocket* proxy, uint16_t udpPort, const std::string& multicastGroup){
+		state = 0;
+		t = std::unique_ptr<std::thread>(new std::thread([this, proxy, udpPort, multicastGroup](){
+			IPv4UDPSocket udp;
+			udp.bind(udpPort, true);
+			udp.setReceiveBufferSize(udpReceiveBufferSize);
+			if(!multicastGroup.empty()){udp.enableAutoMulticastGroupJoining(IPv4Address(multicastGroup, udpPort));}
+			std::vector<char> buffer(batchSize*(StreamProxyAPI::streamHeaderSize+StreamProxyAPI::maxDatagramSize));
+			char* bufs[batchSize];
+			uint32_t sizes[batchSize];
+			const char* out[batchSize];
+			uint32_t outSizes[batchSize];
+			for(uint32_t i=0; i<batchSize; i++){//space for the header in front of each datagram => no copy required
+				bufs[i] = &buffer[i*(StreamProxyAPI::streamHeaderSize+StreamProxyAPI::maxDatagramSize)+StreamProxyAPI::streamHeaderSize];
+			}
+			while(state==0){
+				uint32_t count = udp.recvBatch(bufs, StreamProxyAPI::maxDatagramSize, sizes, batchSize);
+				if(count>0){
+					for(uint32_t i=0; i<count; i++){
+						out[i] = bufs[i]-StreamProxyAPI::streamHeaderSize;
+						((uint8_t*)out[i])[0] = (sizes[i]>>8)&0xFF;
+						((uint8_t*)out[i])[1] = sizes[i]&0xFF;
+						outSizes[i] = sizes[i]+StreamProxyAPI::streamHeaderSize;
+					}
+					if(proxy->sendBuffers(out, outSizes, count)<0){break;}
+				}else{
+					udp.waitForReceive(10);
+					if(proxy->waitForReceive(0) && proxy->getAvailableBytes()==0){break;}//closed by proxy
+				}
+			}
+			delete proxy;
+			state = 2;
+		}));
+	}
+	
+	//! subscriber side: proxy => UDP target, ends if the stream ends
+	StreamForwarder(ASocket* proxy, const IPv4Address& target){
+		state = 0;
+		t = std::unique_ptr<std::thread>(new std::thread([this, proxy, target](){
+			IPv4UDPSocket udp;
+			udp.setUDPTarget(target);
+			std::vector<char> in;
+			const char* bufs[batchSize];
+			uint32_t sizes[batchSize];
+			while(state==0){
+				if(!proxy->waitForReceive(10)){continue;}
+				size_t used = in.size();
+				in.resize(used+receiveSize);
+				uint32_t received = proxy->recv(&in[used], receiveSize, false);
+				in.resize(used+received);
+				if(received==0){break;}//closed by proxy
+				size_t pos = 0;
+				uint32_t count = 0;
+				while(in.size()-pos>=StreamProxyAPI::streamHeaderSize){
+					uint32_t size = (((uint8_t)in[pos])<<8) | ((uint8_t)in[pos+1]);
+					if(in.size()-pos<StreamProxyAPI::streamHeaderSize+size){break;}
+					bufs[count] = &in[pos+StreamProxyAPI::streamHeaderSize];
+					sizes[count] = size;
+					count++;
+					pos += StreamProxyAPI::streamHeaderSize+size;
+					if(count==batchSize){
+						udp.sendBatch(bufs, sizes, count);
+						count = 0;
+					}
+				}
+				if(count>0){udp.sendBatch(bufs, sizes, count);}
+				in.erase(in.begin(), in.begin()+pos);
+			}
+			delete proxy;
+			state = 2;
+		}));
+	}
+	
+	~StreamForwarder(){
+		if(state==0){state = 1;}
+		t->join();
+	}
+	
+};
+
+struct PublishedStream{
+	uint16_t udpPort;
+	std::string multicastGroup;
+	std::shared_ptr<StreamForwarder> forwarder;
+};
 
 struct StreamProxyClientPrivate{
 	
@@ -25,10 +126,44 @@ struct StreamProxyClientPrivate{
 	
 	std::shared_ptr<X509Cert> publicCert;
 	
-	StreamProxyClientPrivate(uint32_t connectTimeout, uint32_t pingTimeout):connectTimeout(connectTimeout),pingTimeout(pingTimeout),c(SSLContext::CLIENT),tcp2proxy(NULL),ssl2proxy(NULL){}
+	std::map<std::string, PublishedStream> publishedStreams;//service + '\n' + stream
+	std::map<std::string, std::shared_ptr<StreamForwarder> > subscribedStreams;//service + '\n' + stream
+	LambdaCallReceiver streamRequestReceiver;
+	
+	StreamProxyClientPrivate(uint32_t connectTimeout, uint32_t pingTimeout):connectTimeout(connectTimeout),pingTimeout(pingTimeout),c(SSLContext::CLIENT),tcp2proxy(NULL),ssl2proxy(NULL),client(NULL){
+		streamRequestReceiver.f = [this](const std::string& procedure, const std::vector<IRPCValue*>& values){
+			static const std::vector<IRPCValue::Type> streamRequestedSignature{IRPCValue::STRING, IRPCValue::STRING, IRPCValue::OBJECT};
+			if(procedure=="OnMCStreamRequested" && hasValidRPCSignature(values, streamRequestedSignature)){
+				std::string key = ((StringValue*)(values[0]))->value+"\n"+((StringValue*)(values[1]))->value;
+				StreamProxyAPI::StreamConnectionSpec spec = createNativeValue<StreamProxyAPI::StreamConnectionSpec>(values[2]);
+				auto it = publishedStreams.find(key);
+				if(it!=publishedStreams.end()){
+					ASocket* s = connectStream(spec);
+					if(s){it->second.forwarder = std::make_shared<StreamForwarder>(s, it->second.udpPort, it->second.multicastGroup);}
+				}
+			}
+			return (IRPCValue*)NULL;
+		};
+	}
 	
 	~StreamProxyClientPrivate(){
-		delete ssl2proxy;
+		publishedStreams.clear();
+		subscribedStreams.clear();
+		delete client;
+	}
+	
+	//! connects to the stream port @ proxy and sends the token, NULL if unsuccessful
+	ASocket* connectStream(const StreamProxyAPI::StreamConnectionSpec& spec){
+		if(spec.port==0 || spec.token.size()!=StreamProxyAPI::streamTokenSize){return NULL;}
+		std::list<IIPAddress*> l = copyAddressList(addressList);
+		for(IIPAddress* a : l){a->setPort(spec.port);}
+		ASocket* s = connectSocketForAddressList(l, connectTimeout);
+		deleteAddressList(l);
+		if(s && !s->send(spec.token.c_str(), spec.token.size())){
+			delete s;
+			s = NULL;
+		}
+		return s;
 	}
 	
 };
@@ -46,12 +181,22 @@ bool StreamProxyClient::connect(const std::list<IIPAddress*>& addressList, std::
 	disconnect();
 	deleteAddressList(p->addressList);
 	p->addressList = copyAddressList(addressList);
-	ASocket* s = connectSocketForAddressList(addressList, p->connectTimeout);
+	IIPAddress* connectedAddress = NULL;
+	ASocket* s = connectSocketForAddressList(addressList, p->connectTimeout, &connectedAddress);
 	if(s){
 		p->tcp2proxy = s;//even if it is null, to abort previous connection
 		p->ssl2proxy = new SSLSocket(&(p->c), s, true);
+		p->ssl2proxy->setPeerName(connectedAddress->getAddressAsString()+":"+std::to_string(connectedAddress->getPort()));//session resumption on reconnect
+		if(!p->ssl2proxy->connect()){
+			delete p->ssl2proxy;
+			p->ssl2proxy = NULL;
+			p->tcp2proxy = NULL;
+			std::cerr << "TLS handshake with proxy server failed." << std::endl;
+			return false;
+		}
 		p->client = new JSONRPC2Client();
-		p->client->useSocket(p->ssl2proxy, p->pingTimeout, p->pingTimeout/3);
+		p->client->useSocket(new ZSocket(p->ssl2proxy), p->pingTimeout, p->pingTimeout/3);//same layers as @ proxy
+		p->client->registerCallReceiver("OnMCStreamRequested", &(p->streamRequestReceiver));
 		if(p->publicCert && !p->ssl2proxy->isPeerCertificateEqual(*(p->publicCert))){
 			disconnect();
 			std::cerr << "Proxy server public certificate / key does not match." << std::endl;
@@ -69,6 +214,8 @@ void StreamProxyClient::disconnect(){
 	p->ssl2proxy = NULL;
 	p->tcp2proxy = NULL;
 	p->service2newTCPCallback.clear();
+	p->subscribedStreams.clear();
+	for(auto& s : p->publishedStreams){s.second.forwarder.reset();}
 }
 
 bool StreamProxyClient::isConnected() const{
@@ -135,6 +282,43 @@ ASocket* StreamProxyClient::connectTCP(const std::string& service){
 	return s;
 }
 
+void StreamProxyClient::publishMCStream(const std::string& service, const std::string& stream, uint16_t udpPort, const std::string& multicastGroup){
+	p->publishedStreams[service+"\n"+stream] = PublishedStream{udpPort, multicastGroup, std::shared_ptr<StreamForwarder>()};
+}
+
+bool StreamProxyClient::subscribeToMCStream(const std::string& service, const std::string& stream, const IPv4Address& target){
+	ASocket* s = NULL;
+	if(p->client){
+		bool running = true;
+		StreamProxyAPI::subscribeToMCStream(p->client, service, stream, new ProcedureCallAdapter([this, &running, &s](IRPCValue* results, uint32_t id){
+			StreamProxyAPI::StreamConnectionSpec spec = createNativeValue<StreamProxyAPI::StreamConnectionSpec>(results);
+			delete results;
+			s = p->connectStream(spec);
+			running = false;
+		}, [&running](int32_t errorCode, const std::string& errorMessage, IRPCValue* errorData, uint32_t id){
+			delete errorData;
+			running = false;
+		}));
+		while(running && p->client->isConnected()){//block for rpc return
+			p->client->update();
+			delay(10);
+		}
+	}
+	if(s){
+		p->subscribedStreams[service+"\n"+stream] = std::make_shared<StreamForwarder>(s, target);
+	}
+	return s!=NULL;
+}
+
+void StreamProxyClient::unsubscribeFromMCStream(const std::string& service, const std::string& stream){
+	p->subscribedStreams.erase(service+"\n"+stream);
+}
+
+bool StreamProxyClient::isSubscribedToMCStream(const std::string& service, const std::string& stream) const{
+	auto it = p->subscribedStreams.find(service+"\n"+stream);
+	return it!=p->subscribedStreams.end() && it->second->state==0;
+}
+
 void StreamProxyClient::getServiceList(const std::function<void(const std::vector<std::string>&)>& OnServiceListResult){
 	//TODO
 }
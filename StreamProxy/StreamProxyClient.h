@@ -10,6 +10,8 @@
 
 class X509Cert;
 class IIPAddress;
+class IPv4Address;
+class ASocket;
 struct StreamProxyClientPrivate;
 
 class StreamProxyClient{
@@ -42,6 +44,19 @@ class StreamProxyClient{
 	//! socket==NULL if unsuccessful, otherwise new connected TCP socket
 	ASocket* connectTCP(const std::string& service);
 	
+	//! offers a UDP stream of a registered service, the datagrams received @ udpPort (multicastGroup is joined if not empty) are sent to the proxy only while there are subscribers
+	//! the proxy requests the stream once for all subscribers
+	void publishMCStream(const std::string& service, const std::string& stream, uint16_t udpPort, const std::string& multicastGroup = "");
+	
+	//! blocking to subscribe to a stream of a service, prior authentication required
+	//! the received datagrams are sent to target (e.g. a multicast group in the local network) until unsubscribeFromMCStream is called or the stream ends, true if successful
+	bool subscribeToMCStream(const std::string& service, const std::string& stream, const IPv4Address& target);
+	
+	void unsubscribeFromMCStream(const std::string& service, const std::string& stream);
+	
+	//! true until unsubscribed or the stream ended
+	bool isSubscribedToMCStream(const std::string& service, const std::string& stream) const;
+	
 	//! retrieves service list available @ proxy, login required
 	void getServiceList(const std::function<void(const std::vector<std::string>&)>& OnServiceListResult);
 	
@@ -0,0 +1,181 @@
+#include <JSONRPC2Server.h>
+#include <JSONRPC2Client.h>
+#include <SimpleSockets.h>
+#include <TCPAcceptor.h>
+#include <timing.h>
+
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <cstdlib>
+#include <cstring>
+
+//! Connection storm against a JSONRPC2Server (all peers reconnect at once, each one answers the protocol negotiation after a simulated WAN delay):
+//! accept in the thread calling accept vs. SO_REUSEPORT sharded accept threads (see TCPAcceptor).
+//! Usage: ./AcceptStormBenchmark [connectionCount] [peerDelay in ms] (default: 400 10)
+
+static const uint16_t port = 48200;
+static const char* hello = "hello";
+static const uint32_t helloSize = 5;
+
+static uint32_t errorCount = 0;
+
+static void check(bool ok, const char* what){
+	if(!ok){
+		std::cerr << "Error: " << what << std::endl;
+		errorCount++;
+	}
+}
+
+//! waits for the hello of the peer
+class HelloHandler : public IMetaProtocolHandler{
+
+	public:
+
+	std::atomic<uint32_t> failed;
+
+	HelloHandler():failed(0){}
+
+	bool tryNegotiate(ICommunicationEndpoint* socket){
+		ASocket* s = (ASocket*)socket;
+		char buf[helloSize];
+		uint32_t received = 0;
+		double t = getSecs();
+		while(received<helloSize && getSecs()-t<2.0){
+			if(s->waitForReceive(100)){
+				uint32_t r = s->recv(buf+received, helloSize-received, false);
+				if(r==0){break;}
+				received += r;
+			}
+		}
+		bool success = received==helloSize && memcmp(buf, hello, helloSize)==0;
+		if(!success){failed++;}
+		return success;
+	}
+
+};
+
+static void checkTCPAcceptor(){
+	std::atomic<uint32_t> accepted(0);
+	{
+		TCPAcceptor acceptor(port, 4, 128, [&accepted](IPv6TCPSocket* s, const IPv6Address& address){
+			accepted++;
+			delete s;
+		});
+		check(acceptor.isGood() && acceptor.getThreadCount()==4, "acceptor must listen with 4 sockets");
+		for(uint32_t i=0; i<64; i++){
+			IPv6TCPSocket s;
+			check(s.connect(IPv6Address("::1", port), 1000), "connect to acceptor");
+		}
+		double t = getSecs();
+		while(accepted<64 && getSecs()-t<2.0){delay(1);}
+		check(accepted==64 && acceptor.getAcceptedCount()==64, "all connections must be accepted");
+	}
+	IPv6TCPSocket s;
+	check(!s.connect(IPv6Address("::1", port), 100), "no more connections after destruction");
+}
+
+//! a peer which does not answer the negotiation must not delay the next connections
+static void checkSilentPeer(){
+	HelloHandler handler;
+	double t;
+	{
+		JSONRPC2Server server(port, 60000, &handler, 128, 1);
+		IPv6TCPSocket silent;
+		check(silent.connect(IPv6Address("::1", port), 1000), "connect silent peer");
+		delay(50);//accepted first
+		IPv6TCPSocket peer;
+		check(peer.connect(IPv6Address("::1", port), 1000) && peer.send(hello, helloSize), "connect peer");
+		t = getSecs();
+		JSONRPC2Client* client = server.accept(1500);
+		t = getSecs()-t;
+		check(client!=NULL && t<0.5, "the negotiation with a silent peer must not block the accept thread");
+		delete client;
+	}
+	std::cout << "Accepted next to a silent peer after " << (1000.0*t) << " ms" << std::endl;
+}
+
+//! connections of the simulated peers, open until the end of the storm
+struct Peers{
+	std::vector<std::unique_ptr<IPv6TCPSocket> > sockets;
+	std::vector<double> connectTimes;
+	std::atomic<uint32_t> failedConnects;
+};
+
+static void runStorm(const char* name, uint32_t acceptThreadCount, int maxPendingConnections, uint32_t connectionCount, uint32_t peerDelay){
+	HelloHandler handler;
+	JSONRPC2Server server(port, 60000, &handler, maxPendingConnections, acceptThreadCount);
+	check(server.isGood(), "server must listen");
+	const uint32_t peerThreadCount = 16;
+	Peers peers;
+	peers.sockets.resize(connectionCount);
+	peers.connectTimes.resize(connectionCount, 0.0);
+	peers.failedConnects = 0;
+	double t = getSecs();
+	std::vector<std::thread> threads;
+	for(uint32_t i=0; i<peerThreadCount; i++){
+		threads.emplace_back([&peers, i, connectionCount, peerDelay](){
+			std::list<std::pair<double, IPv6TCPSocket*> > waiting;//hello is sent peerDelay after the connect
+			auto sendHellos = [&waiting](double t){
+				while(!waiting.empty() && waiting.front().first<=t){
+					waiting.front().second->send(hello, helloSize);
+					waiting.pop_front();
+				}
+			};
+			for(uint32_t j=i; j<connectionCount; j+=peerThreadCount){
+				double start = getSecs();
+				IPv6TCPSocket* s = new IPv6TCPSocket();
+				if(s->connect(IPv6Address("::1", port), 3000)){
+					double t = getSecs();
+					peers.connectTimes[j] = t-start;
+					peers.sockets[j] = std::unique_ptr<IPv6TCPSocket>(s);
+					waiting.emplace_back(t+peerDelay/1000.0, s);
+				}else{
+					peers.failedConnects++;
+					delete s;
+				}
+				sendHellos(getSecs());
+			}
+			while(!waiting.empty()){
+				delay(1);
+				sendHellos(getSecs());
+			}
+		});
+	}
+	std::vector<JSONRPC2Client*> clients;
+	while(clients.size()+peers.failedConnects+handler.failed<connectionCount && getSecs()-t<20.0){//main loop of a server
+		JSONRPC2Client* c = server.accept(0);
+		while(c!=NULL){
+			clients.push_back(c);
+			c = server.accept(0);
+		}
+		delay(1);
+	}
+	t = getSecs()-t;
+	for(std::thread& th : threads){th.join();}
+	double maxConnect = 0.0;
+	for(double c : peers.connectTimes){maxConnect = std::max(maxConnect, c);}
+	std::cout << name << ": " << clients.size() << " of " << connectionCount << " clients after " << (1000.0*t) << " ms, max. connect time: " << (1000.0*maxConnect) << " ms, failed connects: " << peers.failedConnects << ", failed negotiations: " << handler.failed << std::endl;
+	for(JSONRPC2Client* c : clients){delete c;}
+}
+
+int main(int argc, char *argv[]){
+	uint32_t connectionCount = argc>1?atoi(argv[1]):400;
+	uint32_t peerDelay = argc>2?atoi(argv[2]):10;
+	double t = getSecs();
+	checkTCPAcceptor();
+	std::cout << "TCPAcceptor checked in " << (1000.0*(getSecs()-t)) << " ms (including the destruction)" << std::endl;
+	checkSilentPeer();
+	if(errorCount>0){
+		std::cerr << errorCount << " errors" << std::endl;
+		return 1;
+	}
+	std::cout << "Checks passed." << std::endl;
+	runStorm("accept in main thread, backlog 10", 0, 10, connectionCount, peerDelay);
+	runStorm("accept in main thread, backlog 128", 0, 128, connectionCount, peerDelay);
+	runStorm("1 accept thread", 1, 128, connectionCount, peerDelay);
+	runStorm("4 accept threads (SO_REUSEPORT)", 4, 128, connectionCount, peerDelay);
+	return 0;
+}
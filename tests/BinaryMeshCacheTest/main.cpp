@@ -0,0 +1,168 @@
+#include <timing.h>
+
+#include <irrlicht.h>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace irr;
+using namespace core;
+using namespace video;
+using namespace scene;
+
+//! Loads an OBJ file with the binary mesh cache (MESH_BINARY_CACHE_DIRECTORY) enabled, reloads it from the cache and compares the meshes.
+//! Checks that a changed source file (also within the same second) and a truncated cache file are not used and measures the loading times.
+//! Usage: ./BinaryMeshCacheTest [grid size] (default: 400, 400*400 quads)
+
+static const char* cacheDirectory = "binarycache";
+static const char* sourceFile = "large.obj";
+
+static uint32_t errorCount = 0;
+
+static void check(bool ok, const char* what){
+	if(!ok){
+		std::cerr << "Error: " << what << std::endl;
+		errorCount++;
+	}
+}
+
+//! all vertices, indices, bounding boxes and the diffuse colors
+static std::string dumpMesh(IAnimatedMesh* animatedMesh){
+	if(!animatedMesh){return "";}
+	IMesh* mesh = animatedMesh->getMesh(0);
+	std::stringstream ss;
+	char buf[256];
+	ss << "meshbuffers: " << mesh->getMeshBufferCount() << "\n";
+	for(u32 i=0; i<mesh->getMeshBufferCount(); i++){
+		IMeshBuffer* mb = mesh->getMeshBuffer(i);
+		const aabbox3df& box = mb->getBoundingBox();
+		snprintf(buf, sizeof(buf), "box %.9g %.9g %.9g %.9g %.9g %.9g diffuse %08x\n", box.MinEdge.X, box.MinEdge.Y, box.MinEdge.Z, box.MaxEdge.X, box.MaxEdge.Y, box.MaxEdge.Z, mb->getMaterial().DiffuseColor.color);
+		ss << buf;
+		S3DVertex* vertices = (S3DVertex*)mb->getVertices();
+		ss << "vertices: " << mb->getVertexCount() << " indices: " << mb->getIndexCount() << "\n";
+		for(u32 j=0; j<mb->getVertexCount(); j++){
+			const S3DVertex& v = vertices[j];
+			snprintf(buf, sizeof(buf), "%.9g %.9g %.9g | %.9g %.9g %.9g | %.9g %.9g | %08x\n", v.Pos.X, v.Pos.Y, v.Pos.Z, v.Normal.X, v.Normal.Y, v.Normal.Z, v.TCoords.X, v.TCoords.Y, v.Color.color);
+			ss << buf;
+		}
+		for(u32 j=0; j<mb->getIndexCount(); j++){
+			ss << mb->getIndices()[j] << ((j%3==2)?"\n":" ");
+		}
+	}
+	return ss.str();
+}
+
+//! grid of quads with positions, texture coordinates and normals, firstZ: z of the first vertex
+static void writeOBJ(u32 size, u32 firstZ){
+	std::ofstream out(sourceFile);
+	for(u32 y=0; y<=size; y++){
+		for(u32 x=0; x<=size; x++){
+			if(x==0 && y==0){
+				out << "v 0 0 " << firstZ << "\n";
+			}else{
+				out << "v " << x*0.01f << " " << y*0.01f << " " << sinf(x*0.1f)*cosf(y*0.1f) << "\n";
+			}
+			out << "vt " << x/(f32)size << " " << y/(f32)size << "\n";
+			out << "vn 0 0 1\n";
+		}
+	}
+	for(u32 y=0; y<size; y++){
+		for(u32 x=0; x<size; x++){
+			u32 a = y*(size+1)+x+1, b = a+1, c = a+size+2, d = a+size+1;
+			out << "f " << a << "/" << a << "/1 " << b << "/" << b << "/1 " << c << "/" << c << "/1 " << d << "/" << d << "/1\n";
+		}
+	}
+}
+
+static std::vector<std::string> listCacheDirectory(){
+	std::vector<std::string> files;
+	DIR* dir = opendir(cacheDirectory);
+	if(dir){
+		for(dirent* e = readdir(dir); e; e = readdir(dir)){
+			if(strcmp(e->d_name, ".")!=0 && strcmp(e->d_name, "..")!=0){files.push_back(std::string(cacheDirectory)+"/"+e->d_name);}
+		}
+		closedir(dir);
+	}
+	return files;
+}
+
+static void clearCacheDirectory(){
+	for(const std::string& f : listCacheDirectory()){remove(f.c_str());}
+}
+
+static uint64_t getFileSize(const std::string& file){
+	struct stat st;
+	return stat(file.c_str(), &st)==0?st.st_size:0;
+}
+
+//! loads the source file with an empty mesh cache, returns the time in ms
+static double load(ISceneManager* smgr, std::string& dump){
+	smgr->getMeshCache()->clear();
+	double t = getSecs();
+	IAnimatedMesh* mesh = smgr->getMesh(sourceFile);
+	t = getSecs()-t;
+	dump = dumpMesh(mesh);
+	return 1000.0*t;
+}
+
+int main(int argc, char *argv[]){
+	u32 size = argc>1?atoi(argv[1]):400;
+	mkdir(cacheDirectory, 0755);
+	clearCacheDirectory();
+	writeOBJ(size, 0);
+	IrrlichtDevice* device = createDevice(EDT_NULL);
+	device->getLogger()->setLogLevel(ELL_WARNING);
+	ISceneManager* smgr = device->getSceneManager();
+	smgr->getParameters()->setAttribute(MESH_BINARY_CACHE_DIRECTORY, cacheDirectory);
+	//miss: the cache file is created
+	std::string original, cached;
+	double missTime = load(smgr, original);
+	check(!original.empty(), "the source file must be loaded");
+	std::vector<std::string> files = listCacheDirectory();
+	check(files.size()==1 && files[0].find(".irrbmesh")==files[0].size()-9, "exactly one cache file and no temporary file");
+	std::string cacheFile = files.empty()?"":files[0];
+	//hit
+	double hitTime = load(smgr, cached);
+	check(cached==original, "the mesh from the cache must be equal to the loaded one");
+	check(hitTime<missTime, "loading from the cache must be faster");
+	std::cout << (size*size) << " quads: loaded in " << missTime << " ms, from the binary cache in " << hitTime << " ms" << std::endl;
+	//truncated cache file
+	uint64_t cacheSize = getFileSize(cacheFile);
+	check(cacheSize>0 && truncate(cacheFile.c_str(), cacheSize/2)==0, "truncate the cache file");
+	load(smgr, cached);
+	check(cached==original, "a truncated cache file must not be used");
+	check(getFileSize(cacheFile)==cacheSize && listCacheDirectory().size()==1, "the truncated cache file must be replaced");
+	//source changed within the same second without changing its size (small mesh to stay within the second)
+	time_t second = time(NULL);
+	while(time(NULL)==second){delay(1);}
+	writeOBJ(10, 0);
+	load(smgr, original);
+	delay(20);
+	writeOBJ(10, 1);
+	std::string changed;
+	load(smgr, changed);
+	check(time(NULL)==second+1, "the source file must be changed within one second");
+	check(!changed.empty() && changed!=original, "a source file changed within the same second must be loaded again");
+	load(smgr, cached);
+	check(cached==changed, "the cache must be updated after a change");
+	device->drop();
+	clearCacheDirectory();
+	rmdir(cacheDirectory);
+	remove(sourceFile);
+	if(errorCount>0){
+		std::cerr << errorCount << " errors" << std::endl;
+		return 1;
+	}
+	std::cout << "Checks passed." << std::endl;
+	return 0;
+}
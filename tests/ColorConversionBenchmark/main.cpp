@@ -0,0 +1,127 @@
+#include <ColorConversionKernels.h>
+#include <timing.h>
+
+#include <iostream>
+#include <functional>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+
+//! Compares the row conversion kernels of IrrlichtOpenCVGlue with the per pixel conversion (getPixel + std::function like convertImageToMat) for all supported formats.
+//! Usage: ./ColorConversionBenchmark [width] [height] [repetitions] (default: 1920 1080 20)
+
+using namespace irr;
+using namespace video;
+
+static uint32_t errorCount = 0;
+
+static void check(bool ok, const std::string& what){
+	if(!ok){
+		std::cerr << "Error: " << what << std::endl;
+		errorCount++;
+	}
+}
+
+struct Format{
+	ECOLOR_FORMAT format;
+	const char* name;
+	uint32_t bytesPerPixel;
+};
+
+static const Format formats[] = {{ECF_A8R8G8B8, "A8R8G8B8", 4}, {ECF_R8G8B8, "R8G8B8", 3}, {ECF_R5G6B5, "R5G6B5", 2}};
+
+enum Target{GRAY, INVERSE_GRAY, BGR, TARGET_COUNT};
+
+static const char* targetNames[TARGET_COUNT] = {"gray", "inverse gray", "BGR"};
+
+static const uint32_t targetBytesPerPixel[TARGET_COUNT] = {1, 1, 3};
+
+//! same as IImage::getPixel
+static SColor getPixel(ECOLOR_FORMAT format, const uint8_t* p){
+	if(format==ECF_A8R8G8B8){
+		uint32_t c;
+		memcpy(&c, p, 4);
+		return SColor(c);
+	}else if(format==ECF_R8G8B8){
+		return SColor(255, p[0], p[1], p[2]);
+	}else{
+		uint16_t c;
+		memcpy(&c, p, 2);
+		return SColor(R5G6B5toA8R8G8B8(c));
+	}
+}
+
+//! per pixel conversion like convertImageToMat
+static void convertPerPixel(const Format& f, Target target, const uint8_t* src, uint8_t* dst, uint32_t pixelCount){
+	std::function<SColor(const uint8_t*)> get = [&f](const uint8_t* p){return getPixel(f.format, p);};
+	if(target==BGR){
+		std::function<void(SColor, uint8_t*)> convert = [](SColor c, uint8_t* out){out[0] = c.getBlue(); out[1] = c.getGreen(); out[2] = c.getRed();};
+		for(uint32_t i=0; i<pixelCount; i++){convert(get(src+i*f.bytesPerPixel), dst+3*i);}
+	}else{
+		std::function<uint8_t(SColor)> convert = [](SColor c){return (30*c.getRed() + 59*c.getGreen() + 11*c.getBlue())/100;};
+		if(target==INVERSE_GRAY){convert = [](SColor c){return 255-(30*c.getRed() + 59*c.getGreen() + 11*c.getBlue())/100;};}
+		for(uint32_t i=0; i<pixelCount; i++){dst[i] = convert(get(src+i*f.bytesPerPixel));}
+	}
+}
+
+static void convertWithKernel(const Format& f, Target target, const uint8_t* src, uint8_t* dst, uint32_t width, uint32_t height){
+	for(uint32_t y=0; y<height; y++){
+		const uint8_t* s = src+y*width*f.bytesPerPixel;
+		uint8_t* d = dst+y*width*targetBytesPerPixel[target];
+		if(target==BGR){
+			convertRowToBGR(f.format, s, d, width);
+		}else{
+			convertRowToGray(f.format, s, d, width, target==INVERSE_GRAY);
+		}
+	}
+}
+
+static std::vector<uint8_t> createRandomImage(uint32_t size){
+	std::vector<uint8_t> res(size);
+	for(uint8_t& v : res){v = rand()%256;}
+	return res;
+}
+
+//! all widths up to 3 times the largest vector size to cover the scalar tails, unaligned source and destination
+static void checkRowWidths(const Format& f, Target target){
+	std::vector<uint8_t> src = createRandomImage(1+200*f.bytesPerPixel);
+	bool equal = true;
+	for(uint32_t width=0; width<=200 && equal; width++){
+		uint32_t outSize = width*targetBytesPerPixel[target];
+		std::vector<uint8_t> expected(outSize+2, 0xAB), result(outSize+2, 0xAB);
+		convertPerPixel(f, target, src.data()+1, expected.data()+1, width);
+		convertWithKernel(f, target, src.data()+1, result.data()+1, width, 1);
+		equal = expected==result;
+	}
+	check(equal, std::string(f.name) + " to " + targetNames[target] + ": rows of any width must match the per pixel conversion");
+}
+
+int main(int argc, char *argv[]){
+	uint32_t width = argc>1?atoi(argv[1]):1920;
+	uint32_t height = argc>2?atoi(argv[2]):1080;
+	uint32_t repetitions = argc>3?atoi(argv[3]):20;
+	for(const Format& f : formats){
+		check(isColorConversionKernelAvailable(f.format), std::string(f.name) + ": kernel must be available");
+		std::vector<uint8_t> src = createRandomImage(width*height*f.bytesPerPixel);
+		for(uint32_t t=0; t<TARGET_COUNT; t++){
+			Target target = (Target)t;
+			checkRowWidths(f, target);
+			std::vector<uint8_t> expected(width*height*targetBytesPerPixel[target]), result(expected.size());
+			double perPixelTime = getSecs();
+			for(uint32_t i=0; i<repetitions; i++){convertPerPixel(f, target, src.data(), expected.data(), width*height);}
+			perPixelTime = (getSecs()-perPixelTime)/repetitions;
+			double kernelTime = getSecs();
+			for(uint32_t i=0; i<repetitions; i++){convertWithKernel(f, target, src.data(), result.data(), width, height);}
+			kernelTime = (getSecs()-kernelTime)/repetitions;
+			check(expected==result, std::string(f.name) + " to " + targetNames[target] + ": image must match the per pixel conversion");
+			std::cout << f.name << " to " << targetNames[target] << " (" << width << "x" << height << "): per pixel: " << (1000.0*perPixelTime) << " ms, kernel: " << (1000.0*kernelTime) << " ms (" << (perPixelTime/kernelTime) << "x)" << std::endl;
+		}
+	}
+	check(!isColorConversionKernelAvailable(ECF_A1R5G5B5), "A1R5G5B5 has no kernel");
+	if(errorCount>0){
+		std::cerr << errorCount << " errors" << std::endl;
+		return 1;
+	}
+	std::cout << "Checks passed." << std::endl;
+	return 0;
+}
@@ -0,0 +1,119 @@
+#include <Drawer2D.h>
+#include <timing.h>
+
+#include <irrlicht.h>
+
+#include <iostream>
+#include <cstring>
+
+using namespace irr;
+using namespace core;
+using namespace video;
+
+//! Draws a dashboard with 300 gauges (outline, arc, needle and icon) layer by layer with and without the batching mode of Drawer2D.
+//! Usage: ./Drawer2DBenchmark [opengl] (default: null driver, which measures only the cpu side)
+
+static const u32 gaugeCount = 300;
+static const u32 frameCount = 100;
+
+static u32 errorCount = 0;
+
+static void check(bool ok, const char* what){
+	if(!ok){
+		std::cerr << "Error: " << what << std::endl;
+		errorCount++;
+	}
+}
+
+//! meshbuffers which can not be batched must be drawn after the geometry which has been batched before
+static void checkBatchOrder(IrrlichtDevice* device, Drawer2D* drawer){
+	IVideoDriver* driver = device->getVideoDriver();
+	scene::SMeshBuffer triangles, lines;
+	for(u32 i=0; i<3; i++){
+		S3DVertex v(i*10.f, (i%2)*10.f, 0.f, 0.f, 0.f, -1.f, SColor(255,0,0,0), 0.f, 0.f);
+		triangles.Vertices.push_back(v);
+		triangles.Indices.push_back(i);
+		lines.Vertices.push_back(v);
+		lines.Indices.push_back(i);
+	}
+	lines.Indices.push_back(0);
+	lines.setPrimitiveType(scene::EPT_LINES);
+	device->run();
+	driver->beginScene(true, true, SColor(255,240,240,240));
+	drawer->resetStatistics();
+	drawer->beginBatch();
+	drawer->draw2DMeshBuffer(&triangles);
+	check(drawer->getStatistics().drawCalls==0, "triangles must be batched");
+	drawer->draw2DMeshBuffer(&lines);
+	check(drawer->getStatistics().drawCalls==2, "batched triangles must be drawn before the lines");
+	drawer->draw2DMeshBuffer(&triangles, vector2d<f32>(5.f, 5.f));
+	drawer->draw2DMeshBuffer(&lines, vector2d<f32>(5.f, 5.f));
+	check(drawer->getStatistics().drawCalls==4, "batched triangles must be drawn before the lines (transformed)");
+	drawer->endBatch();
+	driver->endScene();
+}
+
+static double runFrames(IrrlichtDevice* device, Drawer2D* drawer, ITexture* icon, bool batching){
+	IVideoDriver* driver = device->getVideoDriver();
+	const u32 columns = 20;
+	array< vector2d<f32> > outline;
+	drawer->resetStatistics();
+	double start = getSecs();
+	for(u32 frame=0; frame<frameCount; frame++){
+		device->run();
+		driver->beginScene(true, true, SColor(255,240,240,240));
+		if(batching){drawer->beginBatch();}
+		for(u32 layer=0; layer<4; layer++){//layer by layer: consecutive draws share the same state
+			for(u32 i=0; i<gaugeCount; i++){
+				f32 x = (i%columns)*70.f+35.f, y = (i/columns)*70.f+35.f;
+				f32 value = 0.5f+0.5f*sinf(0.1f*frame+i);
+				if(layer==0){
+					drawer->drawRectOutline(rect<f32>(x-33.f, y-33.f, x+33.f, y+33.f), SColor(255,0,0,0), 1.f);
+				}else if(layer==1){
+					drawer->setColor(SColor(255,80,80,80));
+					drawer->drawArc(NULL, position2d<s32>(x, y), 30.f, 0.f, 180.f*value, 5.f, 4);
+					drawer->setColor();
+				}else if(layer==2){
+					drawer->drawLine(NULL, vector2d<f32>(x, y), vector2d<f32>(x-25.f*cosf(value*PI), y-25.f*sinf(value*PI)), 2.f);
+				}else{
+					drawer->draw(icon, position2d<f32>(x-8.f, y+8.f), dimension2d<f32>(16.f, 16.f));
+				}
+			}
+		}
+		if(batching){drawer->endBatch();}
+		driver->endScene();
+	}
+	return (getSecs()-start)/frameCount;
+}
+
+int main(int argc, char *argv[]){
+	bool useOpenGL = argc>1 && strcmp(argv[1], "opengl")==0;
+	SIrrlichtCreationParameters param;
+	param.DriverType = useOpenGL?EDT_OPENGL:EDT_NULL;
+	param.WindowSize = dimension2d<u32>(1400, 1050);
+	IrrlichtDevice* device = createDeviceEx(param);
+	
+	Drawer2D* drawer = new Drawer2D(device);
+	ITexture* icon = device->getVideoDriver()->getTexture("../../Irrlicht/media/irrlichtlogo.jpg");
+	
+	checkBatchOrder(device, drawer);
+	
+	std::cout << gaugeCount << " gauges, " << (useOpenGL?"OpenGL":"null driver") << std::endl;
+	for(int batching=0; batching<2; batching++){
+		runFrames(device, drawer, icon, batching);//warm up
+		double t = runFrames(device, drawer, icon, batching);
+		const Drawer2D::Statistics& s = drawer->getStatistics();
+		std::cout << (batching?"with batching:    ":"without batching: ") << (t*1000.0) << " ms/frame, draw calls/frame: " << s.drawCalls/frameCount << ", vertices/frame: " << s.vertexCount/frameCount << ", draw requests/frame: " << s.drawRequests/frameCount << std::endl;
+	}
+	
+	delete drawer;
+	device->closeDevice();
+	device->run();
+	device->drop();
+	if(errorCount>0){
+		std::cerr << errorCount << " errors" << std::endl;
+		return 1;
+	}
+	std::cout << "Checks passed." << std::endl;
+	return 0;
+}
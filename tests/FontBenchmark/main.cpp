@@ -0,0 +1,82 @@
+#include <FlexibleFont.h>
+#include <timing.h>
+
+#include <irrlicht.h>
+
+#include <sstream>
+#include <iostream>
+#include <cstring>
+
+using namespace irr;
+using namespace core;
+using namespace video;
+using namespace gui;
+
+//! Draws a screen with 500 labels (50 of them change every frame) with and without the layout cache of FlexibleFont.
+//! Usage: ./FontBenchmark [opengl] (default: null driver, which measures only the cpu side)
+
+static const u32 labelCount = 500;
+static const u32 dynamicLabelCount = 50;
+static const u32 frameCount = 200;
+
+static double runFrames(IrrlichtDevice* device, FlexibleFont* font, const array<stringw>& labels){
+	IVideoDriver* driver = device->getVideoDriver();
+	const u32 columns = 10;
+	double start = getSecs();
+	for(u32 frame=0; frame<frameCount; frame++){
+		device->run();
+		driver->beginScene(true, true, SColor(255,240,240,240));
+		for(u32 i=0; i<labelCount; i++){
+			rect<s32> r((i%columns)*150, (i/columns)*20, (i%columns)*150+150, (i/columns)*20+20);
+			if(i<dynamicLabelCount){
+				stringw dynamicLabel(labels[i]);
+				dynamicLabel.append(L": ").append(stringw(frame*labelCount+i));
+				font->draw(dynamicLabel, r, SColor(255,0,0,0), true, true, &r);
+			}else{
+				font->draw(labels[i], r, SColor(255,0,0,0), true, true, &r);
+			}
+		}
+		driver->endScene();
+	}
+	return (getSecs()-start)/frameCount;
+}
+
+int main(int argc, char *argv[]){
+	bool useOpenGL = argc>1 && strcmp(argv[1], "opengl")==0;
+	SIrrlichtCreationParameters param;
+	param.DriverType = useOpenGL?EDT_OPENGL:EDT_NULL;
+	param.WindowSize = dimension2d<u32>(1500, 1000);
+	IrrlichtDevice* device = createDeviceEx(param);
+	
+	FlexibleFontManager* fmgr = new FlexibleFontManager(device);
+	BMFontLoader* bmFontLoader = new BMFontLoader(fmgr);
+	fmgr->addFontLoader(bmFontLoader);
+	bmFontLoader->drop();
+	FlexibleFont* font = fmgr->getFont("../FontTest/roboto-medium.fnt");
+	font->setDefaultScale(vector2df(0.5f, 0.5f));
+	
+	array<stringw> labels;
+	for(u32 i=0; i<labelCount; i++){
+		std::wstringstream ss;
+		ss << L"Label " << i << L"\tValue " << (i*7919)%1000;
+		labels.push_back(ss.str().c_str());
+	}
+	
+	font->setLayoutCacheSize(0);
+	runFrames(device, font, labels);//warm up
+	double uncached = runFrames(device, font, labels);
+	font->setLayoutCacheSize();
+	runFrames(device, font, labels);
+	double cached = runFrames(device, font, labels);
+	
+	std::cout << labelCount << " labels (" << dynamicLabelCount << " changing every frame), " << (useOpenGL?"OpenGL":"null driver") << std::endl;
+	std::cout << "without layout cache: " << (uncached*1000.0) << " ms/frame" << std::endl;
+	std::cout << "with layout cache:    " << (cached*1000.0) << " ms/frame" << std::endl;
+	std::cout << "speedup: " << (uncached/cached) << "x" << std::endl;
+	
+	fmgr->drop();
+	device->closeDevice();
+	device->run();
+	device->drop();
+	return 0;
+}
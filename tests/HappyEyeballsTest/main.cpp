@@ -0,0 +1,174 @@
+#include <SimpleSockets.h>
+#include <timing.h>
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/select.h>
+#include <vector>
+#include <list>
+
+//! Checks the host name resolution with timeout and cache and the parallel connect of connectSocketForAddressList using loopback addresses.
+//! A "black hole" is a listening socket whose backlog is full, further SYNs are dropped without answer.
+
+static uint32_t errorCount = 0;
+
+static void check(bool ok, const char* what){
+	if(!ok){
+		std::cerr << "Error: " << what << std::endl;
+		errorCount++;
+	}
+}
+
+static const uint16_t goodPort = 47311;
+static const uint16_t blackHolePort = 47312;
+static const uint16_t closedPort = 47313;
+static const uint16_t good6Port = 47314;//the IPv6 socket also receives IPv4
+static const uint16_t highHandlePort = 47315;
+
+static uint32_t getThreadCount(){
+	std::ifstream status("/proc/self/status");
+	std::string line;
+	while(std::getline(status, line)){
+		if(line.compare(0, 8, "Threads:")==0){return atoi(line.c_str()+8);}
+	}
+	return 0;
+}
+
+//! many concurrent queries must not start a thread each
+static void checkConcurrentQueries(){
+	setHostNameCacheTTL(0);
+	uint32_t threadCount = getThreadCount();
+	std::vector<HostNameQuery*> queries;
+	for(uint32_t i=0; i<100; i++){
+		queries.push_back(new HostNameQuery("localhost"));//the same host name shares the resolution
+		queries.push_back(new HostNameQuery("host"+std::to_string(i)+".invalid"));
+	}
+	uint32_t maxThreadCount = getThreadCount();
+	bool allDone = true, sameResult = true;
+	for(HostNameQuery* query : queries){
+		allDone = query->wait(5000) && allDone;
+	}
+	std::list<IIPAddress*> first = queries[0]->createAddressList(0);
+	for(uint32_t i=0; i<queries.size(); i+=2){
+		std::list<IIPAddress*> l = queries[i]->createAddressList(0);
+		sameResult = sameResult && l.size()==first.size() && !l.empty();
+		deleteAddressList(l);
+	}
+	deleteAddressList(first);
+	for(HostNameQuery* query : queries){delete query;}
+	std::cout << "200 concurrent queries: " << (maxThreadCount-threadCount) << " resolver threads" << std::endl;
+	check(maxThreadCount<=threadCount+HostNameQuery::maxResolverThreads, "the number of resolver threads must be limited");
+	check(allDone && sameResult, "all queued queries must finish");
+	setHostNameCacheTTL(60000);
+}
+
+static void checkResolution(){
+	clearHostNameCache();
+	double t = getSecs();
+	std::list<IIPAddress*> l = queryIPAddressesForHostName("localhost", 80, 2000);
+	double firstTime = getSecs()-t;
+	check(!l.empty(), "localhost must be resolved");
+	for(IIPAddress* a : l){
+		check(a->getPort()==80, "port must be filled");
+	}
+	t = getSecs();
+	std::list<IIPAddress*> cached = queryIPAddressesForHostName("localhost", 81, 2000);
+	double cachedTime = getSecs()-t;
+	check(cached.size()==l.size() && !cached.empty() && cached.front()->getPort()==81, "cached result");
+	std::cout << "Resolution of localhost: " << (1000.0*firstTime) << " ms, cached: " << (1000.0*cachedTime) << " ms" << std::endl;
+	deleteAddressList(l);
+	deleteAddressList(cached);
+	{
+		HostNameQuery query("localhost");
+		check(query.wait(2000) && query.isDone(), "query must finish");
+		l = query.createAddressList(82);
+		check(!l.empty() && l.front()->getPort()==82, "query result");
+		deleteAddressList(l);
+	}
+	setHostNameCacheTTL(0);
+	{
+		HostNameQuery query("localhost");//deleted while possibly still running
+	}
+	l = queryIPAddressesForHostName("host.invalid", 0, 2000);
+	check(l.empty(), "invalid host name");
+	setHostNameCacheTTL(60000);
+}
+
+//! connects to addressList and checks the result
+static void checkConnect(const std::list<IIPAddress*>& addressList, uint32_t timeout, IIPAddress* expected, double minTime, double maxTime, const char* what){
+	IIPAddress* connected = NULL;
+	double t = getSecs();
+	ASocket* s = connectSocketForAddressList(addressList, timeout, &connected);
+	t = getSecs()-t;
+	std::cout << what << ": " << (s?"connected":"not connected") << " after " << (1000.0*t) << " ms" << std::endl;
+	check((s!=NULL)==(expected!=NULL) && connected==expected && t>=minTime && t<=maxTime, what);
+	delete s;
+}
+
+//! socket handles above FD_SETSIZE can not be used with select
+static void checkHighSocketHandles(){
+	IPv4TCPSocket listener;
+	check(listener.bind(highHandlePort) && listener.listen(8), "listener for high socket handles");
+	IPv4Address address("127.0.0.1", highHandlePort);
+	std::vector<int> fillers;
+	while(fillers.size()<FD_SETSIZE){
+		int fd = open("/dev/null", O_RDONLY);
+		if(fd<0){break;}
+		fillers.push_back(fd);
+	}
+	IPv4TCPSocket client;
+	check(client.connect(address, 1000) && client.getSocketHandle()>=FD_SETSIZE, "connect with a socket handle above FD_SETSIZE");
+	IPv4TCPSocket* accepted = listener.accept(1000);
+	check(accepted!=NULL, "accept with a socket handle above FD_SETSIZE");
+	if(accepted){
+		check(!accepted->waitForReceive(10), "nothing to receive yet");
+		client.send("x", 1);
+		check(accepted->waitForReceive(1000), "wait for receive with a socket handle above FD_SETSIZE");
+		delete accepted;
+	}
+	checkConnect({&address}, 1000, &address, 0.0, 0.1, "connect to an address list with socket handles above FD_SETSIZE");
+	for(int fd : fillers){close(fd);}
+}
+
+int main(int argc, char *argv[]){
+	checkResolution();
+	checkConcurrentQueries();
+	IPv4TCPSocket good;
+	check(good.bind(goodPort) && good.listen(8), "good listener");
+	IPv6TCPSocket good6;
+	check(good6.bind(good6Port) && good6.listen(8), "good IPv6 listener");
+	IPv4TCPSocket blackHole;
+	check(blackHole.bind(blackHolePort) && blackHole.listen(0), "black hole listener");
+	IPv4Address blackHoleAddress("127.0.0.1", blackHolePort);
+	std::vector<IPv4TCPSocket*> fillers;
+	for(int i=0; i<8; i++){//fills the backlog
+		IPv4TCPSocket* s = new IPv4TCPSocket();
+		if(!s->connect(blackHoleAddress, 200)){
+			delete s;
+			break;
+		}
+		fillers.push_back(s);
+	}
+	IPv4Address goodAddress("127.0.0.1", goodPort);
+	IPv6Address good6Address("::1", good6Port);
+	IPv6Address closed6Address("::1", closedPort);
+	IPv4Address blackHoleAddress2("127.0.0.1", blackHolePort);
+	checkConnect({&blackHoleAddress, &goodAddress}, 3000, &goodAddress, 0.2, 0.6, "black hole, good");
+	checkConnect({&closed6Address, &goodAddress}, 3000, &goodAddress, 0.0, 0.1, "refused, good");
+	checkConnect({&blackHoleAddress, &blackHoleAddress2, &good6Address}, 3000, &good6Address, 0.2, 0.4, "IPv6 is tried second");
+	checkConnect({&blackHoleAddress, &blackHoleAddress2, &blackHoleAddress}, 1000, NULL, 0.95, 1.3, "only black holes");
+	checkConnect({&closed6Address}, 1000, NULL, 0.0, 0.1, "only refused");
+	for(IPv4TCPSocket* s : fillers){delete s;}
+	checkHighSocketHandles();
+	if(errorCount>0){
+		std::cerr << errorCount << " errors" << std::endl;
+		return 1;
+	}
+	std::cout << "Checks passed." << std::endl;
+	return 0;
+}
@@ -0,0 +1,84 @@
+#include <SimpleSockets.h>
+#include <timing.h>
+
+#include <iostream>
+#include <cstdlib>
+
+//! Checks the IPInterfaceMonitor and the automatic multicast group joining of IPv4UDPSocket.
+//! Adding and removing a loopback address requires the ip tool and root, these checks are skipped otherwise.
+//! Usage: ./InterfaceMonitorTest [recvCount] (default: 1000000)
+
+static uint32_t errorCount = 0;
+
+static void check(bool ok, const char* what){
+	if(!ok){
+		std::cerr << "Error: " << what << std::endl;
+		errorCount++;
+	}
+}
+
+static const char* testAddress = "127.0.0.77";
+
+static bool containsAddress(const std::list<IPInterface>& interfaces, const std::string& address){
+	for(const IPInterface& iface : interfaces){
+		if(iface.address && iface.address->getAddressAsString()==address){return true;}
+	}
+	return false;
+}
+
+//! runs the command and waits for the resulting change, returns false if the command failed
+static bool changeAndWait(const std::string& command, bool expectContained, IPv4UDPSocket& s, const IPv4Address*& lastJoinedAddress){
+	uint64_t generation = IPInterfaceMonitor::getGeneration();
+	if(system((command+" 2>/dev/null").c_str())!=0){return false;}
+	double t = getSecs();
+	uint64_t newGeneration = IPInterfaceMonitor::waitForChange(generation, 5000);
+	t = getSecs()-t;
+	std::cout << command << ": change signaled after " << (1000.0*t) << " ms" << std::endl;
+	check(newGeneration!=generation, "change must be signaled");
+	check(containsAddress(IPInterfaceMonitor::getInterfaces(), testAddress)==expectContained, "snapshot must be updated");
+	lastJoinedAddress = NULL;
+	char buf[16];
+	s.recv(buf, sizeof(buf));
+	if(expectContained){
+		check(lastJoinedAddress!=NULL, "multicast group must be joined on the new address at the next recv");
+	}
+	return true;
+}
+
+int main(int argc, char *argv[]){
+	uint32_t recvCount = argc>1?atoi(argv[1]):1000000;
+	IPInterfaceMonitor::start();
+	uint64_t generation = IPInterfaceMonitor::getGeneration();
+	check(generation>0, "started monitor must have a generation");
+	check(containsAddress(IPInterfaceMonitor::getInterfaces(), "127.0.0.1"), "loopback must be in the snapshot");
+	std::cout << "Event driven: " << IPInterfaceMonitor::isEventDriven() << std::endl;
+	check(IPInterfaceMonitor::waitForChange(generation, 300)==generation, "no change without interface changes");
+	IPv4UDPSocket s;
+	check(s.bind(47320), "bind");
+	IPv4Address joined;
+	const IPv4Address* lastJoinedAddress = NULL;
+	s.enableAutoMulticastGroupJoining(IPv4Address("239.1.2.3", 0), [&](const IPv4Address& multicastAddress, const IPv4Address& localInterfaceAddress, bool success){
+		if(localInterfaceAddress.getAddressAsString()==testAddress){
+			joined = localInterfaceAddress;
+			lastJoinedAddress = &joined;
+		}
+	});
+	char buf[16];
+	double t = getSecs();
+	for(uint32_t i=0; i<recvCount; i++){
+		s.recv(buf, sizeof(buf));
+	}
+	t = getSecs()-t;
+	std::cout << "recv without data: " << (1000000000.0*t/recvCount) << " ns per call" << std::endl;
+	if(IPInterfaceMonitor::isEventDriven() && changeAndWait(std::string("ip addr add ")+testAddress+"/8 dev lo", true, s, lastJoinedAddress)){
+		changeAndWait(std::string("ip addr del ")+testAddress+"/8 dev lo", false, s, lastJoinedAddress);
+	}else{
+		std::cout << "Interface change checks skipped." << std::endl;
+	}
+	if(errorCount>0){
+		std::cerr << errorCount << " errors" << std::endl;
+		return 1;
+	}
+	std::cout << "Checks passed." << std::endl;
+	return 0;
+}
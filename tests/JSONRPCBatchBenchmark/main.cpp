@@ -0,0 +1,113 @@
+#include <RequestBasedJSONRPC2ServerHelpers.h>
+#include <JSONRPC2Client.h>
+#include <Threading.h>
+#include <timing.h>
+
+#include <iostream>
+#include <vector>
+#include <atomic>
+#include <cstdlib>
+
+//! Measures processJSONRPC2Request for batches of slow calls with different degrees of parallelism and checks the order of the responses and the streaming response writer.
+//! Usage: ./JSONRPCBatchBenchmark [callsPerBatch] [callDuration in ms] (default: 32 5)
+//! NO_CURL=1 make builds without curl.
+
+static uint32_t errorCount = 0;
+
+static void check(bool ok, const char* what){
+	if(!ok){
+		std::cerr << "Error: " << what << std::endl;
+		errorCount++;
+	}
+}
+
+//! "work" waits (e.g. for a database) and returns the sum, "data" returns a large string, counts the max amount of concurrent calls
+class TestProcedureHandler : public IRemoteProcedureCallReceiver{
+
+	public:
+	
+	const std::unordered_map<std::string, IRemoteProcedureCallReceiver*> registrations;
+	uint32_t callDuration;
+	std::atomic<uint32_t> concurrentCalls;
+	std::atomic<uint32_t> maxConcurrentCalls;
+
+	TestProcedureHandler(uint32_t callDuration):registrations{{"work",this}, {"data",this}},callDuration(callDuration),concurrentCalls(0),maxConcurrentCalls(0){
+	}
+
+	IRPCValue* callProcedure(const std::string& procedure, const std::vector<IRPCValue*>& values){
+		uint32_t c = ++concurrentCalls;
+		uint32_t m = maxConcurrentCalls;
+		while(c>m && !maxConcurrentCalls.compare_exchange_weak(m, c)){}
+		IRPCValue* res = NULL;
+		if(procedure.compare("work")==0){
+			delay(callDuration);
+			res = createRPCValue(createNativeValue<int>(values[0])+createNativeValue<int>(values[1]));
+		}else if(procedure.compare("data")==0){
+			res = new StringValue(std::string(createNativeValue<int>(values[0]), 'x'));
+		}
+		concurrentCalls--;
+		return res;
+	}
+
+};
+
+//! batch array with callCount calls and a notification in between
+static std::string createBatch(const char* method, uint32_t callCount, int param){
+	std::string res = "[";
+	for(uint32_t i=0; i<callCount; i++){
+		if(i>0){res += ",";}
+		uint32_t id = i;
+		res += makeJSONRPCRequest(method, {new IntegerValue(param), new IntegerValue(i)}, &id, true);
+		if(i==callCount/2){res += ","+makeJSONRPCRequest(method, {new IntegerValue(param), new IntegerValue(i)}, NULL, true);}
+	}
+	return res+"]";
+}
+
+int main(int argc, char *argv[]){
+	uint32_t callCount = argc>1?atoi(argv[1]):32;
+	uint32_t callDuration = argc>2?atoi(argv[2]):5;
+	TestProcedureHandler handler(callDuration);
+	std::string batch = createBatch("work", callCount, 1000);
+	std::string expected = processJSONRPC2Request(batch, handler.registrations, true);
+	std::string expectedStart = convertRPCValueToJSONResult(IntegerValue(1000), 0, true);
+	check(expected.compare(0, expectedStart.size(), expectedStart)==0, "first response");
+	ThreadPool pool;
+	for(uint32_t parallelCalls : {1, 4, 8, 16}){
+		for(ThreadPool* p : {(ThreadPool*)NULL, &pool}){
+			handler.maxConcurrentCalls = 0;
+			uint32_t repetitions = 5;
+			double t = getSecs();
+			for(uint32_t i=0; i<repetitions; i++){
+				std::string response = processJSONRPC2Request(batch, handler.registrations, true, p, parallelCalls);
+				check(response==expected, "responses must be in order");
+			}
+			t = (getSecs()-t)/repetitions;
+			std::cout << callCount << " calls of " << callDuration << " ms, max " << parallelCalls << " parallel calls" << (p?" (thread pool)":"") << ": " << (1000.0*t) << " ms per batch, max concurrent calls: " << handler.maxConcurrentCalls << std::endl;
+			check(handler.maxConcurrentCalls<=parallelCalls, "parallelism must be limited");
+		}
+	}
+	std::string dataBatch = createBatch("data", 64, 1000000);
+	for(uint32_t parallelCalls : {1, 4}){
+		uint32_t pieceCount = 0;
+		size_t maxPieceSize = 0, totalSize = 0;
+		bool success = processJSONRPC2Request(dataBatch, handler.registrations, [&](const char* data, uint32_t size){
+			pieceCount++;
+			maxPieceSize = std::max(maxPieceSize, (size_t)size);
+			totalSize += size;
+			return true;
+		}, true, NULL, parallelCalls);
+		std::cout << "streaming writer, max " << parallelCalls << " parallel calls: " << pieceCount << " pieces, largest: " << (maxPieceSize/1000) << " kB, total: " << (totalSize/1000) << " kB" << std::endl;
+		check(success && pieceCount==64 && maxPieceSize<1100000, "streaming writer");
+		pieceCount = 0;
+		success = processJSONRPC2Request(dataBatch, handler.registrations, [&](const char* data, uint32_t size){
+			return ++pieceCount<3;
+		}, true, NULL, parallelCalls);
+		check(!success && pieceCount==3, "aborted by writer");
+	}
+	if(errorCount>0){
+		std::cerr << errorCount << " errors" << std::endl;
+		return 1;
+	}
+	std::cout << "Checks passed." << std::endl;
+	return 0;
+}
@@ -0,0 +1,235 @@
+#include "httplib.h"
+
+#include <RequestBasedJSONRPC2Client.h>
+#include <RequestBasedJSONRPC2ServerHelpers.h>
+#include <timing.h>
+
+#include <iostream>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <cstdlib>
+
+//! Compares the classic and the pipelining mode of RequestBasedJSONRPC2Client with HTTPRequestSender against an httplib server (same setup as JSONRPCTestHttpServer) on loopback.
+//! The server delays each HTTP request to simulate backend latency, "sleep" simulates a slow call.
+//! Usage: ./JSONRPCPipeliningBenchmark [callCount] [serverDelay in ms] (default: 2000 2)
+//! NO_CURL=1 make builds without curl.
+
+static const uint16_t port = 34635;
+static const char* url = "http://127.0.0.1:34635/rpc";
+
+static uint32_t errorCount = 0;
+
+static void check(bool ok, const char* what){
+	if(!ok){
+		std::cerr << "Error: " << what << std::endl;
+		errorCount++;
+	}
+}
+
+class TestProcedureHandler : public IRemoteProcedureCallReceiver{
+
+	public:
+	
+	const std::unordered_map<std::string, IRemoteProcedureCallReceiver*> registrations;
+
+	TestProcedureHandler():registrations{{"moveXY",this}, {"sleep",this}}{
+	}
+
+	IRPCValue* callProcedure(const std::string& procedure, const std::vector<IRPCValue*>& values){
+		if(procedure.compare("moveXY")==0){
+			return createRPCValue(createNativeValue<int>(values[0])+createNativeValue<int>(values[1]));
+		}else if(procedure.compare("sleep")==0){
+			delay(createNativeValue<int>(values[0]));
+			return createRPCValue(true);
+		}
+		return NULL;
+	}
+
+};
+
+class TestCaller : public IRemoteProcedureCaller{
+
+	public:
+	
+	struct Call{
+		double startTime;
+		double endTime;
+		int expected;
+		bool success;
+		int32_t errorCode;
+	};
+	
+	std::map<uint32_t, Call> calls;
+	uint32_t completed = 0;
+	
+	void add(uint32_t id, int expected){
+		calls[id] = Call{getSecs(), 0.0, expected, false, 0};
+	}
+	
+	void OnProcedureResult(IRPCValue* results, uint32_t id){
+		Call& c = calls[id];
+		c.endTime = getSecs();
+		c.success = results->getType()==IRPCValue::INTEGER?(((IntegerValue*)results)->value==c.expected):(results->getType()==IRPCValue::BOOLEAN);
+		completed++;
+		delete results;
+	}
+	
+	void OnProcedureError(int32_t errorCode, const std::string& errorMessage, IRPCValue* errorData, uint32_t id){
+		Call& c = calls[id];
+		c.endTime = getSecs();
+		c.errorCode = errorCode;
+		completed++;
+		delete errorData;
+	}
+	
+	bool waitForAll(IRPC& client, double timeout){
+		double t = getSecs();
+		while(completed<calls.size() && getSecs()-t<timeout){
+			client.update();
+			delay(1);
+		}
+		return completed==calls.size();
+	}
+	
+	//! average and 99th percentile latency in ms
+	void printLatency(const char* name){
+		std::vector<double> latencies;
+		for(auto& c : calls){latencies.push_back(1000.0*(c.second.endTime-c.second.startTime));}
+		std::sort(latencies.begin(), latencies.end());
+		double sum = 0.0;
+		for(double l : latencies){sum += l;}
+		std::cout << name << ": latency avg: " << (sum/latencies.size()) << " ms, p99: " << latencies[latencies.size()*99/100] << " ms";
+	}
+	
+};
+
+static bool callMoveXY(IRPC& client, TestCaller& caller, uint32_t id){
+	bool res = client.callRemoteProcedure("moveXY", std::vector<IRPCValue*>{new IntegerValue(id), new IntegerValue(7)}, &caller, id);
+	if(res){caller.add(id, id+7);}
+	return res;
+}
+
+static bool allSuccessful(const TestCaller& caller){
+	for(auto& c : caller.calls){
+		if(!c.second.success){return false;}
+	}
+	return true;
+}
+
+//! issues calls in bursts of 16 every ms until callCount calls are done
+static void benchmarkThroughput(IRPC& client, const char* name, uint32_t callCount){
+	TestCaller caller;
+	double t = getSecs();
+	uint32_t id = 0;
+	while(id<callCount){
+		for(uint32_t i=0; i<16 && id<callCount; i++){
+			if(callMoveXY(client, caller, id)){id++;}
+		}
+		client.update();
+		delay(1);
+	}
+	check(caller.waitForAll(client, 30.0), "throughput: all calls must complete");
+	t = getSecs()-t;
+	check(allSuccessful(caller), "throughput: results");
+	caller.printLatency(name);
+	std::cout << ", " << (callCount/t) << " calls/s" << std::endl;
+}
+
+//! a slow call (200 ms) followed by fast calls every 5 ms
+static void benchmarkHeadOfLineBlocking(IRPC& client, const char* name, double maxAverageLatency){
+	TestCaller slowCaller, caller;
+	client.callRemoteProcedure("sleep", std::vector<IRPCValue*>{new IntegerValue(200)}, &slowCaller, 0);
+	slowCaller.add(0, 0);
+	client.update();
+	delay(5);
+	for(uint32_t i=0; i<30; i++){
+		callMoveXY(client, caller, i);
+		client.update();
+		delay(5);
+	}
+	check(caller.waitForAll(client, 10.0) && slowCaller.waitForAll(client, 10.0), "head of line: all calls must complete");
+	check(allSuccessful(caller) && allSuccessful(slowCaller), "head of line: results");
+	caller.printLatency(name);
+	std::cout << " (fast calls behind a 200 ms call)" << std::endl;
+	double sum = 0.0;
+	for(auto& c : caller.calls){sum += 1000.0*(c.second.endTime-c.second.startTime);}
+	check(sum/caller.calls.size()<maxAverageLatency, "head of line: latency");
+}
+
+int main(int argc, char *argv[]){
+	uint32_t callCount = argc>1?atoi(argv[1]):2000;
+	uint32_t serverDelay = argc>2?atoi(argv[2]):2;
+	
+	TestProcedureHandler procHandler;
+	httplib::Server svr;
+	svr.set_keep_alive_max_count(100000);
+	svr.Post("/rpc", [&procHandler, serverDelay](const httplib::Request& req, httplib::Response& res){
+		delay(serverDelay);
+		res.set_content(processJSONRPC2Request(req.body, procHandler.registrations, true), "application/json");
+	});
+	std::thread svrThread([&svr](){svr.listen("127.0.0.1", port);});
+	while(!svr.is_running()){delay(1);}
+	
+	{
+		HTTPRequestSender sender(url);
+		RequestBasedJSONRPC2Client client(&sender, 0);
+		benchmarkThroughput(client, "classic", callCount);
+		benchmarkHeadOfLineBlocking(client, "classic", 1000.0);
+		std::cout << "classic: " << sender.getConnectionCount() << " connection(s)" << std::endl;
+	}
+	{
+		std::vector<HTTPRequestSender*> senders;
+		RequestBasedJSONRPC2Client::PipeliningParams params;
+		RequestBasedJSONRPC2Client client([&senders](){senders.push_back(new HTTPRequestSender(url)); return senders.back();}, 0, params);
+		benchmarkThroughput(client, "pipelining", callCount);
+		benchmarkHeadOfLineBlocking(client, "pipelining", 50.0);
+		uint32_t connectionCount = 0;
+		for(HTTPRequestSender* s : senders){connectionCount += s->getConnectionCount();}
+		std::cout << "pipelining: " << connectionCount << " connection(s) for " << senders.size() << " senders" << std::endl;
+		check(connectionCount==senders.size(), "connections must be kept alive");
+	}
+	{
+		RequestBasedJSONRPC2Client::PipeliningParams params;
+		params.deadline = 100;
+		RequestBasedJSONRPC2Client client([](){return new HTTPRequestSender(url);}, 0, params);
+		TestCaller caller;
+		client.callRemoteProcedure("sleep", std::vector<IRPCValue*>{new IntegerValue(400)}, &caller, 0);
+		caller.add(0, 0);
+		check(caller.waitForAll(client, 5.0), "deadline: error expected");
+		double latency = 1000.0*(caller.calls[0].endTime-caller.calls[0].startTime);
+		std::cout << "deadline 100 ms: error " << caller.calls[0].errorCode << " after " << latency << " ms" << std::endl;
+		check(caller.calls[0].errorCode==-32000 && latency<200.0, "deadline: error code and time");
+		TestCaller other;
+		callMoveXY(client, other, 1);
+		check(other.waitForAll(client, 5.0) && allSuccessful(other), "deadline: following calls must succeed");
+		delay(400);
+		client.update();
+		check(caller.completed==1 && client.getPendingCallCount()==0, "deadline: late response must be dropped");
+	}
+	{
+		RequestBasedJSONRPC2Client::PipeliningParams params;
+		params.maxPendingCalls = 8;
+		params.connectionCount = 2;
+		RequestBasedJSONRPC2Client client([](){return new HTTPRequestSender(url);}, 0, params);
+		TestCaller caller;
+		uint32_t accepted = 0;
+		for(uint32_t i=0; i<20; i++){
+			if(callMoveXY(client, caller, i)){accepted++;}
+		}
+		std::cout << "backpressure: " << accepted << " of 20 calls accepted with maxPendingCalls 8" << std::endl;
+		check(accepted==8, "backpressure");
+		check(caller.waitForAll(client, 5.0) && allSuccessful(caller), "backpressure: accepted calls must succeed");
+		check(callMoveXY(client, caller, 100), "backpressure: calls must be accepted again");
+		check(caller.waitForAll(client, 5.0), "backpressure: last call");
+	}
+	
+	svr.stop();
+	svrThread.join();
+	if(errorCount>0){
+		std::cerr << errorCount << " errors" << std::endl;
+		return 1;
+	}
+	std::cout << "Checks passed." << std::endl;
+	return 0;
+}
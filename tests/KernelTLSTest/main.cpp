@@ -0,0 +1,182 @@
+#include <SSLSocket.h>
+#include <SimpleSockets.h>
+#include <timing.h>
+
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+
+//! Transfers data over loopback through SSLSocket with the user space BIO path and with the kernel TLS path (SSLContext::setKernelTLSEnabled) and compares the throughput.
+//! If the tls kernel module is not available the kTLS path falls back to OpenSSL on the socket.
+//! Checks that recv does not block if a record is incomplete.
+//! Uses the key and certificate of tests/OpenSSLServer.
+//! Usage: ./KernelTLSTest [megabytes] (default: 256)
+
+static uint32_t errorCount = 0;
+
+static void check(bool ok, const char* what){
+	if(!ok){
+		std::cerr << "Error: " << what << std::endl;
+		errorCount++;
+	}
+}
+
+static const uint16_t port = 47340;
+static const uint32_t chunkSize = 16384;
+
+//! forwards to a socket, used to force the BIO path
+class ForwardingEndpoint : public ICommunicationEndpoint{
+	
+	ASocket* s;
+	
+	public:
+	
+	ForwardingEndpoint(ASocket* s):s(s){}
+	
+	~ForwardingEndpoint(){delete s;}
+	
+	int32_t recv(char* buf, uint32_t bufSize){return s->recv(buf, bufSize);}
+	
+	bool send(const char* buf, uint32_t bufSize){return s->send(buf, bufSize);}
+	
+};
+
+//! sends the first bytes of each package, waits and sends the rest (incomplete TLS records at the receiver)
+class SplittingEndpoint : public ForwardingEndpoint{
+	
+	public:
+	
+	bool split;
+	
+	SplittingEndpoint(ASocket* s):ForwardingEndpoint(s),split(false){}
+	
+	bool send(const char* buf, uint32_t bufSize){
+		if(!split || bufSize<=3){return ForwardingEndpoint::send(buf, bufSize);}
+		bool success = ForwardingEndpoint::send(buf, 3);
+		delay(1500);
+		return success && ForwardingEndpoint::send(buf+3, bufSize-3);
+	}
+	
+};
+
+static uint8_t getByte(uint64_t i){
+	return (uint8_t)(i*31+(i>>13));
+}
+
+//! receives byteCount bytes and checks the content, answers with one byte
+static void serverMain(IPv4TCPSocket* server, SSLContext* c, uint64_t byteCount, bool forceBIO, bool* contentOK){
+	IPv4TCPSocket* tcp = server->accept(5000);
+	*contentOK = false;
+	if(!tcp){return;}
+	SSLSocket ssl(c, forceBIO?(ICommunicationEndpoint*)new ForwardingEndpoint(tcp):tcp, true);
+	if(!ssl.accept()){return;}
+	std::vector<char> buf(chunkSize);
+	uint64_t received = 0;
+	bool equal = true;
+	double lastReceived = getSecs();
+	while(received<byteCount && getSecs()-lastReceived<5.0){
+		int32_t n = ssl.recv(buf.data(), buf.size());
+		if(n<0){break;}
+		if(n==0){delay(0); continue;}
+		for(int32_t i=0; i<n; i++){
+			equal = equal && (uint8_t)buf[i]==getByte(received+i);
+		}
+		received += n;
+		lastReceived = getSecs();
+	}
+	*contentOK = equal && received==byteCount;
+	ssl.send("k", 1);
+}
+
+//! returns MB/s
+static double transfer(bool kernelTLS, bool forceBIO, uint64_t byteCount){
+	SSLContext serverContext(SSLContext::SERVER);
+	check(serverContext.usePrivateKeyFromFile("../OpenSSLServer/selfsigned-private.key") && serverContext.useCertificateFromFile("../OpenSSLServer/selfsigned-public.crt"), "key and certificate");
+	serverContext.setKernelTLSEnabled(kernelTLS);
+	SSLContext clientContext(SSLContext::CLIENT);
+	clientContext.setKernelTLSEnabled(kernelTLS);
+	IPv4TCPSocket server;
+	check(server.bind(port, true) && server.listen(1), "listen");
+	bool contentOK = false;
+	std::thread serverThread(serverMain, &server, &serverContext, byteCount, forceBIO, &contentOK);
+	IPv4TCPSocket* tcp = new IPv4TCPSocket();
+	check(tcp->connect(IPv4Address("127.0.0.1", port), 2000), "connect");
+	SSLSocket ssl(&clientContext, forceBIO?(ICommunicationEndpoint*)new ForwardingEndpoint(tcp):tcp, true);
+	check(ssl.connect(), "handshake");
+	std::vector<char> chunk(chunkSize);
+	double t = getSecs();
+	for(uint64_t sent=0; sent<byteCount; sent+=chunkSize){
+		for(uint32_t i=0; i<chunkSize; i++){chunk[i] = (char)getByte(sent+i);}
+		if(!ssl.send(chunk.data(), chunkSize)){
+			check(false, "send");
+			break;
+		}
+	}
+	char answer = 0;
+	double answerTime = getSecs();
+	while(ssl.recv(&answer, 1)==0 && getSecs()-answerTime<10.0){delay(1);}
+	t = getSecs()-t;
+	serverThread.join();
+	check(answer=='k' && contentOK, "transferred content");
+	if(kernelTLS && forceBIO){
+		check(!ssl.isKernelTLSSendActive() && !ssl.isKernelTLSReceiveActive(), "endpoints which are no sockets must use the BIO path");
+	}
+	double rate = byteCount/(1024.0*1024.0*t);
+	std::cout << (kernelTLS?"kTLS enabled":"kTLS disabled") << (forceBIO?" (not a socket)":"") << ": kernel send " << ssl.isKernelTLSSendActive() << " receive " << ssl.isKernelTLSReceiveActive() << ", " << rate << " MB/s" << std::endl;
+	return rate;
+}
+
+static void partialRecordServerMain(IPv4TCPSocket* server, SSLContext* c){
+	IPv4TCPSocket* tcp = server->accept(5000);
+	if(!tcp){return;}
+	SplittingEndpoint* endpoint = new SplittingEndpoint(tcp);
+	SSLSocket ssl(c, endpoint, true);
+	if(!ssl.accept()){return;}
+	endpoint->split = true;
+	ssl.send("x", 1);
+	delay(500);
+}
+
+//! recv must not block if only a part of a record has been received (the socket is blocking, OpenSSL must not read from it unless the kernel decrypts complete records)
+static void checkPartialRecord(){
+	SSLContext serverContext(SSLContext::SERVER);
+	check(serverContext.usePrivateKeyFromFile("../OpenSSLServer/selfsigned-private.key") && serverContext.useCertificateFromFile("../OpenSSLServer/selfsigned-public.crt"), "key and certificate");
+	SSLContext clientContext(SSLContext::CLIENT);
+	clientContext.setKernelTLSEnabled(true);
+	IPv4TCPSocket server;
+	check(server.bind(port, true) && server.listen(1), "listen");
+	std::thread serverThread(partialRecordServerMain, &server, &serverContext);
+	IPv4TCPSocket* tcp = new IPv4TCPSocket();
+	check(tcp->connect(IPv4Address("127.0.0.1", port), 2000), "connect");
+	SSLSocket ssl(&clientContext, tcp, true);
+	check(ssl.connect(), "handshake");
+	char answer = 0;
+	double maxRecvTime = 0.0;
+	double start = getSecs();
+	int32_t n = 0;
+	while(n==0 && getSecs()-start<5.0){
+		double t = getSecs();
+		n = ssl.recv(&answer, 1);
+		maxRecvTime = std::max(maxRecvTime, getSecs()-t);
+		delay(1);
+	}
+	serverThread.join();
+	check(n==1 && answer=='x', "partial record: content");
+	check(maxRecvTime<0.5, "recv must not block after a partial record");
+}
+
+int main(int argc, char *argv[]){
+	uint64_t byteCount = (argc>1?atoi(argv[1]):256)*1024ull*1024ull;
+	transfer(false, false, byteCount);
+	transfer(true, true, byteCount/8);
+	transfer(true, false, byteCount);
+	checkPartialRecord();
+	if(errorCount>0){
+		std::cerr << errorCount << " errors" << std::endl;
+		return 1;
+	}
+	std::cout << "Checks passed." << std::endl;
+	return 0;
+}
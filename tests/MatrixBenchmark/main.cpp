@@ -0,0 +1,197 @@
+#include <Matrix.h>
+#include <timing.h>
+
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <cmath>
+
+//! Microbenchmarks of the fixed size Matrix operations including correctness checks against straightforward reference implementations.
+//! Usage: ./MatrixBenchmark [iterations] (default: 1000000)
+
+static const uint32_t inputCount = 256;//inputs are cycled to prevent constant folding
+
+static volatile double sink = 0.0;
+
+static double rnd(){
+	return (rand()%20001-10000)/1000.0;
+}
+
+template <typename TMatrix>
+static std::vector<TMatrix> createInputs(){
+	std::vector<TMatrix> res(inputCount);
+	for(TMatrix& m : res){
+		for(uint32_t i=0; i<TMatrix::size; i++){m[i] = rnd();}
+	}
+	return res;
+}
+
+//! makes the matrices well conditioned for inversion by increasing the diagonal
+template <typename TMatrix>
+static void makeDiagonallyDominant(std::vector<TMatrix>& v){
+	for(TMatrix& m : v){
+		for(uint32_t i=0; i<TMatrix::rowCount; i++){m.get(i,i) += 100.0;}
+	}
+}
+
+//! all elements are used to prevent the elimination of the calculations
+template <typename TMatrix>
+static double sumElements(const TMatrix& m){
+	double sum = 0.0;
+	for(uint32_t i=0; i<TMatrix::size; i++){sum += m[i];}
+	return sum;
+}
+
+template <typename TFunction>
+static void benchmark(const char* name, uint32_t iterations, const TFunction& f){
+	double sum = 0.0;
+	double t = getSecs();
+	for(uint32_t i=0; i<iterations; i++){
+		sum += f(i%inputCount);
+	}
+	t = getSecs()-t;
+	sink = sink+sum;
+	std::cout << name << ": " << (t*1000000000.0/iterations) << " ns/op" << std::endl;
+}
+
+//! triple loop reference product
+template <typename TMatrixA, typename TMatrixB>
+static Matrix<TMatrixA::rowCount, TMatrixB::columnCount, typename TMatrixA::Scalar> referenceProduct(const TMatrixA& a, const TMatrixB& b){
+	Matrix<TMatrixA::rowCount, TMatrixB::columnCount, typename TMatrixA::Scalar> res;
+	for(uint32_t i=0; i<TMatrixA::rowCount; i++){
+		for(uint32_t j=0; j<TMatrixB::columnCount; j++){
+			typename TMatrixA::Scalar dot = 0;
+			for(uint32_t k=0; k<TMatrixA::columnCount; k++){dot += a.get(i,k)*b.get(k,j);}
+			res.get(i,j) = dot;
+		}
+	}
+	return res;
+}
+
+template <typename TMatrix>
+static bool checkIdentity(const TMatrix& m, typename TMatrix::Scalar eps){
+	return areMatricesEqual(m, Matrix<TMatrix::rowCount, TMatrix::columnCount, typename TMatrix::Scalar>(MatrixInit::IDENTITY), eps);
+}
+
+static uint32_t errorCount = 0;
+
+static void check(bool ok, const char* what){
+	if(!ok){
+		std::cerr << "Error: " << what << std::endl;
+		errorCount++;
+	}
+}
+
+static void runChecks(){
+	Vector3D<double> a{1,2,3}, b{4,5,6}, c{7,8,9};
+	auto expression = a+b-c*2.0;//operands are lvalues and referenced
+	Vector3D<double> r = expression;
+	check(areMatricesEqual(r, Vector3D<double>{-9,-9,-9}), "chained expression");
+	a = a+a;//aliasing is allowed for element wise expressions
+	check(areMatricesEqual(a, Vector3D<double>{2,4,6}), "aliased expression");
+	Matrix2D<double> m{1,2,3,4}, n{1,2,3,4}, o{1,2,3,4};
+	m = createTransposeMatrix(m)+m;//the operands are read at other positions than the one being written
+	check(areMatricesEqual(m, Matrix2D<double>{2,5,5,8}), "aliased transpose expression");
+	n = -createTransposeMatrix(n);
+	check(areMatricesEqual(n, Matrix2D<double>{-1,-3,-2,-4}), "aliased negated transpose");
+	auto transposedO = createTransposeMatrix(o);
+	transposedO = o*2.0;
+	check(areMatricesEqual(o, Matrix2D<double>{2,6,4,8}), "expression assigned to aliased transpose");
+	Matrix3D<double> p{1,2,3,4,5,6,7,8,9};
+	auto upperRight = createSubMatrix(p, 0, 1, 2, 2);
+	upperRight = createSubMatrix(p, 1, 0, 2, 2)-createSubMatrix(p, 0, 0, 2, 2);
+	check(areMatricesEqual(p, Matrix3D<double>{1,3,3,4,3,3,7,8,9}), "aliased sub matrix expression");
+	auto stored = Vector3D<double>{1,1,1}*3.0 - (-b);//temporaries are moved into the expression
+	check(areMatricesEqual(evalMatrix(stored), Vector3D<double>{7,8,9}), "stored expression");
+	Matrix<4,4,int> integral;
+	for(uint32_t i=0; i<16; i++){integral[i] = (i*7)%11 + (i%5==0?5:0);}
+	Matrix<4,4,double> floating = convertMatrix<double>(integral);
+	check(std::abs(calcDeterminant(floating)-calcDeterminant(integral))<1e-9, "LU determinant");
+	auto f4 = createInputs<Matrix4D<float>>();
+	auto v4 = createInputs<Vector4D<float>>();
+	auto d4 = createInputs<Matrix4D<double>>();
+	auto d3 = createInputs<Matrix3D<double>>();
+	auto d6 = createInputs<Matrix<6,6,double>>();
+	auto v6 = createInputs<Vector<6,double>>();
+	makeDiagonallyDominant(d3);
+	makeDiagonallyDominant(d6);
+	for(uint32_t i=0; i<inputCount; i++){
+		uint32_t j = (i+1)%inputCount;
+		check(areMatricesEqual(f4[i]*f4[j], referenceProduct(f4[i], f4[j]), 1e-3f), "4x4 float product");
+		check(areMatricesEqual(f4[i]*v4[j], referenceProduct(f4[i], v4[j]), 1e-3f), "4x4 float matrix vector product");
+		check(areMatricesEqual(d4[i]*d4[j], referenceProduct(d4[i], d4[j]), 1e-9), "4x4 double product");
+		check(areMatricesEqual(d3[i]*d3[j], referenceProduct(d3[i], d3[j]), 1e-9), "3x3 double product");
+		check(checkIdentity(calcInverse(d3[i])*d3[i], 1e-9), "3x3 inverse");
+		check(checkIdentity(calcInverse(d6[i])*d6[i], 1e-9), "6x6 inverse");
+		Vector<6,double> x;
+		check(solveLinearSystem(d6[i], v6[i], x) && areMatricesEqual(d6[i]*x, v6[i], 1e-9), "6x6 LU solve");
+		Matrix<6,6,double> spd = d6[i]*createTransposeMatrix(d6[i]), l;
+		check(calcCholeskyDecomposition(spd, l) && areMatricesEqual(spd*solveWithCholesky<6,1>(l, v6[i]), v6[i], 1e-6), "6x6 Cholesky solve");
+	}
+	Matrix<3,3,double> notPositiveDefinite{1,2,3, 2,1,4, 3,4,1}, l;
+	check(!calcCholeskyDecomposition(notPositiveDefinite, l), "Cholesky of indefinite matrix");
+	Matrix<5,5,double> singular(0.0);
+	check(calcDeterminant(singular)==0.0, "singular determinant");
+}
+
+int main(int argc, char *argv[]){
+	uint32_t iterations = argc>1?atoi(argv[1]):1000000;
+	srand(42);
+	runChecks();
+	if(errorCount>0){
+		std::cerr << errorCount << " errors" << std::endl;
+		return 1;
+	}
+	std::cout << "Checks passed." << std::endl;
+	auto v3 = createInputs<Vector3D<double>>();
+	auto d3 = createInputs<Matrix3D<double>>();
+	auto f4 = createInputs<Matrix4D<float>>();
+	auto v4 = createInputs<Vector4D<float>>();
+	auto d4 = createInputs<Matrix4D<double>>();
+	auto d6 = createInputs<Matrix<6,6,double>>();
+	auto v6 = createInputs<Vector<6,double>>();
+	makeDiagonallyDominant(d3);
+	makeDiagonallyDominant(d6);
+	benchmark("Vector3D<double> a+b-c*s", iterations, [&](uint32_t i){
+		Vector3D<double> r = v3[i]+v3[(i+1)%inputCount]-v3[(i+2)%inputCount]*2.0;
+		return sumElements(r);
+	});
+	benchmark("Matrix3D<double> product", iterations, [&](uint32_t i){
+		Matrix3D<double> r = d3[i]*d3[(i+1)%inputCount];
+		return sumElements(r);
+	});
+	benchmark("Matrix3D<double> * Vector3D<double>", iterations, [&](uint32_t i){
+		Vector3D<double> r = d3[i]*v3[i];
+		return sumElements(r);
+	});
+	benchmark("Matrix4D<float> product", iterations, [&](uint32_t i){
+		Matrix4D<float> r = f4[i]*f4[(i+1)%inputCount];
+		return sumElements(r);
+	});
+	benchmark("Matrix4D<float> * Vector4D<float>", iterations, [&](uint32_t i){
+		Vector4D<float> r = f4[i]*v4[i];
+		return sumElements(r);
+	});
+	benchmark("Matrix4D<double> product", iterations, [&](uint32_t i){
+		Matrix4D<double> r = d4[i]*d4[(i+1)%inputCount];
+		return sumElements(r);
+	});
+	benchmark("Matrix3D<double> inverse", iterations, [&](uint32_t i){
+		Matrix3D<double> r = calcInverse(d3[i]);
+		return sumElements(r);
+	});
+	uint32_t slowIterations = std::max(iterations/100, (uint32_t)1);
+	benchmark("Matrix<6,6,double> inverse", slowIterations, [&](uint32_t i){
+		Matrix<6,6,double> r = calcInverse(d6[i]);
+		return sumElements(r);
+	});
+	benchmark("Matrix<6,6,double> determinant", slowIterations, [&](uint32_t i){
+		return calcDeterminant(d6[i]);
+	});
+	benchmark("Matrix<6,6,double> LU solve", slowIterations, [&](uint32_t i){
+		Vector<6,double> x;
+		solveLinearSystem(d6[i], v6[i], x);
+		return sumElements(x);
+	});
+	return 0;
+}
@@ -0,0 +1,116 @@
+#include <timing.h>
+
+#include <irrlicht.h>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <cstdio>
+#include <cstring>
+
+using namespace irr;
+using namespace core;
+using namespace video;
+using namespace scene;
+
+//! Loads reference.obj (groups, materials, quads, polygons, negative indices, near duplicate vertices, CR/LF line ends) and compares all vertices and indices with reference.txt,
+//! which has been written by the former OBJ loader (parsing with temporary words, deduplication with core::map). Measures the loading time of a large mesh.
+//! Usage: ./OBJLoaderTest [dump] (dump: writes the output of the current loader to reference.txt)
+
+static uint32_t errorCount = 0;
+
+static void check(bool ok, const char* what){
+	if(!ok){
+		std::cerr << "Error: " << what << std::endl;
+		errorCount++;
+	}
+}
+
+static std::string dumpMesh(IMesh* mesh){
+	std::stringstream ss;
+	char buf[256];
+	ss << "meshbuffers: " << mesh->getMeshBufferCount() << "\n";
+	for(u32 i=0; i<mesh->getMeshBufferCount(); i++){
+		IMeshBuffer* mb = mesh->getMeshBuffer(i);
+		S3DVertex* vertices = (S3DVertex*)mb->getVertices();
+		ss << "meshbuffer " << i << " vertices: " << mb->getVertexCount() << " indices: " << mb->getIndexCount() << "\n";
+		for(u32 j=0; j<mb->getVertexCount(); j++){
+			const S3DVertex& v = vertices[j];
+			snprintf(buf, sizeof(buf), "%.9g %.9g %.9g | %.9g %.9g %.9g | %.9g %.9g | %08x\n", v.Pos.X, v.Pos.Y, v.Pos.Z, v.Normal.X, v.Normal.Y, v.Normal.Z, v.TCoords.X, v.TCoords.Y, v.Color.color);
+			ss << buf;
+		}
+		for(u32 j=0; j<mb->getIndexCount(); j++){
+			ss << mb->getIndices()[j] << ((j%3==2)?"\n":" ");
+		}
+	}
+	return ss.str();
+}
+
+static IMesh* loadFromMemory(ISceneManager* smgr, const std::string& obj, const char* name){
+	io::IReadFile* file = smgr->getFileSystem()->createMemoryReadFile(obj.c_str(), obj.size(), name);
+	IAnimatedMesh* mesh = smgr->getMesh(file);
+	file->drop();
+	return mesh?mesh->getMesh(0):NULL;
+}
+
+//! grid of quads with positions, texture coordinates and normals
+static std::string createLargeOBJ(u32 size){
+	std::stringstream ss;
+	for(u32 y=0; y<=size; y++){
+		for(u32 x=0; x<=size; x++){
+			ss << "v " << x*0.01f << " " << y*0.01f << " " << sinf(x*0.1f)*cosf(y*0.1f) << "\n";
+			ss << "vt " << x/(f32)size << " " << y/(f32)size << "\n";
+			ss << "vn 0 0 1\n";
+		}
+	}
+	for(u32 y=0; y<size; y++){
+		for(u32 x=0; x<size; x++){
+			u32 a = y*(size+1)+x+1, b = a+1, c = a+size+2, d = a+size+1;
+			ss << "f " << a << "/" << a << "/1 " << b << "/" << b << "/1 " << c << "/" << c << "/1 " << d << "/" << d << "/1\n";
+		}
+	}
+	return ss.str();
+}
+
+int main(int argc, char *argv[]){
+	bool dump = argc>1 && strcmp(argv[1], "dump")==0;
+	IrrlichtDevice* device = createDevice(EDT_NULL);
+	ISceneManager* smgr = device->getSceneManager();
+	IAnimatedMesh* reference = smgr->getMesh("reference.obj");
+	check(reference!=NULL, "reference.obj must be loaded");
+	if(reference){
+		std::string output = dumpMesh(reference->getMesh(0));
+		if(dump){
+			std::ofstream("reference.txt") << output;
+			std::cout << "reference.txt written." << std::endl;
+		}else{
+			std::ifstream in("reference.txt");
+			std::stringstream expected;
+			expected << in.rdbuf();
+			check(!expected.str().empty(), "reference.txt must exist");
+			check(output==expected.str(), "vertices and indices must be equal to the output of the former loader");
+		}
+	}
+	//vertices which are equal within the rounding tolerance of S3DVertex::operator== are merged (also across the cells of the vertex hash), others are kept apart
+	IMesh* mesh = loadFromMemory(smgr, "v 0 0 0\nv 1 0 0\nv 0 1 0\nv 0.0000001 -0.0000005 0\nv 0.00001 0 0\nf 1 2 3\nf 4 2 3\nf 5 2 3\n", "tolerance.obj");
+	check(mesh && mesh->getMeshBufferCount()==1 && mesh->getMeshBuffer(0)->getVertexCount()==4 && mesh->getMeshBuffer(0)->getIndexCount()==9, "deduplication with tolerance");
+	if(mesh && mesh->getMeshBuffer(0)->getIndexCount()==9){
+		const u16* indices = mesh->getMeshBuffer(0)->getIndices();
+		check(indices[2]==indices[5] && indices[2]!=indices[8], "near duplicate must be merged with the first vertex");
+	}
+	//loading time
+	std::string large = createLargeOBJ(400);
+	double t = getSecs();
+	mesh = loadFromMemory(smgr, large, "large.obj");
+	t = getSecs()-t;
+	check(mesh && mesh->getMeshBuffer(0)->getVertexCount()==401*401 && mesh->getMeshBuffer(0)->getIndexCount()==400*400*6, "large mesh");
+	std::cout << "large mesh (" << (large.size()/(1024*1024)) << " MB, 160000 quads) loaded in " << (1000.0*t) << " ms" << std::endl;
+	device->drop();
+	if(errorCount>0){
+		std::cerr << errorCount << " errors" << std::endl;
+		return 1;
+	}
+	std::cout << "Checks passed." << std::endl;
+	return 0;
+}
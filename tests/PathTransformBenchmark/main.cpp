@@ -0,0 +1,165 @@
+#include <TriangulatedPathTransfrom.h>
+#include <timing.h>
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <cstdlib>
+#include <cmath>
+
+//! Compares the grid/walk based TriangulatedPathTransfrom with the former linear scan for dense calibration meshes and long paths.
+//! Usage: ./PathTransformBenchmark [threadCount] (default: 4)
+
+typedef Vector3D<double> TestVector;
+typedef std::vector<TestVector> TestPath;
+
+static const uint32_t gridSize = 100;//gridSize*gridSize matched points
+static const double gridSpacing = 10.0;
+static const double lineDistance = 2.0;
+static const double minAreaWithNeighbors = 0.0001;
+
+//! the former implementation: linear scan over all triangles for each point
+class LinearScanPathTransform : public TriangulatedPathTransfrom<TestPath, double>{
+
+	public:
+	
+	typedef TriangulatedPathTransfrom<TestPath, double> Super;
+	
+	LinearScanPathTransform(const std::string& representation):Super(representation){}
+	
+	void transformSingle(TestVector& vector, uint32_t& hint){
+		Vector3D<double> v{vector[0], vector[1], 1.0};
+		Vector2D<double> v2d{vector[0], vector[1]};
+		double smallestDist = std::numeric_limits<double>::max();
+		Vector3D<double> closestBary(MatrixInit::IDENTITY);
+		uint32_t closestIndex = 0;
+		for(uint32_t i=0; i<transformations.size(); i++){
+			TriangleTransformation& t = transformations[i];
+			if(t.triangleArea>MIN_TRIANGLE_AREA){
+				Vector3D<double> barycentric = t.toBarycentric * v;
+				if(isInsideTriangle(barycentric)){
+					fillResult(vector, t, barycentric);
+					return;
+				}else{
+					double minDist = getMatrixMin(calcDistancesFromEdges(v2d, t));
+					if(minDist<smallestDist){
+						closestBary = barycentric;
+						closestIndex = i;
+						smallestDist = minDist;
+					}
+				}
+			}
+		}
+		fillResult(vector, transformations[closestIndex], closestBary);
+	}
+	
+	void transformSingle(TestVector& vector){
+		uint32_t hint = 0;
+		transformSingle(vector, hint);
+	}
+	
+};
+
+static double random(double min, double max){
+	return min+(max-min)*rand()/(double)RAND_MAX;
+}
+
+//! jittered grid of matched points with a smooth distortion, two triangles per grid cell
+static std::string createRepresentation(){
+	std::stringstream ss;
+	ss << TriangulatedPathTransfrom<TestPath, double>::id << "," << lineDistance << "," << minAreaWithNeighbors << "," << gridSize*gridSize;
+	for(uint32_t y=0; y<gridSize; y++){
+		for(uint32_t x=0; x<gridSize; x++){
+			double sx = x*gridSpacing+random(-2.0, 2.0), sy = y*gridSpacing+random(-2.0, 2.0);
+			ss << "," << sx << "," << sy << "," << (sx+5.0*sin(sy*0.01)) << "," << (sy+5.0*cos(sx*0.01));
+		}
+	}
+	ss << "," << (gridSize-1)*(gridSize-1)*6;
+	for(uint32_t y=0; y+1<gridSize; y++){
+		for(uint32_t x=0; x+1<gridSize; x++){
+			uint32_t i = y*gridSize+x;
+			ss << "," << i << "," << (i+1) << "," << (i+gridSize) << "," << (i+1) << "," << (i+gridSize+1) << "," << (i+gridSize);
+		}
+	}
+	return ss.str();
+}
+
+//! random walk which also leaves the triangulated area
+static TestPath createPath(uint32_t size){
+	TestPath path(size);
+	double extent = gridSize*gridSpacing;
+	TestVector p{extent*0.5, extent*0.5, 0.0};
+	for(uint32_t i=0; i<size; i++){
+		p[0] = std::max(-0.2*extent, std::min(1.2*extent, p[0]+random(-6.0, 6.0)));
+		p[1] = std::max(-0.2*extent, std::min(1.2*extent, p[1]+random(-6.0, 6.0)));
+		path[i] = p;
+	}
+	return path;
+}
+
+static bool arePathsEqual(const std::vector<TestVector>& a, const std::vector<TestVector>& b){
+	if(a.size()!=b.size()){return false;}
+	for(uint32_t i=0; i<a.size(); i++){
+		if(!areMatricesEqual(a[i], b[i], 0.000001)){return false;}
+	}
+	return true;
+}
+
+int main(int argc, char *argv[]){
+	uint32_t threadCount = argc>1?atoi(argv[1]):4;
+	srand(1);
+	std::string representation = createRepresentation();
+	TriangulatedPathTransfrom<TestPath, double> transform(representation);
+	LinearScanPathTransform reference(representation);
+	std::cout << "matched points: " << gridSize*gridSize << ", triangles: " << (gridSize-1)*(gridSize-1)*2 << std::endl;
+	//single points inside and outside of the triangulation
+	double extent = gridSize*gridSpacing;
+	std::vector<TestVector> points(2000);
+	for(TestVector& p : points){
+		p = TestVector{random(-0.2*extent, 1.2*extent), random(-0.2*extent, 1.2*extent), 0.0};
+	}
+	std::vector<TestVector> results(points), referenceResults(points);
+	double start = getSecs();
+	for(TestVector& p : results){transform.transformSingle(p);}
+	double indexedTime = getSecs()-start;
+	start = getSecs();
+	for(TestVector& p : referenceResults){reference.transformSingle(p);}
+	double linearTime = getSecs()-start;
+	if(!arePathsEqual(results, referenceResults)){
+		std::cout << "Error: transformed points differ from the linear scan." << std::endl;
+		return 1;
+	}
+	std::cout << "random points: " << points.size() << ", linear scan: " << linearTime*1000.0 << " ms, grid/walk: " << indexedTime*1000.0 << " ms (" << linearTime/indexedTime << "x)" << std::endl;
+	//short path with subdivisions compared to the linear scan
+	TestPath path = createPath(200);
+	std::vector<TestVector> out, referenceOut;
+	start = getSecs();
+	transform.transform(path, out);
+	indexedTime = getSecs()-start;
+	start = getSecs();
+	reference.transform(path, referenceOut);
+	linearTime = getSecs()-start;
+	if(!arePathsEqual(out, referenceOut)){
+		std::cout << "Error: transformed path differs from the linear scan." << std::endl;
+		return 1;
+	}
+	std::cout << "path: " << path.size() << " -> " << out.size() << " points, linear scan: " << linearTime*1000.0 << " ms, grid/walk: " << indexedTime*1000.0 << " ms (" << linearTime/indexedTime << "x)" << std::endl;
+	//long path sequentially and in parallel
+	path = createPath(200000);
+	start = getSecs();
+	transform.transform(path, out);
+	double sequentialTime = getSecs()-start;
+	std::vector<TestVector> parallelOut;
+	transform.setThreadCount(threadCount);
+	start = getSecs();
+	transform.transform(path, parallelOut);
+	double parallelTime = getSecs()-start;
+	TestPath compatibleOut = transform.transform(path);
+	if(!arePathsEqual(out, parallelOut) || !arePathsEqual(out, std::vector<TestVector>(compatibleOut.begin(), compatibleOut.end()))){
+		std::cout << "Error: parallel transformation differs from the sequential one." << std::endl;
+		return 1;
+	}
+	std::cout << "path: " << path.size() << " -> " << out.size() << " points, sequential: " << sequentialTime*1000.0 << " ms, " << threadCount << " threads: " << parallelTime*1000.0 << " ms (" << sequentialTime/parallelTime << "x)" << std::endl;
+	std::cout << "Transformation results equal." << std::endl;
+	return 0;
+}
@@ -0,0 +1,128 @@
+#include <Profiler.h>
+#include <Threading.h>
+#include <timing.h>
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <atomic>
+
+static uint32_t errorCount = 0;
+
+static void check(bool ok, const char* what){
+	if(!ok){
+		std::cerr << "Error: " << what << std::endl;
+		errorCount++;
+	}
+}
+
+static void* threadMain(void* data){
+	PROFILE_THREAD_NAME("Worker");
+	for(int i=0; i<100; i++){
+		PROFILE_SCOPE("worker step");
+		delay(1);
+	}
+	return NULL;
+}
+
+static void* shortThreadMain(void* data){
+	PROFILE_SCOPE("short thread");
+	return NULL;
+}
+
+static std::atomic<bool> recording;
+
+//! records as fast as possible while another thread exports
+static void* stressThreadMain(void* data){
+	while(recording){
+		PROFILE_SCOPE("stress");
+	}
+	return NULL;
+}
+
+int main(int argc, char *argv[]){
+
+	setProfileRingBufferSize(64);
+
+	Thread t;
+	check(createThread(t, threadMain, NULL, true), "create worker thread");
+
+	PROFILE_THREAD_NAME("Main");
+	for(int i=0; i<20; i++){
+		PROFILE_SCOPE("main frame");
+		{
+			PROFILE_SCOPE("main sub \"stage\"");
+			delay(2);
+		}
+	}
+
+	check(joinThread(t), "join worker thread");
+
+	std::vector<ProfileStatistics> stats = calcProfileStatistics(60.0);
+	check(stats.size()==3, "statistics for 3 names");
+	for(const ProfileStatistics& s : stats){
+		check(s.p50<=s.p90 && s.p90<=s.p99 && s.p99<=s.max, "percentiles must be ordered");
+		if(s.name=="worker step"){
+			check(s.count==64, "ring buffer size limit");
+			check(s.p50>=1000.0, "worker step duration");
+		}else{
+			check(s.count==20, "main event count");
+			check(s.p50>=2000.0, "main event duration");
+		}
+	}
+	std::cout << printProfileStatistics(60.0) << std::endl;
+
+	std::stringstream ss;
+	writeChromeTrace(ss);
+	std::string trace = ss.str();
+	check(trace.find("{\"traceEvents\":[")==0, "trace header");
+	check(trace.find("\"thread_name\"")!=std::string::npos, "thread names in trace");
+	check(trace.find("main sub \\\"stage\\\"")!=std::string::npos, "escaped names in trace");
+
+	std::ofstream out("trace.json");
+	out << trace;
+	std::cout << "Chrome trace written to trace.json" << std::endl;
+
+	clearProfileData();
+	check(calcProfileStatistics(60.0).empty(), "no events after clear");
+
+	//the buffers of exited threads are reused
+	for(int i=0; i<100; i++){
+		check(createThread(t, shortThreadMain, NULL, true) && joinThread(t), "short thread");
+	}
+	check(getProfileThreadBufferCount()==2, "buffers of exited threads must be reused");
+	stats = calcProfileStatistics(60.0);
+	check(stats.size()==1 && stats[0].count==1, "events of a reused buffer must be discarded");
+
+	//export while recording
+	recording = true;
+	Thread stressThreads[4];
+	for(Thread& st : stressThreads){
+		check(createThread(st, stressThreadMain, NULL, true), "create stress thread");
+	}
+	double start = getSecs();
+	uint32_t exports = 0;
+	while(getSecs()-start<1.0){
+		for(const ProfileStatistics& s : calcProfileStatistics(60.0)){
+			check(s.count<=4*64 && s.max<1000000.0, "consistent events while recording");
+		}
+		exports++;
+	}
+	recording = false;
+	for(Thread& st : stressThreads){
+		check(joinThread(st), "join stress thread");
+	}
+	uint64_t t0 = getProfileTime();
+	const uint32_t eventCount = 1000000;
+	for(uint32_t i=0; i<eventCount; i++){
+		PROFILE_SCOPE("overhead");
+	}
+	std::cout << exports << " exports while recording, " << ((getProfileTime()-t0)/(double)eventCount) << " ns per scope" << std::endl;
+
+	if(errorCount>0){
+		std::cerr << errorCount << " errors" << std::endl;
+		return 1;
+	}
+	std::cout << "Checks passed." << std::endl;
+	return 0;
+}
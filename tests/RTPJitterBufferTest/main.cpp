@@ -0,0 +1,293 @@
+#include <RTPJitterBuffer.h>
+#include <RTPSender.h>
+#include <SimpleSockets.h>
+#include <BitFunctions.h>
+#include <timing.h>
+
+#include <iostream>
+#include <vector>
+#include <map>
+#include <random>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+//! Streams MJPEG like frames with an RTPSender through a simulated network (virtual time) with jitter, reordering, loss and duplicates:
+//! content and order of the released frames, accounting of late / lost / concealed frames, regularity of the playout schedule and receiver reports.
+//! Usage: ./RTPJitterBufferTest [frameCount] [max. network jitter in ms] [loss in %] (default: 3000 40 1)
+
+static const uint32_t clockRate = 90000;
+static const double frameRate = 25.0;
+static const uint32_t maxPacketSize = 1400;
+static const uint16_t udpPort = 48300;
+
+static uint32_t errorCount = 0;
+
+static void check(bool ok, const char* what){
+	if(!ok){
+		std::cerr << "Error: " << what << std::endl;
+		errorCount++;
+	}
+}
+
+//! delivers each packet after a random delay in [0, maxDelay] (reorders packets) unless it is lost
+class SimulatedNetwork : public ICommunicationEndpoint{
+
+	std::mt19937 rng;
+	std::uniform_real_distribution<double> uniform;
+	std::multimap<double, std::vector<char> > inFlight;//delivery time -> packet
+
+	public:
+
+	double now;
+	double maxDelay;
+	double lossRate;
+	double duplicateRate;
+
+	SimulatedNetwork(double maxDelay, double lossRate, double duplicateRate):rng(1234),uniform(0.0, 1.0),now(0.0),maxDelay(maxDelay),lossRate(lossRate),duplicateRate(duplicateRate){}
+
+	bool send(const char* buf, uint32_t bufSize){
+		if(uniform(rng)>=lossRate){
+			inFlight.emplace(now+maxDelay*uniform(rng), std::vector<char>(buf, buf+bufSize));
+			if(uniform(rng)<duplicateRate){
+				inFlight.emplace(now+maxDelay*uniform(rng), std::vector<char>(buf, buf+bufSize));
+			}
+		}
+		return true;
+	}
+
+	int32_t recv(char* buf, uint32_t bufSize){
+		if(inFlight.empty() || inFlight.begin()->first>now){return 0;}
+		std::vector<char>& packet = inFlight.begin()->second;
+		uint32_t size = std::min<uint32_t>(bufSize, packet.size());
+		memcpy(buf, packet.data(), size);
+		inFlight.erase(inFlight.begin());
+		return size;
+	}
+
+};
+
+//! frame with random size and content, the RTPSender header space in front
+static std::vector<uint8_t> createFrame(std::mt19937& rng){
+	std::vector<uint8_t> frame(RTPSender::headerSize+std::uniform_int_distribution<uint32_t>(2000, 40000)(rng));
+	for(uint32_t i=RTPSender::headerSize; i<frame.size(); i++){frame[i] = rng();}
+	return frame;
+}
+
+static double getStandardDeviation(const std::vector<double>& values){
+	double mean = 0.0, variance = 0.0;
+	for(double v : values){mean += v;}
+	mean /= values.size();
+	for(double v : values){variance += (v-mean)*(v-mean);}
+	return sqrt(variance/values.size());
+}
+
+struct RunResult{
+	RTPJitterBuffer::Statistics stats;
+	RTPJitterBuffer::Statistics halfTimeStats;
+	uint32_t sentFrames;
+	uint32_t firstPlayedIndex;//index of the first released frame
+	bool contentOk;
+	bool orderOk;
+};
+
+static RunResult run(const char* name, uint32_t frameCount, double maxNetworkDelay, double lossRate, double duplicateRate){
+	SimulatedNetwork network(maxNetworkDelay, lossRate, duplicateRate);
+	RTPSender sender(&network, 26, 42, maxPacketSize, false);
+	RTPJitterBuffer buffer(&network, false);
+	std::mt19937 rng(5678);
+	const uint32_t firstTimestamp = 0xFFFFFFFF-10*clockRate/frameRate;//wraps around after 10 frames
+	std::map<uint32_t, std::pair<uint32_t, std::vector<uint8_t> > > sent;//timestamp -> index, payload
+	RunResult res;
+	res.sentFrames = frameCount;
+	res.firstPlayedIndex = frameCount;
+	res.contentOk = res.orderOk = true;
+	std::vector<double> scheduleOffsets;//release time - timestamp time
+	bool anyPlayed = false;
+	uint32_t lastIndex = 0;
+	const double step = 0.001;
+	const double endTime = frameCount/frameRate+1.0;
+	uint32_t nextFrame = 0;
+	for(uint32_t s=0; s*step<endTime; s++){
+		network.now = s*step;
+		if(nextFrame<frameCount && network.now>=nextFrame/frameRate){
+			uint32_t timestamp = firstTimestamp+nextFrame*(uint32_t)(clockRate/frameRate);
+			std::vector<uint8_t> frame = createFrame(rng);
+			sent[timestamp] = std::make_pair(nextFrame, std::vector<uint8_t>(frame.begin()+RTPSender::headerSize, frame.end()));
+			sender.send(frame.data(), frame.size(), timestamp);
+			nextFrame++;
+			if(nextFrame==frameCount/2){res.halfTimeStats = buffer.getStatistics();}
+		}
+		const RTPJitterBuffer::Frame* f = buffer.update(network.now);
+		while(f){
+			auto it = sent.find(f->timestamp);
+			if(it==sent.end()){
+				res.contentOk = false;
+			}else{
+				const std::vector<uint8_t>& payload = it->second.second;
+				res.contentOk = res.contentOk && f->payload.size()==payload.size() && memcmp(f->payload.data(), payload.data(), payload.size())==0;
+				res.orderOk = res.orderOk && (!anyPlayed || (it->second.first>lastIndex && it->second.first==lastIndex+1+f->concealedBefore));
+				if(!anyPlayed){res.firstPlayedIndex = it->second.first;}
+				anyPlayed = true;
+				lastIndex = it->second.first;
+				res.orderOk = res.orderOk && f->playoutTime<=network.now;
+				double timestampTime = it->second.first/frameRate;
+				scheduleOffsets.push_back(network.now-timestampTime);
+			}
+			f = buffer.update(network.now);
+		}
+	}
+	res.stats = buffer.getStatistics();
+	std::cout << name << ": " << frameCount << " frames, played: " << res.stats.playedFrames << " late: " << res.stats.lateFrames << " lost: " << res.stats.lostFrames << " concealed: " << res.stats.concealedFrames;
+	std::cout << " lost packets: " << res.stats.lostPackets << " duplicates: " << res.stats.duplicatePackets;
+	std::cout << " jitter: " << (1000.0*res.stats.jitter) << " ms delay: " << (1000.0*res.stats.delay) << " ms";
+	std::cout << " playout jitter (std. dev.): " << (1000.0*getStandardDeviation(scheduleOffsets)) << " ms" << std::endl;
+	return res;
+}
+
+static void checkReceiverReport(){
+	SimulatedNetwork network(0.0, 0.0, 0.0);
+	RTPSender sender(&network, 26, 0x01020304, maxPacketSize, false);
+	RTPJitterBuffer buffer(&network, false);
+	uint8_t report[64];
+	check(buffer.writeReceiverReport(report, sizeof(report), 7)==0, "no receiver report without packets");
+	std::mt19937 rng(1);
+	for(uint32_t i=0; i<10; i++){
+		std::vector<uint8_t> frame = createFrame(rng);
+		if(i==5){network.lossRate = 1.0;}//the complete frame is lost
+		sender.send(frame.data(), frame.size(), i*3600);
+		network.lossRate = 0.0;
+	}
+	buffer.update(1.0);
+	RTPJitterBuffer::Statistics stats = buffer.getStatistics();
+	check(stats.lostPackets>0, "lost packets");
+	check(buffer.writeReceiverReport(report, 31, 7)==0, "buffer too small");
+	check(buffer.writeReceiverReport(report, sizeof(report), 7)==32, "receiver report size");
+	uint32_t offset = 0;
+	check(report[0]==0b10000001 && report[1]==201, "receiver report header");
+	offset = 2;
+	check(readBigEndian<uint16_t>(report, offset)==7, "length");
+	check(readBigEndian<uint32_t>(report, offset)==7, "receiver ssrc");
+	check(readBigEndian<uint32_t>(report, offset)==0x01020304, "source ssrc");
+	uint32_t lost = readBigEndian<uint32_t>(report, offset);
+	check((lost>>24)>0 && (int64_t)(lost&0xFFFFFF)==stats.lostPackets, "fraction and cumulative lost");
+	buffer.writeReceiverReport(report, sizeof(report), 7);
+	offset = 12;
+	check((readBigEndian<uint32_t>(report, offset)>>24)==0, "no losses since the last report");
+}
+
+//! packets of another source are ignored while the current one is active, the buffer restarts with the other source after the current one stopped
+static void checkSourceChange(){
+	SimulatedNetwork network(0.0, 0.0, 0.0);
+	RTPSender first(&network, 26, 1, maxPacketSize, false);
+	RTPSender second(&network, 26, 2, maxPacketSize, false);
+	RTPJitterBuffer buffer(&network, false);
+	std::mt19937 rng(3);
+	const uint32_t frameCount = 50;
+	uint32_t interval = (uint32_t)(clockRate/frameRate);
+	std::map<uint32_t, std::vector<uint8_t> > sent;//first source
+	uint32_t played = 0, playedAfterChange = 0;
+	bool contentOk = true;
+	for(uint32_t i=0; i<3*frameCount; i++){
+		network.now = i/frameRate;
+		uint32_t timestamp = i*interval;
+		std::vector<uint8_t> frame = createFrame(rng);
+		if(i<frameCount){
+			sent[timestamp] = std::vector<uint8_t>(frame.begin()+RTPSender::headerSize, frame.end());
+			first.send(frame.data(), frame.size(), timestamp);
+			frame = createFrame(rng);
+		}
+		if(i<frameCount || i>=2*frameCount){//the second source is interrupted longer than sourceTimeout
+			second.send(frame.data(), frame.size(), 1000000+timestamp);
+		}
+		const RTPJitterBuffer::Frame* f = buffer.update(network.now);
+		while(f){
+			if(i<2*frameCount){
+				played++;
+				auto it = sent.find(f->timestamp);
+				contentOk = contentOk && it!=sent.end() && f->payload.size()==it->second.size() && memcmp(f->payload.data(), it->second.data(), it->second.size())==0;
+			}else{
+				playedAfterChange += f->timestamp>=1000000?1:0;
+			}
+			f = buffer.update(network.now);
+		}
+		if(i==frameCount){
+			check(buffer.getStatistics().foreignPackets>0, "packets of the second source must be ignored");
+		}
+	}
+	RTPJitterBuffer::Statistics stats = buffer.getStatistics();
+	check(played>=frameCount-2 && contentOk, "only the frames of the first source must be played");
+	check(playedAfterChange>=frameCount-2, "the second source must be played after the first one stopped");
+	check(stats.foreignPackets==0 && stats.lostPackets==0, "statistics must restart with the second source");
+	uint8_t report[32];
+	uint32_t offset = 8;
+	check(buffer.writeReceiverReport(report, sizeof(report), 7)==32 && readBigEndian<uint32_t>(report, offset)==2, "receiver report for the second source");
+}
+
+//! real UDP on localhost in real time
+static void checkUDP(){
+	IPv4UDPSocket* receiver = new IPv4UDPSocket();
+	check(receiver->bind(udpPort), "bind");
+	receiver->setReceiveBufferSize(4*1024*1024);
+	RTPJitterBuffer buffer(receiver);
+	IPv4UDPSocket* s = new IPv4UDPSocket();
+	s->setUDPTarget(IPv4Address("127.0.0.1", udpPort));
+	RTPSender sender(s, 26, 42, maxPacketSize);
+	std::mt19937 rng(9);
+	const uint32_t frameCount = 30;
+	std::map<uint32_t, std::vector<uint8_t> > sent;
+	uint32_t played = 0;
+	bool contentOk = true;
+	double start = getSecs();
+	uint32_t nextFrame = 0;
+	while(getSecs()-start<frameCount/frameRate+0.5){
+		if(nextFrame<frameCount && getSecs()-start>=nextFrame/frameRate){
+			std::vector<uint8_t> frame = createFrame(rng);
+			uint32_t timestamp = nextFrame*(uint32_t)(clockRate/frameRate);
+			sent[timestamp] = std::vector<uint8_t>(frame.begin()+RTPSender::headerSize, frame.end());
+			sender.send(frame.data(), frame.size(), timestamp);
+			nextFrame++;
+		}
+		const RTPJitterBuffer::Frame* f = buffer.update();
+		while(f){
+			played++;
+			const std::vector<uint8_t>& payload = sent[f->timestamp];
+			contentOk = contentOk && f->payload.size()==payload.size() && memcmp(f->payload.data(), payload.data(), payload.size())==0;
+			f = buffer.update();
+		}
+		delay(1);
+	}
+	std::cout << "UDP: " << played << " of " << frameCount << " frames played" << std::endl;
+	check(played>=frameCount-2 && contentOk, "frames via UDP");
+}
+
+int main(int argc, char *argv[]){
+	uint32_t frameCount = argc>1?atoi(argv[1]):3000;
+	double maxNetworkDelay = (argc>2?atof(argv[2]):40.0)/1000.0;
+	double lossRate = (argc>3?atof(argv[3]):1.0)/100.0;
+	checkReceiverReport();
+	checkSourceChange();
+	//jitter and reordering only: nothing is lost and nothing is late after the delay has adapted
+	RunResult res = run("jitter", frameCount, maxNetworkDelay, 0.0, 0.0);
+	check(res.contentOk, "frames must be unchanged");
+	check(res.orderOk, "frames must be released in timestamp order at their playout time");
+	check(res.stats.lostFrames==0 && res.stats.lostPackets==0, "no losses");
+	check(res.stats.lateFrames==res.halfTimeStats.lateFrames && res.stats.concealedFrames==res.halfTimeStats.concealedFrames, "no late frames after the delay has adapted");
+	check(res.stats.playedFrames+res.stats.concealedFrames==res.sentFrames-res.firstPlayedIndex, "each frame must be played or concealed");
+	check(res.stats.delay<=maxNetworkDelay+0.02, "delay must stay close to the network jitter");
+	//additional losses and duplicates
+	res = run("jitter and loss", frameCount, maxNetworkDelay, lossRate, 0.01);
+	check(res.contentOk, "frames must be unchanged (loss)");
+	check(res.orderOk, "frames must be released in timestamp order at their playout time (loss)");
+	check(lossRate==0.0 || (res.stats.lostFrames>0 && res.stats.lostPackets>0), "losses must be detected");
+	check(res.stats.duplicatePackets>0, "duplicates must be detected");
+	check(res.stats.playedFrames+res.stats.concealedFrames==res.sentFrames-res.firstPlayedIndex, "each frame must be played or concealed (loss)");
+	check(res.stats.lostFrames<=res.stats.concealedFrames, "lost frames must be concealed");
+	checkUDP();
+	if(errorCount>0){
+		std::cerr << errorCount << " errors" << std::endl;
+		return 1;
+	}
+	std::cout << "Checks passed." << std::endl;
+	return 0;
+}
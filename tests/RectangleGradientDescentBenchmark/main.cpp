@@ -0,0 +1,225 @@
+#include <RectangleGradientDescent.h>
+#include <timing.h>
+
+#include <iostream>
+#include <vector>
+#include <list>
+#include <cstdlib>
+#include <cmath>
+
+//! Compares the incremental, parallel RectangleGradientDescent with the former implementation (quadtree rebuilt every step, serial gradient) for many labels.
+//! Usage: ./RectangleGradientDescentBenchmark [rectangleCount] [stepCount] [threadCount] (default: 3000 50 4)
+
+using namespace irr;
+using namespace core;
+
+typedef RectangleGradientDescent::Rectangle Rectangle;
+typedef RectangleGradientDescent::RectanglePair RectanglePair;
+
+template<typename T>
+static inline bool isRectInside(const rect<T>& inner, const rect<T>& outer){
+	return outer.isPointInside(inner.UpperLeftCorner) && outer.isPointInside(inner.LowerRightCorner);
+}
+
+template<typename T>
+static inline T calcOverlapping(T a1, T a2, T b1, T b2){
+	return b1>a1?(a2-b1):(b2-a1);
+}
+
+//! the former quadtree
+class LegacyRectangleQuadTree{
+
+	private:
+
+	rect<double> quadRect;
+
+	std::list<rect<double>*> rects;
+
+	enum SUBQUAD{UPPER_LEFT, LOWER_LEFT, LOWER_RIGHT, UPPER_RIGHT, SUBQUAD_COUNT};
+
+	LegacyRectangleQuadTree* subQuads[SUBQUAD_COUNT];
+
+	double calcOverlappingArea(rect<double>* r, const rect<double>& newRectangle){
+		double area = 0.0;
+		for(auto it = rects.begin(); it != rects.end(); ++it){
+			rect<double>* other = *it;
+			if(other != r){
+				double overlapX = calcOverlapping(newRectangle.UpperLeftCorner.X, newRectangle.LowerRightCorner.X, other->UpperLeftCorner.X, other->LowerRightCorner.X);
+				double overlapY = calcOverlapping(newRectangle.UpperLeftCorner.Y, newRectangle.LowerRightCorner.Y, other->UpperLeftCorner.Y, other->LowerRightCorner.Y);
+				if(overlapX>0.0 && overlapY>0.0){
+					area += (overlapX*overlapY);
+				}
+			}
+		}
+		if(subQuads[0]!=NULL){
+			for(int i=0; i<SUBQUAD_COUNT; i++){
+				if(newRectangle.isRectCollided(subQuads[i]->quadRect)){
+					area += subQuads[i]->calcOverlappingArea(r, newRectangle);
+				}
+			}
+		}
+		return area;
+	}
+
+	public:
+
+	LegacyRectangleQuadTree(rect<double> quadRect):quadRect(quadRect){
+		for(int i=0; i<(int)SUBQUAD_COUNT; i++){subQuads[i] = NULL;}
+	}
+
+	~LegacyRectangleQuadTree(){
+		for(int i=0; i<(int)SUBQUAD_COUNT; i++){
+			if(subQuads[i]!=NULL){delete subQuads[i];}
+		}
+	}
+
+	void insert(rect<double>* r){
+		if(subQuads[0]==NULL){
+			if(rects.empty()){
+				rects.push_back(r);
+			}else{
+				vector2d<double> center = quadRect.getCenter();
+				subQuads[UPPER_LEFT] = new LegacyRectangleQuadTree(rect<double>(quadRect.UpperLeftCorner, center));
+				subQuads[LOWER_LEFT] = new LegacyRectangleQuadTree(rect<double>(quadRect.UpperLeftCorner.X, center.Y, center.X, quadRect.LowerRightCorner.Y));
+				subQuads[LOWER_RIGHT] = new LegacyRectangleQuadTree(rect<double>(center, quadRect.LowerRightCorner));
+				subQuads[UPPER_RIGHT] = new LegacyRectangleQuadTree(rect<double>(center.X, quadRect.UpperLeftCorner.Y, quadRect.LowerRightCorner.X, center.Y));
+				rect<double>* prev = rects.back();
+				rects.clear();
+				insert(prev);
+				insert(r);
+			}
+		}else{
+			for(int i=0; i<SUBQUAD_COUNT; i++){
+				if(isRectInside(*r, subQuads[i]->quadRect)){
+					subQuads[i]->insert(r);
+					return;
+				}
+			}
+			rects.push_back(r);
+		}
+	}
+
+	double calcOverlappingArea(RectanglePair* r, double deltaAngle){
+		Rectangle rCopy(r->first);
+		rCopy.angle += deltaAngle;
+		rect<double> newRectangle = rCopy.convertToRect();
+		return calcOverlappingArea(&(r->second), newRectangle);
+	}
+
+};
+
+//! the former optimization
+static bool legacyOptimize(std::vector<RectanglePair>& rectangles, const rect<double>& availableSpace, uint32_t maxStepCount, double deltaAngle, double gradientEps, bool avoidPivotRectangles){
+	double halfDeltaAngle = 0.5*deltaAngle;
+	for(uint32_t i=0; i<maxStepCount; i++){
+		LegacyRectangleQuadTree* tree = new LegacyRectangleQuadTree(availableSpace);
+		for(uint32_t j=0; j<rectangles.size(); j++){
+			tree->insert(&(rectangles[j].second));
+		}
+		std::list<rect<double>> pivotRectangles;
+		if(avoidPivotRectangles){
+			for(uint32_t j=0; j<rectangles.size(); j++){
+				Rectangle& r = rectangles[j].first;
+				pivotRectangles.push_back(rect<double>(r.pivot.X-0.5*r.rectWidth, r.pivot.Y-0.5*r.rectHeight, r.pivot.X+0.5*r.rectWidth, r.pivot.Y+0.5*r.rectHeight));
+				tree->insert(&(pivotRectangles.back()));
+			}
+		}
+		std::vector<double> gradient(rectangles.size(), 0.0);
+		bool allSmallerEps = true;
+		for(uint32_t j=0; j<gradient.size(); j++){
+			RectanglePair* r = &rectangles[j];
+			gradient[j] = (tree->calcOverlappingArea(r, halfDeltaAngle)-tree->calcOverlappingArea(r, -halfDeltaAngle))/deltaAngle;
+			allSmallerEps = allSmallerEps && fabs(gradient[j])<gradientEps;
+		}
+		if(allSmallerEps){
+			delete tree;
+			return true;
+		}
+		for(uint32_t j=0; j<gradient.size(); j++){
+			if(fabs(gradient[j])>=gradientEps){
+				RectanglePair& r = rectangles[j];
+				r.first.angle -= gradient[j]>0?halfDeltaAngle:-halfDeltaAngle;
+				r.second = r.first.convertToRect();
+			}
+		}
+		delete tree;
+	}
+	return false;
+}
+
+static const double deltaAngle = 0.1;
+static const double gradientEps = 0.001;
+
+static double rnd(double min, double max){
+	return min+(max-min)*(rand()%100001)/100000.0;
+}
+
+static std::vector<Rectangle> createLabels(uint32_t count, const rect<double>* limit){
+	std::vector<Rectangle> res;
+	double size = 40.0*sqrt((double)count);//dense enough for many overlaps
+	for(uint32_t i=0; i<count; i++){
+		res.push_back(Rectangle{vector2d<double>(rnd(0.0, size), rnd(0.0, size)), rnd(40.0, 120.0), rnd(12.0, 24.0), rnd(0.0, 6.283), 8.0, 8.0, limit});
+	}
+	return res;
+}
+
+//! returns the amount of rectangles which differ from the former implementation
+static uint32_t compare(const std::vector<Rectangle>& labels, const rect<double>& space, uint32_t stepCount, uint32_t threadCount, bool avoidPivotRectangles, bool changeFromOutside){
+	std::vector<RectanglePair> legacy;
+	RectangleGradientDescent rgd(space);
+	rgd.setThreadCount(threadCount);
+	std::vector<RectanglePair*> pairs;
+	for(const Rectangle& r : labels){
+		legacy.push_back(RectanglePair(r, r.convertToRect()));
+		pairs.push_back(rgd.addRectangle(r));
+	}
+	double legacyTime = 0.0, time = 0.0;
+	bool legacyFinished = false, finished = false;
+	const uint32_t callCount = changeFromOutside?5:1;
+	for(uint32_t call=0; call<callCount; call++){
+		if(changeFromOutside && call>0){//like GUIHelp: change some rectangles between optimize calls
+			for(uint32_t j=call; j<labels.size(); j+=7){
+				legacy[j].first.angle += 0.5;
+				legacy[j].second = legacy[j].first.convertToRect();
+				pairs[j]->first.angle += 0.5;
+				pairs[j]->second = pairs[j]->first.convertToRect();
+			}
+		}
+		double t = getSecs();
+		legacyFinished = legacyOptimize(legacy, space, stepCount/callCount, deltaAngle, gradientEps, avoidPivotRectangles);
+		legacyTime += getSecs()-t;
+		t = getSecs();
+		finished = rgd.optimize(stepCount/callCount, deltaAngle, gradientEps, avoidPivotRectangles);
+		time += getSecs()-t;
+	}
+	uint32_t differences = finished!=legacyFinished?1:0;
+	for(uint32_t j=0; j<labels.size(); j++){
+		const RectanglePair* r = rgd.getRectangle(j);
+		if(r->first.angle!=legacy[j].first.angle || r->second!=legacy[j].second){differences++;}
+	}
+	std::cout << labels.size() << " rectangles, " << stepCount << " steps, " << threadCount << " threads" << (avoidPivotRectangles?", avoiding pivots":"") << (changeFromOutside?", changed from outside":"") << ": former: " << (1000.0*legacyTime) << " ms, new: " << (1000.0*time) << " ms (" << (legacyTime/time) << "x), differences: " << differences << std::endl;
+	return differences;
+}
+
+int main(int argc, char *argv[]){
+	uint32_t rectangleCount = argc>1?atoi(argv[1]):3000;
+	uint32_t stepCount = argc>2?atoi(argv[2]):50;
+	uint32_t threadCount = argc>3?atoi(argv[3]):4;
+	srand(42);
+	double size = 40.0*sqrt((double)rectangleCount);
+	rect<double> space(-100.0, -100.0, size+100.0, size+100.0);
+	std::vector<Rectangle> labels = createLabels(rectangleCount, &space);
+	uint32_t differences = 0;
+	differences += compare(labels, space, stepCount, 1, true, false);
+	differences += compare(labels, space, stepCount, threadCount, true, false);
+	differences += compare(labels, space, stepCount, threadCount, false, false);
+	differences += compare(labels, space, stepCount, threadCount, true, true);
+	std::vector<Rectangle> smallLabels = createLabels(100, NULL);
+	differences += compare(smallLabels, space, 200, threadCount, true, false);
+	if(differences>0){
+		std::cerr << "Error: Results differ from the former implementation." << std::endl;
+		return 1;
+	}
+	std::cout << "Results equal." << std::endl;
+	return 0;
+}
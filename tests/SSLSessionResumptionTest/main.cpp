@@ -0,0 +1,103 @@
+#include <SSLSocket.h>
+#include <SimpleSockets.h>
+#include <timing.h>
+
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <cstdlib>
+
+//! Measures the TLS connection setup time over loopback with and without session resumption and checks the handshake counters.
+//! Uses the key and certificate of tests/OpenSSLServer.
+//! Usage: ./SSLSessionResumptionTest [connectionCount] (default: 50)
+
+static uint32_t errorCount = 0;
+
+static void check(bool ok, const char* what){
+	if(!ok){
+		std::cerr << "Error: " << what << std::endl;
+		errorCount++;
+	}
+}
+
+static const uint16_t port = 47330;
+static const std::string hello = "hello";
+
+//! receives until something arrives or the timeout (ms) is over
+static int32_t recvWithTimeout(SSLSocket& s, char* buf, uint32_t bufSize, uint32_t timeout){
+	double t = getSecs();
+	int32_t res = 0;
+	while(res==0 && getSecs()-t<timeout/1000.0){
+		res = s.recv(buf, bufSize);
+		if(res==0){delay(1);}
+	}
+	return res;
+}
+
+//! accepts connectionCount connections sequentially, sends hello and waits for the answer
+static void serverMain(IPv4TCPSocket* server, SSLContext* c, uint32_t connectionCount){
+	char buf[16];
+	for(uint32_t i=0; i<connectionCount; i++){
+		IPv4TCPSocket* tcp = server->accept(5000);
+		if(!tcp){break;}
+		SSLSocket ssl(c, tcp, true);
+		if(ssl.accept()){
+			ssl.send(hello.c_str(), hello.size());
+			recvWithTimeout(ssl, buf, sizeof(buf), 5000);
+		}
+	}
+}
+
+//! returns the average connection setup time in ms (tcp connect, handshake and first data)
+static double measure(bool resumption, uint32_t connectionCount){
+	SSLContext serverContext(SSLContext::SERVER);
+	check(serverContext.usePrivateKeyFromFile("../OpenSSLServer/selfsigned-private.key") && serverContext.useCertificateFromFile("../OpenSSLServer/selfsigned-public.crt"), "key and certificate");
+	serverContext.setSessionResumptionEnabled(resumption);
+	SSLContext clientContext(SSLContext::CLIENT);
+	clientContext.setSessionResumptionEnabled(resumption);
+	IPv4TCPSocket server;
+	check(server.bind(port, true) && server.listen(10), "listen");
+	std::thread serverThread(serverMain, &server, &serverContext, connectionCount);
+	IPv4Address address("127.0.0.1", port);
+	X509Cert expectedCert("../OpenSSLServer/selfsigned-public.crt");
+	double sum = 0.0;
+	uint32_t reusedCount = 0;
+	char buf[16];
+	for(uint32_t i=0; i<connectionCount; i++){
+		double t = getSecs();
+		IPv4TCPSocket* tcp = new IPv4TCPSocket();
+		bool success = tcp->connect(address, 2000);
+		SSLSocket ssl(&clientContext, tcp, true);
+		ssl.setPeerName(address.getAddressAsString()+":"+std::to_string(port));
+		success = success && ssl.connect();
+		success = success && recvWithTimeout(ssl, buf, sizeof(buf), 2000)==(int32_t)hello.size();
+		if(i>0){sum += getSecs()-t;}//the first handshake is always a full one
+		check(success, "connection");
+		check(ssl.isPeerCertificateEqual(expectedCert), "the peer certificate must also be known after resumption");
+		reusedCount += ssl.isSessionReused()?1:0;
+		ssl.send(hello.c_str(), hello.size());
+	}
+	serverThread.join();
+	SSLContext::HandshakeStatistics serverStats = serverContext.getHandshakeStatistics();
+	SSLContext::HandshakeStatistics clientStats = clientContext.getHandshakeStatistics();
+	std::cout << "Session resumption " << (resumption?"enabled":"disabled") << ": " << (1000.0*sum/(connectionCount-1)) << " ms per connection, client full/resumed: " << clientStats.fullHandshakeCount << "/" << clientStats.resumedHandshakeCount;
+	std::cout << ", server full/resumed: " << serverStats.fullHandshakeCount << "/" << serverStats.resumedHandshakeCount << std::endl;
+	uint32_t expectedResumed = resumption?connectionCount-1:0;
+	check(reusedCount==expectedResumed, "reused sessions");
+	check(clientStats.resumedHandshakeCount==expectedResumed && clientStats.fullHandshakeCount==connectionCount-expectedResumed, "client statistics");
+	check(serverStats.resumedHandshakeCount==expectedResumed && serverStats.fullHandshakeCount==connectionCount-expectedResumed, "server statistics");
+	return sum/(connectionCount-1);
+}
+
+int main(int argc, char *argv[]){
+	uint32_t connectionCount = argc>1?atoi(argv[1]):50;
+	double full = measure(false, connectionCount);
+	double resumed = measure(true, connectionCount);
+	std::cout << "Speedup: " << (full/resumed) << std::endl;
+	if(errorCount>0){
+		std::cerr << errorCount << " errors" << std::endl;
+		return 1;
+	}
+	std::cout << "Checks passed." << std::endl;
+	return 0;
+}
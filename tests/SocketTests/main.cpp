@@ -149,6 +149,9 @@ int main(int argc, char *argv[]){
 
 	bool result = client.connect(a, 5);
 	assert(result);
+	IIPAddress* peer = client.createPeerAddress();
+	::test(peer && peer->getAddressAsString()=="127.0.0.1" && peer->getPort()==9999, "Peer address test");
+	delete peer;
 	
 	for(int i=0; i<20; i++){
 		client.send(test.c_str(), test.size());
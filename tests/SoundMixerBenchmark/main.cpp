@@ -0,0 +1,239 @@
+#include <SoundManager.h>
+#include <SoundMixer.h>
+#include <NoSoundDriver.h>
+#include <timing.h>
+
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <cmath>
+#include <cstring>
+
+//! Checks the SoundMixer (gain, saturation, sample rate conversion, commands) and measures cpu usage and command latency of the mixing thread using the NoSoundDriver.
+//! Usage: ./SoundMixerBenchmark [sourceCount] [seconds] (default: 16 3)
+
+//! periodic signal in any pcm format from a precomputed table, counts the delivered frames
+class TestSource : public ISoundSource{
+
+	private:
+
+	PCMFormat format;
+	uint32_t sampleRate;
+	std::vector<int16_t> table;
+	uint64_t frameIndex;
+	uint64_t endFrame;
+
+	public:
+
+	//! frequency 0 => constant amplitude; endFrame 0 => infinite
+	TestSource(SoundManager* soundmgr, PCMFormat format, uint32_t sampleRate, double frequency, float amplitude, uint64_t endFrame = 0):ISoundSource(soundmgr),format(format),sampleRate(sampleRate),frameIndex(0),endFrame(endFrame){
+		uint32_t period = frequency>0.0?(uint32_t)(sampleRate/frequency+0.5):1;
+		for(uint32_t i=0; i<period; i++){
+			table.push_back((int16_t)(32767.0*amplitude*(frequency>0.0?sin(2.0*M_PI*i/period):1.0)));
+		}
+	}
+
+	int16_t getValue(uint64_t frame) const{
+		return table[frame%table.size()];
+	}
+
+	uint64_t getFrameIndex() const{
+		return frameIndex;
+	}
+
+	PCMFormat getPCMFormat() const{
+		return format;
+	}
+
+	uint32_t getSampleRate() const{
+		return sampleRate;
+	}
+
+	uint32_t fillNextBytes(uint8_t* buffer, uint32_t bufferSize){
+		uint32_t frameCount = bufferSize/getBytesPerFrame();
+		if(endFrame>0 && frameIndex+frameCount>endFrame){frameCount = endFrame-frameIndex;}
+		uint8_t channelCount = getChannelCount();
+		for(uint32_t i=0; i<frameCount; i++){
+			int16_t v = getValue(frameIndex+i);
+			for(uint8_t c=0; c<channelCount; c++){
+				if(format==MONO8 || format==STEREO8){
+					buffer[i*channelCount+c] = (uint8_t)((v>>8)+128);
+				}else{
+					memcpy(buffer+2*(i*channelCount+c), &v, 2);
+				}
+			}
+		}
+		frameIndex += frameCount;
+		return frameCount*getBytesPerFrame();
+	}
+
+	bool isPlayingOrReady(){
+		return endFrame==0 || frameIndex<endFrame;
+	}
+
+};
+
+static uint32_t errorCount = 0;
+
+static void check(bool ok, const char* what){
+	if(!ok){
+		std::cerr << "Error: " << what << std::endl;
+		errorCount++;
+	}
+}
+
+static const uint32_t outputRate = 44100;
+
+static std::vector<int16_t> pull(SoundMixer& mixer, uint32_t frameCount){
+	std::vector<int16_t> res(2*frameCount);
+	uint32_t bytes = mixer.fillNextBytes((uint8_t*)res.data(), 4*frameCount);
+	check(bytes==4*frameCount, "mixer must always deliver the requested frames");
+	return res;
+}
+
+static bool allEqual(const std::vector<int16_t>& v, int16_t value){
+	for(int16_t x : v){
+		if(x!=value){return false;}
+	}
+	return true;
+}
+
+static void runChecks(){
+	{
+		SoundMixer mixer(NULL, outputRate);
+		TestSource s(NULL, ISoundSource::STEREO16, outputRate, 441.0, 0.8f);
+		mixer.play(&s);
+		std::vector<int16_t> out = pull(mixer, 1000);
+		bool equal = true;
+		for(uint32_t i=0; i<1000; i++){
+			equal = equal && out[2*i]==s.getValue(i) && out[2*i+1]==s.getValue(i);
+		}
+		check(equal, "single source at output rate must be passed through unchanged");
+		mixer.pause(&s);
+		check(allEqual(pull(mixer, 500), 0), "paused source must be silent");
+		check(s.getFrameIndex()==1000, "paused source must not be pulled");
+		mixer.setGain(&s, 0.0f);
+		mixer.play(&s);
+		check(allEqual(pull(mixer, 500), 0), "gain 0");
+		uint64_t stopCommand = mixer.stop(&s);
+		pull(mixer, 10);
+		check(mixer.isProcessed(stopCommand) && mixer.getStatistics().activeSourceCount==0, "stopped source must be removed");
+	}
+	{
+		SoundMixer mixer(NULL, outputRate);
+		TestSource a(NULL, ISoundSource::MONO16, outputRate, 0.0, 0.25f);
+		TestSource b(NULL, ISoundSource::STEREO16, outputRate, 0.0, 0.5f);
+		mixer.play(&a);
+		mixer.play(&b);
+		mixer.setGain(&b, 0.5f);
+		std::vector<int16_t> out = pull(mixer, 600);
+		int16_t expected = (int16_t)lrintf(a.getValue(0)+0.5f*b.getValue(0));
+		check(allEqual(out, expected), "sum with gain");
+		mixer.setGain(&b, 4.0f);
+		check(allEqual(pull(mixer, 600), 32767), "positive saturation");
+		mixer.setGain(&b, -4.0f);
+		check(allEqual(pull(mixer, 600), -32768), "negative saturation");
+	}
+	{
+		SoundMixer mixer(NULL, outputRate);
+		TestSource constant(NULL, ISoundSource::MONO8, 22050, 0.0, 0.5f);
+		TestSource sine(NULL, ISoundSource::STEREO16, 48000, 1000.0, 0.5f);
+		mixer.play(&constant);
+		std::vector<int16_t> out = pull(mixer, outputRate);
+		check(allEqual(out, (constant.getValue(0)>>8)*256), "interpolation of a constant signal");
+		int64_t consumed = constant.getFrameIndex();
+		check(consumed>=22050 && consumed<=22050+4, "22050 Hz source must be consumed at half rate");
+		mixer.stop(&constant);
+		mixer.play(&sine);
+		out = pull(mixer, outputRate);
+		consumed = sine.getFrameIndex();
+		check(consumed>=48000 && consumed<=48000+4, "48000 Hz source must be consumed at the source rate");
+		double maxError = 0.0;
+		for(uint32_t i=0; i<outputRate; i++){//linear interpolation of a 1 kHz sine sampled at 48 kHz
+			double expected = 32767.0*0.5*sin(2.0*M_PI*1000.0*i/outputRate);
+			maxError = std::max(maxError, std::abs(out[2*i]-expected));
+		}
+		check(maxError<50.0, "resampled sine");
+	}
+	{
+		SoundMixer mixer(NULL, outputRate);
+		TestSource s(NULL, ISoundSource::STEREO16, outputRate, 0.0, 0.5f, 100);
+		mixer.play(&s);
+		std::vector<int16_t> out = pull(mixer, 300);
+		check(out[2*99]==s.getValue(0) && out[2*100]==0 && out[2*299]==0, "end of source must be filled with silence");
+	}
+}
+
+static std::vector<TestSource*> createSources(SoundManager* soundmgr, uint32_t count){
+	static const ISoundSource::PCMFormat formats[] = {ISoundSource::STEREO16, ISoundSource::MONO16, ISoundSource::STEREO16, ISoundSource::MONO8};
+	static const uint32_t rates[] = {44100, 22050, 48000, 8000};
+	std::vector<TestSource*> res;
+	for(uint32_t i=0; i<count; i++){
+		if(soundmgr){
+			res.push_back(soundmgr->create<TestSource>(formats[i%4], rates[i%4], 200.0+50.0*i, 0.9f/count));
+		}else{
+			res.push_back(new TestSource(NULL, formats[i%4], rates[i%4], 200.0+50.0*i, 0.9f/count));
+		}
+	}
+	return res;
+}
+
+//! mixes as fast as possible
+static void benchmarkThroughput(uint32_t sourceCount){
+	SoundMixer mixer(NULL, outputRate);
+	std::vector<TestSource*> sources = createSources(NULL, sourceCount);
+	for(TestSource* s : sources){mixer.play(s);}
+	const uint32_t seconds = 10;
+	std::vector<uint8_t> buffer(4*512);
+	double t = getSecs();
+	for(uint32_t i=0; i<seconds*outputRate/512; i++){
+		mixer.fillNextBytes(buffer.data(), buffer.size());
+	}
+	t = getSecs()-t;
+	SoundMixer::Statistics stats = mixer.getStatistics();
+	std::cout << sourceCount << " sources, " << seconds << " s audio mixed in " << (1000.0*t) << " ms (" << (seconds/t) << "x real time, " << (1000000000.0*t/stats.mixedFrameCount) << " ns per output frame)" << std::endl;
+	for(TestSource* s : sources){delete s;}
+}
+
+//! mixing thread with the NoSoundDriver which consumes in real time
+static void benchmarkRealtime(uint32_t sourceCount, double seconds){
+	SoundManager soundmgr(0.02, new NoSoundDriver());
+	std::vector<TestSource*> sources = createSources(&soundmgr, sourceCount);
+	double t = getSecs();
+	for(TestSource* s : sources){soundmgr.play(s);}
+	uint32_t step = 0;
+	while(getSecs()-t<seconds){
+		delay(10);
+		TestSource* s = sources[step%sources.size()];
+		if(step%3==0){
+			soundmgr.pause(s);
+		}else if(step%3==1){
+			soundmgr.setGain(s, 0.5f+0.1f*(step%5));
+			soundmgr.play(s);
+		}else{
+			soundmgr.stop(s);
+			soundmgr.play(s);
+		}
+		soundmgr.update();
+		step++;
+	}
+	t = getSecs()-t;
+	SoundMixer::Statistics stats = soundmgr.getMixer()->getStatistics();
+	std::cout << sourceCount << " sources in real time for " << t << " s: " << stats.mixedFrameCount << " frames mixed (" << (stats.mixedFrameCount/(t*outputRate)) << " of real time), mixing thread cpu: " << (100.0*stats.mixingTime/t) << " %, ";
+	std::cout << stats.commandCount << " commands, latency avg: " << (1000.0*stats.sumCommandLatency/stats.commandCount) << " ms, max: " << (1000.0*stats.maxCommandLatency) << " ms" << std::endl;
+}
+
+int main(int argc, char *argv[]){
+	uint32_t sourceCount = argc>1?atoi(argv[1]):16;
+	double seconds = argc>2?atof(argv[2]):3.0;
+	runChecks();
+	if(errorCount>0){
+		std::cerr << errorCount << " errors" << std::endl;
+		return 1;
+	}
+	std::cout << "Checks passed." << std::endl;
+	benchmarkThroughput(1);
+	benchmarkThroughput(sourceCount);
+	benchmarkRealtime(sourceCount, seconds);
+	return 0;
+}
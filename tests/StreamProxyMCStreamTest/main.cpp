@@ -0,0 +1,202 @@
+#include <StreamProxy.h>
+#include <StreamProxyClient.h>
+#include <SimpleSockets.h>
+#include <SSLSocket.h>
+#include <timing.h>
+
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <cstdlib>
+#include <cstring>
+
+//! Relays a UDP stream of one service to several subscribers via the StreamProxy on localhost: content, order, one upstream per stream and throughput.
+//! Usage: ./StreamProxyMCStreamTest [subscriberCount] [datagramCount] [acceptThreadCount] (default: 3 20000 0, datagrams with 1000 bytes)
+
+static const std::string password = "proxy password";
+static const std::string servicePassword = "service password";
+static const uint16_t controlPort = 48100;
+static const uint16_t dataPort = 48101;
+static const uint16_t streamPort = 48102;
+static const uint16_t publisherPort = 48110;
+static const uint16_t firstSubscriberPort = 48111;
+static const uint32_t datagramSize = 1000;
+
+static uint32_t errorCount = 0;
+
+static void check(bool ok, const char* what){
+	if(!ok){
+		std::cerr << "Error: " << what << std::endl;
+		errorCount++;
+	}
+}
+
+static std::shared_ptr<X509Cert> cert;
+
+//! calls update until done is true or timeout, returns done
+static bool updateUntil(const std::vector<StreamProxyClient*>& clients, const std::function<bool()>& done, double timeout = 5.0){
+	double t = getSecs();
+	while(!done() && getSecs()-t<timeout){
+		for(StreamProxyClient* c : clients){c->update();}
+		delay(1);
+	}
+	return done();
+}
+
+static StreamProxyClient* connectAndLogin(){
+	StreamProxyClient* c = new StreamProxyClient();
+	std::list<IIPAddress*> l{new IPv6Address("::1", controlPort)};
+	bool connected = c->connect(l, cert);
+	deleteAddressList(l);
+	check(connected, "connect to proxy");
+	int32_t result = -1;
+	c->login(password, [&result](bool success){result = success;});
+	check(updateUntil({c}, [&result](){return result!=-1;}) && result==1, "login");
+	return c;
+}
+
+struct Subscriber{
+	StreamProxyClient* client;
+	IPv4UDPSocket udp;
+	uint32_t received;
+	uint32_t next;//expected sequence number
+	bool inOrder;
+};
+
+//! receives everything available, returns true if any datagram has been received
+static bool receive(Subscriber& s){
+	char buf[StreamProxyAPI::maxDatagramSize];
+	bool any = false;
+	uint32_t size = s.udp.recv(buf, sizeof(buf));
+	while(size>0){
+		uint32_t sequence;
+		memcpy(&sequence, buf, sizeof(sequence));
+		if(sequence>0){//0: warm up
+			s.inOrder = s.inOrder && sequence==s.next && size==datagramSize;
+			s.next = sequence+1;
+			s.received++;
+		}
+		any = true;
+		size = s.udp.recv(buf, sizeof(buf));
+	}
+	return any;
+}
+
+int main(int argc, char *argv[]){
+	uint32_t subscriberCount = argc>1?atoi(argv[1]):3;
+	uint32_t datagramCount = argc>2?atoi(argv[2]):20000;
+	uint32_t acceptThreadCount = argc>3?atoi(argv[3]):0;
+	StreamProxy proxy(password, controlPort, dataPort, StreamProxyAPI::proxyPingTimeout, 1000, streamPort, acceptThreadCount);
+	check(proxy.usePrivateKeyFromFile("../OpenSSLServer/selfsigned-private.key"), "private key");
+	check(proxy.useCertificateFromFile("../OpenSSLServer/selfsigned-public.crt"), "certificate");
+	cert = std::make_shared<X509Cert>(std::string("../OpenSSLServer/selfsigned-public.crt"));
+	std::atomic<bool> running(true);
+	std::thread proxyThread([&proxy, &running](){
+		while(running){
+			proxy.update();
+			delay(1);
+		}
+	});
+	//service
+	StreamProxyClient* service = connectAndLogin();
+	int32_t registered = -1;
+	service->registerService("service", servicePassword, [&registered](bool success){registered = success;}, [](const std::string& service, ASocket* s){delete s;});
+	check(updateUntil({service}, [&registered](){return registered!=-1;}) && registered==1, "register service");
+	service->publishMCStream("service", "stream", publisherPort);
+	//subscribers
+	std::vector<Subscriber> subscribers(subscriberCount);
+	std::vector<StreamProxyClient*> clients{service};
+	for(uint32_t i=0; i<subscriberCount; i++){
+		Subscriber& s = subscribers[i];
+		s.client = connectAndLogin();
+		s.received = 0;
+		s.next = 1;
+		s.inOrder = true;
+		s.udp.bind(firstSubscriberPort+i);
+		s.udp.setReceiveBufferSize(4*1024*1024);//bursts from the TCP leg
+		int32_t authenticated = -1;
+		s.client->authenticate("service", servicePassword, [&authenticated](const std::string& service, bool success){authenticated = success;});
+		check(updateUntil({s.client}, [&authenticated](){return authenticated!=-1;}) && authenticated==1, "authenticate");
+		check(s.client->subscribeToMCStream("service", "stream", IPv4Address("127.0.0.1", firstSubscriberPort+i)), "subscribe");
+		clients.push_back(s.client);
+	}
+	//warm up until the stream reaches all subscribers
+	IPv4UDPSocket sender;
+	sender.setUDPTarget(IPv4Address("127.0.0.1", publisherPort));
+	std::vector<char> datagram(datagramSize, 'x');
+	std::vector<bool> reached(subscriberCount, false);
+	uint32_t reachedCount = 0;
+	check(updateUntil(clients, [&](){
+		uint32_t warmUp = 0;
+		memcpy(datagram.data(), &warmUp, sizeof(warmUp));
+		sender.send(datagram.data(), datagramSize);
+		for(uint32_t i=0; i<subscriberCount; i++){
+			if(receive(subscribers[i]) && !reached[i]){
+				reached[i] = true;
+				reachedCount++;
+			}
+		}
+		return reachedCount==subscriberCount;
+	}), "stream must reach all subscribers");
+	delay(100);
+	for(Subscriber& s : subscribers){receive(s);}
+	StreamProxy::StreamStatistics before = proxy.getStreamStatistics();
+	check(before.relayCount==1 && before.subscriberCount==subscriberCount, "one relay for all subscribers");
+	//stream paced in bursts to avoid losses in the local UDP receive buffers
+	double t = getSecs();
+	for(uint32_t i=1; i<=datagramCount; i++){
+		memcpy(datagram.data(), &i, sizeof(i));
+		sender.send(datagram.data(), datagramSize);
+		if(i%200==0){
+			for(Subscriber& s : subscribers){receive(s);}
+			delay(1);
+		}
+	}
+	updateUntil({}, [&](){
+		bool complete = true;
+		for(Subscriber& s : subscribers){
+			receive(s);
+			complete = complete && s.received==datagramCount;
+		}
+		return complete;
+	});
+	t = getSecs()-t;
+	for(Subscriber& s : subscribers){
+		check(s.received==datagramCount, "all datagrams must be received");
+		check(s.inOrder, "datagrams must be received in order and unchanged");
+	}
+	StreamProxy::StreamStatistics after = proxy.getStreamStatistics();
+	uint64_t received = after.receivedDatagrams-before.receivedDatagrams;
+	uint64_t sent = after.sentDatagrams-before.sentDatagrams;
+	check(received==datagramCount && sent==subscriberCount*received && after.droppedDatagrams==0, "each datagram must be received once and sent to each subscriber");
+	std::cout << datagramCount << " datagrams to " << subscriberCount << " subscribers in " << (1000.0*t) << " ms (" << (datagramCount/t) << " datagrams/s, " << (subscriberCount*datagramCount*datagramSize/(t*1024.0*1024.0)) << " MB/s delivered)" << std::endl;
+	//relay and upstream end without subscribers
+	for(Subscriber& s : subscribers){
+		s.client->unsubscribeFromMCStream("service", "stream");
+		check(!s.client->isSubscribedToMCStream("service", "stream"), "unsubscribed");
+	}
+	check(updateUntil(clients, [&proxy](){return proxy.getStreamStatistics().relayCount==0;}), "relay must end without subscribers");
+	//a new subscription requests the stream again
+	Subscriber& s = subscribers[0];
+	s.next = 1;
+	s.received = 0;
+	check(s.client->subscribeToMCStream("service", "stream", IPv4Address("127.0.0.1", firstSubscriberPort)), "subscribe again");
+	check(updateUntil(clients, [&](){
+		uint32_t one = 1;
+		memcpy(datagram.data(), &one, sizeof(one));
+		sender.send(datagram.data(), datagramSize);
+		receive(s);
+		return s.received>0;
+	}), "stream must be requested again");
+	for(StreamProxyClient* c : clients){delete c;}
+	running = false;
+	proxyThread.join();
+	if(errorCount>0){
+		std::cerr << errorCount << " errors" << std::endl;
+		return 1;
+	}
+	std::cout << "Checks passed." << std::endl;
+	return 0;
+}
@@ -0,0 +1,142 @@
+#include <SoundManager.h>
+#include <NoSoundDriver.h>
+#include <StaticWaveFileSource.h>
+#include <StreamingWaveFileSource.h>
+#include <MappedWaveFile.h>
+#include <timing.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+
+//! Compares StaticWaveFileSource and StreamingWaveFileSource for a long wave file: time until the first frames are available, memory usage and content.
+//! Usage: ./StreamingWaveFileBenchmark [seconds] (default: 300, STEREO16 at 44100 Hz)
+
+static const char* path = "StreamingWaveFileBenchmark.wav";
+static const uint32_t sampleRate = 44100;
+static const uint32_t chunkFrameCount = 1024;
+
+static uint32_t errorCount = 0;
+
+static void check(bool ok, const char* what){
+	if(!ok){
+		std::cerr << "Error: " << what << std::endl;
+		errorCount++;
+	}
+}
+
+static int16_t getSample(uint32_t frame, uint32_t channel){
+	return (int16_t)(frame*7+channel*13);
+}
+
+static void writeLittleEndian(std::ofstream& out, uint32_t value, uint32_t size){
+	for(uint32_t i=0; i<size; i++){out.put((char)((value>>(8*i))&0xFF));}
+}
+
+static void writeWaveFile(uint32_t frameCount){
+	std::ofstream out(path, std::ofstream::binary);
+	uint32_t dataSize = 4*frameCount;
+	out.write("RIFF", 4); writeLittleEndian(out, 36+dataSize, 4); out.write("WAVE", 4);
+	out.write("fmt ", 4); writeLittleEndian(out, 16, 4); writeLittleEndian(out, 1, 2); writeLittleEndian(out, 2, 2);
+	writeLittleEndian(out, sampleRate, 4); writeLittleEndian(out, 4*sampleRate, 4); writeLittleEndian(out, 4, 2); writeLittleEndian(out, 16, 2);
+	out.write("data", 4); writeLittleEndian(out, dataSize, 4);
+	std::vector<int16_t> chunk(2*chunkFrameCount);
+	for(uint32_t i=0; i<frameCount; i+=chunkFrameCount){
+		uint32_t n = std::min(chunkFrameCount, frameCount-i);
+		for(uint32_t j=0; j<n; j++){
+			chunk[2*j] = getSample(i+j, 0);
+			chunk[2*j+1] = getSample(i+j, 1);
+		}
+		out.write((const char*)chunk.data(), 4*n);
+	}
+}
+
+//! evicts the file from the page cache to measure a cold start
+static void evictFromCache(){
+	int fd = open(path, O_RDONLY);
+	if(fd>=0){
+		fdatasync(fd);
+		posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+		close(fd);
+	}
+}
+
+static double getResidentMB(){
+	std::ifstream statm("/proc/self/statm");
+	uint64_t size = 0, resident = 0;
+	statm >> size >> resident;
+	return resident*sysconf(_SC_PAGESIZE)/(1024.0*1024.0);
+}
+
+//! plays the whole source and compares the content, returns the peak resident memory in MB
+static double playAndCompare(ISoundSource* source, uint32_t frameCount, uint32_t firstFrame, const char* name){
+	std::vector<int16_t> buffer(2*chunkFrameCount);
+	double peak = getResidentMB();
+	bool equal = true;
+	uint32_t frame = firstFrame;
+	while(true){
+		uint32_t n = source->fillNextBytes((uint8_t*)buffer.data(), 4*chunkFrameCount)/4;
+		if(n==0){break;}
+		for(uint32_t j=0; j<n; j++){
+			equal = equal && buffer[2*j]==getSample(frame+j, 0) && buffer[2*j+1]==getSample(frame+j, 1);
+		}
+		frame += n;
+		if(frame%(64*chunkFrameCount)==0){peak = std::max(peak, getResidentMB());}
+	}
+	check(equal && frame==frameCount, name);
+	return std::max(peak, getResidentMB());
+}
+
+int main(int argc, char *argv[]){
+	uint32_t seconds = argc>1?atoi(argv[1]):300;
+	uint32_t frameCount = seconds*sampleRate;
+	writeWaveFile(frameCount);
+	std::cout << "Wave file: " << seconds << " s, " << (4.0*frameCount/(1024.0*1024.0)) << " MB" << std::endl;
+	SoundManager soundmgr(0.1, new NoSoundDriver());
+	std::vector<uint8_t> buffer(4*chunkFrameCount);
+	{
+		evictFromCache();
+		double before = getResidentMB();
+		double t = getSecs();
+		StaticWaveFileSource* s = soundmgr.create<StaticWaveFileSource>(path);
+		s->fillNextBytes(buffer.data(), buffer.size());
+		t = getSecs()-t;
+		double loaded = getResidentMB();
+		s->seek(0.f);
+		double peak = playAndCompare(s, frameCount, 0, "static content");
+		std::cout << "StaticWaveFileSource: first frames after " << (1000.0*t) << " ms, memory after start: " << (loaded-before) << " MB, peak: " << (peak-before) << " MB" << std::endl;
+		soundmgr.deleteSource(s);
+	}
+	{
+		evictFromCache();
+		double before = getResidentMB();
+		double t = getSecs();
+		StreamingWaveFileSource* s = soundmgr.create<StreamingWaveFileSource>(path);
+		s->fillNextBytes(buffer.data(), buffer.size());
+		t = getSecs()-t;
+		double loaded = getResidentMB();
+		s->seek(0.f);
+		double peak = playAndCompare(s, frameCount, 0, "streamed content");
+		std::cout << "StreamingWaveFileSource: first frames after " << (1000.0*t) << " ms, memory after start: " << (loaded-before) << " MB, peak: " << (peak-before) << " MB" << std::endl;
+		s->seek(0.5f);
+		playAndCompare(s, frameCount, frameCount/2, "streamed content after seek");
+		StreamingWaveFileSource* other = soundmgr.create<StreamingWaveFileSource>(path);
+		check(soundmgr.getMappedWaveFile(path)==soundmgr.getMappedWaveFile(path), "mapping must be shared while in use");
+		other->seek(0.75f);
+		playAndCompare(other, frameCount, frameCount*3/4, "shared content");
+		soundmgr.deleteSource(s);
+		soundmgr.deleteSource(other);
+	}
+	unlink(path);
+	if(errorCount>0){
+		std::cerr << errorCount << " errors" << std::endl;
+		return 1;
+	}
+	std::cout << "Checks passed." << std::endl;
+	return 0;
+}
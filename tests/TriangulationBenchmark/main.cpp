@@ -0,0 +1,151 @@
+#include <Triangulate.h>
+#include <timing.h>
+
+#include <irrMath.h>
+#include <rect.h>
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cmath>
+
+using namespace irr;
+using namespace core;
+
+//! Compares the ear clipping Triangulate::Process with the sweep line MonotoneTriangulator for polygons with 100 to 100k vertices.
+//! The triangulations are verified by comparing the sum of the triangle areas with the polygon area.
+
+//! star shaped polygon with random radii (many reflex vertices)
+static void createStar(Vector2dVector& out, u32 n, f32 radius, const vector2d<f32>& center, bool clockwise){
+	out.set_used(0);
+	for(u32 i=0; i<n; i++){
+		f64 angle = (clockwise?-2.0:2.0)*PI64*i/n;
+		f64 r = radius*(0.5+0.5*rand()/(f64)RAND_MAX);
+		out.push_back(vector2d<f32>(center.X+r*cos(angle), center.Y+r*sin(angle)));
+	}
+}
+
+//! axis aligned rectangle with subdivided (collinear) edges and duplicated points
+static void createSubdividedRectangle(Vector2dVector& out, u32 n, const rect<f32>& r){
+	out.set_used(0);
+	u32 perSide = n/4;
+	vector2d<f32> corners[4] = {r.UpperLeftCorner, vector2d<f32>(r.LowerRightCorner.X, r.UpperLeftCorner.Y), r.LowerRightCorner, vector2d<f32>(r.UpperLeftCorner.X, r.LowerRightCorner.Y)};
+	for(u32 c=0; c<4; c++){
+		for(u32 i=0; i<perSide; i++){
+			out.push_back(corners[c]+(corners[(c+1)%4]-corners[c])*((f32)i/perSide));
+			if(i%16==0){out.push_back(out.getLast());}
+		}
+	}
+}
+
+static f64 calcArea(const Vector2dVector& contour){
+	return fabs(Triangulate::Area(contour));
+}
+
+static f64 calcTriangleArea(const Vector2dVector& triangles){
+	f64 area = 0.0;
+	for(u32 i=0; i+2<triangles.size(); i+=3){
+		const vector2d<f32>& a = triangles[i];
+		const vector2d<f32>& b = triangles[i+1];
+		const vector2d<f32>& c = triangles[i+2];
+		area += fabs(((f64)b.X-a.X)*((f64)c.Y-a.Y)-((f64)c.X-a.X)*((f64)b.Y-a.Y))*0.5;
+	}
+	return area;
+}
+
+static bool isAreaEqual(f64 a, f64 b){
+	return fabs(a-b)<=1e-4*fabs(b);
+}
+
+static u32 errorCount = 0;
+
+static void check(bool ok, const char* what){
+	if(!ok){
+		std::cerr << "Error: " << what << std::endl;
+		errorCount++;
+	}
+}
+
+static void printRow(const char* name, u32 n, f64 monotoneTime, f64 earTime){
+	std::cout << std::left << std::setw(24) << name << std::right << std::setw(8) << n << std::setw(14) << monotoneTime*1000.0;
+	if(earTime>=0.0){
+		std::cout << std::setw(14) << earTime*1000.0 << std::setw(10) << earTime/monotoneTime << "x";
+	}else{
+		std::cout << std::setw(14) << "-";
+	}
+	std::cout << std::endl;
+}
+
+int main(int argc, char *argv[]){
+	srand(1);
+	MonotoneTriangulator triangulator;
+	Vector2dVector contour, holes[8], result;
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << std::left << std::setw(24) << "polygon" << std::right << std::setw(8) << "n" << std::setw(14) << "sweep [ms]" << std::setw(14) << "ear [ms]" << std::setw(11) << "speedup" << std::endl;
+	u32 sizes[] = {100, 1000, 10000, 100000};
+	for(u32 s=0; s<4; s++){
+		u32 n = sizes[s];
+		u32 repetitions = 100000/n;
+		//star
+		createStar(contour, n, 1000.f, vector2d<f32>(0.f, 0.f), false);
+		f64 start = getSecs();
+		for(u32 i=0; i<repetitions; i++){
+			result.set_used(0);
+			check(triangulator.process(contour, result), "triangulation must succeed");
+		}
+		f64 monotoneTime = (getSecs()-start)/repetitions;
+		check(result.size()==3*(n-2), "star: triangle count");
+		check(isAreaEqual(calcTriangleArea(result), calcArea(contour)), "star: area");
+		f64 earTime = -1.0;
+		if(n<=10000){//O(n^3) worst case, 100k vertices take too long
+			u32 earRepetitions = n<=1000?repetitions:1;
+			start = getSecs();
+			for(u32 i=0; i<earRepetitions; i++){
+				result.set_used(0);
+				result.reallocate(3*n);
+				Triangulate::Process(contour, result);
+			}
+			earTime = (getSecs()-start)/earRepetitions;
+			check(isAreaEqual(calcTriangleArea(result), calcArea(contour)), "star (ear clipping): area");
+		}
+		printRow("star", n, monotoneTime, earTime);
+		//star with 8 holes (orientation of holes does not matter)
+		u32 holeCount = 8;
+		f64 holeArea = 0.0;
+		for(u32 h=0; h<holeCount; h++){
+			f64 angle = 2.0*PI64*h/holeCount;
+			createStar(holes[h], n/holeCount, 40.f, vector2d<f32>(300.0*cos(angle), 300.0*sin(angle)), h%2==0);
+			holeArea += calcArea(holes[h]);
+		}
+		start = getSecs();
+		for(u32 i=0; i<repetitions; i++){
+			triangulator.clear();
+			triangulator.addContour(contour);
+			for(u32 h=0; h<holeCount; h++){
+				triangulator.addContour(holes[h]);
+			}
+			result.set_used(0);
+			check(triangulator.triangulate(result), "triangulation with holes must succeed");
+		}
+		monotoneTime = (getSecs()-start)/repetitions;
+		check(result.size()==3*(n+holeCount*(n/holeCount)+2*holeCount-2), "star with holes: triangle count");
+		check(isAreaEqual(calcTriangleArea(result), calcArea(contour)-holeArea), "star with holes: area");
+		printRow("star with 8 holes", n, monotoneTime, -1.0);
+		//collinear and duplicated points
+		createSubdividedRectangle(contour, n, rect<f32>(0.f, 0.f, 800.f, 600.f));
+		start = getSecs();
+		for(u32 i=0; i<repetitions; i++){
+			result.set_used(0);
+			check(triangulator.process(contour, result), "triangulation must succeed");
+		}
+		monotoneTime = (getSecs()-start)/repetitions;
+		check(isAreaEqual(calcTriangleArea(result), 800.0*600.0), "collinear rectangle: area");
+		printRow("collinear rectangle", n, monotoneTime, -1.0);
+	}
+	if(errorCount>0){
+		std::cerr << errorCount << " errors" << std::endl;
+		return 1;
+	}
+	std::cout << "Triangulation results correct." << std::endl;
+	return 0;
+}
@@ -0,0 +1,174 @@
+#include <ZSocket.h>
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <random>
+#include <ctime>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+//! Compares the classic ZSocket with the framed mode (fixed level, adaptive, adaptive with JSON-RPC dictionary) for JSON-RPC messages, binary sensor data and incompressible data.
+//! The incompressible data (uniformly random bytes) stands in for JPEG frames whose entropy coded data has almost no redundancy left.
+//! Usage: ./ZSocketBenchmark [megabytes] (default: 8)
+
+static uint32_t errorCount = 0;
+
+static void check(bool ok, const char* what){
+	if(!ok){
+		std::cerr << "Error: " << what << std::endl;
+		errorCount++;
+	}
+}
+
+//! in memory connection, the receiving side reads what the sending side has sent
+class MemoryPipe : public ICommunicationEndpoint{
+	
+	public:
+	
+	std::vector<char> data;
+	size_t readPos = 0;
+	
+	int32_t recv(char* buf, uint32_t bufSize){
+		uint32_t count = std::min((size_t)bufSize, data.size()-readPos);
+		memcpy(buf, data.data()+readPos, count);
+		readPos += count;
+		if(readPos==data.size()){
+			data.clear();
+			readPos = 0;
+		}
+		return count;
+	}
+	
+	bool send(const char* buf, uint32_t bufSize){
+		data.insert(data.end(), buf, buf+bufSize);
+		return true;
+	}
+	
+};
+
+static std::vector<std::string> createJSONMessages(uint64_t byteCount){
+	std::vector<std::string> res;
+	std::mt19937 rng(1);
+	static const char* methods[] = {"moveXY", "setParameter", "getStatus", "registerForSpam"};
+	uint64_t sum = 0;
+	for(uint32_t id=1; sum<byteCount; id++){
+		std::string msg;
+		if(id%2==1){
+			msg = std::string("{\"jsonrpc\":\"2.0\",\"method\":\"")+methods[rng()%4]+"\",\"params\":["+std::to_string(rng()%1000/10.0)+","+std::to_string((int)(rng()%2000)-1000)+",\"value"+std::to_string(rng()%100)+"\"],\"id\":"+std::to_string(id)+"}";
+		}else{
+			msg = std::string("{\"jsonrpc\":\"2.0\",\"result\":{\"x\":")+std::to_string(rng()%1000)+",\"y\":"+std::to_string(rng()%1000)+",\"ok\":true},\"id\":"+std::to_string(id-1)+"}";
+		}
+		sum += msg.size();
+		res.push_back(msg);
+	}
+	return res;
+}
+
+//! 4 KB blocks of slowly changing 16 bit samples with noise
+static std::vector<std::string> createBinaryBlocks(uint64_t byteCount){
+	std::vector<std::string> res;
+	std::mt19937 rng(2);
+	uint32_t t = 0;
+	for(uint64_t sum=0; sum<byteCount; sum+=4096){
+		std::string block(4096, '\0');
+		int16_t* samples = (int16_t*)&block[0];
+		for(uint32_t i=0; i<2048; i++, t++){
+			samples[i] = (int16_t)(1000.0*sin(t*0.001)+(int)(rng()%16));
+		}
+		res.push_back(block);
+	}
+	return res;
+}
+
+static std::vector<std::string> createRandomBlocks(uint64_t byteCount){
+	std::vector<std::string> res;
+	std::mt19937 rng(3);
+	for(uint64_t sum=0; sum<byteCount; sum+=32768){
+		std::string block(32768, '\0');
+		for(char& c : block){c = (char)rng();}
+		res.push_back(block);
+	}
+	return res;
+}
+
+enum Mode{CLASSIC, FRAMED, ADAPTIVE, ADAPTIVE_JSON, MODE_COUNT};
+static const char* modeNames[MODE_COUNT] = {"classic level 9", "framed level 9", "adaptive", "adaptive + json dictionary"};
+
+static ZSocket* createSocket(Mode mode, MemoryPipe* pipe){
+	if(mode==CLASSIC){
+		return new ZSocket(pipe, 1024*1024, 1024*1024, 9, false);
+	}else if(mode==FRAMED){
+		return new ZSocket(pipe, new DeflateCodec(9), false, 9, false);
+	}else if(mode==ADAPTIVE){
+		return createZSocket(pipe, "deflate", false);
+	}
+	return createZSocket(pipe, "deflate-json", false);
+}
+
+static void run(const char* payloadName, const std::vector<std::string>& messages, Mode mode){
+	MemoryPipe pipe;
+	ZSocket* sender = createSocket(mode, &pipe);
+	ZSocket* receiver = createSocket(mode, &pipe);
+	std::vector<char> buf(65536);
+	bool equal = true;
+	uint64_t rawBytes = 0;
+	std::clock_t c = std::clock();
+	for(const std::string& msg : messages){
+		equal = equal && sender->send(msg.c_str(), msg.size());
+		size_t received = 0;
+		while(received<msg.size()){
+			int32_t n = receiver->recv(buf.data(), buf.size());
+			if(n<=0){break;}
+			equal = equal && received+n<=msg.size() && memcmp(buf.data(), msg.data()+received, n)==0;
+			received += n;
+		}
+		equal = equal && received==msg.size();
+		rawBytes += msg.size();
+	}
+	double cpu = (std::clock()-c)/(double)CLOCKS_PER_SEC;
+	ZSocket::Statistics stats = sender->getStatistics();
+	check(equal && stats.rawBytes==rawBytes, (std::string(payloadName)+" "+modeNames[mode]+": content").c_str());
+	double mb = rawBytes/(1024.0*1024.0);
+	if(mode==ADAPTIVE || mode==ADAPTIVE_JSON){
+		check(stats.sentBytes<=rawBytes+rawBytes/100+messages.size()*4, "adaptive mode must not expand the data");
+	}
+	std::cout << payloadName << ", " << modeNames[mode] << ": ratio " << (stats.sentBytes/(double)rawBytes) << ", " << (1000.0*cpu/mb) << " ms cpu per MB, passed through: " << (100.0*stats.bypassedBytes/rawBytes) << " %, final level: " << stats.level << std::endl;
+	delete sender;
+	delete receiver;
+}
+
+//! bytes sent for the first messages of a new connection, where the preset dictionary matters most
+static uint64_t measureShortConnection(const std::vector<std::string>& messages, Mode mode, uint32_t messageCount){
+	MemoryPipe pipe;
+	ZSocket* sender = createSocket(mode, &pipe);
+	for(uint32_t i=0; i<messageCount; i++){
+		sender->send(messages[i].c_str(), messages[i].size());
+	}
+	uint64_t sentBytes = sender->getStatistics().sentBytes;
+	delete sender;
+	return sentBytes;
+}
+
+int main(int argc, char *argv[]){
+	uint64_t byteCount = (argc>1?atoi(argv[1]):8)*1024ull*1024ull;
+	std::vector<std::string> payloads[3] = {createJSONMessages(byteCount), createBinaryBlocks(byteCount), createRandomBlocks(byteCount)};
+	const char* payloadNames[3] = {"JSON-RPC", "binary", "incompressible"};
+	for(uint32_t i=0; i<3; i++){
+		for(uint32_t mode=0; mode<MODE_COUNT; mode++){
+			run(payloadNames[i], payloads[i], (Mode)mode);
+		}
+	}
+	uint64_t withoutDictionary = measureShortConnection(payloads[0], ADAPTIVE, 10);
+	uint64_t withDictionary = measureShortConnection(payloads[0], ADAPTIVE_JSON, 10);
+	std::cout << "First 10 JSON-RPC messages of a connection: " << withoutDictionary << " bytes without, " << withDictionary << " bytes with dictionary" << std::endl;
+	check(withDictionary<withoutDictionary, "dictionary must improve small messages");
+	check(createZSocket(NULL, "unknown")==NULL, "unknown codec");
+	if(errorCount>0){
+		std::cerr << errorCount << " errors" << std::endl;
+		return 1;
+	}
+	std::cout << "Checks passed." << std::endl;
+	return 0;
+}
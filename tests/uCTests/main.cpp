@@ -1,3 +1,5 @@
+#include "uCRPCBenchmark.h"
+
 #include <uCMatrix.h>
 
 #include <iostream>
@@ -31,5 +33,9 @@ int main(int argc, char *argv[]){
 	assert(I==I);
 	assert(res==T);
 	
+	if(!runUCRPCBenchmark()){
+		return 1;
+	}
+	
 	return 0;
 }
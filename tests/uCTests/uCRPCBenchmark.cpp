@@ -0,0 +1,394 @@
+#include "uCRPCBenchmark.h"
+
+#include <uCRPC.h>
+#include <timing.h>
+
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <cstdlib>
+#include <cstring>
+
+using namespace UCRPC;
+
+static constexpr uint16_t maxParameterSize = 256;
+static constexpr uint8_t delimeter = 0b10101010;
+static constexpr uint8_t escape = 0b11001100;
+
+//! function ids with and without bytes which need escaping
+static constexpr uint16_t escapedFunctionID = delimeter;
+static constexpr uint16_t plainFunctionID = 0x0012;
+
+using RegFunc = RegisteredFunction<uint16_t, maxParameterSize>;
+using Functions = ucstd::array<RegFunc, 2>;
+
+static uint32_t errorCount = 0;
+
+static void check(bool ok, const char* what){
+	if(!ok){
+		std::cerr << "Error: " << what << std::endl;
+		errorCount++;
+	}
+}
+
+//! in-memory serial, everything sent can be received
+class MemorySerial{
+	
+	public:
+	
+	std::vector<uint8_t> data;
+	size_t readOffset;
+	uint64_t sendCount;
+	
+	MemorySerial():readOffset(0),sendCount(0){}
+	
+	bool send(const char* buf, uint32_t bufSize){
+		data.insert(data.end(), (const uint8_t*)buf, (const uint8_t*)buf+bufSize);
+		sendCount++;
+		return true;
+	}
+	
+	int32_t recv(char* buf, uint32_t bufSize){
+		uint32_t n = std::min<size_t>(bufSize, data.size()-readOffset);
+		memcpy(buf, &(data[readOffset]), n);
+		readOffset += n;
+		return n;
+	}
+	
+	void clear(){
+		data.clear();
+		readOffset = 0;
+		sendCount = 0;
+	}
+	
+};
+
+//! compares the received parameters with the expected ones
+class Receiver : public IUCRemoteProcedureCallReceiver<uint16_t, maxParameterSize>{
+	
+	public:
+	
+	const std::vector<std::vector<uint8_t>>* expected;
+	size_t receivedCount;
+	bool allEqual;
+	
+	Receiver():expected(NULL),receivedCount(0),allEqual(true){}
+	
+	void callProcedure(IUCRPC<uint16_t, maxParameterSize>* ucrpc, uint16_t functionID, uint8_t* parameter, uint16_t parameterLength){
+		const std::vector<uint8_t>& e = (*expected)[receivedCount%expected->size()];
+		allEqual = allEqual && functionID==(receivedCount%2==0?escapedFunctionID:plainFunctionID) && parameterLength==e.size() && (e.empty() || memcmp(parameter, e.data(), e.size())==0);
+		receivedCount++;
+	}
+	
+};
+
+template <uint8_t coalescedPackageCount>
+using TestRPC = ::UCRPC::UCRPC<uint16_t, MemorySerial, maxParameterSize, 8, Functions, 0, MemorySerial, 200, 10, 16, 10, 10000/3, coalescedPackageCount>;
+
+//! byte-at-a-time encoding like the microcontroller build
+static void writeEscapedReference(std::vector<uint8_t>& out, const uint8_t* data, size_t length, uint32_t& crc32){
+	for(size_t i=0; i<length; i++){
+		uint8_t d = data[i];
+		crc32 = UPDC32(d, crc32);
+		if(d==delimeter || d==escape){
+			out.push_back(escape);
+			out.push_back(~d);
+		}else{
+			out.push_back(d);
+		}
+	}
+}
+
+static void writePackageReference(std::vector<uint8_t>& out, uint16_t functionID, const std::vector<uint8_t>& params){
+	out.push_back(delimeter);
+	STARTCRC32(crc32)
+	uint8_t header[3] = {(uint8_t)(functionID & 0xFF), (uint8_t)(functionID >> 8), 0};
+	writeEscapedReference(out, header, 3, crc32);
+	writeEscapedReference(out, params.data(), params.size(), crc32);
+	ENDCRC32(crc32)
+	uint8_t crc[4] = {(uint8_t)crc32, (uint8_t)(crc32 >> 8), (uint8_t)(crc32 >> 16), (uint8_t)(crc32 >> 24)};
+	uint32_t unused = 0;
+	writeEscapedReference(out, crc, 4, unused);
+	out.push_back(delimeter);
+}
+
+//! random payloads of all sizes, some consisting only of delimeters/escapes, specialRatio: probability in % of a delimeter/escape byte
+static std::vector<std::vector<uint8_t>> createPayloads(size_t count, uint32_t minSize, uint32_t maxSize, uint32_t specialRatio){
+	std::vector<std::vector<uint8_t>> res(count);
+	for(size_t i=0; i<count; i++){
+		res[i].resize(minSize+i%(maxSize-minSize+1));
+		for(uint8_t& v : res[i]){
+			uint32_t r = rand()%100;
+			v = r<specialRatio?(r%2==0?delimeter:escape):rand()%256;
+		}
+	}
+	res.push_back(std::vector<uint8_t>(maxSize, delimeter));
+	res.push_back(std::vector<uint8_t>(maxSize, escape));
+	return res;
+}
+
+static uint16_t getFunctionID(size_t i){
+	return i%2==0?escapedFunctionID:plainFunctionID;
+}
+
+template <uint8_t coalescedPackageCount>
+static void checkCompatibility(const std::vector<std::vector<uint8_t>>& payloads){
+	MemorySerial serial;
+	Functions functions{};
+	TestRPC<coalescedPackageCount> rpc(serial, functions);
+	std::vector<uint8_t> reference;
+	for(size_t i=0; i<payloads.size(); i++){
+		rpc.callRemoteProcedure(getFunctionID(i), (uint8_t*)payloads[i].data(), payloads[i].size());
+		writePackageReference(reference, getFunctionID(i), payloads[i]);
+	}
+	rpc.flush();
+	check(serial.data==reference, "encoded packages must match the byte-at-a-time encoding");
+	MemorySerial rcvSerial;
+	rcvSerial.data = reference;
+	Receiver receiver;
+	receiver.expected = &payloads;
+	Functions rcvFunctions{RegFunc{escapedFunctionID, &receiver}, RegFunc{plainFunctionID, &receiver}};
+	TestRPC<coalescedPackageCount> rcvRPC(rcvSerial, rcvFunctions);
+	while(rcvSerial.readOffset<rcvSerial.data.size()){rcvRPC.update();}
+	check(receiver.receivedCount==payloads.size() && receiver.allEqual, "byte-at-a-time encoded packages must be decoded");
+	std::vector<uint8_t> corrupted = reference;
+	corrupted[corrupted.size()/2] ^= 0x01;
+	rcvSerial.clear();
+	rcvSerial.data = corrupted;
+	size_t before = receiver.receivedCount;
+	std::cout << "Expecting a CRC error:" << std::endl;
+	while(rcvSerial.readOffset<rcvSerial.data.size()){rcvRPC.update();}
+	check(receiver.receivedCount<before+payloads.size(), "corrupted package must be rejected");
+}
+
+template <uint8_t coalescedPackageCount>
+static void benchmark(const char* name, const std::vector<std::vector<uint8_t>>& payloads, uint32_t callCount){
+	MemorySerial serial;
+	serial.data.reserve(callCount*(payloads[0].size()*2+20));
+	Functions functions{};
+	TestRPC<coalescedPackageCount> rpc(serial, functions);
+	size_t payloadBytes = 0;
+	double t = getSecs();
+	for(uint32_t i=0; i<callCount; i++){
+		const std::vector<uint8_t>& p = payloads[i%payloads.size()];
+		rpc.callRemoteProcedure(getFunctionID(i), (uint8_t*)p.data(), p.size());
+		payloadBytes += p.size();
+	}
+	rpc.flush();
+	double encodeTime = getSecs()-t;
+	Receiver receiver;
+	receiver.expected = &payloads;
+	Functions rcvFunctions{RegFunc{escapedFunctionID, &receiver}, RegFunc{plainFunctionID, &receiver}};
+	TestRPC<coalescedPackageCount> rcvRPC(serial, rcvFunctions);
+	t = getSecs();
+	while(serial.readOffset<serial.data.size()){rcvRPC.update();}
+	double decodeTime = getSecs()-t;
+	check(receiver.receivedCount==callCount && receiver.allEqual, "benchmark packages must be decoded");
+	std::cout << name << ": encode: " << (callCount/encodeTime) << " calls/s (" << (payloadBytes/(1024.0*1024.0*encodeTime)) << " MB/s, " << serial.sendCount << " send calls), decode: " << (callCount/decodeTime) << " calls/s (" << (payloadBytes/(1024.0*1024.0*decodeTime)) << " MB/s)" << std::endl;
+}
+
+static void benchmarkReference(const std::vector<std::vector<uint8_t>>& payloads, uint32_t callCount){
+	std::vector<uint8_t> out;
+	out.reserve(callCount*(payloads[0].size()*2+20));
+	size_t payloadBytes = 0;
+	double t = getSecs();
+	for(uint32_t i=0; i<callCount; i++){
+		const std::vector<uint8_t>& p = payloads[i%payloads.size()];
+		writePackageReference(out, getFunctionID(i), p);
+		payloadBytes += p.size();
+	}
+	t = getSecs()-t;
+	std::cout << "byte-at-a-time reference: encode: " << (callCount/t) << " calls/s (" << (payloadBytes/(1024.0*1024.0*t)) << " MB/s)" << std::endl;
+}
+
+//! one direction of a simulated radio link with limited bandwidth, latency, a limited queue (tail drop) and random loss of sent chunks
+class SimulatedChannel{
+	
+	struct Chunk{
+		double deliveryTime;
+		std::vector<uint8_t> data;
+	};
+	
+	std::deque<Chunk> chunks;
+	size_t readOffset;//in the first chunk
+	double busyUntil;
+	
+	public:
+	
+	double bytesPerSecond;
+	double latency;//s
+	double maxQueueDelay;//s
+	uint32_t lossPercent;
+	uint64_t sentBytes;
+	
+	SimulatedChannel():readOffset(0),busyUntil(0.0),bytesPerSecond(50000.0),latency(0.02),maxQueueDelay(0.2),lossPercent(10),sentBytes(0){}
+	
+	void send(const uint8_t* buf, uint32_t bufSize){
+		double t = getSecs();
+		double start = std::max(t, busyUntil);
+		if(start-t>maxQueueDelay){return;}//queue full
+		sentBytes += bufSize;
+		busyUntil = start+bufSize/bytesPerSecond;
+		if((uint32_t)(rand()%100)<lossPercent){return;}
+		chunks.push_back(Chunk{busyUntil+latency, std::vector<uint8_t>(buf, buf+bufSize)});
+	}
+	
+	//! stream semantics: chunks may be received partially
+	int32_t recv(char* buf, uint32_t bufSize){
+		uint32_t received = 0;
+		double t = getSecs();
+		while(!chunks.empty() && chunks.front().deliveryTime<=t && received<bufSize){
+			std::vector<uint8_t>& data = chunks.front().data;
+			uint32_t n = std::min<size_t>(bufSize-received, data.size()-readOffset);
+			memcpy(buf+received, &(data[readOffset]), n);
+			received += n;
+			readOffset += n;
+			if(readOffset==data.size()){
+				chunks.pop_front();
+				readOffset = 0;
+			}
+		}
+		return received;
+	}
+	
+};
+
+//! one endpoint of a pair of SimulatedChannels
+class SimulatedSerial{
+	
+	public:
+	
+	SimulatedChannel* sendChannel;
+	SimulatedChannel* rcvChannel;
+	
+	bool send(const char* buf, uint32_t bufSize){
+		sendChannel->send((const uint8_t*)buf, bufSize);
+		return true;
+	}
+	
+	int32_t recv(char* buf, uint32_t bufSize){
+		return rcvChannel->recv(buf, bufSize);
+	}
+	
+};
+
+static constexpr uint8_t linkParallelCalls = 32;
+
+//! no coalescing: one radio packet per package
+using LinkRPC = ::UCRPC::UCRPC<uint16_t, SimulatedSerial, maxParameterSize, linkParallelCalls, Functions, 0, SimulatedSerial, 200, 10, 16, 10, 10000/3, 1>;
+
+//! returns the parameter
+class EchoReceiver : public IUCRemoteProcedureCallReceiver<uint16_t, maxParameterSize>{
+	
+	public:
+	
+	void callProcedure(IUCRPC<uint16_t, maxParameterSize>* ucrpc, uint16_t functionID, uint8_t* parameter, uint16_t parameterLength){
+		ucrpc->returnValue(parameter, parameterLength);
+	}
+	
+};
+
+//! plainFunctionID has a higher priority than escapedFunctionID, records the order of the results
+class LinkCaller : public IUCRemoteProcedureCaller{
+	
+	public:
+	
+	uint32_t resultCount;
+	uint32_t errorCount;
+	std::vector<uint32_t> results;
+	
+	LinkCaller():resultCount(0),errorCount(0){}
+	
+	void OnProcedureResult(uint8_t* result, uint16_t resultLength, uint16_t functionID){
+		uint32_t value;
+		if(deserializeResult(result, resultLength, value)){results.push_back(value);}
+		resultCount++;
+	}
+	
+	void OnProcedureError(ProcedureError error, uint16_t functionID){
+		errorCount++;
+	}
+	
+	uint8_t getPriority(uint16_t functionID){
+		return functionID==plainFunctionID?1:0;
+	}
+	
+};
+
+//! window of one call: queued calls must be sent in order of priority
+static void checkPriorities(){
+	SimulatedChannel a, b;
+	a.lossPercent = b.lossPercent = 0;
+	SimulatedSerial clientSerial{&a, &b}, serverSerial{&b, &a};
+	Functions clientFunctions{};
+	EchoReceiver echo;
+	Functions serverFunctions{RegFunc{escapedFunctionID, &echo}, RegFunc{plainFunctionID, &echo}};
+	LinkRPC client(clientSerial, clientFunctions), server(serverSerial, serverFunctions);
+	client.setMaxCallsInFlight(1);
+	LinkCaller caller;
+	for(uint32_t i=0; i<6; i++){
+		client.callRemoteProcedure(i<3?escapedFunctionID:plainFunctionID, i, &caller);
+	}
+	check(client.getStatistics().callsInFlight==1 && client.getStatistics().queuedCallCount==5, "calls exceeding the window must be queued");
+	double t = getSecs();
+	while(caller.resultCount+caller.errorCount<6 && getSecs()-t<5.0){
+		client.update();
+		server.update();
+		delay(1);
+	}
+	check(caller.results==std::vector<uint32_t>({0, 3, 4, 5, 1, 2}), "queued calls must be sent by priority, FIFO for equal priorities");
+}
+
+//! keeps all calls busy for the given time, retryPeriod: fixed or initial in case of adaptive retransmission, returns the completed calls per second
+static double runLossyLink(bool adaptive, uc_time_t retryPeriod, uint32_t lossPercent, double seconds){
+	SimulatedChannel a, b;
+	a.lossPercent = b.lossPercent = lossPercent;
+	SimulatedSerial clientSerial{&a, &b}, serverSerial{&b, &a};
+	Functions clientFunctions{};
+	EchoReceiver echo;
+	Functions serverFunctions{RegFunc{escapedFunctionID, &echo}, RegFunc{plainFunctionID, &echo}};
+	LinkRPC client(clientSerial, clientFunctions), server(serverSerial, serverFunctions);
+	client.setAdaptiveRetransmission(adaptive);
+	client.setRetryParameters(0, retryPeriod);
+	LinkCaller caller;
+	ucstd::array<uint8_t, 128> parameter{};
+	double t = getSecs();
+	while(getSecs()-t<seconds){
+		while(client.hasFreeFunctionCalls()){
+			client.callRemoteProcedure(plainFunctionID, parameter, &caller);
+		}
+		client.update();
+		server.update();
+		delay(1);
+	}
+	t = getSecs()-t;
+	LinkRPC::LinkStatistics stats = client.getStatistics();
+	std::cout << (adaptive?"adaptive":"fixed") << " retransmission (" << retryPeriod << " ms" << (adaptive?" initially":"") << "), " << lossPercent << " % loss: " << (caller.resultCount/t) << " calls/s, retransmissions: " << (100.0*stats.getRetransmissionRate()) << " %, ";
+	std::cout << "rtt: " << (stats.smoothedRTT/1000.0) << " ms (+-" << (stats.rttVariation/1000.0) << ", " << (stats.minRTT/1000.0) << "-" << (stats.maxRTT/1000.0) << "), timeout: " << stats.retransmissionTimeout << " ms, sent: " << (a.sentBytes/1024) << " KiB" << std::endl;
+	check(caller.errorCount==0, "calls must not fail if retried forever");
+	return caller.resultCount/t;
+}
+
+bool runUCRPCBenchmark(){
+	std::vector<std::vector<uint8_t>> payloads = createPayloads(600, 0, maxParameterSize, 5);
+	checkCompatibility<1>(payloads);
+	checkCompatibility<8>(payloads);
+	std::vector<std::vector<uint8_t>> benchmarkPayloads = createPayloads(64, 64, 64, 1);
+	const uint32_t callCount = 500000;
+	benchmarkReference(benchmarkPayloads, callCount);
+	benchmark<1>("UCRPC, 64 byte parameters, no coalescing", benchmarkPayloads, callCount);
+	benchmark<8>("UCRPC, 64 byte parameters, 8 packages coalesced", benchmarkPayloads, callCount);
+	checkPriorities();
+	std::cout << "Simulated radio link: 50 kB/s, 20 ms latency, 32 calls in flight with 128 byte parameters:" << std::endl;
+	for(uint32_t lossPercent : {0, 20}){
+		runLossyLink(false, 30, lossPercent, 2.0);//too short: floods the link with retransmissions
+		runLossyLink(false, 1000, lossPercent, 2.0);//too long: stalls on losses
+		runLossyLink(true, 30, lossPercent, 2.0);
+	}
+	if(errorCount>0){
+		std::cerr << errorCount << " errors" << std::endl;
+		return false;
+	}
+	std::cout << "UCRPC checks passed." << std::endl;
+	return true;
+}
@@ -0,0 +1,8 @@
+#ifndef uCRPCBenchmark_H_INCLUDED
+#define uCRPCBenchmark_H_INCLUDED
+
+//! Checks the wire compatibility of the UCRPC host fast path with the byte-at-a-time encoding, measures the encoding/decoding throughput
+//! and compares fixed and adaptive retransmission over a simulated lossy radio link, returns false on errors
+bool runUCRPCBenchmark();
+
+#endif
@@ -14,12 +14,21 @@
 
 #ifdef MICROCONTROLLER_PLATFORM
 #define UCRPC_DEBUG(MSG)
+#define UCRPC_DEFAULT_COALESCED_PACKAGE_COUNT 1
 #else
 #include <misc.h>
 #include <string>
 #include <iostream>
 #include <functional>
+#include <cstring>
 #define UCRPC_DEBUG(MSG) std::cerr << MSG << std::endl;
+//! host side: escaping/unescaping scans multiple bytes at a time, CRC32 uses slicing by 8 (see updateCRC32Buffer)
+#define UCRPC_FAST_PATH
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=2)
+#define UCRPC_USE_SSE2
+#include <emmintrin.h>
+#endif
+#define UCRPC_DEFAULT_COALESCED_PACKAGE_COUNT 8
 #endif
 
 namespace UCRPC{
@@ -419,6 +428,11 @@ namespace UCRPC{
 		
 		virtual void OnProcedureError(ProcedureError error, uint16_t functionID) = 0;
 		
+		//! calls with higher priority are sent first if the window of calls in flight is full (see UCRPC::setMaxCallsInFlight)
+		virtual uint8_t getPriority(uint16_t functionID){
+			return 0;
+		}
+		
 	};
 	
 	//! Interface to provide a way to return values at runtime
@@ -468,6 +482,36 @@ namespace UCRPC{
 		bool operator<(const RegisteredFunction& other) const{return functionID < other.functionID;}
 	};
 	
+	#ifdef UCRPC_FAST_PATH
+	
+	//! true if any byte of w equals the byte repeated in pattern
+	inline bool hasByte(uint64_t w, uint64_t pattern){
+		uint64_t x = w ^ pattern;
+		return ((x - 0x0101010101010101ULL) & ~x & 0x8080808080808080ULL) != 0;
+	}
+	
+	//! returns the index of the first byte which equals a or b, length if there is none
+	template <typename TIndex>
+	TIndex findFirstOf(const uint8_t* data, TIndex length, uint8_t a, uint8_t b){
+		TIndex i = 0;
+		#ifdef UCRPC_USE_SSE2
+		__m128i va = _mm_set1_epi8((char)a), vb = _mm_set1_epi8((char)b);
+		for(; i+16<=length; i+=16){
+			__m128i v = _mm_loadu_si128((const __m128i*)&(data[i]));
+			if(_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)))!=0){break;}
+		}
+		#endif
+		uint64_t pa = 0x0101010101010101ULL*a, pb = 0x0101010101010101ULL*b;
+		for(; i+8<=length; i+=8){
+			uint64_t w; memcpy(&w, &(data[i]), 8);
+			if(hasByte(w, pa) || hasByte(w, pb)){break;}
+		}
+		for(; i<length && data[i]!=a && data[i]!=b; i++){}
+		return i;
+	}
+	
+	#endif
+	
 	static constexpr uint16_t getAdditionalRetryPeriod(uint16_t i){
 		return 1 << (i%6);//0..32ms
 	}
@@ -476,7 +520,7 @@ namespace UCRPC{
 	//! TSerial must not block during receive or send. If data cannot be send they shall be discarded.
 	//! maxParameterSize: max. amount of bytes of the largest parameters data (see callProcedure) and the largest return value
 	//! minBufferFillToSend: how many bytes must be there before a message is sent (optimum for USB/VCP in case of a STM32 is 16-32 bytes)
-	//! maxSimultaneousFunctionCalls: should be a small number to save space in case of microcontrollers, in case of a PC it may be large
+	//! maxSimultaneousFunctionCalls: should be a small number to save space in case of microcontrollers, in case of a PC it may be large (limited to 127)
 	//! retryPeriod: time in ms after which a function call is retried (+ some offset to avoid simultanous sending)
 	//! for compatibility between different API versions new functions have to be introduced, optional fields are not possible
 	//! sendPeriod time in ms after which a package is sent regardless if the accumulated size is optimal
@@ -484,7 +528,8 @@ namespace UCRPC{
 	//! maxSendBytesBeforeReceive: (useful from host perspective) max amount of bytes which can be sent before a receive (excess bytes are discarded), 0 disables this feature. On some STM32 microcontrollers the USB receive buffer must not be fully filled (deadlock, freeze). In this case maxSendBytesBeforeReceive should be around half the USB receive buffer.
 	//! maxSendReceiveTimeUS: time in us after which sending/receiving is paused to yield to other "tasks" (manual scheduling), there are two read tasks (without second serial one) and one send task in the update function  (worst case delay is 3*maxSendReceiveTimeUS)
 	//! retryCount: if 0 retries calls forever
-	template <typename TIndex, typename TSerial, TIndex maxParameterSize, uint8_t maxParallelFunctionCalls, typename TRegisteredFunctions, uint16_t maxSendBytesBeforeReceive = 0, typename TSecondarySerial = TSerial, uc_time_t initialRetryPeriod = 200, uint8_t initialRetryCount = 10, uint16_t minBufferFillToSend = 16, uc_time_t sendPeriod = 10, uc_time_t maxSendReceiveTimeUS = 10000/3>
+	//! coalescedPackageCount: if >1 the send buffer holds this amount of largest packages and packages are only sent if the next one may not fit or in update/flush (less serial.send calls on hosts), 1: packages are sent depending on minBufferFillToSend (default for microcontrollers), see isCoalescing
+	template <typename TIndex, typename TSerial, TIndex maxParameterSize, uint8_t maxParallelFunctionCalls, typename TRegisteredFunctions, uint16_t maxSendBytesBeforeReceive = 0, typename TSecondarySerial = TSerial, uc_time_t initialRetryPeriod = 200, uint8_t initialRetryCount = 10, uint16_t minBufferFillToSend = 16, uc_time_t sendPeriod = 10, uc_time_t maxSendReceiveTimeUS = 10000/3, uint8_t coalescedPackageCount = UCRPC_DEFAULT_COALESCED_PACKAGE_COUNT>
 	class UCRPC : public IUCRPC<TIndex, maxParameterSize>{
 
 		public:
@@ -496,6 +541,11 @@ namespace UCRPC{
 		
 		static constexpr TIndex bufferSize = getMaxPackageSize(maxParameterSize);
 		
+		//! no coalescing if maxSendBytesBeforeReceive is used (large chunks would be discarded) or if coalescedPackageCount*bufferSize does not fit into TIndex
+		static constexpr bool isCoalescing = coalescedPackageCount>1 && maxSendBytesBeforeReceive==0 && (TIndex)(bufferSize*coalescedPackageCount)/coalescedPackageCount==bufferSize;
+		
+		static constexpr TIndex sendBufferSize = isCoalescing?(TIndex)(bufferSize*coalescedPackageCount):bufferSize;
+		
 		private:
 
 		static constexpr uint8_t delimeter = 0b10101010;
@@ -506,7 +556,7 @@ namespace UCRPC{
 		TSerial& serial;
 		TSecondarySerial* secondarySerial;
 		
-		uint8_t sendBuffer[bufferSize];
+		uint8_t sendBuffer[sendBufferSize];
 		TIndex sendBufferOffset;
 		
 		uint8_t rcvBuffer[bufferSize];
@@ -517,63 +567,144 @@ namespace UCRPC{
 		
 		struct Call{
 			uint16_t functionID;
-			uint8_t uniqueID;//0: no unique id / result irrelevant
+			uint8_t uniqueID;//0: no unique id / result irrelevant / unused call
 			IUCRemoteProcedureCaller* caller;
 			uint8_t parameter[maxParameterSize];
 			TIndex usedParameterSpace;
 			uc_time_t lastSendTime;
-			uint8_t sendCount;
+			uc_time_t firstSendTimeUS;//for round trip time measurement
+			uint8_t sendCount;//0: queued (not sent yet)
+			uint8_t priority;
+			uint8_t generation;//part of uniqueID to distinguish subsequent calls in the same slot
 		};
 		
-		Call calls[maxParallelFunctionCalls];
-		Call* callPtrs[maxParallelFunctionCalls];//allows re-sorting without copying if function returns
+		//! uids 1..255 are composed of slot index and generation, at most 127 slots so that each slot has at least 2 generations (a late reply must not match the next call in the same slot)
+		static constexpr uint8_t callSlotCount = maxParallelFunctionCalls>127?127:maxParallelFunctionCalls;
+		
+		Call calls[callSlotCount];
+		Call* callPtrs[callSlotCount];//[0, callPtrIndex): active calls in order of creation, others: unused
 		uint8_t callPtrIndex;//index of the next available call
+		uint8_t callsInFlight;//active calls which have been sent at least once
 		
 		uint16_t bytesSentBeforeReceive;
 		
 		void erase(Call* c){
 			for(uint8_t i=0; i<callPtrIndex; i++){
 				if(callPtrs[i]==c){
+					for(uint8_t j=i+1; j<callPtrIndex; j++){//keep order for FIFO sending of queued calls
+						callPtrs[j-1] = callPtrs[j];
+					}
 					callPtrIndex--;
-					Call* tmp = callPtrs[i];
-					callPtrs[i] = callPtrs[callPtrIndex];
-					callPtrs[callPtrIndex] = tmp;
+					callPtrs[callPtrIndex] = c;
+					if(c->sendCount>0){callsInFlight--;}
+					c->uniqueID = 0;
 					return;
 				}
 			}
 		}
 		
+		static_assert(maxParallelFunctionCalls>0, "At least one function call required");
+		
+		static constexpr uint8_t uidGenerationCount = 255/callSlotCount;
+		
+		//! O(1) since the uid contains the slot index
 		Call* findCall(uint8_t uniqueID){
-			for(uint8_t i=0; i<callPtrIndex; i++){
-				if(callPtrs[i]->uniqueID==uniqueID){
-					return callPtrs[i];
-				}
-			}
-			return nullptr;
+			if(uniqueID==0){return nullptr;}
+			Call* c = &(calls[(uniqueID-1)%callSlotCount]);
+			return c->uniqueID==uniqueID?c:nullptr;
 		}
 		
-		uint8_t uidCounter;
-		
 		uint8_t retryCount;
 		uint32_t retryPeriod;
 		
-		uint8_t getUnusedUID(){
-			bool used = true;
-			while(used){
-				uidCounter++;
-				if(uidCounter==0){uidCounter++;}//don't use 0 => signals no return
-				bool notFound = true;
-				for(uint8_t i=0; notFound && i<callPtrIndex; i++){
-					notFound = callPtrs[i]->uniqueID != uidCounter;
-				}
-				used = !notFound;
+		uint8_t createUID(Call* c){
+			c->generation = (c->generation+1)%uidGenerationCount;
+			return 1+(c-calls)+c->generation*callSlotCount;
+		}
+		
+		bool adaptiveRetransmission;
+		uc_time_t minRetryPeriod;
+		uc_time_t maxRetryPeriod;
+		uint32_t smoothedRTT;//us
+		uint32_t rttVariation;//us
+		uc_time_t retransmissionTimeout;//ms
+		uc_time_t lastTimeoutBackoff;
+		uint8_t maxCallsInFlight;
+		
+		public:
+		
+		struct LinkStatistics{
+			uint32_t callCount;//! calls with caller which have been sent at least once
+			uint32_t retransmissionCount;
+			uint32_t resultCount;//! received results and errors
+			uint32_t timeoutCount;
+			uint32_t rttSampleCount;//! only calls without retransmission are sampled
+			uint32_t smoothedRTT;//! us
+			uint32_t rttVariation;//! us
+			uint32_t minRTT;//! us
+			uint32_t maxRTT;//! us
+			uc_time_t retransmissionTimeout;//! ms, before backoff
+			uint8_t callsInFlight;
+			uint8_t queuedCallCount;
+			
+			//! ratio of retransmissions to all sent call packages
+			float getRetransmissionRate() const{
+				return (callCount+retransmissionCount)==0?0.f:(float)retransmissionCount/(callCount+retransmissionCount);
+			}
+		};
+		
+		private:
+		
+		LinkStatistics stats;
+		
+		//! Jacobson/Karels estimation: timeout = smoothed rtt + 4 * rtt variation
+		void addRTTSample(uint32_t rtt){
+			if(stats.rttSampleCount==0){
+				smoothedRTT = rtt;
+				rttVariation = rtt/2;
+				stats.minRTT = stats.maxRTT = rtt;
+			}else{
+				int32_t error = (int32_t)(rtt-smoothedRTT);
+				smoothedRTT = (uint32_t)((int32_t)smoothedRTT+error/8);
+				uint32_t absError = error<0?-error:error;
+				rttVariation = (uint32_t)((int32_t)rttVariation+((int32_t)(absError-rttVariation))/4);
+				if(rtt<stats.minRTT){stats.minRTT = rtt;}
+				if(rtt>stats.maxRTT){stats.maxRTT = rtt;}
+			}
+			stats.rttSampleCount++;
+			uc_time_t timeout = (smoothedRTT+4*rttVariation)/1000+1;
+			retransmissionTimeout = timeout<minRetryPeriod?minRetryPeriod:(timeout>maxRetryPeriod?maxRetryPeriod:timeout);
+		}
+		
+		//! time after the last send until a call is sent again, exponential backoff in case of adaptive retransmission
+		uc_time_t getRetryTimeout(const Call* c) const{
+			if(!adaptiveRetransmission){return retryPeriod;}
+			uint8_t backoff = c->sendCount>1?c->sendCount-1:0;
+			uint32_t timeout = (uint32_t)retransmissionTimeout << (backoff>6?6:backoff);
+			return timeout>maxRetryPeriod?maxRetryPeriod:timeout;
+		}
+		
+		void onResult(Call* c){
+			stats.resultCount++;
+			if(c->sendCount==1){//Karn's algorithm: ambiguous if retransmitted
+				addRTTSample(calcTimeDifference((uc_time_t)micros(), c->firstSendTimeUS));
 			}
-			return uidCounter;
 		}
 		
 		// returns false if erased
 		bool resendCall(Call* c, uc_time_t t){
 			if(c->sendCount<retryCount || retryCount==0){
+				if(c->sendCount==0){
+					callsInFlight++;
+					stats.callCount++;
+					c->firstSendTimeUS = micros();
+				}else{
+					stats.retransmissionCount++;
+					if(adaptiveRetransmission && calcTimeDifference(t, lastTimeoutBackoff)>=retransmissionTimeout){//keep the backoff for new calls (at most once per timeout), otherwise there may be no valid rtt samples if the timeout is too short
+						retransmissionTimeout = 2*retransmissionTimeout>maxRetryPeriod?maxRetryPeriod:2*retransmissionTimeout;
+						lastTimeoutBackoff = t;
+					}
+				}
 				c->sendCount++;
 				c->lastSendTime = t;
 				if(!writeFunctionPackage(c->functionID, c->uniqueID, c->parameter, c->usedParameterSpace, true)){
@@ -583,12 +714,40 @@ namespace UCRPC{
 				}
 				return true;
 			}else{
+				stats.timeoutCount++;
 				c->caller->OnProcedureError(IUCRemoteProcedureCaller::TIMEOUT, c->functionID);
 				erase(c);
 				return false;
 			}
 		}
 		
+		//! sends queued calls with the highest priority first (FIFO for equal priority) as long as the window allows
+		void sendQueuedCalls(uc_time_t t){
+			while(callsInFlight<maxCallsInFlight){
+				Call* next = nullptr;
+				for(uint8_t i=0; i<callPtrIndex; i++){
+					Call* c = callPtrs[i];
+					if(c->sendCount==0 && (next==nullptr || c->priority>next->priority)){next = c;}
+				}
+				if(next==nullptr){return;}
+				resendCall(next, t);
+			}
+		}
+		
+		//! returns the new call or nullptr if no free call is available
+		Call* createCall(uint16_t functionID, IUCRemoteProcedureCaller* caller){
+			if(callPtrIndex>=callSlotCount){return nullptr;}
+			Call* c = callPtrs[callPtrIndex];
+			callPtrIndex++;
+			c->functionID = functionID;
+			c->uniqueID = createUID(c);
+			c->caller = caller;
+			c->usedParameterSpace = 0;
+			c->sendCount = 0;
+			c->priority = caller->getPriority(functionID);
+			return c;
+		}
+		
 		void writeDelimeter(){
 			sendBuffer[sendBufferOffset] = delimeter;
 			sendBufferOffset++;
@@ -596,6 +755,24 @@ namespace UCRPC{
 		
 		//to sendbuffer, returns updated crc32
 		uint32_t writeEscaped(uint8_t* data, TIndex length, uint32_t crc32){
+			#ifdef UCRPC_FAST_PATH
+			crc32 = updateCRC32Buffer(data, length, crc32);
+			TIndex i = 0;
+			while(i<length){
+				TIndex run = findFirstOf<TIndex>(&(data[i]), length-i, delimeter, escape);
+				memcpy(&(sendBuffer[sendBufferOffset]), &(data[i]), run);
+				sendBufferOffset += run;
+				i += run;
+				if(i<length){
+					sendBuffer[sendBufferOffset] = escape;
+					sendBufferOffset++;
+					sendBuffer[sendBufferOffset] = ~data[i];
+					sendBufferOffset++;
+					i++;
+				}
+			}
+			return crc32;
+			#else
 			for(TIndex i=0; i<length; i++){
 				uint8_t d = data[i];
 				crc32 = UPDC32(d, crc32);
@@ -610,6 +787,7 @@ namespace UCRPC{
 				}
 			}
 			return crc32;
+			#endif
 		}
 		
 		//to sendbuffer
@@ -625,7 +803,7 @@ namespace UCRPC{
 			TIndex required = getMaxPackageSize(length);
 			if(required>bufferSize){
 				return false;
-			}else if(required>bufferSize-sendBufferOffset){
+			}else if(required>sendBufferSize-sendBufferOffset){
 				send(true);
 			}
 			writeDelimeter();
@@ -636,12 +814,20 @@ namespace UCRPC{
 			ENDCRC32(crc32)
 			writeEscapedScalar<uint32_t>(crc32, 0);
 			writeDelimeter();
-			if(forceSend || sendBufferOffset>minBufferFillToSend){
+			if(isSendRequired(forceSend)){
 				send(true);
 			}
 			return true;
 		}
 		
+		//! after a package has been written
+		bool isSendRequired(bool forceSend) const{
+			if(isCoalescing){
+				return sendBufferSize-sendBufferOffset<bufferSize;
+			}
+			return forceSend || sendBufferOffset>minBufferFillToSend;
+		}
+		
 		void send(bool force = false){
 			if(force || maxSendBytesBeforeReceive==0 || maxSendBytesBeforeReceive-bytesSentBeforeReceive>=sendBufferOffset){
 				serial.send((const char*)sendBuffer, sendBufferOffset);
@@ -652,6 +838,24 @@ namespace UCRPC{
 		
 		//! returns new length, crc32: crc32 to update
 		static TIndex unescapeInPlace(uint8_t* data, TIndex length){
+			#ifdef UCRPC_FAST_PATH
+			TIndex i = 0, j = 0;
+			while(i<length){
+				TIndex run = findFirstOf<TIndex>(&(data[i]), length-i, escape, escape);
+				if(i!=j){memmove(&(data[j]), &(data[i]), run);}
+				i += run;
+				j += run;
+				if(i<length){//skip escape
+					i++;
+					if(i<length){
+						data[j] = ~data[i];
+						j++;
+						i++;
+					}
+				}
+			}
+			return j;
+			#else
 			bool isEscaped = false;
 			TIndex j = 0;
 			for(TIndex i=0; i<length; i++){
@@ -669,19 +873,30 @@ namespace UCRPC{
 				}
 			}
 			return j;
+			#endif
 		}
 		
 		static uint32_t updateCRC(uint8_t* data, TIndex length, uint32_t crc32){
+			#ifdef UCRPC_FAST_PATH
+			return updateCRC32Buffer(data, length, crc32);
+			#else
 			for(TIndex i=0; i<length; i++){
 				crc32 = UPDC32(data[i], crc32);
 			}
 			return crc32;
+			#endif
 		}
 		
 		//from buffer, crc32: crc32 to update
 		template <typename TScalar>
 		static TScalar readEscapedScalar(uint8_t* buffer, TIndex length, TIndex& offset, uint32_t& crc32){
-			uint8_t tmp[sizeof(TScalar)];
+			#ifdef UCRPC_FAST_PATH
+			if(offset<=length && (size_t)(length-offset)>=sizeof(TScalar) && findFirstOf<TIndex>(&(buffer[offset]), sizeof(TScalar), escape, escape)==sizeof(TScalar)){//not escaped
+				crc32 = updateCRC32Buffer(&(buffer[offset]), sizeof(TScalar), crc32);
+				return readLittleEndian<TScalar>(buffer, offset);
+			}
+			#endif
+			uint8_t tmp[sizeof(TScalar)] = {0};//not completely written if the package is truncated
 			bool isEscaped = false;
 			TIndex j=0;
 			for(; offset<length && j<sizeof(TScalar); offset++){
@@ -716,20 +931,67 @@ namespace UCRPC{
 		using MappedIndex = TIndex;
 		static constexpr TIndex MappedMaxParameterSize = maxParameterSize;
 		
-		UCRPC(TSerial& serial, TRegisteredFunctions& functions):serial(serial),secondarySerial(NULL),sendBufferOffset(0),rcvBufferOffset(0),fwdBufferOffset(0),callPtrIndex(0),bytesSentBeforeReceive(0),uidCounter(0),functions(functions),hasLastFunction(false),lastSendTime(0){
+		UCRPC(TSerial& serial, TRegisteredFunctions& functions):serial(serial),secondarySerial(NULL),sendBufferOffset(0),rcvBufferOffset(0),fwdBufferOffset(0),callPtrIndex(0),callsInFlight(0),bytesSentBeforeReceive(0),functions(functions),hasLastFunction(false),lastSendTime(0){
 			retryCount = initialRetryCount;
 			retryPeriod = initialRetryPeriod;
+			adaptiveRetransmission = true;
+			minRetryPeriod = 20;
+			maxRetryPeriod = 5000;
+			retransmissionTimeout = retryPeriod;
+			lastTimeoutBackoff = 0;
+			maxCallsInFlight = callSlotCount;
+			stats.rttSampleCount = 0;
+			resetStatistics();
 			functions.sort();
-			for(uint8_t i=0; i<maxParallelFunctionCalls; i++){
+			for(uint8_t i=0; i<callSlotCount; i++){
 				callPtrs[i] = &(calls[i]);
+				calls[i].uniqueID = 0;
+				calls[i].generation = 0;
 			}
 		}
 		
 		//! 0: retries calls forever
-		//! retryPeriod: used for timeout (fail) and resend
+		//! retryPeriod: used for timeout (fail) and resend, initial retry period in case of adaptive retransmission (until the round trip time has been measured)
 		void setRetryParameters(uint8_t retryCount = initialRetryCount, uc_time_t retryPeriod = initialRetryPeriod){
 			this->retryCount = retryCount;
 			this->retryPeriod = retryPeriod;
+			if(stats.rttSampleCount==0){retransmissionTimeout = retryPeriod;}
+		}
+		
+		//! enabled (default): the retry period is estimated from the measured round trip times (smoothed rtt + 4 * rtt variation clamped to [minRetryPeriod, maxRetryPeriod]) and doubled with each retry of a call (exponential backoff)
+		//! disabled: calls are retried after the fixed retryPeriod
+		void setAdaptiveRetransmission(bool enabled, uc_time_t minRetryPeriod = 20, uc_time_t maxRetryPeriod = 5000){
+			adaptiveRetransmission = enabled;
+			this->minRetryPeriod = minRetryPeriod;
+			this->maxRetryPeriod = maxRetryPeriod;
+		}
+		
+		//! max amount of calls which have been sent but not returned (at most maxParallelFunctionCalls, at most 127), further calls are queued and sent in order of priority (see IUCRemoteProcedureCaller::getPriority)
+		void setMaxCallsInFlight(uint8_t count){
+			maxCallsInFlight = count==0?1:(count>callSlotCount?callSlotCount:count);
+			sendQueuedCalls(millis());
+		}
+		
+		uint8_t getMaxCallsInFlight() const{
+			return maxCallsInFlight;
+		}
+		
+		LinkStatistics getStatistics() const{
+			LinkStatistics res = stats;
+			res.smoothedRTT = smoothedRTT;
+			res.rttVariation = rttVariation;
+			res.retransmissionTimeout = adaptiveRetransmission?retransmissionTimeout:retryPeriod;
+			res.callsInFlight = callsInFlight;
+			res.queuedCallCount = callPtrIndex-callsInFlight;
+			return res;
+		}
+		
+		//! the round trip time estimation is kept
+		void resetStatistics(){
+			uint32_t rttSampleCount = stats.rttSampleCount;
+			memset(&stats, 0, sizeof(stats));
+			stats.rttSampleCount = rttSampleCount;
+			if(rttSampleCount==0){smoothedRTT = rttVariation = 0;}
 		}
 		
 		uint8_t getRetryCount() const{
@@ -752,16 +1014,10 @@ namespace UCRPC{
 			constexpr TIndex spaceReq = getSpaceRequirement<TParameter, TIndex>();
 			static_assert(spaceReq<=maxParameterSize, "Sendbuffer too small");
 			if(caller){
-				if(callPtrIndex<maxParallelFunctionCalls){
-					Call* toFill = callPtrs[callPtrIndex];
-					callPtrIndex++;
-					toFill->functionID = functionID;
-					toFill->uniqueID = getUnusedUID();
-					toFill->caller = caller;
-					toFill->usedParameterSpace = 0;
+				Call* toFill = createCall(functionID, caller);
+				if(toFill){
 					serialize(toFill->parameter, toFill->usedParameterSpace, parameter);
-					toFill->sendCount = 0;
-					resendCall(toFill, millis());
+					sendQueuedCalls(millis());
 				}else{
 					caller->OnProcedureError(IUCRemoteProcedureCaller::NO_FREE_FUNCTION_CALLS, functionID);
 				}
@@ -781,18 +1037,12 @@ namespace UCRPC{
 		
 		//! with raw data but with caller for return values / error handling
 		void callRemoteProcedure(uint16_t functionID, uint8_t* data, TIndex length, IUCRemoteProcedureCaller* caller){
-			if(callPtrIndex<maxParallelFunctionCalls){
+			if(callPtrIndex<callSlotCount){
 				if(length<=maxParameterSize){
-					Call* toFill = callPtrs[callPtrIndex];
-					callPtrIndex++;
-					toFill->functionID = functionID;
-					toFill->uniqueID = getUnusedUID();
-					toFill->caller = caller;
-					toFill->usedParameterSpace = 0;
+					Call* toFill = createCall(functionID, caller);
 					memcpy(toFill->parameter, data, length);
 					toFill->usedParameterSpace = length;
-					toFill->sendCount = 0;
-					resendCall(toFill, millis());
+					sendQueuedCalls(millis());
 				}else{
 					caller->OnProcedureError(IUCRemoteProcedureCaller::SENDBUFFER_TOO_SMALL, functionID);
 				}
@@ -828,7 +1078,7 @@ namespace UCRPC{
 				ENDCRC32(crc32)
 				writeEscapedScalar<uint32_t>(crc32, 0);
 				writeDelimeter();
-				if(sendBufferOffset>minBufferFillToSend){
+				if(isSendRequired(false)){
 					send();
 				}
 				hasLastFunction = false;
@@ -837,7 +1087,7 @@ namespace UCRPC{
 		
 		//! can be used to check if a function call would fail
 		bool hasFreeFunctionCalls() const{
-			return callPtrIndex<maxParallelFunctionCalls;
+			return callPtrIndex<callSlotCount;
 		}
 		
 		void flush(){
@@ -936,14 +1186,15 @@ namespace UCRPC{
 			uint8_t i=0;
 			while(i<callPtrIndex && calcTimeDifference(micros(), startT)<maxSendReceiveTimeUS){//for(uc_time_t startT = micros(); i<callPtrIndex && calcTimeDifference(micros(), startT)<maxSendReceiveTimeUS;){//
 				Call* c = callPtrs[i];
-				if(calcTimeDifference(t, c->lastSendTime)>=retryPeriod+getAdditionalRetryPeriod(i)){
+				if(c->sendCount>0 && calcTimeDifference(t, c->lastSendTime)>=getRetryTimeout(c)+getAdditionalRetryPeriod(i)){
 					if(resendCall(c, t)){i++;}
 				}else{
 					i++;
 				}
-			} 
-			//send buffer if optimal or necessary:
-			if(sendBufferOffset>minBufferFillToSend || (sendBufferOffset>0 && calcTimeDifference(t,lastSendTime)>sendPeriod)){
+			}
+			sendQueuedCalls(t);
+			//send buffer if optimal or necessary (coalesced packages are sent at the latest here):
+			if(sendBufferOffset>minBufferFillToSend || (sendBufferOffset>0 && (isCoalescing || calcTimeDifference(t,lastSendTime)>sendPeriod))){
 				send();
 				lastSendTime = t;
 			}
@@ -968,15 +1219,19 @@ namespace UCRPC{
 						if((lastFunctionID & returnFlag) != 0){//return value read
 							Call* c = findCall(lastUid);
 							if(c){
+								onResult(c);
 								c->caller->OnProcedureResult(&(buffer[offset]), newLength-4, lastFunctionID & ~returnFlag);
 								erase(c);
+								sendQueuedCalls(millis());
 							}
 						}else if((lastFunctionID & errorFlag) != 0){//return error read
 							Call* c = findCall(lastUid);
 							if(c && newLength>=5){//crc+error
+								onResult(c);
 								uint8_t error = buffer[offset];
 								c->caller->OnProcedureError((IUCRemoteProcedureCaller::ProcedureError)error, lastFunctionID & ~errorFlag);
 								erase(c);
+								sendQueuedCalls(millis());
 							}else{
 								UCRPC_DEBUG((c==NULL?"uid not found":"Error code missing in error package."))
 							}